@@ -0,0 +1,34 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+#pragma once
+#include "pixel_format.h"
+
+#include <PVRTexture.h>
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+
+// Texture sizes that benchmarks of whole textures run at
+#define TEXTURE_SIZES ->Arg(256)->Arg(1024)->Arg(4096)
+
+// Deterministic synthetic texture: smooth gradients and rings with a little hashed noise, so that compressors see
+// flat as well as detailed blocks. Same arguments always give the same texels. Supported formats are RGBA8888 and RGBA32323232
+pvrtexture::CPVRTexture* MakeTexture(uint32_t width, uint32_t height, uint64_t format = RGBA8888,
+                                     EPVRTVariableType channel_type = ePVRTVarTypeUnsignedByteNorm,
+                                     EPVRTColourSpace colour_space = ePVRTCSpacelRGB);
+
+// Reports texels of the top level per second as items and its bytes per second as bytes
+void SetProcessed(benchmark::State& state, const pvrtexture::CPVRTextureHeader& header);
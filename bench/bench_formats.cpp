@@ -0,0 +1,134 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+#include "bench.h"
+#include "swizzle.h"
+#include "storage.h"
+#include "common.h"
+
+#include <memory>
+#include <vector>
+
+
+// Pixel format strings and ids
+
+static void BM_ParseType(benchmark::State& state)
+{
+	const char* formats[] = {"rgba8888", "RGB565", "bgra8888", "rg1616", "r32", "rgba32323232", "la88", "rgb101010"};
+	for (auto _: state)
+	{
+		for (const char* format: formats)
+		{
+			benchmark::DoNotOptimize(parseType(format));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * 8);
+}
+BENCHMARK(BM_ParseType);
+
+static void BM_DecodePixelType(benchmark::State& state)
+{
+	const uint64_t formats[] = {RGBA8888, RGB565, RGBA32323232, RGB888, BC7, ETC2_RGBA};
+	for (auto _: state)
+	{
+		for (uint64_t format: formats)
+		{
+			benchmark::DoNotOptimize(DecodePixelType(format));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * 6);
+}
+BENCHMARK(BM_DecodePixelType);
+
+
+// from_numpy. With copy, the array goes through CopyChannels: an [H, W, 3] uint8 array becomes RGBA8888 with alpha filled.
+// Without copy, the texture borrows the memory of the array
+
+static void BM_FromNumpyCopy(benchmark::State& state)
+{
+	const uint32_t size = (uint32_t)state.range(0);
+	std::vector<uint8_t> array((size_t)size * size * 3);
+	for (size_t i = 0; i < array.size(); ++i)
+	{
+		array[i] = (uint8_t)(i * 7u);
+	}
+	StridedImage src;
+	src.data = array.data();
+	src.channels = 3;
+	src.shape[0] = 1;
+	src.shape[1] = size;
+	src.shape[2] = size;
+	src.strides[0] = 0;
+	src.strides[1] = (ptrdiff_t)size * 3;
+	src.strides[2] = 3;
+	src.strides[3] = 1;
+	const int map[4] = {0, 1, 2, -1};
+	const uint8_t fill[4] = {0, 0, 0, 255};
+	pvrtexture::CPVRTextureHeader header(RGBA8888, size, size);
+	for (auto _: state)
+	{
+		pvrtexture::CPVRTexture texture(header);
+		CopyChannels(src, 1, (uint8_t*)texture.getDataPtr(), 4, map, fill);
+		benchmark::ClobberMemory();
+	}
+	SetProcessed(state, header);
+}
+BENCHMARK(BM_FromNumpyCopy) TEXTURE_SIZES;
+
+static void BM_FromNumpyBorrow(benchmark::State& state)
+{
+	const uint32_t size = (uint32_t)state.range(0);
+	std::vector<uint8_t> array((size_t)size * size * 4);
+	pvrtexture::CPVRTextureHeader header(RGBA8888, size, size);
+	for (auto _: state)
+	{
+		TextureHolder texture(new pvrtexture::CPVRTexture());
+		static_cast<pvrtexture::CPVRTextureHeader&>(*texture) = header;
+		BorrowData(*texture, array.data(), py::none());
+		benchmark::DoNotOptimize(texture->getDataPtr());
+	}
+	SetProcessed(state, header);
+}
+BENCHMARK(BM_FromNumpyBorrow) TEXTURE_SIZES;
+
+
+// open_view. A read-only view only locates the surface, a writable view of a shared copy also makes the data unique
+
+static void BM_OpenViewReadOnly(benchmark::State& state)
+{
+	std::unique_ptr<pvrtexture::CPVRTexture> texture(MakeTexture((uint32_t)state.range(0), (uint32_t)state.range(0)));
+	for (auto _: state)
+	{
+		benchmark::DoNotOptimize(GetSurfacePtr(*texture, 0, 0, 0));
+		benchmark::DoNotOptimize(IsBorrowed(*texture));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_OpenViewReadOnly)->Arg(256);
+
+static void BM_OpenViewWritableCopy(benchmark::State& state)
+{
+	TextureHolder texture(MakeTexture((uint32_t)state.range(0), (uint32_t)state.range(0)));
+	for (auto _: state)
+	{
+		TextureHolder copy(new pvrtexture::CPVRTexture());
+		static_cast<pvrtexture::CPVRTextureHeader&>(*copy) = *texture;
+		ShareData(*copy, *texture);
+		MakeUnique(*copy);
+		MarkExposed(*copy);
+		benchmark::DoNotOptimize(GetSurfacePtr(*copy, 0, 0, 0));
+	}
+	SetProcessed(state, *texture);
+}
+BENCHMARK(BM_OpenViewWritableCopy) TEXTURE_SIZES;
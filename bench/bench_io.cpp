@@ -0,0 +1,113 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+#include "bench.h"
+#include "memory_stream.h"
+#include "container.h"
+#include "common.h"
+
+#include <PVRTextureUtilities.h>
+
+#include <memory>
+#include <vector>
+
+
+// Saving and loading of containers, in memory so that disk speed does not show up in the results.
+// Textures have the full mip chain
+
+namespace
+{
+	enum BenchContainer
+	{
+		BenchPVR,
+		BenchDDS,
+		BenchKTX
+	};
+
+	pvrtexture::CPVRTexture* MakeMipmappedTexture(uint32_t size)
+	{
+		pvrtexture::CPVRTexture* texture = MakeTexture(size, size);
+		if (!pvrtexture::GenerateMIPMaps(*texture, pvrtexture::eResizeLinear))
+		{
+			throw runtime_error("Failed to generate mipmaps");
+		}
+		return texture;
+	}
+
+	size_t FileSizeBound(const pvrtexture::CPVRTexture& texture, BenchContainer container)
+	{
+		switch (container)
+		{
+			case BenchPVR: return GetPVRFileSizeBound(texture);
+			case BenchDDS: return GetDDSFileSizeBound(texture);
+			// KTX adds its own header, key-value data and a size field per mip level to the texture data
+			case BenchKTX: return GetPVRFileSizeBound(texture) + 4096;
+		}
+		return 0;
+	}
+
+	size_t Save(const pvrtexture::CPVRTexture& texture, BenchContainer container, std::vector<uint8_t>& buffer)
+	{
+		switch (container)
+		{
+			case BenchPVR: return SaveToMemory(texture, ContainerPVR, buffer.data(), buffer.size() - 1);
+			case BenchDDS: return SaveToMemory(texture, ContainerDDS, buffer.data(), buffer.size() - 1);
+			case BenchKTX: return SaveToMemory(texture, &pvrtexture::CPVRTexture::privateSaveKTXFile, buffer.data(), buffer.size() - 1);
+		}
+		return 0;
+	}
+
+	pvrtexture::CPVRTexture* Load(const std::vector<uint8_t>& buffer, size_t size, BenchContainer container)
+	{
+		switch (container)
+		{
+			case BenchPVR: return LoadPVRFromMemory(buffer.data(), size);
+			case BenchDDS: return LoadFromMemory(&pvrtexture::CPVRTexture::privateLoadDDSFile, buffer.data(), size);
+			case BenchKTX: return LoadFromMemory(&pvrtexture::CPVRTexture::privateLoadKTXFile, buffer.data(), size);
+		}
+		return nullptr;
+	}
+}
+
+
+static void BM_Save(benchmark::State& state, BenchContainer container)
+{
+	std::unique_ptr<pvrtexture::CPVRTexture> texture(MakeMipmappedTexture((uint32_t)state.range(0)));
+	// one byte more for the terminating null of the memory stream
+	std::vector<uint8_t> buffer(FileSizeBound(*texture, container) + 1);
+	for (auto _: state)
+	{
+		benchmark::DoNotOptimize(Save(*texture, container, buffer));
+	}
+	state.SetBytesProcessed(state.iterations() * (int64_t)GetTextureDataSize(*texture));
+}
+BENCHMARK_CAPTURE(BM_Save, PVR, BenchPVR) TEXTURE_SIZES;
+BENCHMARK_CAPTURE(BM_Save, DDS, BenchDDS) TEXTURE_SIZES;
+BENCHMARK_CAPTURE(BM_Save, KTX, BenchKTX) TEXTURE_SIZES;
+
+static void BM_Load(benchmark::State& state, BenchContainer container)
+{
+	std::unique_ptr<pvrtexture::CPVRTexture> texture(MakeMipmappedTexture((uint32_t)state.range(0)));
+	std::vector<uint8_t> buffer(FileSizeBound(*texture, container) + 1);
+	const size_t size = Save(*texture, container, buffer);
+	for (auto _: state)
+	{
+		std::unique_ptr<pvrtexture::CPVRTexture> loaded(Load(buffer, size, container));
+		benchmark::DoNotOptimize(loaded->getDataPtr());
+	}
+	state.SetBytesProcessed(state.iterations() * (int64_t)GetTextureDataSize(*texture));
+}
+BENCHMARK_CAPTURE(BM_Load, PVR, BenchPVR) TEXTURE_SIZES;
+BENCHMARK_CAPTURE(BM_Load, DDS, BenchDDS) TEXTURE_SIZES;
+BENCHMARK_CAPTURE(BM_Load, KTX, BenchKTX) TEXTURE_SIZES;
@@ -0,0 +1,125 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+#include "bench.h"
+#include "container.h"
+#include "common.h"
+
+#include <Python.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+	uint32_t Hash(uint32_t x)
+	{
+		x ^= x >> 16u;
+		x *= 0x7feb352du;
+		x ^= x >> 15u;
+		x *= 0x846ca68bu;
+		x ^= x >> 16u;
+		return x;
+	}
+}
+
+
+pvrtexture::CPVRTexture* MakeTexture(uint32_t width, uint32_t height, uint64_t format, EPVRTVariableType channel_type, EPVRTColourSpace colour_space)
+{
+	if (format != RGBA8888 && format != RGBA32323232)
+	{
+		throw runtime_error("Synthetic textures are RGBA8888 or RGBA32323232");
+	}
+	pvrtexture::CPVRTextureHeader header(format, height, width, 1, 1, 1, 1, colour_space, channel_type);
+	header.setOrientation((EPVRTOrientation)(ePVRTOrientRight | ePVRTOrientDown));
+	pvrtexture::CPVRTexture* texture = new pvrtexture::CPVRTexture(header);
+	uint8_t* data8 = (uint8_t*)texture->getDataPtr();
+	float* data32 = (float*)texture->getDataPtr();
+	const bool hdr = format == RGBA32323232;
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			const float u = (float)x / width;
+			const float v = (float)y / height;
+			const float r = sqrtf((u - 0.5f) * (u - 0.5f) + (v - 0.5f) * (v - 0.5f));
+			const float noise = (Hash(y * 65536u + x) & 0xffu) / 255.0f - 0.5f;
+			float rgba[4] = {
+					u,
+					v,
+					0.5f + 0.5f * sinf(r * 40.0f),
+					1.0f - 0.5f * r
+			};
+			for (int c = 0; c < 4; ++c)
+			{
+				float value = std::min(std::max(rgba[c] + 0.05f * noise, 0.0f), 1.0f);
+				size_t index = ((size_t)y * width + x) * 4 + c;
+				if (hdr)
+				{
+					// colour reaches above one, as HDR content does
+					data32[index] = c < 3 ? value * 16.0f : value;
+				}
+				else
+				{
+					data8[index] = (uint8_t)(value * 255.0f + 0.5f);
+				}
+			}
+		}
+	}
+	return texture;
+}
+
+void SetProcessed(benchmark::State& state, const pvrtexture::CPVRTextureHeader& header)
+{
+	const int64_t texels = (int64_t)header.getWidth() * header.getHeight() * header.getDepth();
+	state.SetItemsProcessed(state.iterations() * texels);
+	state.SetBytesProcessed(state.iterations() * (int64_t)GetSurfaceSize(header, 0));
+}
+
+
+void RegisterTranscodeBenchmarks();
+
+
+// Same flags as any Google Benchmark binary. Results are written to stdout as JSON, unless --benchmark_format
+// is given; --benchmark_out=file writes JSON to a file as well
+int main(int argc, char** argv)
+{
+	// textures that borrow memory keep python references
+	Py_Initialize();
+
+	std::vector<char*> args(argv, argv + argc);
+	bool has_format = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		has_format |= strncmp(argv[i], "--benchmark_format", 18) == 0;
+	}
+	std::string json_format = "--benchmark_format=json";
+	if (!has_format)
+	{
+		args.push_back(&json_format[0]);
+	}
+	int count = (int)args.size();
+	benchmark::Initialize(&count, args.data());
+	if (benchmark::ReportUnrecognizedArguments(count, args.data()))
+	{
+		return 1;
+	}
+	RegisterTranscodeBenchmarks();
+	benchmark::RunSpecifiedBenchmarks();
+	return 0;
+}
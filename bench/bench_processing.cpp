@@ -0,0 +1,226 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+#include "bench.h"
+#include "codec.h"
+#include "mipmaps.h"
+#include "resize.h"
+#include "downsample.h"
+#include "cubemap.h"
+#include "storage.h"
+#include "common.h"
+
+#include <PVRTextureUtilities.h>
+
+#include <memory>
+#include <string>
+
+
+// Operations that run on the thread pool report real time. In place operations work on a fresh copy every iteration,
+// the copy is not timed
+
+namespace
+{
+	pvrtexture::CPVRTexture* CopyTexture(const pvrtexture::CPVRTexture& texture)
+	{
+		return new pvrtexture::CPVRTexture(texture.getHeader(), texture.getDataPtr());
+	}
+
+	const char* QualityName(pvrtexture::ECompressorQuality quality)
+	{
+		switch (quality)
+		{
+			case pvrtexture::ePVRTCFastest: return "Fastest";
+			case pvrtexture::ePVRTCFast: return "Fast";
+			case pvrtexture::ePVRTCNormal: return "Normal";
+			case pvrtexture::ePVRTCHigh: return "High";
+			case pvrtexture::ePVRTCBest: return "Best";
+			default: return "Unknown";
+		}
+	}
+
+	struct TranscodeCase
+	{
+		const char* name;
+		uint64_t format;
+		bool native;
+		bool hdr;
+		// slowest quality level that is run, higher levels of some encoders take minutes per texture
+		pvrtexture::ECompressorQuality max_quality;
+	};
+
+	const TranscodeCase transcode_cases[] = {
+			{"PVRTCI_4bpp_RGBA", PVRTCI_4bpp_RGBA, false, false, pvrtexture::ePVRTCBest},
+			{"ETC1", ETC1, false, false, pvrtexture::ePVRTCFastest},
+			{"ETC2_RGBA", ETC2_RGBA, false, false, pvrtexture::ePVRTCFastest},
+			{"BC1", BC1, true, false, pvrtexture::ePVRTCBest},
+			{"BC3", BC3, true, false, pvrtexture::ePVRTCBest},
+			{"BC4", BC4, true, false, pvrtexture::ePVRTCBest},
+			{"BC5", BC5, true, false, pvrtexture::ePVRTCBest},
+			{"BC6", BC6, true, true, pvrtexture::ePVRTCBest},
+			{"BC7", BC7, true, false, pvrtexture::ePVRTCBest},
+			{"ETC1", ETC1, true, false, pvrtexture::ePVRTCBest},
+			{"ETC2_RGBA", ETC2_RGBA, true, false, pvrtexture::ePVRTCBest},
+			{"EAC_RG11", EAC_RG11, true, false, pvrtexture::ePVRTCBest},
+			{"ASTC_4x4", ASTC_4x4, true, false, pvrtexture::ePVRTCNormal},
+			{"ASTC_6x6", ASTC_6x6, true, false, pvrtexture::ePVRTCNormal},
+	};
+
+	// Same paths as inplace_transcode with engine "native" or "pvrtexlib"
+	void BM_Transcode(benchmark::State& state, TranscodeCase test, pvrtexture::ECompressorQuality quality)
+	{
+		const uint32_t size = (uint32_t)state.range(0);
+		// shared with the copies, so it has to go through TextureDeleter as well
+		TextureHolder source(test.hdr ? MakeTexture(size, size, RGBA32323232, ePVRTVarTypeFloat) : MakeTexture(size, size));
+		const EPVRTVariableType channel_type = test.hdr ? ePVRTVarTypeUnsignedFloat : ePVRTVarTypeUnsignedByteNorm;
+		for (auto _: state)
+		{
+			TextureHolder texture(new pvrtexture::CPVRTexture());
+			static_cast<pvrtexture::CPVRTextureHeader&>(*texture) = *source;
+			ShareData(*texture, *source);
+			if (test.native)
+			{
+				TranscodeNative(*texture, test.format, channel_type, ePVRTCSpacelRGB, quality);
+			}
+			else
+			{
+				MakeUnique(*texture);
+				if (!pvrtexture::Transcode(*texture, test.format, channel_type, ePVRTCSpacelRGB, quality))
+				{
+					state.SkipWithError("Transcode failed");
+					break;
+				}
+			}
+			benchmark::DoNotOptimize(texture->getDataPtr());
+		}
+		SetProcessed(state, *source);
+	}
+}
+
+
+void RegisterTranscodeBenchmarks()
+{
+	const pvrtexture::ECompressorQuality qualities[] = {pvrtexture::ePVRTCFastest, pvrtexture::ePVRTCNormal, pvrtexture::ePVRTCBest};
+	for (const TranscodeCase& test: transcode_cases)
+	{
+		for (pvrtexture::ECompressorQuality quality: qualities)
+		{
+			if (quality > test.max_quality)
+			{
+				continue;
+			}
+			std::string name = std::string("BM_Transcode/") + (test.native ? "native/" : "pvrtexlib/") + test.name + "/" + QualityName(quality);
+			benchmark::internal::Benchmark* benchmark = benchmark::RegisterBenchmark(name.c_str(), BM_Transcode, test, quality);
+			benchmark->Arg(256)->Unit(benchmark::kMillisecond)->UseRealTime();
+			// best quality is measured on the small size only
+			if (quality != pvrtexture::ePVRTCBest)
+			{
+				benchmark->Arg(1024);
+			}
+		}
+	}
+}
+
+
+static void BM_GenerateMIPMaps(benchmark::State& state, pvrtexture::EResizeMode mode)
+{
+	std::unique_ptr<pvrtexture::CPVRTexture> source(MakeTexture((uint32_t)state.range(0), (uint32_t)state.range(0)));
+	for (auto _: state)
+	{
+		state.PauseTiming();
+		std::unique_ptr<pvrtexture::CPVRTexture> texture(CopyTexture(*source));
+		state.ResumeTiming();
+		pvrtexture::GenerateMIPMaps(*texture, mode);
+	}
+	SetProcessed(state, *source);
+}
+BENCHMARK_CAPTURE(BM_GenerateMIPMaps, Linear, pvrtexture::eResizeLinear) TEXTURE_SIZES ->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_GenerateMIPMaps, Cubic, pvrtexture::eResizeCubic) TEXTURE_SIZES ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_GenerateMipmapsNative(benchmark::State& state, ResampleFilter filter)
+{
+	std::unique_ptr<pvrtexture::CPVRTexture> source(MakeTexture((uint32_t)state.range(0), (uint32_t)state.range(0), RGBA8888, ePVRTVarTypeUnsignedByteNorm, ePVRTCSpacesRGB));
+	for (auto _: state)
+	{
+		std::unique_ptr<pvrtexture::CPVRTexture> result(GenerateMipmaps(*source, filter, 2.2f, ePVRTCSpacesRGB));
+		benchmark::DoNotOptimize(result->getDataPtr());
+	}
+	SetProcessed(state, *source);
+}
+BENCHMARK_CAPTURE(BM_GenerateMipmapsNative, Box, FilterBox) TEXTURE_SIZES ->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_GenerateMipmapsNative, BSpline, FilterBSpline) TEXTURE_SIZES ->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_GenerateMipmapsNative, Kaiser, FilterKaiser) TEXTURE_SIZES ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+
+// Resizes to 3/4 of the size, a ratio that none of the filters can take a shortcut for
+
+static void BM_Resize(benchmark::State& state, pvrtexture::EResizeMode mode)
+{
+	const uint32_t size = (uint32_t)state.range(0);
+	std::unique_ptr<pvrtexture::CPVRTexture> source(MakeTexture(size, size));
+	for (auto _: state)
+	{
+		state.PauseTiming();
+		std::unique_ptr<pvrtexture::CPVRTexture> texture(CopyTexture(*source));
+		state.ResumeTiming();
+		pvrtexture::Resize(*texture, size * 3 / 4, size * 3 / 4, 1, mode);
+	}
+	SetProcessed(state, *source);
+}
+BENCHMARK_CAPTURE(BM_Resize, Linear, pvrtexture::eResizeLinear) TEXTURE_SIZES ->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_Resize, Cubic, pvrtexture::eResizeCubic) TEXTURE_SIZES ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_ResizeNative(benchmark::State& state, ResampleFilter filter)
+{
+	const uint32_t size = (uint32_t)state.range(0);
+	std::unique_ptr<pvrtexture::CPVRTexture> source(MakeTexture(size, size, RGBA8888, ePVRTVarTypeUnsignedByteNorm, ePVRTCSpacesRGB));
+	for (auto _: state)
+	{
+		std::unique_ptr<pvrtexture::CPVRTexture> result(ResizeTexture(*source, size * 3 / 4, size * 3 / 4, 1, filter, 2.2f, ePVRTCSpacesRGB));
+		benchmark::DoNotOptimize(result->getDataPtr());
+	}
+	SetProcessed(state, *source);
+}
+BENCHMARK_CAPTURE(BM_ResizeNative, Box, FilterBox) TEXTURE_SIZES ->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_ResizeNative, Lanczos3, FilterLanczos3) TEXTURE_SIZES ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_Downsample2x(benchmark::State& state, DownsampleType type)
+{
+	std::unique_ptr<pvrtexture::CPVRTexture> source(MakeTexture((uint32_t)state.range(0), (uint32_t)state.range(0)));
+	for (auto _: state)
+	{
+		std::unique_ptr<pvrtexture::CPVRTexture> result(Downsample2xTexture(*source, type));
+		benchmark::DoNotOptimize(result->getDataPtr());
+	}
+	SetProcessed(state, *source);
+}
+BENCHMARK_CAPTURE(BM_Downsample2x, AreaAverage, DownsampleAreaAverage) TEXTURE_SIZES ->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_Downsample2x, BSpline, DownsampleBSpline) TEXTURE_SIZES ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+
+// Panorama of 2N x N texels to faces of N / 2
+
+static void BM_CubemapFromEquirectangular(benchmark::State& state, Interpolation interpolation)
+{
+	const uint32_t size = (uint32_t)state.range(0);
+	std::unique_ptr<pvrtexture::CPVRTexture> panorama(MakeTexture(size * 2, size, RGBA8888, ePVRTVarTypeUnsignedByteNorm, ePVRTCSpacesRGB));
+	for (auto _: state)
+	{
+		std::unique_ptr<pvrtexture::CPVRTexture> cubemap(CubemapFromEquirectangular(*panorama, (int)size / 2, interpolation, 2.2f));
+		benchmark::DoNotOptimize(cubemap->getDataPtr());
+	}
+	SetProcessed(state, *panorama);
+}
+BENCHMARK_CAPTURE(BM_CubemapFromEquirectangular, Bilinear, InterpolationBilinear)->Arg(512)->Arg(2048)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_CubemapFromEquirectangular, Bicubic, InterpolationBicubic)->Arg(512)->Arg(2048)->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -230,6 +230,18 @@ extra_compile_args = {
     'win32': ['/MT', '/fp:fast', '/GL', '/GR-'],
 }
 
+# Widest vector instructions of the kernels, see SIMD in CMakeLists.txt. Wheels are built with the default, SSE4
+simd = os.environ.get('TEXTURE_TOOL_SIMD', 'SSE4').upper()
+simd_args = {
+    'SSE4': {'darwin': [], 'posix': [], 'win32': []},
+    'AVX2': {'darwin': ['-mavx2', '-mfma'], 'posix': ['-mavx2', '-mfma'], 'win32': ['/arch:AVX2']},
+    'AVX512': {'darwin': ['-mavx512f', '-mavx2', '-mfma'], 'posix': ['-mavx512f', '-mavx2', '-mfma'], 'win32': ['/arch:AVX512']},
+}
+if simd not in simd_args:
+    raise ValueError('Unknown TEXTURE_TOOL_SIMD %s, expected SSE4, AVX2 or AVX512' % simd)
+for key in extra_compile_args:
+    extra_compile_args[key] += simd_args[simd][key]
+
 extra_compile_cpp_args = {
     'darwin': ['-std=c++11', '-Ofast'],
     'posix': ['-std=c++11', '-Ofast'],
@@ -0,0 +1,1119 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#include "astc.h"
+#include "astc_common.h"
+#include "surface.h"
+
+#include <algorithm>
+
+
+const int ASTCLevels[ASTCRangeCount] = {2, 3, 4, 5, 6, 8, 10, 12, 16, 20, 24, 32, 40, 48, 64, 80, 96, 128, 160, 192, 256};
+
+namespace
+{
+	// Ranges have 2^bits levels, times 3 for trits or times 5 for quints
+	struct RangeEncoding
+	{
+		int bits;
+		int trits;
+		int quints;
+	};
+
+	RangeEncoding GetRangeEncoding(int range)
+	{
+		int levels = ASTCLevels[range];
+		RangeEncoding encoding = {0, levels % 3 == 0, levels % 5 == 0};
+		int base = encoding.trits ? levels / 3 : encoding.quints ? levels / 5 : levels;
+		while ((1 << encoding.bits) < base)
+		{
+			++encoding.bits;
+		}
+		return encoding;
+	}
+
+	void DecodeTrits(int packed, uint8_t* trits)
+	{
+		int c;
+		if (((packed >> 2) & 7) == 7)
+		{
+			c = (((packed >> 5) & 7) << 2) | (packed & 3);
+			trits[4] = 2;
+			trits[3] = 2;
+		}
+		else
+		{
+			c = packed & 0x1F;
+			if (((packed >> 5) & 3) == 3)
+			{
+				trits[4] = 2;
+				trits[3] = (packed >> 7) & 1;
+			}
+			else
+			{
+				trits[4] = (packed >> 7) & 1;
+				trits[3] = (packed >> 5) & 3;
+			}
+		}
+		if ((c & 3) == 3)
+		{
+			trits[2] = 2;
+			trits[1] = (c >> 4) & 1;
+			trits[0] = (((c >> 3) & 1) << 1) | (((c >> 2) & 1) & (((c >> 3) & 1) ^ 1));
+		}
+		else if (((c >> 2) & 3) == 3)
+		{
+			trits[2] = 2;
+			trits[1] = 2;
+			trits[0] = c & 3;
+		}
+		else
+		{
+			trits[2] = (c >> 4) & 1;
+			trits[1] = (c >> 2) & 3;
+			trits[0] = (((c >> 1) & 1) << 1) | ((c & 1) & (((c >> 1) & 1) ^ 1));
+		}
+	}
+
+	void DecodeQuints(int packed, uint8_t* quints)
+	{
+		if (((packed >> 1) & 3) == 3 && ((packed >> 5) & 3) == 0)
+		{
+			int low = packed & 1;
+			quints[2] = (low << 2) | ((((packed >> 4) & 1) & (low ^ 1)) << 1) | (((packed >> 3) & 1) & (low ^ 1));
+			quints[1] = 4;
+			quints[0] = 4;
+			return;
+		}
+		int c;
+		if (((packed >> 1) & 3) == 3)
+		{
+			quints[2] = 4;
+			c = (((packed >> 3) & 3) << 3) | (((~packed >> 5) & 3) << 1) | (packed & 1);
+		}
+		else
+		{
+			quints[2] = (packed >> 5) & 3;
+			c = packed & 0x1F;
+		}
+		if ((c & 7) == 5)
+		{
+			quints[1] = 4;
+			quints[0] = (c >> 3) & 3;
+		}
+		else
+		{
+			quints[1] = (c >> 3) & 3;
+			quints[0] = c & 7;
+		}
+	}
+
+	// Unquantization of trit and quint encoded values, spreads the bits below the trit or quint over the result
+	int UnquantizeColour(int range, int value)
+	{
+		RangeEncoding encoding = GetRangeEncoding(range);
+		if (!encoding.trits && !encoding.quints)
+		{
+			int result = 0;
+			for (int shift = 8 - encoding.bits; shift > -encoding.bits; shift -= encoding.bits)
+			{
+				result |= shift >= 0 ? value << shift : value >> -shift;
+			}
+			return result & 0xFF;
+		}
+		int d = value >> encoding.bits;
+		int m = value & ((1 << encoding.bits) - 1);
+		int a = (m & 1) ? 0x1FF : 0;
+		int b = (m >> 1) & 1, c = (m >> 2) & 1, e = (m >> 3) & 1, f = (m >> 4) & 1, g = (m >> 5) & 1;
+		int spread = 0;
+		int scale = 0;
+		switch (ASTCLevels[range])
+		{
+			case 6: scale = 204; break;
+			case 12: spread = b * 0x116; scale = 93; break;
+			case 24: spread = c * 0x10A + b * 0x85; scale = 44; break;
+			case 48: spread = e * 0x104 + c * 0x82 + b * 0x41; scale = 22; break;
+			case 96: spread = f * 0x102 + e * 0x81 + c * 0x40 + b * 0x20; scale = 11; break;
+			case 192: spread = g * 0x101 + f * 0x80 + e * 0x40 + c * 0x20 + b * 0x10; scale = 5; break;
+			case 10: scale = 113; break;
+			case 20: spread = b * 0x10C; scale = 54; break;
+			case 40: spread = c * 0x105 + b * 0x82; scale = 26; break;
+			case 80: spread = e * 0x102 + c * 0x81 + b * 0x40; scale = 13; break;
+			case 160: spread = f * 0x101 + e * 0x80 + c * 0x40 + b * 0x20; scale = 6; break;
+			default: break;
+		}
+		int t = (d * scale + spread) ^ a;
+		return (a & 0x80) | (t >> 2);
+	}
+
+	int UnquantizeWeight(int range, int value)
+	{
+		RangeEncoding encoding = GetRangeEncoding(range);
+		int result;
+		if (!encoding.trits && !encoding.quints)
+		{
+			result = 0;
+			for (int shift = 6 - encoding.bits; shift > -encoding.bits; shift -= encoding.bits)
+			{
+				result |= shift >= 0 ? value << shift : value >> -shift;
+			}
+			result &= 0x3F;
+		}
+		else if (encoding.bits == 0)
+		{
+			static const int trits[3] = {0, 32, 63};
+			static const int quints[5] = {0, 16, 32, 47, 63};
+			result = encoding.trits ? trits[value] : quints[value];
+		}
+		else
+		{
+			int d = value >> encoding.bits;
+			int m = value & ((1 << encoding.bits) - 1);
+			int a = (m & 1) ? 0x7F : 0;
+			int b = (m >> 1) & 1, c = (m >> 2) & 1;
+			int spread = 0;
+			int scale = 0;
+			switch (ASTCLevels[range])
+			{
+				case 6: scale = 50; break;
+				case 12: spread = b * 0x45; scale = 23; break;
+				case 24: spread = c * 0x42 + b * 0x21; scale = 11; break;
+				case 10: scale = 28; break;
+				case 20: spread = b * 0x42; scale = 13; break;
+				default: break;
+			}
+			int t = (d * scale + spread) ^ a;
+			result = (a & 0x20) | (t >> 2);
+		}
+		return result > 32 ? result + 1 : result;
+	}
+
+	struct Tables
+	{
+		uint8_t trits[256][5];
+		uint8_t trit_packing[243];
+		uint8_t quints[128][3];
+		uint8_t quint_packing[125];
+		uint8_t colour_values[ASTCRangeCount][256];
+		uint8_t colour_quantization[ASTCRangeCount][256];
+		uint8_t colour_quantization_msb[ASTCRangeCount][256];
+		uint8_t weight_values[ASTCWeightRangeCount][32];
+		// indexed by weight in 1/16 steps
+		uint8_t weight_quantization[ASTCWeightRangeCount][1025];
+
+		Tables()
+		{
+			for (int packed = 255; packed >= 0; --packed)
+			{
+				uint8_t* t = trits[packed];
+				DecodeTrits(packed, t);
+				trit_packing[t[0] + 3 * t[1] + 9 * t[2] + 27 * t[3] + 81 * t[4]] = (uint8_t)packed;
+			}
+			for (int packed = 127; packed >= 0; --packed)
+			{
+				uint8_t* q = quints[packed];
+				DecodeQuints(packed, q);
+				quint_packing[q[0] + 5 * q[1] + 25 * q[2]] = (uint8_t)packed;
+			}
+			for (int range = 0; range < ASTCRangeCount; ++range)
+			{
+				for (int value = 0; value < ASTCLevels[range]; ++value)
+				{
+					colour_values[range][value] = (uint8_t)UnquantizeColour(range, value);
+				}
+				for (int x = 0; x < 256; ++x)
+				{
+					int best = -1, best_msb = -1;
+					for (int value = 0; value < ASTCLevels[range]; ++value)
+					{
+						int d = std::abs(colour_values[range][value] - x);
+						if (best < 0 || d < std::abs(colour_values[range][best] - x))
+						{
+							best = value;
+						}
+						bool same_msb = ((colour_values[range][value] ^ x) & 0x80) == 0;
+						if (same_msb && (best_msb < 0 || d < std::abs(colour_values[range][best_msb] - x)))
+						{
+							best_msb = value;
+						}
+					}
+					colour_quantization[range][x] = (uint8_t)best;
+					colour_quantization_msb[range][x] = (uint8_t)(best_msb < 0 ? best : best_msb);
+				}
+			}
+			for (int range = 0; range < ASTCWeightRangeCount; ++range)
+			{
+				for (int value = 0; value < ASTCLevels[range]; ++value)
+				{
+					weight_values[range][value] = (uint8_t)UnquantizeWeight(range, value);
+				}
+				for (int x = 0; x <= 1024; ++x)
+				{
+					int best = 0;
+					for (int value = 1; value < ASTCLevels[range]; ++value)
+					{
+						if (std::abs(weight_values[range][value] * 16 - x) < std::abs(weight_values[range][best] * 16 - x))
+						{
+							best = value;
+						}
+					}
+					weight_quantization[range][x] = (uint8_t)best;
+				}
+			}
+		}
+	};
+
+	const Tables& GetTables()
+	{
+		static const Tables tables;
+		return tables;
+	}
+}
+
+
+int GetISEBits(int count, int range)
+{
+	RangeEncoding encoding = GetRangeEncoding(range);
+	int bits = count * encoding.bits;
+	if (encoding.trits)
+	{
+		bits += (8 * count + 4) / 5;
+	}
+	if (encoding.quints)
+	{
+		bits += (7 * count + 2) / 3;
+	}
+	return bits;
+}
+
+// Values are sent in groups of 5 trits or 3 quints packed into 8 or 7 bits, interleaved with the low bits of values.
+// A group that is cut short ends right after the packed bits that follow its last value
+void EncodeISE(BlockBitWriter& writer, const uint8_t* values, int count, int range)
+{
+	const Tables& tables = GetTables();
+	RangeEncoding encoding = GetRangeEncoding(range);
+	const int mask = (1 << encoding.bits) - 1;
+	if (encoding.trits)
+	{
+		static const int packed_bits[5] = {2, 2, 1, 2, 1};
+		for (int i = 0; i < count; i += 5)
+		{
+			int index = 0;
+			for (int k = 4; k >= 0; --k)
+			{
+				index = index * 3 + (i + k < count ? values[i + k] >> encoding.bits : 0);
+			}
+			int packed = tables.trit_packing[index];
+			for (int k = 0, shift = 0; k < 5 && i + k < count; shift += packed_bits[k], ++k)
+			{
+				writer.Write(values[i + k] & mask, encoding.bits);
+				writer.Write((uint32_t)packed >> shift, packed_bits[k]);
+			}
+		}
+	}
+	else if (encoding.quints)
+	{
+		static const int packed_bits[3] = {3, 2, 2};
+		for (int i = 0; i < count; i += 3)
+		{
+			int index = 0;
+			for (int k = 2; k >= 0; --k)
+			{
+				index = index * 5 + (i + k < count ? values[i + k] >> encoding.bits : 0);
+			}
+			int packed = tables.quint_packing[index];
+			for (int k = 0, shift = 0; k < 3 && i + k < count; shift += packed_bits[k], ++k)
+			{
+				writer.Write(values[i + k] & mask, encoding.bits);
+				writer.Write((uint32_t)packed >> shift, packed_bits[k]);
+			}
+		}
+	}
+	else
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			writer.Write(values[i], encoding.bits);
+		}
+	}
+}
+
+void DecodeISE(BlockBitReader& reader, uint8_t* values, int count, int range)
+{
+	const Tables& tables = GetTables();
+	RangeEncoding encoding = GetRangeEncoding(range);
+	if (encoding.trits || encoding.quints)
+	{
+		const int group = encoding.trits ? 5 : 3;
+		static const int trit_bits[5] = {2, 2, 1, 2, 1};
+		static const int quint_bits[3] = {3, 2, 2};
+		const int* packed_bits = encoding.trits ? trit_bits : quint_bits;
+		for (int i = 0; i < count; i += group)
+		{
+			int low[5] = {};
+			int packed = 0;
+			for (int k = 0, shift = 0; k < group && i + k < count; shift += packed_bits[k], ++k)
+			{
+				low[k] = (int)reader.Read(encoding.bits);
+				packed |= (int)reader.Read(packed_bits[k]) << shift;
+			}
+			const uint8_t* high = encoding.trits ? tables.trits[packed] : tables.quints[packed];
+			for (int k = 0; k < group && i + k < count; ++k)
+			{
+				values[i + k] = (uint8_t)((high[k] << encoding.bits) | low[k]);
+			}
+		}
+	}
+	else
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			values[i] = (uint8_t)reader.Read(encoding.bits);
+		}
+	}
+}
+
+const uint8_t* GetASTCColourValues(int range)
+{
+	return GetTables().colour_values[range];
+}
+
+const uint8_t* GetASTCWeightValues(int range)
+{
+	return GetTables().weight_values[range];
+}
+
+uint8_t QuantizeASTCColour(int range, int value)
+{
+	return GetTables().colour_quantization[range][std::min(std::max(value, 0), 255)];
+}
+
+uint8_t QuantizeASTCColourKeepMSB(int range, int value)
+{
+	return GetTables().colour_quantization_msb[range][std::min(std::max(value, 0), 255)];
+}
+
+uint8_t QuantizeASTCWeight(int range, float weight)
+{
+	int x = (int)(std::min(std::max(weight, 0.0f), 64.0f) * 16.0f + 0.5f);
+	return GetTables().weight_quantization[range][x];
+}
+
+bool DecodeASTCBlockMode(int mode, ASTCBlockMode& block_mode)
+{
+	int r = (mode >> 4) & 1;
+	int h = (mode >> 9) & 1;
+	int d = (mode >> 10) & 1;
+	int a = (mode >> 5) & 3;
+	int width, height;
+	if ((mode & 3) != 0)
+	{
+		r |= (mode & 3) << 1;
+		int b = (mode >> 7) & 3;
+		switch ((mode >> 2) & 3)
+		{
+			case 0: width = b + 4; height = a + 2; break;
+			case 1: width = b + 8; height = a + 2; break;
+			case 2: width = a + 2; height = b + 8; break;
+			default:
+				b &= 1;
+				if (mode & 0x100)
+				{
+					width = b + 2;
+					height = a + 2;
+				}
+				else
+				{
+					width = a + 2;
+					height = b + 6;
+				}
+				break;
+		}
+	}
+	else
+	{
+		r |= ((mode >> 2) & 3) << 1;
+		if (((mode >> 2) & 3) == 0)
+		{
+			return false;
+		}
+		int b = (mode >> 9) & 3;
+		switch ((mode >> 7) & 3)
+		{
+			case 0: width = 12; height = a + 2; break;
+			case 1: width = a + 2; height = 12; break;
+			case 2: width = a + 6; height = b + 6; d = 0; h = 0; break;
+			default:
+				if (a > 1)
+				{
+					return false;
+				}
+				width = a == 0 ? 6 : 10;
+				height = a == 0 ? 10 : 6;
+				break;
+		}
+	}
+	block_mode.grid_width = width;
+	block_mode.grid_height = height;
+	block_mode.dual_plane = d != 0;
+	block_mode.weight_range = r - 2 + 6 * h;
+	int count = width * height * (d + 1);
+	block_mode.weight_bits = GetISEBits(count, block_mode.weight_range);
+	return count <= ASTCMaxWeights && block_mode.weight_bits >= 24 && block_mode.weight_bits <= 96;
+}
+
+int GetASTCPartition(int seed, int x, int y, int partitions, int texel_count)
+{
+	if (texel_count < 31)
+	{
+		x <<= 1;
+		y <<= 1;
+	}
+	seed += (partitions - 1) * 1024;
+
+	uint32_t rnum = (uint32_t)seed;
+	rnum ^= rnum >> 15;
+	rnum -= rnum << 17;
+	rnum += rnum << 7;
+	rnum += rnum << 4;
+	rnum ^= rnum >> 5;
+	rnum += rnum << 16;
+	rnum ^= rnum >> 7;
+	rnum ^= rnum >> 3;
+	rnum ^= rnum << 6;
+	rnum ^= rnum >> 17;
+
+	int seeds[8];
+	for (int i = 0; i < 8; ++i)
+	{
+		seeds[i] = (int)((rnum >> (4 * i)) & 0xF);
+		seeds[i] *= seeds[i];
+	}
+	int sh1, sh2;
+	if (seed & 1)
+	{
+		sh1 = (seed & 2) ? 4 : 5;
+		sh2 = partitions == 3 ? 6 : 5;
+	}
+	else
+	{
+		sh1 = partitions == 3 ? 6 : 5;
+		sh2 = (seed & 2) ? 4 : 5;
+	}
+	for (int i = 0; i < 8; ++i)
+	{
+		seeds[i] >>= (i & 1) ? sh2 : sh1;
+	}
+
+	// z is 0 for 2D blocks, so the remaining four seeds do not contribute
+	int a = (seeds[0] * x + seeds[1] * y + (int)(rnum >> 14)) & 0x3F;
+	int b = (seeds[2] * x + seeds[3] * y + (int)(rnum >> 10)) & 0x3F;
+	int c = (seeds[4] * x + seeds[5] * y + (int)(rnum >> 6)) & 0x3F;
+	int d = (seeds[6] * x + seeds[7] * y + (int)(rnum >> 2)) & 0x3F;
+	if (partitions < 4)
+	{
+		d = 0;
+	}
+	if (partitions < 3)
+	{
+		c = 0;
+	}
+	if (a >= b && a >= c && a >= d)
+	{
+		return 0;
+	}
+	if (b >= c && b >= d)
+	{
+		return 1;
+	}
+	return c >= d ? 2 : 3;
+}
+
+void BuildASTCInfill(int block_width, int block_height, int grid_width, int grid_height, ASTCInfill& infill)
+{
+	const int ds = (1024 + block_width / 2) / (block_width - 1);
+	const int dt = (1024 + block_height / 2) / (block_height - 1);
+	const int last = grid_width * grid_height - 1;
+	for (int t = 0; t < block_height; ++t)
+	{
+		for (int s = 0; s < block_width; ++s)
+		{
+			int gs = (ds * s * (grid_width - 1) + 32) >> 6;
+			int gt = (dt * t * (grid_height - 1) + 32) >> 6;
+			int js = gs >> 4, fs = gs & 0xF;
+			int jt = gt >> 4, ft = gt & 0xF;
+			int w11 = (fs * ft + 8) >> 4;
+			int v0 = js + jt * grid_width;
+			int texel = t * block_width + s;
+			// points past the edge of the grid have zero weight
+			infill.index[texel][0] = (uint8_t)v0;
+			infill.index[texel][1] = (uint8_t)std::min(v0 + 1, last);
+			infill.index[texel][2] = (uint8_t)std::min(v0 + grid_width, last);
+			infill.index[texel][3] = (uint8_t)std::min(v0 + grid_width + 1, last);
+			infill.weight[texel][0] = (uint8_t)(16 - fs - ft + w11);
+			infill.weight[texel][1] = (uint8_t)(fs - w11);
+			infill.weight[texel][2] = (uint8_t)(ft - w11);
+			infill.weight[texel][3] = (uint8_t)w11;
+		}
+	}
+}
+
+namespace
+{
+	void BitTransferSigned(int& a, int& b)
+	{
+		b >>= 1;
+		b |= a & 0x80;
+		a >>= 1;
+		a &= 0x3F;
+		if (a & 0x20)
+		{
+			a -= 0x40;
+		}
+	}
+
+	void Set(int* e, int r, int g, int b, int a)
+	{
+		e[0] = r;
+		e[1] = g;
+		e[2] = b;
+		e[3] = a;
+	}
+
+	void BlueContract(int* e)
+	{
+		e[0] = (e[0] + e[2]) >> 1;
+		e[1] = (e[1] + e[2]) >> 1;
+	}
+
+	// Mode 7, 12 bit base colour and scale with the precision given by the mode, results are 16 bit
+	void UnpackHDRRGBScale(const int* v, int* e0, int* e1)
+	{
+		int mode_value = ((v[0] & 0xC0) >> 6) | (((v[1] & 0x80) >> 7) << 2) | (((v[2] & 0x80) >> 7) << 3);
+		int major, mode;
+		if ((mode_value & 0xC) != 0xC)
+		{
+			major = mode_value >> 2;
+			mode = mode_value & 3;
+		}
+		else if (mode_value != 0xF)
+		{
+			major = mode_value & 3;
+			mode = 4;
+		}
+		else
+		{
+			major = 0;
+			mode = 5;
+		}
+
+		int red = v[0] & 0x3F;
+		int green = v[1] & 0x1F;
+		int blue = v[2] & 0x1F;
+		int scale = v[3] & 0x1F;
+		int bit0 = (v[1] >> 6) & 1, bit1 = (v[1] >> 5) & 1, bit2 = (v[2] >> 6) & 1, bit3 = (v[2] >> 5) & 1;
+		int bit4 = (v[3] >> 7) & 1, bit5 = (v[3] >> 6) & 1, bit6 = (v[3] >> 5) & 1;
+
+		int one_hot = 1 << mode;
+		if (one_hot & 0x30) green |= bit0 << 6;
+		if (one_hot & 0x3A) green |= bit1 << 5;
+		if (one_hot & 0x30) blue |= bit2 << 6;
+		if (one_hot & 0x3A) blue |= bit3 << 5;
+		if (one_hot & 0x3D) scale |= bit6 << 5;
+		if (one_hot & 0x2D) scale |= bit5 << 6;
+		if (one_hot & 0x04) scale |= bit4 << 7;
+		if (one_hot & 0x3B) red |= bit4 << 6;
+		if (one_hot & 0x04) red |= bit3 << 6;
+		if (one_hot & 0x10) red |= bit5 << 7;
+		if (one_hot & 0x0F) red |= bit2 << 7;
+		if (one_hot & 0x05) red |= bit1 << 8;
+		if (one_hot & 0x0A) red |= bit0 << 8;
+		if (one_hot & 0x05) red |= bit0 << 9;
+		if (one_hot & 0x02) red |= bit6 << 9;
+		if (one_hot & 0x01) red |= bit3 << 10;
+		if (one_hot & 0x02) red |= bit5 << 10;
+
+		static const int shifts[6] = {1, 1, 2, 3, 4, 5};
+		red <<= shifts[mode];
+		green <<= shifts[mode];
+		blue <<= shifts[mode];
+		scale <<= shifts[mode];
+		if (mode != 5)
+		{
+			green = red - green;
+			blue = red - blue;
+		}
+		if (major == 1)
+		{
+			std::swap(red, green);
+		}
+		else if (major == 2)
+		{
+			std::swap(red, blue);
+		}
+		int c1[3] = {red, green, blue};
+		for (int c = 0; c < 3; ++c)
+		{
+			e0[c] = std::max(c1[c] - scale, 0) << 4;
+			e1[c] = std::max(c1[c], 0) << 4;
+		}
+	}
+
+	// Modes 11, 14 and 15, HDR colours
+	void UnpackHDRRGB(const int* v, int* e0, int* e1)
+	{
+		int mode = ((v[1] & 0x80) >> 7) | (((v[2] & 0x80) >> 7) << 1) | (((v[3] & 0x80) >> 7) << 2);
+		int major = ((v[4] & 0x80) >> 7) | (((v[5] & 0x80) >> 7) << 1);
+		if (major == 3)
+		{
+			Set(e0, v[0] << 8, v[2] << 8, (v[4] & 0x7F) << 9, 0);
+			Set(e1, v[1] << 8, v[3] << 8, (v[5] & 0x7F) << 9, 0);
+			return;
+		}
+
+		int a = v[0] | ((v[1] & 0x40) << 2);
+		int b0 = v[2] & 0x3F;
+		int b1 = v[3] & 0x3F;
+		int c = v[1] & 0x3F;
+		int d0 = v[4] & 0x7F;
+		int d1 = v[5] & 0x7F;
+		int bit0 = (v[2] >> 6) & 1, bit1 = (v[3] >> 6) & 1, bit2 = (v[4] >> 6) & 1;
+		int bit3 = (v[5] >> 6) & 1, bit4 = (v[4] >> 5) & 1, bit5 = (v[5] >> 5) & 1;
+
+		int one_hot = 1 << mode;
+		if (one_hot & 0xA4) a |= bit0 << 9;
+		if (one_hot & 0x08) a |= bit2 << 9;
+		if (one_hot & 0x50) a |= bit4 << 9;
+		if (one_hot & 0x50) a |= bit5 << 10;
+		if (one_hot & 0xA0) a |= bit1 << 10;
+		if (one_hot & 0xC0) a |= bit2 << 11;
+		if (one_hot & 0x04) c |= bit1 << 6;
+		if (one_hot & 0xE8) c |= bit3 << 6;
+		if (one_hot & 0x20) c |= bit2 << 7;
+		if (one_hot & 0x5B) { b0 |= bit0 << 6; b1 |= bit1 << 6; }
+		if (one_hot & 0x12) { b0 |= bit2 << 7; b1 |= bit3 << 7; }
+		if (one_hot & 0xAF) { d0 |= bit4 << 5; d1 |= bit5 << 5; }
+		if (one_hot & 0x05) { d0 |= bit2 << 6; d1 |= bit3 << 6; }
+
+		static const int d_bits[8] = {7, 6, 7, 6, 5, 6, 5, 6};
+		int sign = 1 << (d_bits[mode] - 1);
+		d0 = ((d0 & (2 * sign - 1)) ^ sign) - sign;
+		d1 = ((d1 & (2 * sign - 1)) ^ sign) - sign;
+
+		int shift = (mode >> 1) ^ 3;
+		a <<= shift;
+		b0 <<= shift;
+		b1 <<= shift;
+		c <<= shift;
+		d0 *= 1 << shift;
+		d1 *= 1 << shift;
+
+		int c1[3] = {a, a - b0, a - b1};
+		int c0[3] = {a - c, a - b0 - c - d0, a - b1 - c - d1};
+		if (major == 1)
+		{
+			std::swap(c1[0], c1[1]);
+			std::swap(c0[0], c0[1]);
+		}
+		else if (major == 2)
+		{
+			std::swap(c1[0], c1[2]);
+			std::swap(c0[0], c0[2]);
+		}
+		for (int k = 0; k < 3; ++k)
+		{
+			e0[k] = std::min(std::max(c0[k], 0), 0xFFF) << 4;
+			e1[k] = std::min(std::max(c1[k], 0), 0xFFF) << 4;
+		}
+	}
+
+	void UnpackHDRAlpha(int v6, int v7, int& a0, int& a1)
+	{
+		int mode = ((v6 >> 7) & 1) | ((v7 >> 6) & 2);
+		v6 &= 0x7F;
+		v7 &= 0x7F;
+		if (mode == 3)
+		{
+			a0 = v6 << 5;
+			a1 = v7 << 5;
+		}
+		else
+		{
+			v6 |= (v7 << (mode + 1)) & 0x780;
+			v7 &= 0x3F >> mode;
+			v7 ^= 0x20 >> mode;
+			v7 -= 0x20 >> mode;
+			v6 <<= 4 - mode;
+			v7 *= 1 << (4 - mode);
+			v7 += v6;
+			a0 = v6;
+			a1 = std::min(std::max(v7, 0), 0xFFF);
+		}
+		a0 <<= 4;
+		a1 <<= 4;
+	}
+}
+
+void UnpackASTCEndpoints(int cem, const int* values, bool srgb, ASTCEndpoints& endpoints)
+{
+	int v[8];
+	std::copy(values, values + GetASTCColourValueCount(cem), v);
+	int* e0 = endpoints.e0;
+	int* e1 = endpoints.e1;
+	// LNS value of 1.0
+	const int one = 0x7800;
+	endpoints.hdr_rgb = IsASTCHDRMode(cem);
+	endpoints.hdr_alpha = endpoints.hdr_rgb && cem != 14;
+	switch (cem)
+	{
+		case 0:
+			Set(e0, v[0], v[0], v[0], 0xFF);
+			Set(e1, v[1], v[1], v[1], 0xFF);
+			break;
+		case 1:
+		{
+			int l0 = (v[0] >> 2) | (v[1] & 0xC0);
+			int l1 = std::min(l0 + (v[1] & 0x3F), 0xFF);
+			Set(e0, l0, l0, l0, 0xFF);
+			Set(e1, l1, l1, l1, 0xFF);
+			break;
+		}
+		case 2:
+		{
+			int y0, y1;
+			if (v[1] >= v[0])
+			{
+				y0 = v[0] << 4;
+				y1 = v[1] << 4;
+			}
+			else
+			{
+				y0 = (v[1] << 4) + 8;
+				y1 = (v[0] << 4) - 8;
+			}
+			Set(e0, y0 << 4, y0 << 4, y0 << 4, one);
+			Set(e1, y1 << 4, y1 << 4, y1 << 4, one);
+			break;
+		}
+		case 3:
+		{
+			int y0, d;
+			if (v[0] & 0x80)
+			{
+				y0 = ((v[1] & 0xE0) << 4) | ((v[0] & 0x7F) << 2);
+				d = (v[1] & 0x1F) << 2;
+			}
+			else
+			{
+				y0 = ((v[1] & 0xF0) << 4) | ((v[0] & 0x7F) << 1);
+				d = (v[1] & 0x0F) << 1;
+			}
+			int y1 = std::min(y0 + d, 0xFFF);
+			Set(e0, y0 << 4, y0 << 4, y0 << 4, one);
+			Set(e1, y1 << 4, y1 << 4, y1 << 4, one);
+			break;
+		}
+		case 4:
+			Set(e0, v[0], v[0], v[0], v[2]);
+			Set(e1, v[1], v[1], v[1], v[3]);
+			break;
+		case 5:
+			BitTransferSigned(v[1], v[0]);
+			BitTransferSigned(v[3], v[2]);
+			Set(e0, v[0], v[0], v[0], v[2]);
+			Set(e1, v[0] + v[1], v[0] + v[1], v[0] + v[1], v[2] + v[3]);
+			break;
+		case 6:
+			Set(e0, (v[0] * v[3]) >> 8, (v[1] * v[3]) >> 8, (v[2] * v[3]) >> 8, 0xFF);
+			Set(e1, v[0], v[1], v[2], 0xFF);
+			break;
+		case 7:
+			UnpackHDRRGBScale(v, e0, e1);
+			e0[3] = e1[3] = one;
+			break;
+		case 8:
+		case 12:
+		{
+			int a0 = cem == 12 ? v[6] : 0xFF;
+			int a1 = cem == 12 ? v[7] : 0xFF;
+			if (v[1] + v[3] + v[5] >= v[0] + v[2] + v[4])
+			{
+				Set(e0, v[0], v[2], v[4], a0);
+				Set(e1, v[1], v[3], v[5], a1);
+			}
+			else
+			{
+				Set(e0, v[1], v[3], v[5], a1);
+				Set(e1, v[0], v[2], v[4], a0);
+				BlueContract(e0);
+				BlueContract(e1);
+			}
+			break;
+		}
+		case 9:
+		case 13:
+		{
+			BitTransferSigned(v[1], v[0]);
+			BitTransferSigned(v[3], v[2]);
+			BitTransferSigned(v[5], v[4]);
+			int a0 = 0xFF, a1 = 0xFF;
+			if (cem == 13)
+			{
+				BitTransferSigned(v[7], v[6]);
+				a0 = v[6];
+				a1 = v[6] + v[7];
+			}
+			if (v[1] + v[3] + v[5] >= 0)
+			{
+				Set(e0, v[0], v[2], v[4], a0);
+				Set(e1, v[0] + v[1], v[2] + v[3], v[4] + v[5], a1);
+			}
+			else
+			{
+				Set(e0, v[0] + v[1], v[2] + v[3], v[4] + v[5], a1);
+				Set(e1, v[0], v[2], v[4], a0);
+				BlueContract(e0);
+				BlueContract(e1);
+			}
+			break;
+		}
+		case 10:
+			Set(e0, (v[0] * v[3]) >> 8, (v[1] * v[3]) >> 8, (v[2] * v[3]) >> 8, v[4]);
+			Set(e1, v[0], v[1], v[2], v[5]);
+			break;
+		case 11:
+			UnpackHDRRGB(v, e0, e1);
+			e0[3] = e1[3] = one;
+			break;
+		case 14:
+			UnpackHDRRGB(v, e0, e1);
+			e0[3] = v[6];
+			e1[3] = v[7];
+			break;
+		default:
+			UnpackHDRRGB(v, e0, e1);
+			UnpackHDRAlpha(v[6], v[7], e0[3], e1[3]);
+			break;
+	}
+
+	for (int c = 0; c < 4; ++c)
+	{
+		if (c < 3 ? endpoints.hdr_rgb : endpoints.hdr_alpha)
+		{
+			continue;
+		}
+		int x0 = std::min(std::max(e0[c], 0), 0xFF);
+		int x1 = std::min(std::max(e1[c], 0), 0xFF);
+		e0[c] = srgb ? (x0 << 8) | 0x80 : x0 * 257;
+		e1[c] = srgb ? (x1 << 8) | 0x80 : x1 * 257;
+	}
+}
+
+uint16_t ASTCLNSToHalf(int lns)
+{
+	int e = lns >> 11;
+	int m = lns & 0x7FF;
+	int mt = m < 512 ? 3 * m : m < 1536 ? 4 * m - 512 : 5 * m - 2048;
+	int half = (e << 10) + (mt >> 3);
+	return (uint16_t)std::min(half, 0x7BFF);
+}
+
+float ASTCHalfToLNS(uint16_t half)
+{
+	int e = (half >> 10) & 0x1F;
+	// centre of the mantissas that map to the half value
+	float mt = (float)((half & 0x3FF) << 3) + 4.0f;
+	float m = mt < 1536.0f ? mt / 3.0f : mt < 5632.0f ? (mt + 512.0f) / 4.0f : (mt + 2048.0f) / 5.0f;
+	return (float)(e << 11) + std::min(m, 2047.0f);
+}
+
+namespace
+{
+	void FillBlock(float* rgba, int texel_count, const float* colour)
+	{
+		for (int i = 0; i < texel_count; ++i)
+		{
+			std::copy(colour, colour + 4, rgba + 4 * i);
+		}
+	}
+
+	float ToFloat(int value, bool hdr, bool srgb)
+	{
+		if (hdr)
+		{
+			return HalfToFloat(ASTCLNSToHalf(value));
+		}
+		return srgb ? (float)(value >> 8) / 255.0f : (float)value / 65535.0f;
+	}
+}
+
+void ReverseASTCBits(const uint8_t* block, uint8_t* reversed)
+{
+	for (int i = 0; i < 16; ++i)
+	{
+		uint8_t x = block[15 - i];
+		x = (uint8_t)(((x & 0xF0) >> 4) | ((x & 0x0F) << 4));
+		x = (uint8_t)(((x & 0xCC) >> 2) | ((x & 0x33) << 2));
+		x = (uint8_t)(((x & 0xAA) >> 1) | ((x & 0x55) << 1));
+		reversed[i] = x;
+	}
+}
+
+void DecodeASTCBlock(const uint8_t* block, int block_width, int block_height, float* rgba, bool srgb)
+{
+	const int texel_count = block_width * block_height;
+	static const float error_colour[4] = {1.0f, 0.0f, 1.0f, 1.0f};
+
+	BlockBitReader reader(block);
+	int mode = (int)reader.Read(11);
+	if (IsASTCVoidExtent(mode))
+	{
+		bool hdr = (mode >> 9) & 1;
+		reader.Seek(64);
+		float colour[4];
+		for (int c = 0; c < 4; ++c)
+		{
+			int value = (int)reader.Read(16);
+			colour[c] = hdr ? HalfToFloat((uint16_t)value) : ToFloat(value, false, srgb);
+		}
+		FillBlock(rgba, texel_count, colour);
+		return;
+	}
+
+	ASTCBlockMode block_mode;
+	if (!DecodeASTCBlockMode(mode, block_mode) || block_mode.grid_width > block_width || block_mode.grid_height > block_height)
+	{
+		FillBlock(rgba, texel_count, error_colour);
+		return;
+	}
+	const int partitions = (int)reader.Read(2) + 1;
+	if (partitions == 4 && block_mode.dual_plane)
+	{
+		FillBlock(rgba, texel_count, error_colour);
+		return;
+	}
+
+	const int below_weights = 128 - block_mode.weight_bits;
+	int cems[4];
+	int seed = 0;
+	int extra_bits = 0;
+	if (partitions == 1)
+	{
+		cems[0] = (int)reader.Read(4);
+	}
+	else
+	{
+		seed = (int)reader.Read(10);
+		int cem = (int)reader.Read(6);
+		if ((cem & 3) == 0)
+		{
+			std::fill(cems, cems + partitions, cem >> 2);
+		}
+		else
+		{
+			// class of the first partition, each partition adds a bit to it and has a 2 bit mode within the class
+			extra_bits = 3 * partitions - 4;
+			reader.Seek(below_weights - extra_bits);
+			int encoded = (cem >> 2) | ((int)reader.Read(extra_bits) << 4);
+			int base = (cem & 3) - 1;
+			for (int p = 0; p < partitions; ++p)
+			{
+				cems[p] = (base + ((encoded >> p) & 1)) << 2;
+			}
+			encoded >>= partitions;
+			for (int p = 0; p < partitions; ++p)
+			{
+				cems[p] |= (encoded >> (2 * p)) & 3;
+			}
+		}
+	}
+	int ccs = -1;
+	int colour_end = below_weights - extra_bits;
+	if (block_mode.dual_plane)
+	{
+		colour_end -= 2;
+		reader.Seek(colour_end);
+		ccs = (int)reader.Read(2);
+	}
+
+	int value_count = 0;
+	for (int p = 0; p < partitions; ++p)
+	{
+		value_count += GetASTCColourValueCount(cems[p]);
+	}
+	const int colour_start = partitions == 1 ? 17 : 29;
+	int colour_range = ASTCRangeCount - 1;
+	while (colour_range >= ASTCMinColourRange && GetISEBits(value_count, colour_range) > colour_end - colour_start)
+	{
+		--colour_range;
+	}
+	if (value_count > ASTCMaxColourValues || colour_range < ASTCMinColourRange)
+	{
+		FillBlock(rgba, texel_count, error_colour);
+		return;
+	}
+
+	uint8_t encoded_values[ASTCMaxColourValues];
+	reader.Seek(colour_start);
+	DecodeISE(reader, encoded_values, value_count, colour_range);
+	const uint8_t* colour_values = GetASTCColourValues(colour_range);
+	ASTCEndpoints endpoints[4];
+	for (int p = 0, offset = 0; p < partitions; ++p)
+	{
+		int values[8];
+		for (int i = 0; i < GetASTCColourValueCount(cems[p]); ++i)
+		{
+			values[i] = colour_values[encoded_values[offset + i]];
+		}
+		offset += GetASTCColourValueCount(cems[p]);
+		UnpackASTCEndpoints(cems[p], values, srgb, endpoints[p]);
+	}
+
+	const int planes = block_mode.dual_plane ? 2 : 1;
+	const int weight_count = block_mode.grid_width * block_mode.grid_height * planes;
+	uint8_t reversed[16];
+	ReverseASTCBits(block, reversed);
+	BlockBitReader weight_reader(reversed);
+	uint8_t weights[ASTCMaxWeights];
+	DecodeISE(weight_reader, weights, weight_count, block_mode.weight_range);
+	const uint8_t* weight_values = GetASTCWeightValues(block_mode.weight_range);
+	for (int i = 0; i < weight_count; ++i)
+	{
+		weights[i] = weight_values[weights[i]];
+	}
+
+	ASTCInfill infill;
+	BuildASTCInfill(block_width, block_height, block_mode.grid_width, block_mode.grid_height, infill);
+	for (int y = 0; y < block_height; ++y)
+	{
+		for (int x = 0; x < block_width; ++x)
+		{
+			int texel = y * block_width + x;
+			const ASTCEndpoints& e = endpoints[partitions == 1 ? 0 : GetASTCPartition(seed, x, y, partitions, texel_count)];
+			int w[2];
+			for (int plane = 0; plane < planes; ++plane)
+			{
+				w[plane] = InfillASTCWeight(infill, weights + plane, planes, texel);
+			}
+			for (int c = 0; c < 4; ++c)
+			{
+				bool hdr = c < 3 ? e.hdr_rgb : e.hdr_alpha;
+				int value = InterpolateASTC(e.e0[c], e.e1[c], w[c == ccs ? 1 : 0]);
+				rgba[4 * texel + c] = ToFloat(value, hdr, srgb);
+			}
+		}
+	}
+}
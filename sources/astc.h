@@ -0,0 +1,44 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#pragma once
+#include <PVRTextureDefines.h>
+
+#include <cstdint>
+
+
+// Block encoder and decoder of ASTC, for 2D footprints from 4x4 to 12x12. Blocks take texels row by row as RGBA float32.
+//
+// LDR blocks clamp values to [0, 1] and use direct endpoint modes: luminance, luminance-alpha, RGB and RGBA, whichever
+// has the fewest channels for the block. HDR blocks encode RGB as LNS endpoints with the direct HDR RGB mode and alpha
+// with LDR endpoints, negative values are clamped to 0. Blocks of a single colour are stored as void extent blocks.
+//
+// Partitionings are ranked by how well they match a k-means clustering of the block, only the best ranked ones are
+// encoded. Below Best, partitionings and weight grids are skipped when their fit with unquantized weights is already
+// worse than the best encoding found, and only the finest weight range of each colour range is tried until the error
+// grows again. Quality levels trade search for speed:
+//   Fastest - one partition, the two largest weight grids;
+//   Fast    - up to 2 partitions, 2 candidate partitionings, 4 largest weight grids;
+//   Normal  - up to 3 partitions, 4 candidates, dual weight planes, 8 largest grids, endpoint refinement;
+//   High    - up to 4 partitions, 8 candidates, 16 largest grids, more refinement passes;
+//   Best    - up to 4 partitions, 32 candidates, all weight grids, no early out.
+
+void EncodeASTCBlock(const float* rgba, int block_width, int block_height, uint8_t* block,
+                     pvrtexture::ECompressorQuality quality, bool hdr);
+
+// Writes RGBA float32 texels. HDR endpoints decode to their half float values. Invalid blocks decode to magenta.
+// With srgb, LDR values are expanded as the sRGB profile requires and returned without gamma correction
+void DecodeASTCBlock(const uint8_t* block, int block_width, int block_height, float* rgba, bool srgb);
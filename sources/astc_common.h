@@ -0,0 +1,137 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#pragma once
+#include "bptc_common.h"
+
+#include <cstdint>
+
+
+// Tables and helpers shared by the ASTC encoder and decoder. Only 2D blocks are supported, up to 12x12 texels.
+
+enum
+{
+	ASTCMaxTexels = 144,
+	ASTCMaxWeights = 64,
+	ASTCMaxColourValues = 18,
+	// quantization ranges of integer sequences: 2, 3, 4, 5, 6, 8, 10, ..., 256 levels
+	ASTCRangeCount = 21,
+	// weights use only the ranges up to 32 levels
+	ASTCWeightRangeCount = 12,
+	// colour values need at least 6 levels
+	ASTCMinColourRange = 4,
+};
+
+// Number of levels of each quantization range
+extern const int ASTCLevels[ASTCRangeCount];
+
+// Size of an integer sequence of count values with the given range, in bits
+int GetISEBits(int count, int range);
+
+// Weights are stored from the most significant bit of the block down, reversing the block lets them be read
+// and written like the rest
+void ReverseASTCBits(const uint8_t* block, uint8_t* reversed);
+
+// Integer sequences packed with trits, quints or plain bits. Values are not unquantized
+void EncodeISE(BlockBitWriter& writer, const uint8_t* values, int count, int range);
+void DecodeISE(BlockBitReader& reader, uint8_t* values, int count, int range);
+
+// Unquantized colour values in [0, 255], indexed by the encoded value
+const uint8_t* GetASTCColourValues(int range);
+// Unquantized weights in [0, 64], indexed by the encoded value
+const uint8_t* GetASTCWeightValues(int range);
+// Encoded value of the nearest colour level
+uint8_t QuantizeASTCColour(int range, int value);
+// Encoded value of the nearest colour level with the same most significant bit as value
+uint8_t QuantizeASTCColourKeepMSB(int range, int value);
+// Encoded value of the nearest weight, weight is in [0, 64]
+uint8_t QuantizeASTCWeight(int range, float weight);
+
+struct ASTCBlockMode
+{
+	int grid_width;
+	int grid_height;
+	bool dual_plane;
+	int weight_range;
+	int weight_bits;
+};
+
+// Decodes the 11 bit block mode field. Returns false for void extent blocks and for reserved or invalid modes
+bool DecodeASTCBlockMode(int mode, ASTCBlockMode& block_mode);
+
+inline bool IsASTCVoidExtent(int mode)
+{
+	return (mode & 0x1FF) == 0x1FC;
+}
+
+// Partition of a texel, for blocks with 2, 3 or 4 partitions
+int GetASTCPartition(int seed, int x, int y, int partitions, int texel_count);
+
+// Texels interpolate their weights from up to 4 points of the weight grid
+struct ASTCInfill
+{
+	uint8_t index[ASTCMaxTexels][4];
+	// out of 16
+	uint8_t weight[ASTCMaxTexels][4];
+};
+
+void BuildASTCInfill(int block_width, int block_height, int grid_width, int grid_height, ASTCInfill& infill);
+
+// Values of the weight plane at texel, weights of grid points are interleaved with the given stride
+inline int InfillASTCWeight(const ASTCInfill& infill, const uint8_t* grid, int stride, int texel)
+{
+	int sum = 8;
+	for (int k = 0; k < 4; ++k)
+	{
+		sum += grid[infill.index[texel][k] * stride] * infill.weight[texel][k];
+	}
+	return sum >> 4;
+}
+
+// Number of colour values of a colour endpoint mode
+inline int GetASTCColourValueCount(int cem)
+{
+	return ((cem >> 2) + 1) * 2;
+}
+
+inline bool IsASTCHDRMode(int cem)
+{
+	return cem == 2 || cem == 3 || cem == 7 || cem == 11 || cem == 14 || cem == 15;
+}
+
+// Endpoints as 16 bit values that are interpolated with weights. Channels flagged as HDR hold LNS values,
+// the others UNORM16 values
+struct ASTCEndpoints
+{
+	int e0[4];
+	int e1[4];
+	bool hdr_rgb;
+	bool hdr_alpha;
+};
+
+// Decodes unquantized colour values of a colour endpoint mode. sRGB expands LDR values with 0x80 in the low byte
+void UnpackASTCEndpoints(int cem, const int* values, bool srgb, ASTCEndpoints& endpoints);
+
+// 16 bit value, interpolated between endpoints with a weight in [0, 64]
+inline int InterpolateASTC(int e0, int e1, int weight)
+{
+	return (e0 * (64 - weight) + e1 * weight + 32) >> 6;
+}
+
+// Half float bits of an interpolated LNS value
+uint16_t ASTCLNSToHalf(int lns);
+// Inverse of ASTCLNSToHalf, not rounded to an integer
+float ASTCHalfToLNS(uint16_t half);
@@ -0,0 +1,1358 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#include "astc.h"
+#include "astc_common.h"
+#include "surface.h"
+#include "simd.h"
+#include "common.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+
+namespace
+{
+	struct Search
+	{
+		int partitions;
+		// partitionings that are encoded for each partition count above 1
+		int candidates;
+		bool dual_plane;
+		// only dual plane encodings of the component that fits the other ones worst are tried, unless this is set
+		bool all_planes;
+		// largest weight grids that are tried, for each plane count
+		int grids;
+		// passes that fit endpoints to quantized weights and weights to the fitted endpoints
+		int refine;
+		// mean squared error of a channel, in [0, 255] units, below which no more partition counts are tried
+		float threshold;
+		// partitionings and weight grids that fit worse than the best encoding before quantization are skipped, as are
+		// weight ranges of a grid past the one with least error
+		bool prune;
+	};
+
+	Search GetSearch(pvrtexture::ECompressorQuality quality)
+	{
+		switch (quality)
+		{
+			case pvrtexture::ePVRTCFastest: return {1, 0, false, false, 2, 0, 0.0f, true};
+			case pvrtexture::ePVRTCFast: return {2, 2, false, false, 4, 1, 4.0f, true};
+			case pvrtexture::ePVRTCHigh: return {4, 8, true, true, 16, 2, 0.25f, true};
+			case pvrtexture::ePVRTCBest: return {4, 32, true, true, 1 << 10, 3, 0.0f, false};
+			default: return {3, 4, true, false, 8, 1, 1.0f, true};
+		}
+	}
+
+	struct ModeInfo
+	{
+		int mode;
+		int weight_range;
+		int weight_bits;
+	};
+
+	// Weight grid of a footprint with the block modes that use it, ordered by weight range
+	struct Grid
+	{
+		int width;
+		int height;
+		int planes;
+		ASTCInfill infill;
+		// sum of infill weights of the texels that take weight from each grid point
+		float coverage[ASTCMaxWeights];
+		std::vector<ModeInfo> modes;
+	};
+
+	struct Partitioning
+	{
+		int seed;
+		uint8_t partition[ASTCMaxTexels];
+		// one bit per texel for each partition
+		uint64_t masks[4][3];
+	};
+
+	int PopCount(uint64_t x)
+	{
+		x = x - ((x >> 1) & 0x5555555555555555ull);
+		x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+		x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+		return (int)((x * 0x0101010101010101ull) >> 56);
+	}
+
+	void SetMasks(const uint8_t* partition, int count, uint64_t (*masks)[3])
+	{
+		std::fill(&masks[0][0], &masks[0][0] + 4 * 3, 0ull);
+		for (int i = 0; i < count; ++i)
+		{
+			masks[partition[i]][i / 64] |= 1ull << (i % 64);
+		}
+	}
+
+	struct Footprint
+	{
+		Footprint(int width, int height): width(width), height(height), count(width * height)
+		{
+			for (int mode = 0; mode < 2048; ++mode)
+			{
+				ASTCBlockMode block_mode;
+				if (!DecodeASTCBlockMode(mode, block_mode) || block_mode.grid_width > width || block_mode.grid_height > height)
+				{
+					continue;
+				}
+				int planes = block_mode.dual_plane ? 2 : 1;
+				auto grid = std::find_if(grids.begin(), grids.end(), [&](const Grid& g)
+				{
+					return g.width == block_mode.grid_width && g.height == block_mode.grid_height && g.planes == planes;
+				});
+				if (grid == grids.end())
+				{
+					grids.emplace_back();
+					grid = grids.end() - 1;
+					grid->width = block_mode.grid_width;
+					grid->height = block_mode.grid_height;
+					grid->planes = planes;
+				}
+				grid->modes.push_back({mode, block_mode.weight_range, block_mode.weight_bits});
+			}
+			std::sort(grids.begin(), grids.end(), [](const Grid& a, const Grid& b)
+			{
+				return a.width * a.height > b.width * b.height;
+			});
+			for (Grid& grid: grids)
+			{
+				std::sort(grid.modes.begin(), grid.modes.end(), [](const ModeInfo& a, const ModeInfo& b)
+				{
+					return a.weight_range < b.weight_range;
+				});
+				BuildASTCInfill(width, height, grid.width, grid.height, grid.infill);
+				std::fill(grid.coverage, grid.coverage + ASTCMaxWeights, 0.0f);
+				for (int i = 0; i < count; ++i)
+				{
+					for (int k = 0; k < 4; ++k)
+					{
+						grid.coverage[grid.infill.index[i][k]] += grid.infill.weight[i][k];
+					}
+				}
+			}
+
+			// partitionings with an empty partition and those that repeat another one with different labels are dropped
+			for (int partitions = 2; partitions <= 4; ++partitions)
+			{
+				std::set<std::vector<uint8_t>> seen;
+				for (int seed = 0; seed < 1024; ++seed)
+				{
+					Partitioning p;
+					p.seed = seed;
+					std::vector<uint8_t> canonical(count);
+					int labels[4] = {-1, -1, -1, -1};
+					int used = 0;
+					for (int y = 0; y < height; ++y)
+					{
+						for (int x = 0; x < width; ++x)
+						{
+							int i = y * width + x;
+							p.partition[i] = (uint8_t)GetASTCPartition(seed, x, y, partitions, count);
+							if (labels[p.partition[i]] < 0)
+							{
+								labels[p.partition[i]] = used++;
+							}
+							canonical[i] = (uint8_t)labels[p.partition[i]];
+						}
+					}
+					if (used < partitions || !seen.insert(canonical).second)
+					{
+						continue;
+					}
+					SetMasks(p.partition, count, p.masks);
+					partitionings[partitions - 2].push_back(p);
+				}
+			}
+		}
+
+		int width;
+		int height;
+		int count;
+		std::vector<Grid> grids;
+		std::vector<Partitioning> partitionings[3];
+	};
+
+	const Footprint& GetFootprint(int width, int height)
+	{
+		static const int sizes[14][2] = {
+				{4, 4}, {5, 4}, {5, 5}, {6, 5}, {6, 6}, {8, 5}, {8, 6}, {8, 8}, {10, 5}, {10, 6}, {10, 8}, {10, 10}, {12, 10}, {12, 12}
+		};
+		static std::once_flag flags[14];
+		static std::unique_ptr<Footprint> footprints[14];
+		for (int i = 0; i < 14; ++i)
+		{
+			if (sizes[i][0] == width && sizes[i][1] == height)
+			{
+				std::call_once(flags[i], [&]{ footprints[i].reset(new Footprint(width, height)); });
+				return *footprints[i];
+			}
+		}
+		throw runtime_error("Unsupported ASTC block size %dx%d", width, height);
+	}
+
+	// Texels in the components of the colour endpoint mode, SoA and zero padded. LDR values are in [0, 255] units,
+	// HDR colours are LNS values in 12 bit units and HDR alpha is in [0, 255] units times 16, so that errors of all
+	// components are comparable
+	struct BlockTexels
+	{
+		int count;
+		bool hdr;
+		int cem;
+		int components;
+		// colour channel of each component, luminance is stored as red
+		int channel[4];
+		float error_weight[4];
+		float limit[4];
+		float value[4][ASTCMaxTexels];
+		// 1 for texels of the block, 0 for padding
+		float mask[ASTCMaxTexels];
+	};
+
+	void LoadTexels(const float* rgba, int count, bool hdr, BlockTexels& t)
+	{
+		bool grey = !hdr;
+		bool opaque = true;
+		for (int i = 0; i < count; ++i)
+		{
+			const float* p = rgba + 4 * i;
+			if (hdr)
+			{
+				opaque = opaque && std::abs(p[3] - 1.0f) < 0.5f / 255.0f;
+			}
+			else
+			{
+				opaque = opaque && p[3] >= 1.0f - 0.5f / 255.0f;
+				grey = grey && std::abs(p[0] - p[1]) < 0.5f / 255.0f && std::abs(p[0] - p[2]) < 0.5f / 255.0f;
+			}
+		}
+		t.count = count;
+		t.hdr = hdr;
+		if (hdr)
+		{
+			t.cem = opaque ? 11 : 14;
+		}
+		else
+		{
+			t.cem = grey ? (opaque ? 0 : 4) : (opaque ? 8 : 12);
+		}
+		t.components = grey ? (opaque ? 1 : 2) : (opaque ? 3 : 4);
+		for (int k = 0; k < 4; ++k)
+		{
+			t.channel[k] = grey && k == 1 ? 3 : k;
+			t.error_weight[k] = grey && k == 0 ? 3.0f : 1.0f;
+			t.limit[k] = hdr ? (k < 3 ? 4095.0f : 255.0f * 16.0f) : 255.0f;
+		}
+		std::fill(&t.value[0][0], &t.value[0][0] + 4 * ASTCMaxTexels, 0.0f);
+		std::fill(t.mask, t.mask + ASTCMaxTexels, 0.0f);
+		for (int i = 0; i < count; ++i)
+		{
+			t.mask[i] = 1.0f;
+			for (int k = 0; k < t.components; ++k)
+			{
+				float x = rgba[4 * i + t.channel[k]];
+				if (hdr && t.channel[k] < 3)
+				{
+					x = ASTCHalfToLNS(FloatToHalf(std::min(std::max(x, 0.0f), 65504.0f))) / 16.0f;
+				}
+				else
+				{
+					x = std::min(std::max(x, 0.0f), 1.0f) * 255.0f * (hdr ? 16.0f : 1.0f);
+				}
+				t.value[k][i] = x;
+			}
+		}
+	}
+
+	bool IsConstant(const float* rgba, int count)
+	{
+		for (int i = 1; i < count; ++i)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				if (rgba[4 * i + c] != rgba[c])
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	void WriteVoidExtent(const float* colour, bool hdr, uint8_t* block)
+	{
+		BlockBitWriter writer;
+		// bits 10 and 11 are reserved and set, the extent coordinates are all ones, meaning no extent is given
+		writer.Write(0x1FC | (hdr ? 0x200 : 0) | 0xC00, 12);
+		writer.Write(0xFFFFFFFFu, 32);
+		writer.Write(0xFFFFFu, 20);
+		for (int c = 0; c < 4; ++c)
+		{
+			if (hdr)
+			{
+				writer.Write(FloatToHalf(std::min(std::max(colour[c], 0.0f), 65504.0f)), 16);
+			}
+			else
+			{
+				writer.Write((uint32_t)(std::min(std::max(colour[c], 0.0f), 1.0f) * 65535.0f + 0.5f), 16);
+			}
+		}
+		writer.Store(block);
+	}
+
+	// Endpoints of the partitions in working units
+	struct Lines
+	{
+		float e0[4][4];
+		float e1[4][4];
+	};
+
+	// Texels of each partition
+	struct Members
+	{
+		int count[4];
+		uint8_t texels[4][ASTCMaxTexels];
+	};
+
+	void GetMembers(const uint8_t* partition, int partitions, int count, Members& members)
+	{
+		std::fill(members.count, members.count + 4, 0);
+		for (int i = 0; i < count; ++i)
+		{
+			int p = partitions == 1 ? 0 : partition[i];
+			members.texels[p][members.count[p]++] = (uint8_t)i;
+		}
+	}
+
+	// Power iteration from the component with the largest variance, the axis points towards increasing values
+	void PrincipalAxis(const float (*covariance)[4], int components, float* axis)
+	{
+		int largest = 0;
+		for (int k = 1; k < components; ++k)
+		{
+			if (covariance[k][k] > covariance[largest][largest])
+			{
+				largest = k;
+			}
+		}
+		float v[4] = {};
+		for (int k = 0; k < components; ++k)
+		{
+			v[k] = covariance[largest][k];
+		}
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[4] = {};
+			float norm = 0.0f;
+			for (int k = 0; k < components; ++k)
+			{
+				for (int j = 0; j < components; ++j)
+				{
+					next[k] += covariance[k][j] * v[j];
+				}
+				norm = std::max(norm, std::abs(next[k]));
+			}
+			if (norm == 0.0f)
+			{
+				break;
+			}
+			for (int k = 0; k < components; ++k)
+			{
+				v[k] = next[k] / norm;
+			}
+		}
+		float length = 0.0f;
+		float sum = 0.0f;
+		for (int k = 0; k < components; ++k)
+		{
+			length += v[k] * v[k];
+			sum += v[k];
+		}
+		length = std::sqrt(length);
+		for (int k = 0; k < components; ++k)
+		{
+			axis[k] = length > 0.0f ? (sum < 0.0f ? -v[k] : v[k]) / length : 1.0f / std::sqrt((float)components);
+		}
+	}
+
+	// Projections of all texels on a line, vectorized over texels
+	void Project(const BlockTexels& t, const float* origin, const float* direction, const bool* use, float* result)
+	{
+		for (int i = 0; i < t.count; i += simd::width)
+		{
+			simd::vfloat sum = simd::set1(0.0f);
+			for (int k = 0; k < t.components; ++k)
+			{
+				if (use[k])
+				{
+					sum = sum + (simd::load(t.value[k] + i) - simd::set1(origin[k])) * simd::set1(direction[k]);
+				}
+			}
+			simd::store(result + i, sum);
+		}
+	}
+
+	// Endpoints and ideal weights in [0, 1] of a partitioning. Components other than plane2 lie on the principal
+	// axis of each partition, the plane2 component spans its own range with the second weight plane
+	void FitLines(const BlockTexels& t, const Members& members, int partitions, int plane2, Lines& lines,
+	              float (*weights)[ASTCMaxTexels])
+	{
+		bool use[2][4];
+		for (int k = 0; k < 4; ++k)
+		{
+			use[0][k] = k != plane2;
+			use[1][k] = k == plane2;
+		}
+		float projection[ASTCMaxTexels];
+		for (int p = 0; p < partitions; ++p)
+		{
+			const int n = members.count[p];
+			const uint8_t* texels = members.texels[p];
+			float mean[4] = {};
+			for (int j = 0; j < n; ++j)
+			{
+				for (int k = 0; k < t.components; ++k)
+				{
+					mean[k] += t.value[k][texels[j]];
+				}
+			}
+			for (int k = 0; k < t.components; ++k)
+			{
+				mean[k] /= (float)n;
+			}
+			float covariance[4][4] = {};
+			for (int j = 0; j < n; ++j)
+			{
+				float d[4];
+				for (int k = 0; k < t.components; ++k)
+				{
+					d[k] = use[0][k] ? t.value[k][texels[j]] - mean[k] : 0.0f;
+				}
+				for (int k = 0; k < t.components; ++k)
+				{
+					for (int l = k; l < t.components; ++l)
+					{
+						covariance[k][l] += d[k] * d[l];
+					}
+				}
+			}
+			for (int k = 0; k < t.components; ++k)
+			{
+				for (int l = 0; l < k; ++l)
+				{
+					covariance[k][l] = covariance[l][k];
+				}
+			}
+
+			for (int plane = 0; plane < (plane2 >= 0 ? 2 : 1); ++plane)
+			{
+				float axis[4] = {};
+				if (plane == 0)
+				{
+					PrincipalAxis(covariance, t.components, axis);
+					for (int k = 0; k < t.components; ++k)
+					{
+						axis[k] = use[0][k] ? axis[k] : 0.0f;
+					}
+				}
+				else
+				{
+					axis[plane2] = 1.0f;
+				}
+				Project(t, mean, axis, use[plane], projection);
+				float low = FLT_MAX, high = -FLT_MAX;
+				for (int j = 0; j < n; ++j)
+				{
+					low = std::min(low, projection[texels[j]]);
+					high = std::max(high, projection[texels[j]]);
+				}
+				float scale = high - low > 1e-6f ? 1.0f / (high - low) : 0.0f;
+				for (int j = 0; j < n; ++j)
+				{
+					weights[plane][texels[j]] = (projection[texels[j]] - low) * scale;
+				}
+				for (int k = 0; k < t.components; ++k)
+				{
+					if (use[plane][k])
+					{
+						lines.e0[p][k] = std::min(std::max(mean[k] + axis[k] * low, 0.0f), t.limit[k]);
+						lines.e1[p][k] = std::min(std::max(mean[k] + axis[k] * high, 0.0f), t.limit[k]);
+					}
+				}
+			}
+		}
+	}
+
+	// Weights of grid points in [0, 64] that approximate texel weights in [0, 1]: coverage weighted averages, followed
+	// by a correction step with the residuals of the interpolated result
+	void Decimate(const Grid& grid, int count, const float* texel_weights, float* grid_weights)
+	{
+		const int points = grid.width * grid.height;
+		if (points == count)
+		{
+			for (int i = 0; i < count; ++i)
+			{
+				grid_weights[i] = texel_weights[i] * 64.0f;
+			}
+			return;
+		}
+		float sum[ASTCMaxWeights] = {};
+		for (int i = 0; i < count; ++i)
+		{
+			for (int k = 0; k < 4; ++k)
+			{
+				sum[grid.infill.index[i][k]] += grid.infill.weight[i][k] * texel_weights[i];
+			}
+		}
+		for (int j = 0; j < points; ++j)
+		{
+			grid_weights[j] = grid.coverage[j] > 0.0f ? sum[j] / grid.coverage[j] : 0.0f;
+			sum[j] = 0.0f;
+		}
+		for (int i = 0; i < count; ++i)
+		{
+			float interpolated = 0.0f;
+			for (int k = 0; k < 4; ++k)
+			{
+				interpolated += grid.infill.weight[i][k] * grid_weights[grid.infill.index[i][k]];
+			}
+			float residual = texel_weights[i] - interpolated / 16.0f;
+			for (int k = 0; k < 4; ++k)
+			{
+				sum[grid.infill.index[i][k]] += grid.infill.weight[i][k] * residual;
+			}
+		}
+		for (int j = 0; j < points; ++j)
+		{
+			float w = grid.coverage[j] > 0.0f ? grid_weights[j] + sum[j] / grid.coverage[j] : 0.0f;
+			grid_weights[j] = std::min(std::max(w, 0.0f), 1.0f) * 64.0f;
+		}
+	}
+
+	// Quantized weights of a plane, encoded values go to every planes-th entry of encoded
+	void QuantizeWeights(const Grid& grid, int range, int count, const float* grid_weights, int plane, uint8_t* encoded,
+	                     float* texel_weights)
+	{
+		const int points = grid.width * grid.height;
+		const uint8_t* values = GetASTCWeightValues(range);
+		uint8_t unquantized[ASTCMaxWeights];
+		for (int j = 0; j < points; ++j)
+		{
+			uint8_t q = QuantizeASTCWeight(range, grid_weights[j]);
+			encoded[j * grid.planes + plane] = q;
+			unquantized[j] = values[q];
+		}
+		for (int i = 0; i < count; ++i)
+		{
+			texel_weights[i] = (float)InfillASTCWeight(grid.infill, unquantized, 1, i) * (1.0f / 64.0f);
+		}
+	}
+
+	// Least squares endpoints of each partition for the given weights
+	void RefineLines(const BlockTexels& t, const Members& members, int partitions, int plane2,
+	                 const float (*weights)[ASTCMaxTexels], Lines& lines)
+	{
+		for (int p = 0; p < partitions; ++p)
+		{
+			const int n = members.count[p];
+			const uint8_t* texels = members.texels[p];
+			for (int plane = 0; plane < (plane2 >= 0 ? 2 : 1); ++plane)
+			{
+				float a00 = 0.0f, a01 = 0.0f, a11 = 0.0f;
+				float b0[4] = {}, b1[4] = {};
+				for (int j = 0; j < n; ++j)
+				{
+					float f = weights[plane][texels[j]];
+					float g = 1.0f - f;
+					a00 += g * g;
+					a01 += g * f;
+					a11 += f * f;
+					for (int k = 0; k < t.components; ++k)
+					{
+						b0[k] += g * t.value[k][texels[j]];
+						b1[k] += f * t.value[k][texels[j]];
+					}
+				}
+				float det = a00 * a11 - a01 * a01;
+				if (det < 1e-3f * (a00 + a11) * (a00 + a11))
+				{
+					continue;
+				}
+				for (int k = 0; k < t.components; ++k)
+				{
+					if ((k == plane2) != (plane == 1))
+					{
+						continue;
+					}
+					float e0 = (b0[k] * a11 - b1[k] * a01) / det;
+					float e1 = (b1[k] * a00 - b0[k] * a01) / det;
+					lines.e0[p][k] = std::min(std::max(e0, 0.0f), t.limit[k]);
+					lines.e1[p][k] = std::min(std::max(e1, 0.0f), t.limit[k]);
+				}
+			}
+		}
+	}
+
+	// Ideal weights in [0, 1] of texels on the lines between the endpoints of their partitions
+	void ProjectOnLines(const BlockTexels& t, const uint8_t* partition, int partitions, int plane2, const Lines& lines,
+	                    float (*weights)[ASTCMaxTexels])
+	{
+		bool use[4];
+		for (int plane = 0; plane < (plane2 >= 0 ? 2 : 1); ++plane)
+		{
+			for (int k = 0; k < 4; ++k)
+			{
+				use[k] = (k == plane2) == (plane == 1);
+			}
+			float projection[ASTCMaxTexels];
+			for (int p = 0; p < partitions; ++p)
+			{
+				float direction[4] = {};
+				float length = 0.0f;
+				for (int k = 0; k < t.components; ++k)
+				{
+					direction[k] = use[k] ? lines.e1[p][k] - lines.e0[p][k] : 0.0f;
+					length += direction[k] * direction[k];
+				}
+				for (int k = 0; k < t.components; ++k)
+				{
+					direction[k] = length > 0.0f ? direction[k] / length : 0.0f;
+				}
+				Project(t, lines.e0[p], direction, use, projection);
+				for (int i = 0; i < t.count; ++i)
+				{
+					if (partitions == 1 || partition[i] == p)
+					{
+						weights[plane][i] = std::min(std::max(projection[i], 0.0f), 1.0f);
+					}
+				}
+			}
+		}
+	}
+
+	// Next colour level above or below the given one, -1 if there is none
+	int GetNextColourLevel(int range, int encoded, int direction)
+	{
+		const uint8_t* values = GetASTCColourValues(range);
+		for (int x = values[encoded] + direction; x >= 0 && x <= 255; x += direction)
+		{
+			int q = QuantizeASTCColour(range, x);
+			if (values[q] != values[encoded])
+			{
+				return q;
+			}
+		}
+		return -1;
+	}
+
+	void QuantizeLDREndpoints(const BlockTexels& t, const float* e0, const float* e1, int range, uint8_t* encoded)
+	{
+		const uint8_t* values = GetASTCColourValues(range);
+		const float scale = t.hdr ? 1.0f / 16.0f : 1.0f;
+		for (int k = 0; k < t.components; ++k)
+		{
+			encoded[2 * k] = QuantizeASTCColour(range, (int)(e0[k] * scale + 0.5f));
+			encoded[2 * k + 1] = QuantizeASTCColour(range, (int)(e1[k] * scale + 0.5f));
+		}
+		if (t.cem != 8 && t.cem != 12)
+		{
+			return;
+		}
+		// direct RGB modes swap the endpoints and contract blue when the second endpoint has a smaller sum, the
+		// endpoints are moved apart until that does not happen
+		int s0 = values[encoded[0]] + values[encoded[2]] + values[encoded[4]];
+		int s1 = values[encoded[1]] + values[encoded[3]] + values[encoded[5]];
+		while (s1 < s0)
+		{
+			int k = 0;
+			for (int c = 1; c < 3; ++c)
+			{
+				if (values[encoded[2 * c]] - values[encoded[2 * c + 1]] > values[encoded[2 * k]] - values[encoded[2 * k + 1]])
+				{
+					k = c;
+				}
+			}
+			int up = GetNextColourLevel(range, encoded[2 * k + 1], 1);
+			if (up >= 0)
+			{
+				s1 += values[up] - values[encoded[2 * k + 1]];
+				encoded[2 * k + 1] = (uint8_t)up;
+			}
+			else
+			{
+				int down = GetNextColourLevel(range, encoded[2 * k], -1);
+				s0 -= values[encoded[2 * k]] - values[down];
+				encoded[2 * k] = (uint8_t)down;
+			}
+		}
+	}
+
+	// Bits of the fields of HDR RGB endpoint mode 11 for each of its 8 submodes
+	const int HDRABits[8] = {9, 9, 10, 10, 11, 11, 12, 12};
+	const int HDRBBits[8] = {7, 8, 6, 7, 8, 6, 7, 6};
+	const int HDRCBits[8] = {6, 6, 7, 7, 6, 8, 7, 7};
+	const int HDRDBits[8] = {7, 6, 7, 6, 5, 6, 5, 6};
+
+	// Places the fields of a submode into the 6 colour values, the inverse of the decoder's bit shuffling.
+	// Submode and major component are in the most significant bits of values 1 to 5
+	void PackHDRRGB(int mode, int major, int a, int b0, int b1, int c, int d0, int d1, int* v)
+	{
+		const int one_hot = 1 << mode;
+		const int d_mask = (1 << HDRDBits[mode]) - 1;
+		d0 &= d_mask;
+		d1 &= d_mask;
+		int bit0 = (one_hot & 0xA4) ? a >> 9 : b0 >> 6;
+		int bit1 = (one_hot & 0x04) ? c >> 6 : (one_hot & 0xA0) ? a >> 10 : b1 >> 6;
+		int bit2 = (one_hot & 0x08) ? a >> 9 : (one_hot & 0xC0) ? a >> 11 : (one_hot & 0x20) ? c >> 7 : (one_hot & 0x12) ? b0 >> 7 : d0 >> 6;
+		int bit3 = (one_hot & 0xE8) ? c >> 6 : (one_hot & 0x12) ? b1 >> 7 : d1 >> 6;
+		int bit4 = (one_hot & 0x50) ? a >> 9 : d0 >> 5;
+		int bit5 = (one_hot & 0x50) ? a >> 10 : d1 >> 5;
+		v[0] = a & 0xFF;
+		v[1] = (c & 0x3F) | (((a >> 8) & 1) << 6) | ((mode & 1) << 7);
+		v[2] = (b0 & 0x3F) | ((bit0 & 1) << 6) | (((mode >> 1) & 1) << 7);
+		v[3] = (b1 & 0x3F) | ((bit1 & 1) << 6) | (((mode >> 2) & 1) << 7);
+		v[4] = (d0 & 0x1F) | ((bit4 & 1) << 5) | ((bit2 & 1) << 6) | ((major & 1) << 7);
+		v[5] = (d1 & 0x1F) | ((bit5 & 1) << 5) | ((bit3 & 1) << 6) | ((major >> 1) << 7);
+	}
+
+	inline int RoundClamp(float x, int low, int high)
+	{
+		return std::min(std::max((int)std::floor(x + 0.5f), low), high);
+	}
+
+	// Tries all submodes of HDR RGB endpoint mode 11 and its direct submode, keeps the one that reproduces the
+	// endpoints best after quantization of the colour values. Endpoints are 12 bit LNS values
+	void QuantizeHDREndpoints(const float* e0, const float* e1, int range, uint8_t* encoded)
+	{
+		const uint8_t* values = GetASTCColourValues(range);
+		int major = 0;
+		for (int k = 1; k < 3; ++k)
+		{
+			if (e1[k] > e1[major])
+			{
+				major = k;
+			}
+		}
+		// the decoder swaps red with the major component
+		int order[3] = {0, 1, 2};
+		std::swap(order[0], order[major]);
+		float c0[3], c1[3];
+		for (int k = 0; k < 3; ++k)
+		{
+			c0[k] = e0[order[k]];
+			c1[k] = e1[order[k]];
+		}
+
+		float best_error = FLT_MAX;
+		for (int mode = 0; mode <= 8; ++mode)
+		{
+			int v[6];
+			if (mode < 8)
+			{
+				const float scale = (float)(1 << ((mode >> 1) ^ 3));
+				const int d_limit = 1 << (HDRDBits[mode] - 1);
+				int a = RoundClamp(c1[0] / scale, 0, (1 << HDRABits[mode]) - 1);
+				float base = (float)a * scale;
+				int b0 = RoundClamp((base - c1[1]) / scale, 0, (1 << HDRBBits[mode]) - 1);
+				int b1 = RoundClamp((base - c1[2]) / scale, 0, (1 << HDRBBits[mode]) - 1);
+				int c = RoundClamp((base - c0[0]) / scale, 0, (1 << HDRCBits[mode]) - 1);
+				int d0 = RoundClamp((base - (float)(b0 + c) * scale - c0[1]) / scale, -d_limit, d_limit - 1);
+				int d1 = RoundClamp((base - (float)(b1 + c) * scale - c0[2]) / scale, -d_limit, d_limit - 1);
+				PackHDRRGB(mode, major, a, b0, b1, c, d0, d1, v);
+			}
+			else
+			{
+				// 8 bits of red and green, 7 bits of blue
+				v[0] = RoundClamp(e0[0] / 16.0f, 0, 255);
+				v[1] = RoundClamp(e1[0] / 16.0f, 0, 255);
+				v[2] = RoundClamp(e0[1] / 16.0f, 0, 255);
+				v[3] = RoundClamp(e1[1] / 16.0f, 0, 255);
+				v[4] = RoundClamp(e0[2] / 32.0f, 0, 127) | 0x80;
+				v[5] = RoundClamp(e1[2] / 32.0f, 0, 127) | 0x80;
+			}
+			uint8_t q[6];
+			int unquantized[6];
+			for (int i = 0; i < 6; ++i)
+			{
+				q[i] = i == 0 ? QuantizeASTCColour(range, v[i]) : QuantizeASTCColourKeepMSB(range, v[i]);
+				unquantized[i] = values[q[i]];
+			}
+			ASTCEndpoints endpoints;
+			UnpackASTCEndpoints(11, unquantized, false, endpoints);
+			float error = 0.0f;
+			for (int k = 0; k < 3; ++k)
+			{
+				float d0 = (float)endpoints.e0[k] / 16.0f - e0[k];
+				float d1 = (float)endpoints.e1[k] / 16.0f - e1[k];
+				error += d0 * d0 + d1 * d1;
+			}
+			if (error < best_error)
+			{
+				best_error = error;
+				std::copy(q, q + 6, encoded);
+			}
+		}
+	}
+
+	void QuantizeEndpoints(const BlockTexels& t, const Lines& lines, int partitions, int range, uint8_t* encoded)
+	{
+		const int n = GetASTCColourValueCount(t.cem);
+		for (int p = 0; p < partitions; ++p)
+		{
+			if (!t.hdr)
+			{
+				QuantizeLDREndpoints(t, lines.e0[p], lines.e1[p], range, encoded + p * n);
+				continue;
+			}
+			QuantizeHDREndpoints(lines.e0[p], lines.e1[p], range, encoded + p * n);
+			if (t.cem == 14)
+			{
+				encoded[p * n + 6] = QuantizeASTCColour(range, (int)(lines.e0[p][3] / 16.0f + 0.5f));
+				encoded[p * n + 7] = QuantizeASTCColour(range, (int)(lines.e1[p][3] / 16.0f + 0.5f));
+			}
+		}
+	}
+
+	// Endpoints that the decoder gets from the colour values, in working units
+	void DecodeEndpoints(const BlockTexels& t, const uint8_t* encoded, int partitions, int range, Lines& lines)
+	{
+		const uint8_t* values = GetASTCColourValues(range);
+		const int n = GetASTCColourValueCount(t.cem);
+		for (int p = 0; p < partitions; ++p)
+		{
+			int v[8];
+			for (int i = 0; i < n; ++i)
+			{
+				v[i] = values[encoded[p * n + i]];
+			}
+			ASTCEndpoints endpoints;
+			UnpackASTCEndpoints(t.cem, v, false, endpoints);
+			for (int k = 0; k < t.components; ++k)
+			{
+				int channel = t.channel[k];
+				bool hdr = channel < 3 ? endpoints.hdr_rgb : endpoints.hdr_alpha;
+				float scale = hdr ? 1.0f / 16.0f : (t.hdr ? 16.0f : 1.0f) / 257.0f;
+				lines.e0[p][k] = (float)endpoints.e0[channel] * scale;
+				lines.e1[p][k] = (float)endpoints.e1[channel] * scale;
+			}
+		}
+	}
+
+	// Weighted squared error of the block, vectorized over texels
+	float GetError(const BlockTexels& t, const uint8_t* partition, int partitions, int plane2, const Lines& lines,
+	               const float (*weights)[ASTCMaxTexels])
+	{
+		float base[ASTCMaxTexels] = {};
+		float delta[ASTCMaxTexels] = {};
+		simd::vfloat total = simd::set1(0.0f);
+		for (int k = 0; k < t.components; ++k)
+		{
+			if (partitions == 1)
+			{
+				std::fill(base, base + t.count, lines.e0[0][k]);
+				std::fill(delta, delta + t.count, lines.e1[0][k] - lines.e0[0][k]);
+			}
+			else
+			{
+				for (int i = 0; i < t.count; ++i)
+				{
+					base[i] = lines.e0[partition[i]][k];
+					delta[i] = lines.e1[partition[i]][k] - lines.e0[partition[i]][k];
+				}
+			}
+			const float* w = weights[k == plane2 ? 1 : 0];
+			simd::vfloat sum = simd::set1(0.0f);
+			for (int i = 0; i < t.count; i += simd::width)
+			{
+				simd::vfloat d = simd::load(t.value[k] + i) - (simd::load(base + i) + simd::load(delta + i) * simd::load(w + i));
+				sum = sum + d * d * simd::load(t.mask + i);
+			}
+			total = total + sum * simd::set1(t.error_weight[k]);
+		}
+		return simd::reduce_add(total);
+	}
+
+	struct Encoding
+	{
+		float error;
+		int mode;
+		int weight_range;
+		int weight_count;
+		int partitions;
+		int seed;
+		int plane2;
+		int colour_range;
+		uint8_t colour[ASTCMaxColourValues];
+		uint8_t weights[ASTCMaxWeights];
+	};
+
+	// A partitioning with the given plane layout, shared by all modes that are tried for it
+	struct Candidate
+	{
+		const uint8_t* partition;
+		Members members;
+		int partitions;
+		int seed;
+		int plane2;
+		Lines lines;
+		float weights[2][ASTCMaxTexels];
+	};
+
+	// Returns the error of the mode, best is updated when it is lower
+	float TryMode(const BlockTexels& t, const Grid& grid, const ModeInfo& mode, int colour_range, const Candidate& candidate,
+	             const float (*grid_weights)[ASTCMaxWeights], const Search& search, Encoding& best)
+	{
+		const int planes = grid.planes;
+		const int partitions = candidate.partitions;
+		Encoding e;
+		float weights[2][ASTCMaxTexels] = {};
+		for (int plane = 0; plane < planes; ++plane)
+		{
+			QuantizeWeights(grid, mode.weight_range, t.count, grid_weights[plane], plane, e.weights, weights[plane]);
+		}
+		Lines lines = candidate.lines;
+		for (int pass = 0; pass < search.refine; ++pass)
+		{
+			RefineLines(t, candidate.members, partitions, candidate.plane2, weights, lines);
+			if (pass + 1 < search.refine)
+			{
+				float ideal[2][ASTCMaxTexels] = {};
+				float decimated[2][ASTCMaxWeights];
+				ProjectOnLines(t, candidate.partition, partitions, candidate.plane2, lines, ideal);
+				for (int plane = 0; plane < planes; ++plane)
+				{
+					Decimate(grid, t.count, ideal[plane], decimated[plane]);
+					QuantizeWeights(grid, mode.weight_range, t.count, decimated[plane], plane, e.weights, weights[plane]);
+				}
+			}
+		}
+
+		QuantizeEndpoints(t, lines, partitions, colour_range, e.colour);
+		Lines decoded;
+		DecodeEndpoints(t, e.colour, partitions, colour_range, decoded);
+		e.error = GetError(t, candidate.partition, partitions, candidate.plane2, decoded, weights);
+
+		if (search.refine > 0 && e.error < best.error * (search.prune ? 1.25f : 2.0f))
+		{
+			// weights chosen for the endpoints the decoder sees
+			uint8_t encoded[ASTCMaxWeights];
+			float ideal[2][ASTCMaxTexels] = {};
+			float decimated[2][ASTCMaxWeights];
+			ProjectOnLines(t, candidate.partition, partitions, candidate.plane2, decoded, ideal);
+			for (int plane = 0; plane < planes; ++plane)
+			{
+				Decimate(grid, t.count, ideal[plane], decimated[plane]);
+				QuantizeWeights(grid, mode.weight_range, t.count, decimated[plane], plane, encoded, weights[plane]);
+			}
+			float error = GetError(t, candidate.partition, partitions, candidate.plane2, decoded, weights);
+			if (error < e.error)
+			{
+				e.error = error;
+				std::copy(encoded, encoded + grid.width * grid.height * planes, e.weights);
+			}
+		}
+
+		if (e.error < best.error)
+		{
+			e.mode = mode.mode;
+			e.weight_range = mode.weight_range;
+			e.weight_count = grid.width * grid.height * planes;
+			e.partitions = partitions;
+			e.seed = candidate.seed;
+			e.plane2 = candidate.plane2;
+			e.colour_range = colour_range;
+			best = e;
+		}
+		return e.error;
+	}
+
+	// Largest colour range whose values fit in the given number of bits, below ASTCMinColourRange if none does
+	int GetColourRange(int value_count, int bits)
+	{
+		int colour_range = ASTCRangeCount - 1;
+		while (colour_range >= ASTCMinColourRange && GetISEBits(value_count, colour_range) > bits)
+		{
+			--colour_range;
+		}
+		return colour_range;
+	}
+
+	// Texel weights in [0, 1] interpolated from unquantized grid weights in [0, 64]
+	void InfillWeights(const Grid& grid, int count, const float* grid_weights, float* texel_weights)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			float w = 0.0f;
+			for (int k = 0; k < 4; ++k)
+			{
+				w += grid.infill.weight[i][k] * grid_weights[grid.infill.index[i][k]];
+			}
+			texel_weights[i] = w * (1.0f / (16.0f * 64.0f));
+		}
+	}
+
+	void TryPartitioning(const BlockTexels& t, const Footprint& footprint, const Search& search, const uint8_t* partition,
+	                     int partitions, int seed, int plane2, Encoding& best)
+	{
+		const int planes = plane2 >= 0 ? 2 : 1;
+		const int value_count = partitions * GetASTCColourValueCount(t.cem);
+		const int header_bits = (partitions == 1 ? 17 : 29) + (planes == 2 ? 2 : 0);
+
+		Candidate candidate;
+		candidate.partition = partition;
+		candidate.partitions = partitions;
+		candidate.seed = seed;
+		candidate.plane2 = plane2;
+		GetMembers(partition, partitions, t.count, candidate.members);
+		std::fill(&candidate.weights[0][0], &candidate.weights[0][0] + 2 * ASTCMaxTexels, 0.0f);
+		FitLines(t, candidate.members, partitions, plane2, candidate.lines, candidate.weights);
+		if (search.prune && GetError(t, partition, partitions, plane2, candidate.lines, candidate.weights) >= best.error)
+		{
+			return;
+		}
+
+		int tried = 0;
+		for (const Grid& grid: footprint.grids)
+		{
+			if (tried >= search.grids)
+			{
+				break;
+			}
+			if (grid.planes != planes)
+			{
+				continue;
+			}
+			float grid_weights[2][ASTCMaxWeights];
+			for (int plane = 0; plane < planes; ++plane)
+			{
+				Decimate(grid, t.count, candidate.weights[plane], grid_weights[plane]);
+			}
+			if (GetColourRange(value_count, 128 - header_bits - grid.modes[0].weight_bits) < ASTCMinColourRange)
+			{
+				continue;
+			}
+			++tried;
+			if (search.prune)
+			{
+				float weights[2][ASTCMaxTexels] = {};
+				for (int plane = 0; plane < planes; ++plane)
+				{
+					InfillWeights(grid, t.count, grid_weights[plane], weights[plane]);
+				}
+				if (GetError(t, partition, partitions, plane2, candidate.lines, weights) >= best.error)
+				{
+					continue;
+				}
+			}
+			float previous = FLT_MAX;
+			for (size_t i = 0; i < grid.modes.size(); ++i)
+			{
+				// modes are ordered by weight range, the ones that follow leave even fewer bits for colours
+				const ModeInfo& mode = grid.modes[i];
+				int colour_range = GetColourRange(value_count, 128 - header_bits - mode.weight_bits);
+				if (colour_range < ASTCMinColourRange)
+				{
+					break;
+				}
+				// a finer weight range with the same colour range does at least as well
+				if (search.prune && i + 1 < grid.modes.size() &&
+				    GetColourRange(value_count, 128 - header_bits - grid.modes[i + 1].weight_bits) == colour_range)
+				{
+					continue;
+				}
+				float error = TryMode(t, grid, mode, colour_range, candidate, grid_weights, search, best);
+				if (search.prune && error > previous)
+				{
+					break;
+				}
+				previous = error;
+			}
+		}
+	}
+
+	// Component that is fitted worst by the principal axis of the block, the one that gains most from its own plane
+	int GetWorstComponent(const BlockTexels& t)
+	{
+		uint8_t partition[ASTCMaxTexels] = {};
+		Members members;
+		GetMembers(partition, 1, t.count, members);
+		Lines lines;
+		float weights[2][ASTCMaxTexels] = {};
+		FitLines(t, members, 1, -1, lines, weights);
+		int worst = 0;
+		float worst_error = -1.0f;
+		for (int k = 0; k < t.components; ++k)
+		{
+			float error = 0.0f;
+			for (int i = 0; i < t.count; ++i)
+			{
+				float d = t.value[k][i] - (lines.e0[0][k] + (lines.e1[0][k] - lines.e0[0][k]) * weights[0][i]);
+				error += d * d;
+			}
+			if (error > worst_error)
+			{
+				worst_error = error;
+				worst = k;
+			}
+		}
+		return worst;
+	}
+
+	void TryPlanes(const BlockTexels& t, const Footprint& footprint, const Search& search, const uint8_t* partition,
+	               int partitions, int seed, int worst, Encoding& best)
+	{
+		TryPartitioning(t, footprint, search, partition, partitions, seed, -1, best);
+		// 4 partitions can not have two planes, luminance can only have a separate alpha plane
+		if (!search.dual_plane || partitions == 4 || t.components == 1)
+		{
+			return;
+		}
+		if (t.components == 2)
+		{
+			TryPartitioning(t, footprint, search, partition, partitions, seed, 1, best);
+		}
+		else if (!search.all_planes)
+		{
+			TryPartitioning(t, footprint, search, partition, partitions, seed, t.components == 4 ? 3 : worst, best);
+		}
+		else
+		{
+			for (int k = 0; k < t.components; ++k)
+			{
+				TryPartitioning(t, footprint, search, partition, partitions, seed, k, best);
+			}
+		}
+	}
+
+	float GetDistance(const BlockTexels& t, int i, const float* centre)
+	{
+		float distance = 0.0f;
+		for (int k = 0; k < t.components; ++k)
+		{
+			float d = t.value[k][i] - centre[k];
+			distance += d * d * t.error_weight[k];
+		}
+		return distance;
+	}
+
+	// Clusters the block with k-means and sorts partitionings by the number of texels that differ from the clusters,
+	// for the best matching assignment of partitions to clusters
+	void RankPartitionings(const BlockTexels& t, const Footprint& footprint, int partitions, int candidates,
+	                       std::vector<const Partitioning*>& ranked)
+	{
+		float centres[4][4] = {};
+		for (int i = 0; i < t.count; ++i)
+		{
+			for (int k = 0; k < t.components; ++k)
+			{
+				centres[0][k] += t.value[k][i] / (float)t.count;
+			}
+		}
+		// the first centre is the texel farthest from the mean, every next one the texel farthest from the others
+		for (int c = 0; c < partitions; ++c)
+		{
+			int farthest = 0;
+			float farthest_distance = -1.0f;
+			for (int i = 0; i < t.count; ++i)
+			{
+				float distance = GetDistance(t, i, centres[0]);
+				for (int j = 1; j < c; ++j)
+				{
+					distance = std::min(distance, GetDistance(t, i, centres[j]));
+				}
+				if (distance > farthest_distance)
+				{
+					farthest_distance = distance;
+					farthest = i;
+				}
+			}
+			for (int k = 0; k < t.components; ++k)
+			{
+				centres[c][k] = t.value[k][farthest];
+			}
+		}
+
+		uint8_t cluster[ASTCMaxTexels] = {};
+		for (int iteration = 0; iteration < 4; ++iteration)
+		{
+			float sums[4][4] = {};
+			int counts[4] = {};
+			for (int i = 0; i < t.count; ++i)
+			{
+				int nearest = 0;
+				float nearest_distance = GetDistance(t, i, centres[0]);
+				for (int c = 1; c < partitions; ++c)
+				{
+					float distance = GetDistance(t, i, centres[c]);
+					if (distance < nearest_distance)
+					{
+						nearest_distance = distance;
+						nearest = c;
+					}
+				}
+				cluster[i] = (uint8_t)nearest;
+				++counts[nearest];
+				for (int k = 0; k < t.components; ++k)
+				{
+					sums[nearest][k] += t.value[k][i];
+				}
+			}
+			for (int c = 0; c < partitions; ++c)
+			{
+				for (int k = 0; k < t.components && counts[c] > 0; ++k)
+				{
+					centres[c][k] = sums[c][k] / (float)counts[c];
+				}
+			}
+		}
+		uint64_t masks[4][3];
+		SetMasks(cluster, t.count, masks);
+
+		const std::vector<Partitioning>& all = footprint.partitionings[partitions - 2];
+		std::vector<std::pair<int, const Partitioning*>> scored;
+		scored.reserve(all.size());
+		for (const Partitioning& p: all)
+		{
+			int permutation[4] = {0, 1, 2, 3};
+			int mismatch = INT32_MAX;
+			do
+			{
+				int m = 0;
+				for (int c = 0; c < partitions; ++c)
+				{
+					for (int w = 0; w < 3; ++w)
+					{
+						m += PopCount(p.masks[c][w] ^ masks[permutation[c]][w]);
+					}
+				}
+				mismatch = std::min(mismatch, m);
+			}
+			while (std::next_permutation(permutation, permutation + partitions));
+			scored.emplace_back(mismatch, &p);
+		}
+		size_t count = std::min<size_t>(candidates, scored.size());
+		std::partial_sort(scored.begin(), scored.begin() + count, scored.end(),
+				[](const std::pair<int, const Partitioning*>& a, const std::pair<int, const Partitioning*>& b)
+				{
+					return a.first < b.first;
+				});
+		ranked.clear();
+		for (size_t i = 0; i < count; ++i)
+		{
+			ranked.push_back(scored[i].second);
+		}
+	}
+
+	void WriteBlock(const BlockTexels& t, const Encoding& e, uint8_t* block)
+	{
+		BlockBitWriter writer;
+		writer.Write(e.mode, 11);
+		writer.Write(e.partitions - 1, 2);
+		if (e.partitions == 1)
+		{
+			writer.Write(t.cem, 4);
+		}
+		else
+		{
+			// all partitions share the endpoint mode
+			writer.Write(e.seed, 10);
+			writer.Write(t.cem << 2, 6);
+		}
+		EncodeISE(writer, e.colour, e.partitions * GetASTCColourValueCount(t.cem), e.colour_range);
+		if (e.plane2 >= 0)
+		{
+			const int ccs_position = 128 - GetISEBits(e.weight_count, e.weight_range) - 2;
+			while (writer.position() < ccs_position)
+			{
+				writer.Write(0, std::min(32, ccs_position - writer.position()));
+			}
+			writer.Write(t.channel[e.plane2], 2);
+		}
+		writer.Store(block);
+
+		BlockBitWriter weight_writer;
+		EncodeISE(weight_writer, e.weights, e.weight_count, e.weight_range);
+		uint8_t weights[16];
+		uint8_t reversed[16];
+		weight_writer.Store(weights);
+		ReverseASTCBits(weights, reversed);
+		for (int i = 0; i < 16; ++i)
+		{
+			block[i] |= reversed[i];
+		}
+	}
+}
+
+
+void EncodeASTCBlock(const float* rgba, int block_width, int block_height, uint8_t* block,
+                     pvrtexture::ECompressorQuality quality, bool hdr)
+{
+	const Footprint& footprint = GetFootprint(block_width, block_height);
+	// blocks that are constant after clamping are void extents too
+	float clamped[ASTCMaxTexels * 4];
+	if (!hdr)
+	{
+		for (int i = 0; i < footprint.count * 4; ++i)
+		{
+			clamped[i] = std::min(std::max(rgba[i], 0.0f), 1.0f);
+		}
+		rgba = clamped;
+	}
+	if (IsConstant(rgba, footprint.count))
+	{
+		WriteVoidExtent(rgba, hdr, block);
+		return;
+	}
+	const Search search = GetSearch(quality);
+	BlockTexels t;
+	LoadTexels(rgba, footprint.count, hdr, t);
+
+	float weight_sum = 0.0f;
+	for (int k = 0; k < t.components; ++k)
+	{
+		weight_sum += t.error_weight[k];
+	}
+	const float threshold = search.threshold * weight_sum * (float)t.count;
+	const int worst = t.components == 3 ? GetWorstComponent(t) : 0;
+
+	Encoding best;
+	best.error = FLT_MAX;
+	const uint8_t single[ASTCMaxTexels] = {};
+	TryPlanes(t, footprint, search, single, 1, 0, worst, best);
+
+	std::vector<const Partitioning*> ranked;
+	for (int partitions = 2; partitions <= search.partitions && best.error > threshold; ++partitions)
+	{
+		if (partitions * GetASTCColourValueCount(t.cem) > ASTCMaxColourValues)
+		{
+			break;
+		}
+		RankPartitionings(t, footprint, partitions, search.candidates, ranked);
+		for (const Partitioning* p: ranked)
+		{
+			TryPlanes(t, footprint, search, p->partition, partitions, p->seed, worst, best);
+		}
+	}
+	WriteBlock(t, best, block);
+}
@@ -0,0 +1,211 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+#include "auto_compress.h"
+#include "codec.h"
+#include "decode.h"
+#include "metrics.h"
+#include "thread_pool.h"
+#include "profiler.h"
+#include "common.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+
+namespace
+{
+	// estimates this far below the target are pruned, sampling error is rarely larger
+	const double PruneMargin = 1.0;
+
+	typedef std::chrono::steady_clock Clock;
+
+	double GetMilliseconds(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	double ToPSNR(double mse)
+	{
+		if (mse <= 0.0)
+		{
+			return std::numeric_limits<double>::infinity();
+		}
+		return -10.0 * std::log10(mse);
+	}
+
+	// PSNR of blocks spread evenly over the first depth slice, values in [0, 1] have a peak of 1
+	double EstimatePSNR(const RGBASurface& source, unsigned mask, const pvrtexture::CPVRTextureHeader& header,
+	                    const AutoCandidate& candidate, int sample_blocks)
+	{
+		int block_width, block_height, block_bytes;
+		GetNativeBlockSize(candidate.format, block_width, block_height, block_bytes);
+		const int blocks_x = (source.width + block_width - 1) / block_width;
+		const int blocks_y = (source.height + block_height - 1) / block_height;
+		const size_t total = (size_t)blocks_x * blocks_y;
+		const size_t count = std::min(total, (size_t)std::max(sample_blocks, 1));
+
+		std::vector<double> errors(count, 0.0);
+		std::vector<size_t> values(count, 0);
+		ThreadPool::GetDefault().ParallelFor(count, [&](size_t i)
+		{
+			const size_t index = (2 * i + 1) * total / (2 * count);
+			const int x0 = (int)(index % blocks_x) * block_width;
+			const int y0 = (int)(index / blocks_x) * block_height;
+			float texels[12 * 12 * 4];
+			float decoded[12 * 12 * 4];
+			uint8_t block[16];
+			for (int y = 0; y < block_height; ++y)
+			{
+				for (int x = 0; x < block_width; ++x)
+				{
+					int sx = std::min(x0 + x, source.width - 1);
+					int sy = std::min(y0 + y, source.height - 1);
+					memcpy(&texels[(y * block_width + x) * 4], &source.float32[((size_t)sy * source.width + sx) * 4], 4 * sizeof(float));
+				}
+			}
+			EncodeNativeBlock(candidate.format, header.getChannelType(), texels, block, candidate.quality);
+			DecodeBlock(header, block, decoded);
+			// replicated texels past the edge are not counted
+			for (int y = 0; y < block_height && y0 + y < source.height; ++y)
+			{
+				for (int x = 0; x < block_width && x0 + x < source.width; ++x)
+				{
+					for (int c = 0; c < 4; ++c)
+					{
+						if (mask & (1u << c))
+						{
+							double d = (double)texels[(y * block_width + x) * 4 + c] - decoded[(y * block_width + x) * 4 + c];
+							errors[i] += d * d;
+							++values[i];
+						}
+					}
+				}
+			}
+		});
+		double error = 0.0;
+		size_t value_count = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			error += errors[i];
+			value_count += values[i];
+		}
+		return ToPSNR(error / (double)std::max(value_count, (size_t)1));
+	}
+}
+
+
+AutoResult AutoCompress(const pvrtexture::CPVRTexture& texture, const std::vector<uint64_t>& formats,
+                        const std::vector<pvrtexture::ECompressorQuality>& qualities, EPVRTVariableType channel_type,
+                        EPVRTColourSpace colour_space, double min_psnr, double budget_ms, int sample_blocks)
+{
+	const Clock::time_point start = Clock::now();
+	AutoResult result;
+	result.chosen = -1;
+	result.target_met = false;
+	result.budget_exceeded = false;
+
+	std::vector<pvrtexture::ECompressorQuality> sorted_qualities(qualities);
+	std::sort(sorted_qualities.begin(), sorted_qualities.end());
+	sorted_qualities.erase(std::unique(sorted_qualities.begin(), sorted_qualities.end()), sorted_qualities.end());
+	for (uint64_t format: formats)
+	{
+		int block_width, block_height, block_bytes;
+		if (!GetNativeBlockSize(format, block_width, block_height, block_bytes))
+		{
+			throw runtime_error("auto_compress needs a native encoder, there is none for pixel format %llu", (unsigned long long)format);
+		}
+		for (pvrtexture::ECompressorQuality quality: sorted_qualities)
+		{
+			AutoCandidate candidate = AutoCandidate();
+			candidate.format = format;
+			candidate.quality = quality;
+			candidate.bits_per_texel = 8.0 * block_bytes / (block_width * block_height);
+			candidate.estimated_psnr = std::numeric_limits<double>::quiet_NaN();
+			candidate.psnr = std::numeric_limits<double>::quiet_NaN();
+			result.candidates.push_back(candidate);
+		}
+	}
+	// the sort is stable, formats of the same size keep their order and qualities stay ascending
+	std::stable_sort(result.candidates.begin(), result.candidates.end(), [](const AutoCandidate& a, const AutoCandidate& b)
+	{
+		return a.bits_per_texel < b.bits_per_texel;
+	});
+
+	RGBASurface source = LoadRGBASurface(texture, 0, 0, 0);
+	ConvertToFloat(source);
+	const unsigned mask = GetChannelMask(texture.getPixelType().PixelTypeID);
+	auto over_budget = [&]()
+	{
+		result.budget_exceeded = result.budget_exceeded || (budget_ms > 0.0 && GetMilliseconds(start) > budget_ms);
+		return result.budget_exceeded;
+	};
+
+	double best_psnr = -std::numeric_limits<double>::infinity();
+	for (size_t first = 0; first < result.candidates.size() && !result.target_met && !over_budget();)
+	{
+		size_t last = first;
+		while (last < result.candidates.size() && result.candidates[last].format == result.candidates[first].format)
+		{
+			++last;
+		}
+
+		pvrtexture::CPVRTextureHeader header(texture.getHeader());
+		header.setPixelFormat(result.candidates[first].format);
+		header.setChannelType(channel_type);
+		header.setColourSpace(colour_space);
+		for (size_t i = first; i < last && !over_budget(); ++i)
+		{
+			AutoCandidate& candidate = result.candidates[i];
+			const Clock::time_point sample_start = Clock::now();
+			candidate.estimated_psnr = EstimatePSNR(source, mask, header, candidate, sample_blocks);
+			candidate.sample_ms = GetMilliseconds(sample_start);
+			candidate.sampled = true;
+			candidate.pruned = candidate.estimated_psnr < min_psnr - PruneMargin;
+			if (candidate.estimated_psnr >= min_psnr)
+			{
+				break;
+			}
+		}
+
+		for (size_t i = first; i < last && !result.target_met && !over_budget(); ++i)
+		{
+			AutoCandidate& candidate = result.candidates[i];
+			if (!candidate.sampled || candidate.pruned)
+			{
+				continue;
+			}
+			const Clock::time_point encode_start = Clock::now();
+			std::unique_ptr<pvrtexture::CPVRTexture> encoded(new pvrtexture::CPVRTexture(texture));
+			CountAllocatedBytes(encoded->getDataSize());
+			TranscodeNative(*encoded, candidate.format, channel_type, colour_space, candidate.quality);
+			candidate.psnr = CompareSurfaces(texture, *encoded, 0, 0, 0, MetricPSNR, false).overall.psnr;
+			candidate.encode_ms = GetMilliseconds(encode_start);
+			candidate.encoded = true;
+			if (candidate.psnr > best_psnr)
+			{
+				best_psnr = candidate.psnr;
+				result.chosen = (int)i;
+				result.texture = std::move(encoded);
+				result.target_met = candidate.psnr >= min_psnr;
+			}
+		}
+		first = last;
+	}
+	result.elapsed_ms = GetMilliseconds(start);
+	return result;
+}
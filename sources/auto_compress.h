@@ -0,0 +1,60 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+#pragma once
+#include <PVRTexture.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+// Picks the cheapest format and the fastest quality level that reach a PSNR target. Formats are tried in order of
+// bits per texel, quality levels from the fastest. Each candidate is first encoded on a sample of blocks of the top mip
+// level; candidates whose estimate falls clearly short of the target are pruned, and once a quality level is estimated
+// to reach it, the slower ones of that format are skipped. Remaining candidates are encoded in full with the native
+// encoders and measured with CompareSurfaces on the top mip level, the first one that reaches the target is chosen.
+// If none does, the fully encoded candidate with the highest PSNR is returned.
+
+struct AutoCandidate
+{
+	uint64_t format;
+	pvrtexture::ECompressorQuality quality;
+	double bits_per_texel;
+	bool sampled;
+	bool pruned;
+	bool encoded;
+	// PSNR of the sampled blocks and of the full encode, valid if sampled and encoded are set
+	double estimated_psnr;
+	double psnr;
+	double sample_ms;
+	double encode_ms;
+};
+
+struct AutoResult
+{
+	// index into candidates, -1 if no candidate was encoded in full
+	int chosen;
+	bool target_met;
+	bool budget_exceeded;
+	double elapsed_ms;
+	std::vector<AutoCandidate> candidates;
+	std::unique_ptr<pvrtexture::CPVRTexture> texture;
+};
+
+// budget_ms <= 0 means no time limit. Once the budget is spent, no further candidates are started.
+// Throws if a format has no native encoder
+AutoResult AutoCompress(const pvrtexture::CPVRTexture& texture, const std::vector<uint64_t>& formats,
+                        const std::vector<pvrtexture::ECompressorQuality>& qualities, EPVRTVariableType channel_type,
+                        EPVRTColourSpace colour_space, double min_psnr, double budget_ms, int sample_blocks);
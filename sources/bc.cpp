@@ -0,0 +1,914 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#include "bc.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+
+
+namespace
+{
+	// Colour texels of a block in SoA layout, scaled to [0, 255]. Texels with zero weight do not contribute to
+	// the error and the endpoint fit, these are the transparent texels of a BC1 block in 3 colour mode
+	struct ColourBlock
+	{
+		float r[16];
+		float g[16];
+		float b[16];
+		float w[16];
+	};
+
+	struct ColourEncoding
+	{
+		uint16_t c0;
+		uint16_t c1;
+		int indices[16];
+		float error;
+	};
+
+	struct AlphaEncoding
+	{
+		int a0;
+		int a1;
+		int indices[16];
+		float error;
+	};
+
+	inline float To255(float x)
+	{
+		return std::min(std::max(x, 0.0f), 1.0f) * 255.0f;
+	}
+
+	inline int Quantize(float x, int max)
+	{
+		int v = (int)(x * max / 255.0f + 0.5f);
+		return std::min(std::max(v, 0), max);
+	}
+
+	inline int Expand5(int x) { return (x << 3) | (x >> 2); }
+	inline int Expand6(int x) { return (x << 2) | (x >> 4); }
+
+	inline uint16_t Pack565(int r, int g, int b)
+	{
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	inline uint16_t Pack565(const float* c)
+	{
+		return Pack565(Quantize(c[0], 31), Quantize(c[1], 63), Quantize(c[2], 31));
+	}
+
+	inline void Unpack565(uint16_t v, int* c)
+	{
+		c[0] = Expand5((v >> 11u) & 31u);
+		c[1] = Expand6((v >> 5u) & 63u);
+		c[2] = Expand5(v & 31u);
+	}
+
+	// Four colour mode if c0 > c1, three colour mode otherwise. In three colour mode entry 3 is transparent black
+	void BuildColourPalette(uint16_t c0, uint16_t c1, float palette[4][3])
+	{
+		int p0[3];
+		int p1[3];
+		Unpack565(c0, p0);
+		Unpack565(c1, p1);
+		for (int k = 0; k < 3; ++k)
+		{
+			palette[0][k] = (float)p0[k];
+			palette[1][k] = (float)p1[k];
+			if (c0 > c1)
+			{
+				palette[2][k] = (2.0f * p0[k] + p1[k]) / 3.0f;
+				palette[3][k] = (p0[k] + 2.0f * p1[k]) / 3.0f;
+			}
+			else
+			{
+				palette[2][k] = (p0[k] + p1[k]) / 2.0f;
+				palette[3][k] = 0.0f;
+			}
+		}
+	}
+
+	// Picks the closest of count palette entries for every texel, returns the total weighted squared error
+	float SelectColourIndices(const ColourBlock& block, const float palette[4][3], int count, int* indices)
+	{
+		using namespace simd;
+		float error = 0.0f;
+		for (int i = 0; i < 16; i += width)
+		{
+			const vfloat r = load(block.r + i);
+			const vfloat g = load(block.g + i);
+			const vfloat b = load(block.b + i);
+			vfloat best = set1(FLT_MAX);
+			vfloat index = set1(0.0f);
+			for (int k = 0; k < count; ++k)
+			{
+				const vfloat dr = r - set1(palette[k][0]);
+				const vfloat dg = g - set1(palette[k][1]);
+				const vfloat db = b - set1(palette[k][2]);
+				const vfloat d = dr * dr + dg * dg + db * db;
+				const vmask closer = d < best;
+				best = select(closer, d, best);
+				index = select(closer, set1((float)k), index);
+			}
+			store(indices + i, index);
+			error += reduce_add(best * load(block.w + i));
+		}
+		return error;
+	}
+
+	// Evaluates endpoints in the mode given by their order, updates best if the error is lower
+	bool TryColourEndpoints(const ColourBlock& block, uint16_t c0, uint16_t c1, ColourEncoding& best)
+	{
+		float palette[4][3];
+		BuildColourPalette(c0, c1, palette);
+		ColourEncoding candidate;
+		candidate.c0 = c0;
+		candidate.c1 = c1;
+		candidate.error = SelectColourIndices(block, palette, c0 > c1 ? 4 : 3, candidate.indices);
+		if (candidate.error >= best.error)
+		{
+			return false;
+		}
+		if (c0 <= c1)
+		{
+			for (int i = 0; i < 16; ++i)
+			{
+				if (block.w[i] == 0.0f)
+				{
+					candidate.indices[i] = 3;
+				}
+			}
+		}
+		best = candidate;
+		return true;
+	}
+
+	// Orders quantized endpoints for the requested mode. Equal endpoints can not select four colour mode,
+	// so one of them is moved by the least significant bit
+	bool TryColourMode(const ColourBlock& block, uint16_t a, uint16_t b, bool four_colour, ColourEncoding& best)
+	{
+		if (four_colour)
+		{
+			if (a < b)
+			{
+				std::swap(a, b);
+			}
+			if (a == b)
+			{
+				if (a == 0)
+				{
+					a = 1;
+				}
+				else
+				{
+					b = a - 1;
+				}
+			}
+		}
+		else if (a > b)
+		{
+			std::swap(a, b);
+		}
+		return TryColourEndpoints(block, a, b, best);
+	}
+
+	struct ColourStatistics
+	{
+		float mean[3];
+		float covariance[6]; // rr, rg, rb, gg, gb, bb
+		float lo[3];
+		float hi[3];
+		float weight;
+	};
+
+	ColourStatistics ComputeColourStatistics(const ColourBlock& block)
+	{
+		using namespace simd;
+		vfloat sw = set1(0.0f);
+		vfloat s[3] = {sw, sw, sw};
+		vfloat ss[6] = {sw, sw, sw, sw, sw, sw};
+		vfloat lo[3] = {set1(FLT_MAX), set1(FLT_MAX), set1(FLT_MAX)};
+		vfloat hi[3] = {set1(-FLT_MAX), set1(-FLT_MAX), set1(-FLT_MAX)};
+		for (int i = 0; i < 16; i += width)
+		{
+			const vfloat w = load(block.w + i);
+			const vfloat c[3] = {load(block.r + i), load(block.g + i), load(block.b + i)};
+			const vmask valid = w > set1(0.0f);
+			sw = sw + w;
+			for (int k = 0; k < 3; ++k)
+			{
+				s[k] = s[k] + w * c[k];
+				lo[k] = min(lo[k], select(valid, c[k], set1(FLT_MAX)));
+				hi[k] = max(hi[k], select(valid, c[k], set1(-FLT_MAX)));
+			}
+			ss[0] = ss[0] + w * c[0] * c[0];
+			ss[1] = ss[1] + w * c[0] * c[1];
+			ss[2] = ss[2] + w * c[0] * c[2];
+			ss[3] = ss[3] + w * c[1] * c[1];
+			ss[4] = ss[4] + w * c[1] * c[2];
+			ss[5] = ss[5] + w * c[2] * c[2];
+		}
+		ColourStatistics stats;
+		stats.weight = reduce_add(sw);
+		float inv = stats.weight > 0.0f ? 1.0f / stats.weight : 0.0f;
+		for (int k = 0; k < 3; ++k)
+		{
+			stats.mean[k] = reduce_add(s[k]) * inv;
+			stats.lo[k] = reduce_min(lo[k]);
+			stats.hi[k] = reduce_max(hi[k]);
+		}
+		const int pairs[6][2] = {{0, 0}, {0, 1}, {0, 2}, {1, 1}, {1, 2}, {2, 2}};
+		for (int k = 0; k < 6; ++k)
+		{
+			stats.covariance[k] = reduce_add(ss[k]) * inv - stats.mean[pairs[k][0]] * stats.mean[pairs[k][1]];
+		}
+		return stats;
+	}
+
+	// Dominant eigenvector of the covariance matrix by power iteration. Returns false for blocks without variance
+	bool PrincipalAxis(const ColourStatistics& stats, float* axis)
+	{
+		const float* c = stats.covariance;
+		const float m[3][3] = {{c[0], c[1], c[2]}, {c[1], c[3], c[4]}, {c[2], c[4], c[5]}};
+		// the row of the largest diagonal element is a good start, it is rarely close to orthogonal to the dominant axis
+		int row = c[0] >= c[3] && c[0] >= c[5] ? 0 : (c[3] >= c[5] ? 1 : 2);
+		float v[3] = {m[row][0], m[row][1], m[row][2]};
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			float x[3];
+			for (int k = 0; k < 3; ++k)
+			{
+				x[k] = m[k][0] * v[0] + m[k][1] * v[1] + m[k][2] * v[2];
+			}
+			float length = std::max(std::max(std::fabs(x[0]), std::fabs(x[1])), std::fabs(x[2]));
+			if (length < 1e-6f)
+			{
+				return false;
+			}
+			for (int k = 0; k < 3; ++k)
+			{
+				v[k] = x[k] / length;
+			}
+		}
+		float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		for (int k = 0; k < 3; ++k)
+		{
+			axis[k] = v[k] / length;
+		}
+		return true;
+	}
+
+	// Endpoints at the extent of the texels along the principal axis
+	void FitPrincipalAxis(const ColourBlock& block, const ColourStatistics& stats, float* e0, float* e1)
+	{
+		using namespace simd;
+		float axis[3];
+		if (!PrincipalAxis(stats, axis))
+		{
+			memcpy(e0, stats.mean, sizeof(stats.mean));
+			memcpy(e1, stats.mean, sizeof(stats.mean));
+			return;
+		}
+		vfloat lo = set1(FLT_MAX);
+		vfloat hi = set1(-FLT_MAX);
+		for (int i = 0; i < 16; i += width)
+		{
+			const vfloat t = (load(block.r + i) - set1(stats.mean[0])) * set1(axis[0]) +
+					(load(block.g + i) - set1(stats.mean[1])) * set1(axis[1]) +
+					(load(block.b + i) - set1(stats.mean[2])) * set1(axis[2]);
+			const vmask valid = load(block.w + i) > set1(0.0f);
+			lo = min(lo, select(valid, t, set1(FLT_MAX)));
+			hi = max(hi, select(valid, t, set1(-FLT_MAX)));
+		}
+		float t0 = reduce_max(hi);
+		float t1 = reduce_min(lo);
+		for (int k = 0; k < 3; ++k)
+		{
+			e0[k] = stats.mean[k] + axis[k] * t0;
+			e1[k] = stats.mean[k] + axis[k] * t1;
+		}
+	}
+
+	// Corners of the bounding box along the diagonal that follows the sign of the covariance
+	void FitBoundingBox(const ColourStatistics& stats, float* e0, float* e1)
+	{
+		const float* c = stats.covariance;
+		int major = c[0] >= c[3] && c[0] >= c[5] ? 0 : (c[3] >= c[5] ? 1 : 2);
+		const int index[3][3] = {{0, 1, 2}, {1, 3, 4}, {2, 4, 5}};
+		for (int k = 0; k < 3; ++k)
+		{
+			bool flip = c[index[major][k]] < 0.0f;
+			e0[k] = flip ? stats.lo[k] : stats.hi[k];
+			e1[k] = flip ? stats.hi[k] : stats.lo[k];
+		}
+	}
+
+	// Shrinks the endpoints by 1/16 of the range, interpolated colours then cover the texels better
+	void InsetEndpoints(float* e0, float* e1)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			float inset = (e0[k] - e1[k]) / 16.0f;
+			e0[k] -= inset;
+			e1[k] += inset;
+		}
+	}
+
+	// Least squares endpoints for fixed indices. Returns false if the system is degenerate
+	bool RefineColourEndpoints(const ColourBlock& block, const ColourEncoding& encoding, float* e0, float* e1)
+	{
+		const bool four_colour = encoding.c0 > encoding.c1;
+		const float weights4[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+		const float weights3[4] = {1.0f, 0.0f, 0.5f, 0.0f};
+		const float* weights = four_colour ? weights4 : weights3;
+		float aa = 0.0f;
+		float ab = 0.0f;
+		float bb = 0.0f;
+		float ax[3] = {0.0f, 0.0f, 0.0f};
+		float bx[3] = {0.0f, 0.0f, 0.0f};
+		for (int i = 0; i < 16; ++i)
+		{
+			int index = encoding.indices[i];
+			if (block.w[i] == 0.0f || (!four_colour && index == 3))
+			{
+				continue;
+			}
+			float a = weights[index];
+			float b = 1.0f - a;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			const float x[3] = {block.r[i], block.g[i], block.b[i]};
+			for (int k = 0; k < 3; ++k)
+			{
+				ax[k] += a * x[k];
+				bx[k] += b * x[k];
+			}
+		}
+		float det = aa * bb - ab * ab;
+		if (std::fabs(det) < 1e-6f)
+		{
+			return false;
+		}
+		for (int k = 0; k < 3; ++k)
+		{
+			e0[k] = std::min(std::max((ax[k] * bb - bx[k] * ab) / det, 0.0f), 255.0f);
+			e1[k] = std::min(std::max((bx[k] * aa - ax[k] * ab) / det, 0.0f), 255.0f);
+		}
+		return true;
+	}
+
+	struct SingleColourTable
+	{
+		// endpoints that give the closest 2/3 interpolation of every 8 bit value
+		uint8_t e5[256][2];
+		uint8_t e6[256][2];
+
+		SingleColourTable()
+		{
+			Fill(e5, 31, Expand5);
+			Fill(e6, 63, Expand6);
+		}
+
+		static void Fill(uint8_t table[256][2], int max, int (*expand)(int))
+		{
+			for (int v = 0; v < 256; ++v)
+			{
+				float best = FLT_MAX;
+				for (int a = 0; a <= max; ++a)
+				{
+					for (int b = 0; b <= max; ++b)
+					{
+						float error = std::fabs((2.0f * expand(a) + expand(b)) / 3.0f - v);
+						if (error < best)
+						{
+							best = error;
+							table[v][0] = (uint8_t)a;
+							table[v][1] = (uint8_t)b;
+						}
+					}
+				}
+			}
+		}
+	};
+
+	const SingleColourTable& GetSingleColourTable()
+	{
+		static SingleColourTable table;
+		return table;
+	}
+
+	bool IsSolid(const ColourBlock& block)
+	{
+		for (int i = 1; i < 16; ++i)
+		{
+			if (block.r[i] != block.r[0] || block.g[i] != block.g[0] || block.b[i] != block.b[0])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void WriteColourBlock(const ColourEncoding& encoding, uint8_t* out)
+	{
+		out[0] = (uint8_t)(encoding.c0 & 0xffu);
+		out[1] = (uint8_t)(encoding.c0 >> 8u);
+		out[2] = (uint8_t)(encoding.c1 & 0xffu);
+		out[3] = (uint8_t)(encoding.c1 >> 8u);
+		uint32_t bits = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			bits |= (uint32_t)encoding.indices[i] << (2u * i);
+		}
+		memcpy(out + 4, &bits, 4);
+	}
+
+	// Searches over +-1 steps of every quantized endpoint component until no step reduces the error
+	void LocalColourSearch(const ColourBlock& block, ColourEncoding& best)
+	{
+		const int shifts[3] = {11, 5, 0};
+		const int masks[3] = {31, 63, 31};
+		for (int pass = 0; pass < 8; ++pass)
+		{
+			bool improved = false;
+			for (int endpoint = 0; endpoint < 2; ++endpoint)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					for (int step = -1; step <= 1; step += 2)
+					{
+						uint16_t c[2] = {best.c0, best.c1};
+						int v = ((c[endpoint] >> shifts[k]) & masks[k]) + step;
+						if (v < 0 || v > masks[k])
+						{
+							continue;
+						}
+						c[endpoint] = (uint16_t)((c[endpoint] & ~(masks[k] << shifts[k])) | (v << shifts[k]));
+						improved |= TryColourMode(block, c[0], c[1], best.c0 > best.c1, best);
+					}
+				}
+			}
+			if (!improved)
+			{
+				break;
+			}
+		}
+	}
+
+	// three_colour allows 3 colour mode, transparent requires it
+	void EncodeColourBlock(const ColourBlock& block, pvrtexture::ECompressorQuality quality, bool three_colour, bool transparent, uint8_t* out)
+	{
+		ColourEncoding best;
+		best.error = FLT_MAX;
+
+		ColourStatistics stats = ComputeColourStatistics(block);
+		if (stats.weight == 0.0f)
+		{
+			// fully transparent
+			best.c0 = 0;
+			best.c1 = 0;
+			for (int i = 0; i < 16; ++i)
+			{
+				best.indices[i] = 3;
+			}
+			WriteColourBlock(best, out);
+			return;
+		}
+
+		const bool try_four = !transparent;
+		const bool try_three = transparent || (three_colour && quality >= pvrtexture::ePVRTCHigh);
+
+		if (quality >= pvrtexture::ePVRTCNormal && !transparent && IsSolid(block))
+		{
+			const SingleColourTable& table = GetSingleColourTable();
+			int r = (int)(block.r[0] + 0.5f);
+			int g = (int)(block.g[0] + 0.5f);
+			int b = (int)(block.b[0] + 0.5f);
+			TryColourMode(block, Pack565(table.e5[r][0], table.e6[g][0], table.e5[b][0]),
+					Pack565(table.e5[r][1], table.e6[g][1], table.e5[b][1]), true, best);
+			// exactly representable colours do not need interpolation
+			const float colour[3] = {block.r[0], block.g[0], block.b[0]};
+			uint16_t c = Pack565(colour);
+			TryColourMode(block, c, c, true, best);
+			WriteColourBlock(best, out);
+			return;
+		}
+
+		float e0[3];
+		float e1[3];
+		if (quality == pvrtexture::ePVRTCFastest)
+		{
+			FitBoundingBox(stats, e0, e1);
+		}
+		else
+		{
+			FitPrincipalAxis(block, stats, e0, e1);
+		}
+		if (quality <= pvrtexture::ePVRTCFast)
+		{
+			InsetEndpoints(e0, e1);
+		}
+		if (try_four)
+		{
+			TryColourMode(block, Pack565(e0), Pack565(e1), true, best);
+		}
+		if (try_three)
+		{
+			TryColourMode(block, Pack565(e0), Pack565(e1), false, best);
+		}
+
+		int passes = 0;
+		switch (quality)
+		{
+			case pvrtexture::ePVRTCNormal: passes = 1; break;
+			case pvrtexture::ePVRTCHigh: passes = 2; break;
+			case pvrtexture::ePVRTCBest: passes = 4; break;
+			default: break;
+		}
+		for (int pass = 0; pass < passes; ++pass)
+		{
+			if (!RefineColourEndpoints(block, best, e0, e1) ||
+			    !TryColourMode(block, Pack565(e0), Pack565(e1), best.c0 > best.c1, best))
+			{
+				break;
+			}
+		}
+		if (quality == pvrtexture::ePVRTCBest)
+		{
+			LocalColourSearch(block, best);
+		}
+		WriteColourBlock(best, out);
+	}
+
+	// Palette of a BC4 block, a0 > a1 selects 6 interpolated values, otherwise 4 and the extremes 0 and 255
+	void BuildAlphaPalette(int a0, int a1, float* palette)
+	{
+		palette[0] = (float)a0;
+		palette[1] = (float)a1;
+		if (a0 > a1)
+		{
+			for (int i = 2; i < 8; ++i)
+			{
+				palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7.0f;
+			}
+		}
+		else
+		{
+			for (int i = 2; i < 6; ++i)
+			{
+				palette[i] = ((6 - i) * a0 + (i - 1) * a1) / 5.0f;
+			}
+			palette[6] = 0.0f;
+			palette[7] = 255.0f;
+		}
+	}
+
+	float SelectAlphaIndices(const float* values, const float* palette, int* indices)
+	{
+		using namespace simd;
+		float error = 0.0f;
+		for (int i = 0; i < 16; i += width)
+		{
+			const vfloat x = load(values + i);
+			vfloat best = set1(FLT_MAX);
+			vfloat index = set1(0.0f);
+			for (int k = 0; k < 8; ++k)
+			{
+				const vfloat d = x - set1(palette[k]);
+				const vfloat e = d * d;
+				const vmask closer = e < best;
+				best = select(closer, e, best);
+				index = select(closer, set1((float)k), index);
+			}
+			store(indices + i, index);
+			error += reduce_add(best);
+		}
+		return error;
+	}
+
+	bool TryAlphaEndpoints(const float* values, int a0, int a1, AlphaEncoding& best)
+	{
+		a0 = std::min(std::max(a0, 0), 255);
+		a1 = std::min(std::max(a1, 0), 255);
+		float palette[8];
+		BuildAlphaPalette(a0, a1, palette);
+		AlphaEncoding candidate;
+		candidate.a0 = a0;
+		candidate.a1 = a1;
+		candidate.error = SelectAlphaIndices(values, palette, candidate.indices);
+		if (candidate.error < best.error)
+		{
+			best = candidate;
+			return true;
+		}
+		return false;
+	}
+
+	// Least squares endpoints of the 8 value mode for fixed indices
+	bool RefineAlphaEndpoints(const float* values, const AlphaEncoding& encoding, float& a0, float& a1)
+	{
+		float aa = 0.0f;
+		float ab = 0.0f;
+		float bb = 0.0f;
+		float ax = 0.0f;
+		float bx = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			int index = encoding.indices[i];
+			float a = index == 0 ? 1.0f : (index == 1 ? 0.0f : (8 - index) / 7.0f);
+			float b = 1.0f - a;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			ax += a * values[i];
+			bx += b * values[i];
+		}
+		float det = aa * bb - ab * ab;
+		if (std::fabs(det) < 1e-6f)
+		{
+			return false;
+		}
+		a0 = (ax * bb - bx * ab) / det;
+		a1 = (bx * aa - ax * ab) / det;
+		return true;
+	}
+
+	// values are 16 texels scaled to [0, 255]
+	void EncodeAlphaBlock(const float* values, pvrtexture::ECompressorQuality quality, uint8_t* out)
+	{
+		using namespace simd;
+		vfloat lo = set1(FLT_MAX);
+		vfloat hi = set1(-FLT_MAX);
+		// extent of the values that are not represented exactly by 0 and 255 of the 6 value mode
+		vfloat inner_lo = set1(FLT_MAX);
+		vfloat inner_hi = set1(-FLT_MAX);
+		for (int i = 0; i < 16; i += width)
+		{
+			const vfloat x = load(values + i);
+			lo = min(lo, x);
+			hi = max(hi, x);
+			const vmask inner = (x > set1(0.5f)) & (x < set1(254.5f));
+			inner_lo = min(inner_lo, select(inner, x, set1(FLT_MAX)));
+			inner_hi = max(inner_hi, select(inner, x, set1(-FLT_MAX)));
+		}
+		const int min_value = (int)(reduce_min(lo) + 0.5f);
+		const int max_value = (int)(reduce_max(hi) + 0.5f);
+
+		AlphaEncoding best;
+		best.error = FLT_MAX;
+		// a0 <= a1 for a block of a single value
+		TryAlphaEndpoints(values, max_value, min_value, best);
+		if (quality >= pvrtexture::ePVRTCFast && min_value != max_value)
+		{
+			float l = reduce_min(inner_lo);
+			float h = reduce_max(inner_hi);
+			if (l <= h)
+			{
+				TryAlphaEndpoints(values, (int)(l + 0.5f), (int)(h + 0.5f), best);
+			}
+		}
+		if (quality >= pvrtexture::ePVRTCNormal && best.a0 > best.a1)
+		{
+			for (int pass = 0; pass < (quality >= pvrtexture::ePVRTCHigh ? 2 : 1); ++pass)
+			{
+				float a0;
+				float a1;
+				if (!RefineAlphaEndpoints(values, best, a0, a1) ||
+				    !TryAlphaEndpoints(values, (int)(a0 + 0.5f), (int)(a1 + 0.5f), best))
+				{
+					break;
+				}
+			}
+		}
+		if (quality >= pvrtexture::ePVRTCHigh)
+		{
+			const int radius = quality == pvrtexture::ePVRTCBest ? 3 : 1;
+			const int a0 = best.a0;
+			const int a1 = best.a1;
+			for (int d0 = -radius; d0 <= radius; ++d0)
+			{
+				for (int d1 = -radius; d1 <= radius; ++d1)
+				{
+					if (d0 != 0 || d1 != 0)
+					{
+						TryAlphaEndpoints(values, a0 + d0, a1 + d1, best);
+					}
+				}
+			}
+		}
+
+		out[0] = (uint8_t)best.a0;
+		out[1] = (uint8_t)best.a1;
+		uint64_t bits = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			bits |= (uint64_t)best.indices[i] << (3u * i);
+		}
+		for (int i = 0; i < 6; ++i)
+		{
+			out[2 + i] = (uint8_t)(bits >> (8u * i));
+		}
+	}
+
+	void LoadColourBlock(const float* rgba, ColourBlock& block, bool punch_through)
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			block.r[i] = To255(rgba[4 * i + 0]);
+			block.g[i] = To255(rgba[4 * i + 1]);
+			block.b[i] = To255(rgba[4 * i + 2]);
+			block.w[i] = punch_through && rgba[4 * i + 3] < 0.5f ? 0.0f : 1.0f;
+		}
+	}
+
+	void LoadChannel(const float* rgba, int channel, float* values)
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			values[i] = To255(rgba[4 * i + channel]);
+		}
+	}
+
+	void DecodeColourBlock(const uint8_t* block, uint8_t* rgba, bool four_colour_only)
+	{
+		uint16_t c0 = (uint16_t)(block[0] | (block[1] << 8u));
+		uint16_t c1 = (uint16_t)(block[2] | (block[3] << 8u));
+		int p0[3];
+		int p1[3];
+		Unpack565(c0, p0);
+		Unpack565(c1, p1);
+		uint8_t palette[4][4];
+		for (int k = 0; k < 3; ++k)
+		{
+			palette[0][k] = (uint8_t)p0[k];
+			palette[1][k] = (uint8_t)p1[k];
+			if (c0 > c1 || four_colour_only)
+			{
+				palette[2][k] = (uint8_t)((2 * p0[k] + p1[k] + 1) / 3);
+				palette[3][k] = (uint8_t)((p0[k] + 2 * p1[k] + 1) / 3);
+			}
+			else
+			{
+				palette[2][k] = (uint8_t)((p0[k] + p1[k] + 1) / 2);
+				palette[3][k] = 0;
+			}
+		}
+		palette[0][3] = palette[1][3] = palette[2][3] = 255;
+		palette[3][3] = c0 > c1 || four_colour_only ? 255 : 0;
+		uint32_t bits;
+		memcpy(&bits, block + 4, 4);
+		for (int i = 0; i < 16; ++i)
+		{
+			memcpy(rgba + 4 * i, palette[(bits >> (2u * i)) & 3u], 4);
+		}
+	}
+
+	void DecodeAlphaBlock(const uint8_t* block, uint8_t* rgba, int channel)
+	{
+		int a0 = block[0];
+		int a1 = block[1];
+		uint8_t palette[8];
+		palette[0] = (uint8_t)a0;
+		palette[1] = (uint8_t)a1;
+		if (a0 > a1)
+		{
+			for (int i = 2; i < 8; ++i)
+			{
+				palette[i] = (uint8_t)(((8 - i) * a0 + (i - 1) * a1 + 3) / 7);
+			}
+		}
+		else
+		{
+			for (int i = 2; i < 6; ++i)
+			{
+				palette[i] = (uint8_t)(((6 - i) * a0 + (i - 1) * a1 + 2) / 5);
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+		uint64_t bits = 0;
+		for (int i = 0; i < 6; ++i)
+		{
+			bits |= (uint64_t)block[2 + i] << (8u * i);
+		}
+		for (int i = 0; i < 16; ++i)
+		{
+			rgba[4 * i + channel] = palette[(bits >> (3u * i)) & 7u];
+		}
+	}
+}
+
+
+void EncodeBC1Block(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality, bool punch_through)
+{
+	ColourBlock colour;
+	LoadColourBlock(rgba, colour, punch_through);
+	bool transparent = false;
+	for (int i = 0; i < 16; ++i)
+	{
+		transparent |= colour.w[i] == 0.0f;
+	}
+	EncodeColourBlock(colour, quality, true, transparent, block);
+}
+
+void EncodeBC2Block(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality)
+{
+	uint64_t alpha = 0;
+	for (int i = 0; i < 16; ++i)
+	{
+		alpha |= (uint64_t)Quantize(To255(rgba[4 * i + 3]), 15) << (4u * i);
+	}
+	memcpy(block, &alpha, 8);
+	ColourBlock colour;
+	LoadColourBlock(rgba, colour, false);
+	EncodeColourBlock(colour, quality, false, false, block + 8);
+}
+
+void EncodeBC3Block(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality)
+{
+	float alpha[16];
+	LoadChannel(rgba, 3, alpha);
+	EncodeAlphaBlock(alpha, quality, block);
+	ColourBlock colour;
+	LoadColourBlock(rgba, colour, false);
+	EncodeColourBlock(colour, quality, false, false, block + 8);
+}
+
+void EncodeBC4Block(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality)
+{
+	float values[16];
+	LoadChannel(rgba, 0, values);
+	EncodeAlphaBlock(values, quality, block);
+}
+
+void EncodeBC5Block(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality)
+{
+	float values[16];
+	LoadChannel(rgba, 0, values);
+	EncodeAlphaBlock(values, quality, block);
+	LoadChannel(rgba, 1, values);
+	EncodeAlphaBlock(values, quality, block + 8);
+}
+
+void DecodeBC1Block(const uint8_t* block, uint8_t* rgba, bool four_colour_only)
+{
+	DecodeColourBlock(block, rgba, four_colour_only);
+}
+
+void DecodeBC2Block(const uint8_t* block, uint8_t* rgba)
+{
+	DecodeColourBlock(block + 8, rgba, true);
+	uint64_t alpha;
+	memcpy(&alpha, block, 8);
+	for (int i = 0; i < 16; ++i)
+	{
+		rgba[4 * i + 3] = (uint8_t)(((alpha >> (4u * i)) & 15u) * 17u);
+	}
+}
+
+void DecodeBC3Block(const uint8_t* block, uint8_t* rgba)
+{
+	DecodeColourBlock(block + 8, rgba, true);
+	DecodeAlphaBlock(block, rgba, 3);
+}
+
+void DecodeBC4Block(const uint8_t* block, uint8_t* rgba)
+{
+	for (int i = 0; i < 16; ++i)
+	{
+		rgba[4 * i + 1] = 0;
+		rgba[4 * i + 2] = 0;
+		rgba[4 * i + 3] = 255;
+	}
+	DecodeAlphaBlock(block, rgba, 0);
+}
+
+void DecodeBC5Block(const uint8_t* block, uint8_t* rgba)
+{
+	for (int i = 0; i < 16; ++i)
+	{
+		rgba[4 * i + 2] = 0;
+		rgba[4 * i + 3] = 255;
+	}
+	DecodeAlphaBlock(block, rgba, 0);
+	DecodeAlphaBlock(block + 8, rgba, 1);
+}
@@ -0,0 +1,49 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#pragma once
+#include <PVRTextureDefines.h>
+
+#include <cstdint>
+
+
+// Block encoders and decoders of BC1 (DXT1), BC2 (DXT3), BC3 (DXT5), BC4 and BC5.
+// Encoders take the 16 texels of a 4x4 block, row by row, as RGBA float32. Values are clamped to [0, 1].
+// Decoders write 16 RGBA8 texels.
+//
+// Quality levels:
+//   Fastest - endpoints from the bounding box of the block;
+//   Fast    - endpoints from the extent of the block along its principal axis;
+//   Normal  - plus least squares refinement of endpoints, exact encoding of solid blocks;
+//   High    - more refinement passes, BC1 also tries 3 colour mode, BC4 searches endpoints around the extremes;
+//   Best    - plus local search over quantized endpoints.
+
+// Texels with alpha below 0.5 are encoded as transparent in 3 colour mode if punch_through is set
+void EncodeBC1Block(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality, bool punch_through);
+void EncodeBC2Block(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality);
+void EncodeBC3Block(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality);
+// Encodes the red channel
+void EncodeBC4Block(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality);
+// Encodes the red and green channels
+void EncodeBC5Block(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality);
+
+// BC2 and BC3 colour blocks are always decoded in 4 colour mode
+void DecodeBC1Block(const uint8_t* block, uint8_t* rgba, bool four_colour_only = false);
+void DecodeBC2Block(const uint8_t* block, uint8_t* rgba);
+void DecodeBC3Block(const uint8_t* block, uint8_t* rgba);
+// Missing channels are decoded as 0, alpha as 255
+void DecodeBC4Block(const uint8_t* block, uint8_t* rgba);
+void DecodeBC5Block(const uint8_t* block, uint8_t* rgba);
@@ -0,0 +1,559 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#include "bptc.h"
+#include "bptc_common.h"
+#include "surface.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+
+namespace
+{
+	// Fields of the BC6H header: endpoints w, x of the first region and y, z of the second one for each channel,
+	// and the partition
+	enum Field
+	{
+		RW, RX, RY, RZ,
+		GW, GX, GY, GZ,
+		BW, BX, BY, BZ,
+		D
+	};
+
+	// Bits of a field from first to last, e.g. {RW, 0, 9} is rw[9:0] and {RW, 15, 10} is rw[10:15], which is stored reversed
+	struct Segment
+	{
+		uint8_t field;
+		uint8_t first;
+		uint8_t last;
+	};
+
+	const Segment layout1[] = {
+			{GY, 4, 4}, {BY, 4, 4}, {BZ, 4, 4}, {RW, 0, 9}, {GW, 0, 9}, {BW, 0, 9}, {RX, 0, 4}, {GZ, 4, 4},
+			{GY, 0, 3}, {GX, 0, 4}, {BZ, 0, 0}, {GZ, 0, 3}, {BX, 0, 4}, {BZ, 1, 1}, {BY, 0, 3}, {RY, 0, 4},
+			{BZ, 2, 2}, {RZ, 0, 4}, {BZ, 3, 3}, {D, 0, 4}};
+	const Segment layout2[] = {
+			{GY, 5, 5}, {GZ, 4, 4}, {GZ, 5, 5}, {RW, 0, 6}, {BZ, 0, 0}, {BZ, 1, 1}, {BY, 4, 4}, {GW, 0, 6},
+			{BY, 5, 5}, {BZ, 2, 2}, {GY, 4, 4}, {BW, 0, 6}, {BZ, 3, 3}, {BZ, 5, 5}, {BZ, 4, 4}, {RX, 0, 5},
+			{GY, 0, 3}, {GX, 0, 5}, {GZ, 0, 3}, {BX, 0, 5}, {BY, 0, 3}, {RY, 0, 5}, {RZ, 0, 5}, {D, 0, 4}};
+	const Segment layout3[] = {
+			{RW, 0, 9}, {GW, 0, 9}, {BW, 0, 9}, {RX, 0, 4}, {RW, 10, 10}, {GY, 0, 3}, {GX, 0, 3}, {GW, 10, 10},
+			{BZ, 0, 0}, {GZ, 0, 3}, {BX, 0, 3}, {BW, 10, 10}, {BZ, 1, 1}, {BY, 0, 3}, {RY, 0, 4}, {BZ, 2, 2},
+			{RZ, 0, 4}, {BZ, 3, 3}, {D, 0, 4}};
+	const Segment layout4[] = {
+			{RW, 0, 9}, {GW, 0, 9}, {BW, 0, 9}, {RX, 0, 3}, {RW, 10, 10}, {GZ, 4, 4}, {GY, 0, 3}, {GX, 0, 4},
+			{GW, 10, 10}, {GZ, 0, 3}, {BX, 0, 3}, {BW, 10, 10}, {BZ, 1, 1}, {BY, 0, 3}, {RY, 0, 3}, {BZ, 0, 0},
+			{BZ, 2, 2}, {RZ, 0, 3}, {GY, 4, 4}, {BZ, 3, 3}, {D, 0, 4}};
+	const Segment layout5[] = {
+			{RW, 0, 9}, {GW, 0, 9}, {BW, 0, 9}, {RX, 0, 3}, {RW, 10, 10}, {BY, 4, 4}, {GY, 0, 3}, {GX, 0, 3},
+			{GW, 10, 10}, {BZ, 0, 0}, {GZ, 0, 3}, {BX, 0, 4}, {BW, 10, 10}, {BY, 0, 3}, {RY, 0, 3}, {BZ, 1, 1},
+			{BZ, 2, 2}, {RZ, 0, 3}, {BZ, 4, 4}, {BZ, 3, 3}, {D, 0, 4}};
+	const Segment layout6[] = {
+			{RW, 0, 8}, {BY, 4, 4}, {GW, 0, 8}, {GY, 4, 4}, {BW, 0, 8}, {BZ, 4, 4}, {RX, 0, 4}, {GZ, 4, 4},
+			{GY, 0, 3}, {GX, 0, 4}, {BZ, 0, 0}, {GZ, 0, 3}, {BX, 0, 4}, {BZ, 1, 1}, {BY, 0, 3}, {RY, 0, 4},
+			{BZ, 2, 2}, {RZ, 0, 4}, {BZ, 3, 3}, {D, 0, 4}};
+	const Segment layout7[] = {
+			{RW, 0, 7}, {GZ, 4, 4}, {BY, 4, 4}, {GW, 0, 7}, {BZ, 2, 2}, {GY, 4, 4}, {BW, 0, 7}, {BZ, 3, 3},
+			{BZ, 4, 4}, {RX, 0, 5}, {GY, 0, 3}, {GX, 0, 4}, {BZ, 0, 0}, {GZ, 0, 3}, {BX, 0, 4}, {BZ, 1, 1},
+			{BY, 0, 3}, {RY, 0, 5}, {RZ, 0, 5}, {D, 0, 4}};
+	const Segment layout8[] = {
+			{RW, 0, 7}, {BZ, 0, 0}, {BY, 4, 4}, {GW, 0, 7}, {GY, 5, 5}, {GY, 4, 4}, {BW, 0, 7}, {GZ, 5, 5},
+			{BZ, 4, 4}, {RX, 0, 4}, {GZ, 4, 4}, {GY, 0, 3}, {GX, 0, 5}, {GZ, 0, 3}, {BX, 0, 4}, {BZ, 1, 1},
+			{BY, 0, 3}, {RY, 0, 4}, {BZ, 2, 2}, {RZ, 0, 4}, {BZ, 3, 3}, {D, 0, 4}};
+	const Segment layout9[] = {
+			{RW, 0, 7}, {BZ, 1, 1}, {BY, 4, 4}, {GW, 0, 7}, {BY, 5, 5}, {GY, 4, 4}, {BW, 0, 7}, {BZ, 5, 5},
+			{BZ, 4, 4}, {RX, 0, 4}, {GZ, 4, 4}, {GY, 0, 3}, {GX, 0, 4}, {BZ, 0, 0}, {GZ, 0, 3}, {BX, 0, 5},
+			{BY, 0, 3}, {RY, 0, 4}, {BZ, 2, 2}, {RZ, 0, 4}, {BZ, 3, 3}, {D, 0, 4}};
+	const Segment layout10[] = {
+			{RW, 0, 5}, {GZ, 4, 4}, {BZ, 0, 0}, {BZ, 1, 1}, {BY, 4, 4}, {GW, 0, 5}, {GY, 5, 5}, {BY, 5, 5},
+			{BZ, 2, 2}, {GY, 4, 4}, {BW, 0, 5}, {GZ, 5, 5}, {BZ, 3, 3}, {BZ, 5, 5}, {BZ, 4, 4}, {RX, 0, 5},
+			{GY, 0, 3}, {GX, 0, 5}, {GZ, 0, 3}, {BX, 0, 5}, {BY, 0, 3}, {RY, 0, 5}, {RZ, 0, 5}, {D, 0, 4}};
+	const Segment layout11[] = {
+			{RW, 0, 9}, {GW, 0, 9}, {BW, 0, 9}, {RX, 0, 9}, {GX, 0, 9}, {BX, 0, 9}};
+	const Segment layout12[] = {
+			{RW, 0, 9}, {GW, 0, 9}, {BW, 0, 9}, {RX, 0, 8}, {RW, 10, 10}, {GX, 0, 8}, {GW, 10, 10}, {BX, 0, 8},
+			{BW, 10, 10}};
+	const Segment layout13[] = {
+			{RW, 0, 9}, {GW, 0, 9}, {BW, 0, 9}, {RX, 0, 7}, {RW, 11, 10}, {GX, 0, 7}, {GW, 11, 10}, {BX, 0, 7},
+			{BW, 11, 10}};
+	const Segment layout14[] = {
+			{RW, 0, 9}, {GW, 0, 9}, {BW, 0, 9}, {RX, 0, 3}, {RW, 15, 10}, {GX, 0, 3}, {GW, 15, 10}, {BX, 0, 3},
+			{BW, 15, 10}};
+
+	struct ModeInfo
+	{
+		uint32_t value;
+		int value_bits;
+		int regions;
+		bool transformed;
+		int endpoint_bits;
+		int delta_bits[3];
+		const Segment* layout;
+		int layout_size;
+	};
+
+#define LAYOUT(layout) layout, (int)(sizeof(layout) / sizeof(layout[0]))
+
+	const ModeInfo modes[14] = {
+			{0x00, 2, 2, true, 10, {5, 5, 5}, LAYOUT(layout1)},
+			{0x01, 2, 2, true, 7, {6, 6, 6}, LAYOUT(layout2)},
+			{0x02, 5, 2, true, 11, {5, 4, 4}, LAYOUT(layout3)},
+			{0x06, 5, 2, true, 11, {4, 5, 4}, LAYOUT(layout4)},
+			{0x0A, 5, 2, true, 11, {4, 4, 5}, LAYOUT(layout5)},
+			{0x0E, 5, 2, true, 9, {5, 5, 5}, LAYOUT(layout6)},
+			{0x12, 5, 2, true, 8, {6, 5, 5}, LAYOUT(layout7)},
+			{0x16, 5, 2, true, 8, {5, 6, 5}, LAYOUT(layout8)},
+			{0x1A, 5, 2, true, 8, {5, 5, 6}, LAYOUT(layout9)},
+			{0x1E, 5, 2, false, 6, {6, 6, 6}, LAYOUT(layout10)},
+			{0x03, 5, 1, false, 10, {10, 10, 10}, LAYOUT(layout11)},
+			{0x07, 5, 1, true, 11, {9, 9, 9}, LAYOUT(layout12)},
+			{0x0B, 5, 1, true, 12, {8, 8, 8}, LAYOUT(layout13)},
+			{0x0F, 5, 1, true, 16, {4, 4, 4}, LAYOUT(layout14)},
+	};
+
+#undef LAYOUT
+
+	// Mode of the header value, -1 for reserved modes
+	int FindMode(uint32_t value)
+	{
+		for (int mode = 0; mode < 14; ++mode)
+		{
+			uint32_t mask = (1u << (unsigned)modes[mode].value_bits) - 1u;
+			if ((value & mask) == modes[mode].value)
+			{
+				return mode;
+			}
+		}
+		return -1;
+	}
+
+	inline int SignExtend(int value, int bits)
+	{
+		int shift = 32 - bits;
+		return (int)((uint32_t)value << (unsigned)shift) >> shift;
+	}
+
+	// Endpoints are quantized in a 16 bit domain, where interpolation takes place before values are scaled to halves
+	int Unquantize(int q, int bits, bool is_signed)
+	{
+		if (!is_signed)
+		{
+			if (bits >= 15 || q == 0)
+			{
+				return q;
+			}
+			if (q == (1 << bits) - 1)
+			{
+				return 0xFFFF;
+			}
+			return ((q << 16) + 0x8000) >> bits;
+		}
+		if (bits >= 16)
+		{
+			return q;
+		}
+		int magnitude = std::abs(q);
+		int result;
+		if (magnitude == 0)
+		{
+			result = 0;
+		}
+		else if (magnitude >= (1 << (bits - 1)) - 1)
+		{
+			result = 0x7FFF;
+		}
+		else
+		{
+			result = ((magnitude << 15) + 0x4000) >> (bits - 1);
+		}
+		return q < 0 ? -result : result;
+	}
+
+	// Value of the half as an integer, negative for negative halves
+	inline int Finish(int x, bool is_signed)
+	{
+		if (!is_signed)
+		{
+			return (x * 31) >> 6;
+		}
+		return x < 0 ? -(((-x) * 31) >> 5) : (x * 31) >> 5;
+	}
+
+	inline uint16_t ToHalf(int value)
+	{
+		return value < 0 ? (uint16_t)(0x8000 | -value) : (uint16_t)value;
+	}
+
+	// Closest quantized value of an endpoint in the unquantized domain
+	int QuantizeEndpoint(float u, int bits, bool is_signed)
+	{
+		int max = is_signed ? (1 << (bits - 1)) - 1 : (1 << bits) - 1;
+		int min = is_signed ? -max : 0;
+		float scale = is_signed ? (float)(1 << (bits - 1)) / 32768.0f : (float)(1 << bits) / 65536.0f;
+		if ((is_signed && bits >= 16) || (!is_signed && bits >= 15))
+		{
+			scale = 1.0f;
+		}
+		int estimate = (int)std::floor(u * scale);
+		int best = std::min(std::max(estimate, min), max);
+		float best_distance = std::abs((float)Unquantize(best, bits, is_signed) - u);
+		for (int q = estimate - 1; q <= estimate + 1; ++q)
+		{
+			if (q < min || q > max)
+			{
+				continue;
+			}
+			float distance = std::abs((float)Unquantize(q, bits, is_signed) - u);
+			if (distance < best_distance)
+			{
+				best = q;
+				best_distance = distance;
+			}
+		}
+		return best;
+	}
+
+	struct HDRBlock
+	{
+		int target[16][3];     // halves as integers
+		float values[16][4];   // targets in the unquantized domain
+		bool is_signed;
+	};
+
+	struct Encoding
+	{
+		int mode;
+		int partition;
+		int endpoints[4][3];   // quantized w, x, y, z
+		uint8_t indices[16];
+		int64_t error;
+	};
+
+	struct Search
+	{
+		int partitions;
+		int refine;
+	};
+
+	Search GetSearch(pvrtexture::ECompressorQuality quality)
+	{
+		switch (quality)
+		{
+			case pvrtexture::ePVRTCFastest: return {0, 0};
+			case pvrtexture::ePVRTCFast: return {1, 1};
+			case pvrtexture::ePVRTCNormal: return {4, 1};
+			case pvrtexture::ePVRTCHigh: return {8, 2};
+			default: return {32, 3};
+		}
+	}
+
+	// Selects indices of all texels for quantized endpoints. Anchor indices are limited to the lower half of
+	// the palette if constrain_anchors is set, otherwise they are left for the caller to fix by swapping endpoints
+	int64_t SelectIndices(const HDRBlock& block, const ModeInfo& info, int partition, const int (*endpoints)[3],
+	                      bool constrain_anchors, uint8_t* indices)
+	{
+		const int index_bits = info.regions == 2 ? 3 : 4;
+		const int entries = 1 << index_bits;
+		const uint8_t* weights = GetBPTCWeights(index_bits);
+		int palette[2][16][3];
+		for (int r = 0; r < info.regions; ++r)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				int a = Unquantize(endpoints[2 * r][c], info.endpoint_bits, block.is_signed);
+				int b = Unquantize(endpoints[2 * r + 1][c], info.endpoint_bits, block.is_signed);
+				for (int k = 0; k < entries; ++k)
+				{
+					palette[r][k][c] = Finish(InterpolateBPTC(a, b, weights[k]), block.is_signed);
+				}
+			}
+		}
+		int64_t total = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			int region = GetBPTCSubset(info.regions, partition, i);
+			bool anchor = i == GetBPTCAnchor(info.regions, partition, region);
+			int count = constrain_anchors && anchor ? entries / 2 : entries;
+			int64_t best = INT64_MAX;
+			for (int k = 0; k < count; ++k)
+			{
+				int64_t error = 0;
+				for (int c = 0; c < 3; ++c)
+				{
+					int64_t d = block.target[i][c] - palette[region][k][c];
+					error += d * d;
+				}
+				if (error < best)
+				{
+					best = error;
+					indices[i] = (uint8_t)k;
+				}
+			}
+			total += best;
+		}
+		return total;
+	}
+
+	// Quantizes region endpoints for a mode, fixes anchors and fits deltas into their bits
+	int64_t QuantizeEncoding(const HDRBlock& block, const float (*ends)[3], Encoding& encoding)
+	{
+		const ModeInfo& info = modes[encoding.mode];
+		for (int e = 0; e < 2 * info.regions; ++e)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				encoding.endpoints[e][c] = QuantizeEndpoint(ends[e][c], info.endpoint_bits, block.is_signed);
+			}
+		}
+		SelectIndices(block, info, encoding.partition, encoding.endpoints, false, encoding.indices);
+		const int half = info.regions == 2 ? 4 : 8;
+		for (int r = 0; r < info.regions; ++r)
+		{
+			if (encoding.indices[GetBPTCAnchor(info.regions, encoding.partition, r)] >= half)
+			{
+				for (int c = 0; c < 3; ++c)
+				{
+					std::swap(encoding.endpoints[2 * r][c], encoding.endpoints[2 * r + 1][c]);
+				}
+			}
+		}
+		if (info.transformed)
+		{
+			// clamped deltas move endpoints towards w, so they stay in range
+			for (int e = 1; e < 2 * info.regions; ++e)
+			{
+				for (int c = 0; c < 3; ++c)
+				{
+					int limit = 1 << (info.delta_bits[c] - 1);
+					int delta = std::min(std::max(encoding.endpoints[e][c] - encoding.endpoints[0][c], -limit), limit - 1);
+					encoding.endpoints[e][c] = encoding.endpoints[0][c] + delta;
+				}
+			}
+		}
+		encoding.error = SelectIndices(block, info, encoding.partition, encoding.endpoints, true, encoding.indices);
+		return encoding.error;
+	}
+
+	void EncodeMode(const HDRBlock& block, int mode, int partition, const uint8_t (*texels)[16], const int* counts,
+	                const float (*fitted)[3], int refine, Encoding& best)
+	{
+		const ModeInfo& info = modes[mode];
+		const uint8_t* weights = GetBPTCWeights(info.regions == 2 ? 3 : 4);
+		float ends[4][3];
+		memcpy(ends, fitted, sizeof(ends));
+		Encoding encoding;
+		encoding.mode = mode;
+		encoding.partition = partition;
+		for (int pass = 0; pass <= refine; ++pass)
+		{
+			if (QuantizeEncoding(block, ends, encoding) < best.error)
+			{
+				best = encoding;
+			}
+			if (encoding.error == 0 || pass == refine)
+			{
+				break;
+			}
+			for (int r = 0; r < info.regions; ++r)
+			{
+				float a[4];
+				float b[4];
+				if (RefineBPTCEndpoints(block.values, texels[r], counts[r], 3, encoding.indices, weights, a, b))
+				{
+					memcpy(ends[2 * r], a, sizeof(ends[0]));
+					memcpy(ends[2 * r + 1], b, sizeof(ends[0]));
+				}
+			}
+		}
+	}
+
+	// Fits lines to the regions of a partition and tries all modes with that number of regions
+	void EncodePartition(const HDRBlock& block, int regions, int partition, int refine, Encoding& best)
+	{
+		uint8_t texels[2][16];
+		int counts[2] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			int r = GetBPTCSubset(regions, partition, i);
+			texels[r][counts[r]++] = (uint8_t)i;
+		}
+		float fitted[4][3] = {};
+		for (int r = 0; r < regions; ++r)
+		{
+			float a[4];
+			float b[4];
+			FitBPTCLine(block.values, texels[r], counts[r], 3, a, b);
+			memcpy(fitted[2 * r], a, sizeof(fitted[0]));
+			memcpy(fitted[2 * r + 1], b, sizeof(fitted[0]));
+		}
+		for (int mode = 0; mode < 14 && best.error > 0; ++mode)
+		{
+			if (modes[mode].regions == regions)
+			{
+				EncodeMode(block, mode, partition, texels, counts, fitted, refine, best);
+			}
+		}
+	}
+
+	void WriteBlock(const Encoding& encoding, uint8_t* block)
+	{
+		const ModeInfo& info = modes[encoding.mode];
+		uint32_t fields[13] = {};
+		for (int c = 0; c < 3; ++c)
+		{
+			int w = encoding.endpoints[0][c];
+			fields[4 * c] = (uint32_t)w;
+			for (int e = 1; e < 2 * info.regions; ++e)
+			{
+				fields[4 * c + e] = (uint32_t)(info.transformed ? encoding.endpoints[e][c] - w : encoding.endpoints[e][c]);
+			}
+		}
+		fields[D] = (uint32_t)encoding.partition;
+
+		BlockBitWriter writer;
+		writer.Write(info.value, info.value_bits);
+		for (int i = 0; i < info.layout_size; ++i)
+		{
+			const Segment& segment = info.layout[i];
+			int step = segment.last >= segment.first ? 1 : -1;
+			for (int bit = segment.first; ; bit += step)
+			{
+				writer.Write(fields[segment.field] >> (unsigned)bit, 1);
+				if (bit == segment.last)
+				{
+					break;
+				}
+			}
+		}
+		for (int i = 0; i < 16; ++i)
+		{
+			int region = GetBPTCSubset(info.regions, encoding.partition, i);
+			bool anchor = i == GetBPTCAnchor(info.regions, encoding.partition, region);
+			writer.Write(encoding.indices[i], (info.regions == 2 ? 3 : 4) - (anchor ? 1 : 0));
+		}
+		writer.Store(block);
+	}
+}
+
+
+void EncodeBC6HBlock(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality, bool is_signed)
+{
+	HDRBlock hdr;
+	hdr.is_signed = is_signed;
+	for (int i = 0; i < 16; ++i)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			uint16_t h = FloatToHalf(rgba[4 * i + c]);
+			bool negative = (h & 0x8000u) != 0;
+			// infinity and NaN become the largest finite half
+			int magnitude = std::min(h & 0x7FFF, 0x7BFF);
+			int value = negative ? (is_signed ? -magnitude : 0) : magnitude;
+			hdr.target[i][c] = value;
+			hdr.values[i][c] = is_signed ? value * 32.0f / 31.0f : value * 64.0f / 31.0f;
+		}
+		hdr.values[i][3] = 0.0f;
+	}
+
+	Search search = GetSearch(quality);
+	Encoding best;
+	best.error = INT64_MAX;
+	EncodePartition(hdr, 1, 0, search.refine, best);
+	if (search.partitions > 0 && best.error > 0)
+	{
+		int ranked[32];
+		RankBPTCPartitions(hdr.values, 2, 32, 3, ranked);
+		for (int i = 0; i < search.partitions && best.error > 0; ++i)
+		{
+			EncodePartition(hdr, 2, ranked[i], search.refine, best);
+		}
+	}
+	WriteBlock(best, block);
+}
+
+void DecodeBC6HBlock(const uint8_t* block, float* rgba, bool is_signed)
+{
+	BlockBitReader reader(block);
+	uint32_t value = reader.Read(2);
+	if (value >= 2)
+	{
+		value |= reader.Read(3) << 2u;
+	}
+	int mode = FindMode(value);
+	if (mode < 0)
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			rgba[4 * i] = rgba[4 * i + 1] = rgba[4 * i + 2] = 0.0f;
+			rgba[4 * i + 3] = 1.0f;
+		}
+		return;
+	}
+	const ModeInfo& info = modes[mode];
+	uint32_t fields[13] = {};
+	for (int i = 0; i < info.layout_size; ++i)
+	{
+		const Segment& segment = info.layout[i];
+		int step = segment.last >= segment.first ? 1 : -1;
+		for (int bit = segment.first; ; bit += step)
+		{
+			fields[segment.field] |= reader.Read(1) << (unsigned)bit;
+			if (bit == segment.last)
+			{
+				break;
+			}
+		}
+	}
+	int partition = info.regions == 2 ? (int)fields[D] : 0;
+
+	int endpoints[4][3];
+	const int mask = (1 << info.endpoint_bits) - 1;
+	for (int c = 0; c < 3; ++c)
+	{
+		int w = (int)fields[4 * c];
+		for (int e = 0; e < 2 * info.regions; ++e)
+		{
+			int v = (int)fields[4 * c + e];
+			if (info.transformed && e > 0)
+			{
+				v = (w + SignExtend(v, info.delta_bits[c])) & mask;
+			}
+			if (is_signed)
+			{
+				v = SignExtend(v, info.endpoint_bits);
+			}
+			endpoints[e][c] = Unquantize(v, info.endpoint_bits, is_signed);
+		}
+	}
+
+	const int index_bits = info.regions == 2 ? 3 : 4;
+	const uint8_t* weights = GetBPTCWeights(index_bits);
+	for (int i = 0; i < 16; ++i)
+	{
+		int region = GetBPTCSubset(info.regions, partition, i);
+		bool anchor = i == GetBPTCAnchor(info.regions, partition, region);
+		int index = (int)reader.Read(index_bits - (anchor ? 1 : 0));
+		for (int c = 0; c < 3; ++c)
+		{
+			int x = InterpolateBPTC(endpoints[2 * region][c], endpoints[2 * region + 1][c], weights[index]);
+			rgba[4 * i + c] = HalfToFloat(ToHalf(Finish(x, is_signed)));
+		}
+		rgba[4 * i + 3] = 1.0f;
+	}
+}
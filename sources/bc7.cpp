@@ -0,0 +1,558 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#include "bptc.h"
+#include "bptc_common.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+
+
+namespace
+{
+	struct ModeInfo
+	{
+		int subsets;
+		int partition_bits;
+		int rotation_bits;
+		int index_selection_bits;
+		int colour_bits;
+		int alpha_bits;
+		int endpoint_pbits;
+		int shared_pbits;
+		int index_bits;
+		int index_bits2;
+	};
+
+	const ModeInfo modes[8] = {
+			{3, 4, 0, 0, 4, 0, 1, 0, 3, 0},
+			{2, 6, 0, 0, 6, 0, 0, 1, 3, 0},
+			{3, 6, 0, 0, 5, 0, 0, 0, 2, 0},
+			{2, 6, 0, 0, 7, 0, 1, 0, 2, 0},
+			{1, 0, 2, 1, 5, 6, 0, 0, 2, 3},
+			{1, 0, 2, 0, 7, 8, 0, 0, 2, 2},
+			{1, 0, 0, 0, 7, 7, 1, 0, 4, 0},
+			{2, 6, 0, 0, 5, 5, 1, 0, 2, 0},
+	};
+
+	enum PBits
+	{
+		PBitsNone,
+		PBitsPerEndpoint,
+		PBitsShared
+	};
+
+	// Endpoints of one subset on the channels [first_channel, first_channel + channels), with one set of indices
+	struct FitParams
+	{
+		int first_channel;
+		int channels;
+		int bits[4];
+		PBits pbits;
+		int index_bits;
+		int refine;
+	};
+
+	struct EndpointFit
+	{
+		int q[2][4];           // quantized, without p-bits
+		int p[2];
+		int e[2][4];           // expanded to 8 bits
+		uint8_t indices[16];   // by texel position
+		float error;
+	};
+
+	struct Encoding
+	{
+		int mode;
+		int partition;
+		int rotation;
+		int index_selection;
+		int q[3][2][4];
+		int p[3][2];
+		uint8_t indices[2][16];
+		float error;
+	};
+
+	struct Search
+	{
+		unsigned mode_mask;
+		int partitions2;
+		int partitions3;
+		int refine;
+		bool rotations;
+	};
+
+	Search GetSearch(pvrtexture::ECompressorQuality quality)
+	{
+		switch (quality)
+		{
+			case pvrtexture::ePVRTCFastest: return {1u << 6u, 0, 0, 0, false};
+			case pvrtexture::ePVRTCFast: return {(1u << 6u) | (1u << 1u) | (1u << 5u), 1, 0, 1, false};
+			case pvrtexture::ePVRTCNormal: return {0xFFu, 4, 2, 1, false};
+			case pvrtexture::ePVRTCHigh: return {0xFFu, 16, 8, 2, true};
+			default: return {0xFFu, 64, 64, 3, true};
+		}
+	}
+
+	inline int Expand(int value, int bits)
+	{
+		return bits >= 8 ? value : ((value << (8 - bits)) | (value >> (2 * bits - 8)));
+	}
+
+	// Closest value of bits bits with the given p-bit appended, or without p-bit if pbit < 0
+	inline int QuantizeChannel(float x, int bits, int pbit)
+	{
+		x = std::min(std::max(x, 0.0f), 255.0f);
+		if (pbit < 0)
+		{
+			int max = (1 << bits) - 1;
+			return std::min(max, (int)(x * max / 255.0f + 0.5f));
+		}
+		int max = (1 << (bits + 1)) - 1;
+		int q = (int)((x * max / 255.0f - pbit) * 0.5f + 0.5f);
+		return std::min(std::max(q, 0), (1 << bits) - 1);
+	}
+
+	// Palettes of 8 and 16 entries are searched around the projection of the texel on the endpoint line, weights are
+	// spaced evenly enough for the nearest entry to be within one step of it
+	float SelectIndices(const float (*values)[4], const uint8_t* texels, int count, const FitParams& params,
+	                    EndpointFit& fit)
+	{
+		const uint8_t* weights = GetBPTCWeights(params.index_bits);
+		const int entries = 1 << params.index_bits;
+		float palette[16][4];
+		for (int k = 0; k < entries; ++k)
+		{
+			for (int c = 0; c < params.channels; ++c)
+			{
+				palette[k][c] = (float)InterpolateBPTC(fit.e[0][c], fit.e[1][c], weights[k]);
+			}
+		}
+		float direction[4];
+		float length = 0.0f;
+		for (int c = 0; c < params.channels; ++c)
+		{
+			direction[c] = palette[entries - 1][c] - palette[0][c];
+			length += direction[c] * direction[c];
+		}
+		float scale = length > 0.0f ? (entries - 1) / length : 0.0f;
+
+		float total = 0.0f;
+		for (int i = 0; i < count; ++i)
+		{
+			const float* v = values[texels[i]] + params.first_channel;
+			int first = 0;
+			int last = entries - 1;
+			if (entries > 4)
+			{
+				float t = 0.0f;
+				for (int c = 0; c < params.channels; ++c)
+				{
+					t += (v[c] - palette[0][c]) * direction[c];
+				}
+				int k = std::min(std::max((int)(t * scale + 0.5f), 0), entries - 1);
+				first = std::max(k - 1, 0);
+				last = std::min(k + 1, entries - 1);
+			}
+			float best = FLT_MAX;
+			int best_index = first;
+			for (int k = first; k <= last; ++k)
+			{
+				float error = 0.0f;
+				for (int c = 0; c < params.channels; ++c)
+				{
+					float d = v[c] - palette[k][c];
+					error += d * d;
+				}
+				if (error < best)
+				{
+					best = error;
+					best_index = k;
+				}
+			}
+			fit.indices[texels[i]] = (uint8_t)best_index;
+			total += best;
+		}
+		return total;
+	}
+
+	// Tries all p-bit combinations for the endpoints a and b, keeps the best in fit
+	bool TryEndpoints(const float (*values)[4], const uint8_t* texels, int count, const FitParams& params,
+	                  const float* a, const float* b, EndpointFit& fit)
+	{
+		int combinations = params.pbits == PBitsPerEndpoint ? 4 : (params.pbits == PBitsShared ? 2 : 1);
+		bool improved = false;
+		for (int combination = 0; combination < combinations; ++combination)
+		{
+			EndpointFit candidate;
+			candidate.p[0] = params.pbits == PBitsNone ? -1 : (combination & 1);
+			candidate.p[1] = params.pbits == PBitsPerEndpoint ? (combination >> 1) : candidate.p[0];
+			for (int c = 0; c < params.channels; ++c)
+			{
+				int bits = params.bits[c];
+				candidate.q[0][c] = QuantizeChannel(a[c], bits, candidate.p[0]);
+				candidate.q[1][c] = QuantizeChannel(b[c], bits, candidate.p[1]);
+				for (int e = 0; e < 2; ++e)
+				{
+					candidate.e[e][c] = candidate.p[e] < 0 ? Expand(candidate.q[e][c], bits) :
+							Expand((candidate.q[e][c] << 1) | candidate.p[e], bits + 1);
+				}
+			}
+			candidate.error = SelectIndices(values, texels, count, params, candidate);
+			if (candidate.error < fit.error)
+			{
+				fit = candidate;
+				improved = true;
+			}
+		}
+		return improved;
+	}
+
+	void FitSubset(const float (*values)[4], const uint8_t* texels, int count, const FitParams& params, EndpointFit& fit)
+	{
+		const float (*channels)[4] = (const float (*)[4])(&values[0][0] + params.first_channel);
+		float a[4];
+		float b[4];
+		FitBPTCLine(channels, texels, count, params.channels, a, b);
+		fit.error = FLT_MAX;
+		TryEndpoints(values, texels, count, params, a, b, fit);
+		const uint8_t* weights = GetBPTCWeights(params.index_bits);
+		for (int pass = 0; pass < params.refine && fit.error > 0.0f; ++pass)
+		{
+			if (!RefineBPTCEndpoints(channels, texels, count, params.channels, fit.indices, weights, a, b) ||
+			    !TryEndpoints(values, texels, count, params, a, b, fit))
+			{
+				break;
+			}
+		}
+
+		// the most significant bit of the anchor index is implicit, so it must be 0
+		int anchor = texels[0];
+		if (fit.indices[anchor] >> (params.index_bits - 1))
+		{
+			int max = (1 << params.index_bits) - 1;
+			for (int c = 0; c < params.channels; ++c)
+			{
+				std::swap(fit.q[0][c], fit.q[1][c]);
+				std::swap(fit.e[0][c], fit.e[1][c]);
+			}
+			std::swap(fit.p[0], fit.p[1]);
+			for (int i = 0; i < count; ++i)
+			{
+				fit.indices[texels[i]] = (uint8_t)(max - fit.indices[texels[i]]);
+			}
+		}
+	}
+
+	void EncodeMode(const float (*values)[4], int mode, int partition, int rotation, int index_selection, int refine,
+	                Encoding& best)
+	{
+		const ModeInfo& info = modes[mode];
+		uint8_t texels[3][16];
+		int counts[3] = {};
+		for (int s = 0; s < info.subsets; ++s)
+		{
+			// the anchor goes first, FitSubset expects it there
+			int anchor = GetBPTCAnchor(info.subsets, partition, s);
+			texels[s][counts[s]++] = (uint8_t)anchor;
+		}
+		for (int i = 0; i < 16; ++i)
+		{
+			int s = GetBPTCSubset(info.subsets, partition, i);
+			if (i != GetBPTCAnchor(info.subsets, partition, s))
+			{
+				texels[s][counts[s]++] = (uint8_t)i;
+			}
+		}
+
+		PBits pbits = info.endpoint_pbits ? PBitsPerEndpoint : (info.shared_pbits ? PBitsShared : PBitsNone);
+		bool separate_alpha = info.index_bits2 != 0;
+		FitParams colour = {0, separate_alpha || info.alpha_bits == 0 ? 3 : 4,
+		                    {info.colour_bits, info.colour_bits, info.colour_bits, info.alpha_bits},
+		                    pbits, index_selection ? info.index_bits2 : info.index_bits, refine};
+
+		Encoding encoding;
+		encoding.mode = mode;
+		encoding.partition = partition;
+		encoding.rotation = rotation;
+		encoding.index_selection = index_selection;
+		encoding.error = 0.0f;
+		for (int s = 0; s < info.subsets; ++s)
+		{
+			EndpointFit fit;
+			FitSubset(values, texels[s], counts[s], colour, fit);
+			encoding.error += fit.error;
+			if (encoding.error >= best.error)
+			{
+				return;
+			}
+			for (int c = 0; c < colour.channels; ++c)
+			{
+				encoding.q[s][0][c] = fit.q[0][c];
+				encoding.q[s][1][c] = fit.q[1][c];
+			}
+			encoding.p[s][0] = fit.p[0];
+			encoding.p[s][1] = fit.p[1];
+			for (int i = 0; i < counts[s]; ++i)
+			{
+				encoding.indices[index_selection][texels[s][i]] = fit.indices[texels[s][i]];
+			}
+		}
+		if (separate_alpha)
+		{
+			FitParams alpha = {3, 1, {info.alpha_bits}, PBitsNone, index_selection ? info.index_bits : info.index_bits2, refine};
+			EndpointFit fit;
+			FitSubset(values, texels[0], counts[0], alpha, fit);
+			encoding.error += fit.error;
+			encoding.q[0][0][3] = fit.q[0][0];
+			encoding.q[0][1][3] = fit.q[1][0];
+			memcpy(encoding.indices[1 - index_selection], fit.indices, 16);
+		}
+		if (encoding.error < best.error)
+		{
+			best = encoding;
+		}
+	}
+
+	void WriteBlock(const Encoding& encoding, uint8_t* block)
+	{
+		const ModeInfo& info = modes[encoding.mode];
+		BlockBitWriter writer;
+		writer.Write(1u << encoding.mode, encoding.mode + 1);
+		writer.Write(encoding.partition, info.partition_bits);
+		writer.Write(encoding.rotation, info.rotation_bits);
+		writer.Write(encoding.index_selection, info.index_selection_bits);
+		for (int c = 0; c < 3; ++c)
+		{
+			for (int s = 0; s < info.subsets; ++s)
+			{
+				writer.Write(encoding.q[s][0][c], info.colour_bits);
+				writer.Write(encoding.q[s][1][c], info.colour_bits);
+			}
+		}
+		if (info.alpha_bits)
+		{
+			for (int s = 0; s < info.subsets; ++s)
+			{
+				writer.Write(encoding.q[s][0][3], info.alpha_bits);
+				writer.Write(encoding.q[s][1][3], info.alpha_bits);
+			}
+		}
+		for (int s = 0; s < info.subsets; ++s)
+		{
+			if (info.endpoint_pbits)
+			{
+				writer.Write(encoding.p[s][0], 1);
+				writer.Write(encoding.p[s][1], 1);
+			}
+			else if (info.shared_pbits)
+			{
+				writer.Write(encoding.p[s][0], 1);
+			}
+		}
+		for (int i = 0; i < 16; ++i)
+		{
+			bool anchor = i == GetBPTCAnchor(info.subsets, encoding.partition, GetBPTCSubset(info.subsets, encoding.partition, i));
+			writer.Write(encoding.indices[0][i], info.index_bits - (anchor ? 1 : 0));
+		}
+		if (info.index_bits2)
+		{
+			for (int i = 0; i < 16; ++i)
+			{
+				writer.Write(encoding.indices[1][i], info.index_bits2 - (i == 0 ? 1 : 0));
+			}
+		}
+		writer.Store(block);
+	}
+}
+
+
+void EncodeBC7Block(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality)
+{
+	float values[16][4];
+	bool opaque = true;
+	for (int i = 0; i < 16; ++i)
+	{
+		for (int c = 0; c < 4; ++c)
+		{
+			// texels are matched to the 8 bit values they decode to
+			values[i][c] = (float)(int)(std::min(std::max(rgba[4 * i + c], 0.0f), 1.0f) * 255.0f + 0.5f);
+		}
+		opaque = opaque && values[i][3] == 255.0f;
+	}
+
+	Search search = GetSearch(quality);
+	Encoding best;
+	best.error = FLT_MAX;
+
+	// partitions are ranked once for all modes with the same number of subsets, modes with alpha are only used
+	// for blocks that are not opaque and the other way round
+	int ranked[2][64];
+	bool is_ranked[2] = {false, false};
+
+	// single subset modes first, they are cheap and often good enough to stop early
+	const int mode_order[8] = {6, 5, 4, 1, 3, 0, 2, 7};
+	for (int mode: mode_order)
+	{
+		const ModeInfo& info = modes[mode];
+		if (!(search.mode_mask & (1u << (unsigned)mode)))
+		{
+			continue;
+		}
+		// modes without alpha decode it as 255, and mode 7 gains nothing over mode 3 on opaque blocks
+		if ((info.alpha_bits == 0 && !opaque) || (mode == 7 && opaque))
+		{
+			continue;
+		}
+		if (info.subsets == 1)
+		{
+			int rotations = search.rotations ? (1 << info.rotation_bits) : 1;
+			int selections = search.rotations ? (1 << info.index_selection_bits) : 1;
+			for (int rotation = 0; rotation < rotations; ++rotation)
+			{
+				float rotated[16][4];
+				memcpy(rotated, values, sizeof(values));
+				if (rotation != 0)
+				{
+					for (int i = 0; i < 16; ++i)
+					{
+						std::swap(rotated[i][rotation - 1], rotated[i][3]);
+					}
+				}
+				for (int selection = 0; selection < selections; ++selection)
+				{
+					EncodeMode(rotated, mode, 0, rotation, selection, search.refine, best);
+				}
+			}
+		}
+		else
+		{
+			// mode 0 has only the first 16 partitions, the others all 64
+			int partition_count = 1 << info.partition_bits;
+			int tries = std::min(partition_count, info.subsets == 2 ? search.partitions2 : search.partitions3);
+			int* partitions = ranked[info.subsets - 2];
+			if (tries > 0 && !is_ranked[info.subsets - 2])
+			{
+				RankBPTCPartitions(values, info.subsets, 64, opaque ? 3 : 4, partitions);
+				is_ranked[info.subsets - 2] = true;
+			}
+			for (int i = 0; i < 64 && tries > 0; ++i)
+			{
+				if (partitions[i] < partition_count)
+				{
+					EncodeMode(values, mode, partitions[i], 0, 0, search.refine, best);
+					--tries;
+				}
+			}
+		}
+		if (best.error == 0.0f)
+		{
+			break;
+		}
+	}
+	WriteBlock(best, block);
+}
+
+void DecodeBC7Block(const uint8_t* block, uint8_t* rgba)
+{
+	int mode = 0;
+	while (mode < 8 && !(block[0] & (1u << (unsigned)mode)))
+	{
+		++mode;
+	}
+	if (mode == 8)
+	{
+		memset(rgba, 0, 64);
+		return;
+	}
+	const ModeInfo& info = modes[mode];
+	BlockBitReader reader(block);
+	reader.Read(mode + 1);
+	int partition = (int)reader.Read(info.partition_bits);
+	int rotation = (int)reader.Read(info.rotation_bits);
+	int index_selection = (int)reader.Read(info.index_selection_bits);
+
+	int endpoints[3][2][4];
+	for (int c = 0; c < 4; ++c)
+	{
+		int bits = c < 3 ? info.colour_bits : info.alpha_bits;
+		for (int s = 0; s < info.subsets; ++s)
+		{
+			for (int e = 0; e < 2; ++e)
+			{
+				endpoints[s][e][c] = bits ? (int)reader.Read(bits) : 255;
+			}
+		}
+	}
+	for (int s = 0; s < info.subsets; ++s)
+	{
+		int p[2] = {-1, -1};
+		if (info.endpoint_pbits)
+		{
+			p[0] = (int)reader.Read(1);
+			p[1] = (int)reader.Read(1);
+		}
+		else if (info.shared_pbits)
+		{
+			p[0] = p[1] = (int)reader.Read(1);
+		}
+		for (int e = 0; e < 2; ++e)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				int bits = c < 3 ? info.colour_bits : info.alpha_bits;
+				if (bits == 0)
+				{
+					continue;
+				}
+				endpoints[s][e][c] = p[e] < 0 ? Expand(endpoints[s][e][c], bits) :
+						Expand((endpoints[s][e][c] << 1) | p[e], bits + 1);
+			}
+		}
+	}
+
+	int indices[2][16];
+	for (int i = 0; i < 16; ++i)
+	{
+		bool anchor = i == GetBPTCAnchor(info.subsets, partition, GetBPTCSubset(info.subsets, partition, i));
+		indices[0][i] = (int)reader.Read(info.index_bits - (anchor ? 1 : 0));
+	}
+	for (int i = 0; i < 16 && info.index_bits2; ++i)
+	{
+		indices[1][i] = (int)reader.Read(info.index_bits2 - (i == 0 ? 1 : 0));
+	}
+
+	const uint8_t* colour_weights = GetBPTCWeights(index_selection ? info.index_bits2 : info.index_bits);
+	const uint8_t* alpha_weights = GetBPTCWeights(info.index_bits2 && !index_selection ? info.index_bits2 : info.index_bits);
+	const int* colour_indices = indices[info.index_bits2 && index_selection ? 1 : 0];
+	const int* alpha_indices = indices[info.index_bits2 && !index_selection ? 1 : 0];
+	for (int i = 0; i < 16; ++i)
+	{
+		const int (*e)[4] = endpoints[GetBPTCSubset(info.subsets, partition, i)];
+		uint8_t* texel = rgba + 4 * i;
+		for (int c = 0; c < 3; ++c)
+		{
+			texel[c] = (uint8_t)InterpolateBPTC(e[0][c], e[1][c], colour_weights[colour_indices[i]]);
+		}
+		texel[3] = (uint8_t)InterpolateBPTC(e[0][3], e[1][3], alpha_weights[alpha_indices[i]]);
+		if (rotation != 0)
+		{
+			std::swap(texel[rotation - 1], texel[3]);
+		}
+	}
+}
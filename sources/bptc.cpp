@@ -0,0 +1,328 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#include "bptc_common.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+const uint16_t BPTCPartitions2[64] = {
+		0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+		0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+		0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+		0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+		0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+		0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+		0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+		0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22,
+};
+
+const uint32_t BPTCPartitions3[64] = {
+		0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000, 0xA0A05050, 0x5555A0A0, 0x5A5A5050,
+		0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090, 0x94949494, 0xA4A4A4A4, 0xA9A59450, 0x2A0A4250,
+		0xA5945040, 0x0A425054, 0xA5A5A500, 0x55A0A0A0, 0xA8A85454, 0x6A6A4040, 0xA4A45000, 0x1A1A0500,
+		0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400, 0xA08585A0, 0xAA821414, 0x50A4A450, 0x6A5A0200,
+		0xA9A58000, 0x5090A0A8, 0xA8A09050, 0x24242424, 0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50,
+		0x500AA550, 0xAAAA4444, 0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600,
+		0xAA444444, 0x54A854A8, 0x95809580, 0x96969600, 0xA85454A8, 0x80959580, 0xAA141414, 0x96960000,
+		0xAAAA1414, 0xA05050A0, 0xA0A5A5A0, 0x96000000, 0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254,
+};
+
+const uint8_t BPTCAnchors2[64] = {
+		15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+		15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+		15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+		 6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15,
+};
+
+const uint8_t BPTCAnchors3[64][2] = {
+		{ 3, 15}, { 3,  8}, {15,  8}, {15,  3}, { 8, 15}, { 3, 15}, {15,  3}, {15,  8},
+		{ 8, 15}, { 8, 15}, { 6, 15}, { 6, 15}, { 6, 15}, { 5, 15}, { 3, 15}, { 3,  8},
+		{ 3, 15}, { 3,  8}, { 8, 15}, {15,  3}, { 3, 15}, { 3,  8}, { 6, 15}, {10,  8},
+		{ 5,  3}, { 8, 15}, { 8,  6}, { 6, 10}, { 8, 15}, { 5, 15}, {15, 10}, {15,  8},
+		{ 8, 15}, {15,  3}, { 3, 15}, { 5, 10}, { 6, 10}, {10,  8}, { 8,  9}, {15, 10},
+		{15,  6}, { 3, 15}, {15,  8}, { 5, 15}, {15,  3}, {15,  6}, {15,  6}, {15,  8},
+		{ 3, 15}, {15,  3}, { 5, 15}, { 5, 15}, { 5, 15}, { 8, 15}, { 5, 15}, {10, 15},
+		{ 5, 15}, {10, 15}, { 8, 15}, {13, 15}, {15,  3}, {12, 15}, { 3, 15}, { 3,  8},
+};
+
+namespace
+{
+	const uint8_t weights2[4] = {0, 21, 43, 64};
+	const uint8_t weights3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+	const uint8_t weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+	// Power iteration, starting from the row of the channel with the largest variance. Returns the largest eigenvalue
+	// of the symmetric covariance matrix, axis is normalized, or left zero if the matrix is zero.
+	// The starting row is usually close to the axis already, a few iterations are enough to rank partitions
+	float PrincipalAxis(const float (*covariance)[4], int channels, int iterations, float* axis)
+	{
+		int largest = 0;
+		for (int c = 1; c < channels; ++c)
+		{
+			if (covariance[c][c] > covariance[largest][largest])
+			{
+				largest = c;
+			}
+		}
+		float v[4] = {};
+		for (int c = 0; c < channels; ++c)
+		{
+			v[c] = covariance[largest][c];
+			axis[c] = 0.0f;
+		}
+		float norm = 0.0f;
+		for (int iteration = 0; iteration < iterations; ++iteration)
+		{
+			float next[4] = {};
+			norm = 0.0f;
+			for (int c = 0; c < channels; ++c)
+			{
+				for (int k = 0; k < channels; ++k)
+				{
+					next[c] += covariance[c][k] * v[k];
+				}
+				norm = std::max(norm, std::abs(next[c]));
+			}
+			if (norm == 0.0f)
+			{
+				return 0.0f;
+			}
+			float scale = 1.0f / norm;
+			for (int c = 0; c < channels; ++c)
+			{
+				v[c] = next[c] * scale;
+			}
+		}
+		float length = 0.0f;
+		for (int c = 0; c < channels; ++c)
+		{
+			length += v[c] * v[c];
+		}
+		length = std::sqrt(length);
+		// Rayleigh quotient of the normalized axis
+		float eigenvalue = 0.0f;
+		for (int c = 0; c < channels; ++c)
+		{
+			axis[c] = v[c] / length;
+		}
+		for (int c = 0; c < channels; ++c)
+		{
+			for (int k = 0; k < channels; ++k)
+			{
+				eigenvalue += axis[c] * covariance[c][k] * axis[k];
+			}
+		}
+		return eigenvalue;
+	}
+
+	// Sums of values and of their pairwise products over a set of texels. Values are taken relative to an origin close to
+	// their mean, otherwise covariance of HDR values would be lost to cancellation
+	struct Moments
+	{
+		float count;
+		float sum[4];
+		float products[4][4];
+	};
+
+	void AddTexel(Moments& moments, const float* value, const float* origin, int channels)
+	{
+		float v[4];
+		for (int c = 0; c < channels; ++c)
+		{
+			v[c] = value[c] - origin[c];
+		}
+		moments.count += 1.0f;
+		for (int c = 0; c < channels; ++c)
+		{
+			moments.sum[c] += v[c];
+			for (int k = c; k < channels; ++k)
+			{
+				moments.products[c][k] += v[c] * v[k];
+			}
+		}
+	}
+
+	float GetLineError(const Moments& moments, int channels)
+	{
+		if (moments.count == 0.0f)
+		{
+			return 0.0f;
+		}
+		float covariance[4][4];
+		float variance = 0.0f;
+		for (int c = 0; c < channels; ++c)
+		{
+			for (int k = c; k < channels; ++k)
+			{
+				covariance[c][k] = covariance[k][c] = moments.products[c][k] - moments.sum[c] * moments.sum[k] / moments.count;
+			}
+			variance += covariance[c][c];
+		}
+		float axis[4];
+		return std::max(variance - PrincipalAxis(covariance, channels, 3, axis), 0.0f);
+	}
+
+	void ComputeMean(const float (*values)[4], const uint8_t* texels, int count, int channels, float* mean)
+	{
+		for (int c = 0; c < channels; ++c)
+		{
+			mean[c] = 0.0f;
+			for (int i = 0; i < count; ++i)
+			{
+				mean[c] += values[texels[i]][c];
+			}
+			mean[c] /= (float)count;
+		}
+	}
+
+	void ComputeMoments(const float (*values)[4], const uint8_t* texels, int count, int channels, const float* origin,
+	                    Moments& moments)
+	{
+		memset(&moments, 0, sizeof(moments));
+		for (int i = 0; i < count; ++i)
+		{
+			AddTexel(moments, values[texels[i]], origin, channels);
+		}
+	}
+}
+
+
+const uint8_t* GetBPTCWeights(int index_bits)
+{
+	switch (index_bits)
+	{
+		case 2: return weights2;
+		case 3: return weights3;
+		default: return weights4;
+	}
+}
+
+void FitBPTCLine(const float (*values)[4], const uint8_t* texels, int count, int channels, float* a, float* b)
+{
+	float mean[4];
+	ComputeMean(values, texels, count, channels, mean);
+	Moments moments;
+	ComputeMoments(values, texels, count, channels, mean, moments);
+	float covariance[4][4];
+	for (int c = 0; c < channels; ++c)
+	{
+		for (int k = c; k < channels; ++k)
+		{
+			covariance[c][k] = covariance[k][c] = moments.products[c][k];
+		}
+	}
+	float axis[4];
+	PrincipalAxis(covariance, channels, 8, axis);
+	float low = 0.0f;
+	float high = 0.0f;
+	for (int i = 0; i < count; ++i)
+	{
+		float t = 0.0f;
+		for (int c = 0; c < channels; ++c)
+		{
+			t += (values[texels[i]][c] - mean[c]) * axis[c];
+		}
+		low = std::min(low, t);
+		high = std::max(high, t);
+	}
+	for (int c = 0; c < channels; ++c)
+	{
+		a[c] = mean[c] + axis[c] * low;
+		b[c] = mean[c] + axis[c] * high;
+	}
+}
+
+bool RefineBPTCEndpoints(const float (*values)[4], const uint8_t* texels, int count, int channels,
+                         const uint8_t* indices, const uint8_t* weights, float* a, float* b)
+{
+	float aa = 0.0f;
+	float ab = 0.0f;
+	float bb = 0.0f;
+	float at[4] = {};
+	float bt[4] = {};
+	for (int i = 0; i < count; ++i)
+	{
+		int texel = texels[i];
+		float w = weights[indices[texel]] / 64.0f;
+		float v = 1.0f - w;
+		aa += v * v;
+		ab += v * w;
+		bb += w * w;
+		for (int c = 0; c < channels; ++c)
+		{
+			at[c] += v * values[texel][c];
+			bt[c] += w * values[texel][c];
+		}
+	}
+	float det = aa * bb - ab * ab;
+	if (std::abs(det) < 1e-6f)
+	{
+		return false;
+	}
+	for (int c = 0; c < channels; ++c)
+	{
+		a[c] = (at[c] * bb - bt[c] * ab) / det;
+		b[c] = (bt[c] * aa - at[c] * ab) / det;
+	}
+	return true;
+}
+
+void RankBPTCPartitions(const float (*values)[4], int subsets, int partition_count, int channels, int* order)
+{
+	const uint8_t all[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+	float mean[4];
+	ComputeMean(values, all, 16, channels, mean);
+	Moments total;
+	ComputeMoments(values, all, 16, channels, mean, total);
+	float errors[64];
+	for (int p = 0; p < partition_count; ++p)
+	{
+		// moments of the first subset are what remains of the others
+		Moments moments[3];
+		memset(moments, 0, sizeof(moments));
+		for (int i = 0; i < 16; ++i)
+		{
+			int s = GetBPTCSubset(subsets, p, i);
+			if (s != 0)
+			{
+				AddTexel(moments[s], values[i], mean, channels);
+			}
+		}
+		moments[0] = total;
+		for (int s = 1; s < subsets; ++s)
+		{
+			moments[0].count -= moments[s].count;
+			for (int c = 0; c < channels; ++c)
+			{
+				moments[0].sum[c] -= moments[s].sum[c];
+				for (int k = c; k < channels; ++k)
+				{
+					moments[0].products[c][k] -= moments[s].products[c][k];
+				}
+			}
+		}
+		errors[p] = 0.0f;
+		for (int s = 0; s < subsets; ++s)
+		{
+			errors[p] += GetLineError(moments[s], channels);
+		}
+		order[p] = p;
+	}
+	std::stable_sort(order, order + partition_count, [&errors](int x, int y){ return errors[x] < errors[y]; });
+}
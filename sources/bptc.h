@@ -0,0 +1,41 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#pragma once
+#include <PVRTextureDefines.h>
+
+#include <cstdint>
+
+
+// Block encoders and decoders of BC6H and BC7. Encoders take the 16 texels of a 4x4 block, row by row, as RGBA float32.
+// BC7 clamps values to [0, 1]. BC6H encodes RGB as half floats, alpha is ignored; the unsigned variant clamps negative
+// values to 0 and both clamp magnitudes to the largest finite half.
+//
+// Quality levels limit the modes and partitions that are searched. Partitions are ranked by how well each of their
+// subsets fits a line, only the best ranked ones are tried:
+//   Fastest - BC7 mode 6, BC6H one region modes;
+//   Fast    - plus BC7 modes 1 and 5, BC6H two region modes, best partition only;
+//   Normal  - all BC7 modes without rotations, 4 best partitions of 2 subset modes and 2 of 3 subset modes;
+//   High    - plus BC7 rotations and index selection, 16 and 8 best partitions, more refinement passes;
+//   Best    - all partitions.
+
+void EncodeBC6HBlock(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality, bool is_signed);
+void EncodeBC7Block(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality);
+
+// Writes 16 RGBA float32 texels, alpha is 1. Blocks with reserved modes decode to 0
+void DecodeBC6HBlock(const uint8_t* block, float* rgba, bool is_signed);
+// Writes 16 RGBA8 texels. Blocks with reserved modes decode to transparent black
+void DecodeBC7Block(const uint8_t* block, uint8_t* rgba);
@@ -0,0 +1,153 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#pragma once
+#include <cstdint>
+
+
+// Tables and helpers shared by the BC6H and BC7 codecs. BC6H uses the first 32 partitions of BC7 two subset modes.
+
+// Subset of each texel of 2 subset partitions, one bit per texel
+extern const uint16_t BPTCPartitions2[64];
+// Subset of each texel of 3 subset partitions, two bits per texel
+extern const uint32_t BPTCPartitions3[64];
+// Anchor texel of the second subset of 2 subset partitions
+extern const uint8_t BPTCAnchors2[64];
+// Anchor texels of the second and the third subset of 3 subset partitions
+extern const uint8_t BPTCAnchors3[64][2];
+
+// Interpolation weights of 2, 3 and 4 bit indices, out of 64
+const uint8_t* GetBPTCWeights(int index_bits);
+
+inline int GetBPTCSubset(int subsets, int partition, int texel)
+{
+	switch (subsets)
+	{
+		case 2: return (BPTCPartitions2[partition] >> texel) & 1;
+		case 3: return (BPTCPartitions3[partition] >> (2 * texel)) & 3;
+		default: return 0;
+	}
+}
+
+// Index of the anchor texel of a subset has its most significant bit implicitly set to 0
+inline int GetBPTCAnchor(int subsets, int partition, int subset)
+{
+	if (subset == 0)
+	{
+		return 0;
+	}
+	return subsets == 2 ? BPTCAnchors2[partition] : BPTCAnchors3[partition][subset - 1];
+}
+
+inline int InterpolateBPTC(int a, int b, int weight)
+{
+	return ((64 - weight) * a + weight * b + 32) >> 6;
+}
+
+
+// 128 bit block, read and written from the least significant bit
+class BlockBitReader
+{
+public:
+	explicit BlockBitReader(const uint8_t* block): m_lo(0), m_hi(0), m_position(0)
+	{
+		for (int i = 7; i >= 0; --i)
+		{
+			m_lo = (m_lo << 8u) | block[i];
+			m_hi = (m_hi << 8u) | block[i + 8];
+		}
+	}
+
+	uint32_t Read(int bits)
+	{
+		uint64_t value;
+		if (m_position >= 64)
+		{
+			value = m_hi >> (m_position - 64);
+		}
+		else
+		{
+			value = m_lo >> m_position;
+			if (m_position + bits > 64)
+			{
+				value |= m_hi << (64 - m_position);
+			}
+		}
+		m_position += bits;
+		return (uint32_t)(value & ((1ull << bits) - 1u));
+	}
+
+	void Seek(int position) { m_position = position; }
+
+private:
+	uint64_t m_lo;
+	uint64_t m_hi;
+	int m_position;
+};
+
+class BlockBitWriter
+{
+public:
+	BlockBitWriter(): m_lo(0), m_hi(0), m_position(0) {}
+
+	void Write(uint32_t value, int bits)
+	{
+		uint64_t v = value & ((1ull << bits) - 1u);
+		if (m_position >= 64)
+		{
+			m_hi |= v << (m_position - 64);
+		}
+		else
+		{
+			m_lo |= v << m_position;
+			if (m_position + bits > 64)
+			{
+				m_hi |= v >> (64 - m_position);
+			}
+		}
+		m_position += bits;
+	}
+
+	int position() const { return m_position; }
+
+	void Store(uint8_t* block) const
+	{
+		for (int i = 0; i < 8; ++i)
+		{
+			block[i] = (uint8_t)(m_lo >> (8 * i));
+			block[i + 8] = (uint8_t)(m_hi >> (8 * i));
+		}
+	}
+
+private:
+	uint64_t m_lo;
+	uint64_t m_hi;
+	int m_position;
+};
+
+
+// Endpoint fitting on up to 4 channels of the texels listed in texels, values are indexed by texel position
+
+// Extremes of the projection of texels on their principal axis
+void FitBPTCLine(const float (*values)[4], const uint8_t* texels, int count, int channels, float* a, float* b);
+
+// Least squares endpoints for the given indices. Returns false if all texels use the same weight
+bool RefineBPTCEndpoints(const float (*values)[4], const uint8_t* texels, int count, int channels,
+                         const uint8_t* indices, const uint8_t* weights, float* a, float* b);
+
+// Sorts the first partition_count partitions by the total distance of texels from the principal axes of their subsets,
+// best first
+void RankBPTCPartitions(const float (*values)[4], int subsets, int partition_count, int channels, int* order);
@@ -0,0 +1,590 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+#include "cache.h"
+#include "container.h"
+#include "mapped_pvr.h"
+#include "texture_writer.h"
+#include "common.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#include <cerrno>
+#endif
+
+
+namespace
+{
+	// Part of every key, has to be changed whenever encoders or filters start producing different results
+	const uint32_t CacheVersion = 1;
+
+	const char* EntryExtension = ".pvr";
+	const size_t EntryNameLength = 32;
+
+	inline uint64_t RotateLeft(uint64_t x, int r)
+	{
+		return (x << r) | (x >> (64 - r));
+	}
+
+	inline uint64_t Mix(uint64_t k)
+	{
+		k ^= k >> 33u;
+		k *= 0xff51afd7ed558ccdull;
+		k ^= k >> 33u;
+		k *= 0xc4ceb9fe1a85ec53ull;
+		k ^= k >> 33u;
+		return k;
+	}
+
+	const uint64_t C1 = 0x87c37b91114253d5ull;
+	const uint64_t C2 = 0x4cf5852e2f433f27ull;
+
+	int64_t GetTimeMilliseconds()
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+	bool IsEntryName(const std::string& filename)
+	{
+		const size_t extension_length = strlen(EntryExtension);
+		return filename.size() == EntryNameLength + extension_length
+			&& filename.compare(EntryNameLength, extension_length, EntryExtension) == 0
+			&& filename.find_first_not_of("0123456789abcdef") == EntryNameLength;
+	}
+
+#ifdef _WIN32
+	int64_t ToMilliseconds(const FILETIME& time)
+	{
+		// FILETIME counts 100 ns intervals since 1601
+		uint64_t t = ((uint64_t)time.dwHighDateTime << 32u) | time.dwLowDateTime;
+		return (int64_t)(t - 116444736000000000ull) / 10000;
+	}
+
+	bool GetFileInfo(const std::string& path, uint64_t& size, int64_t& modified)
+	{
+		WIN32_FILE_ATTRIBUTE_DATA data;
+		if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data) || (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+		{
+			return false;
+		}
+		size = ((uint64_t)data.nFileSizeHigh << 32u) | data.nFileSizeLow;
+		modified = ToMilliseconds(data.ftLastWriteTime);
+		return true;
+	}
+
+	bool IsDirectory(const std::string& path)
+	{
+		DWORD attributes = GetFileAttributesA(path.c_str());
+		return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+	}
+
+	void MakeDirectory(const std::string& path)
+	{
+		CreateDirectoryA(path.c_str(), nullptr);
+	}
+
+	std::vector<std::string> ListDirectory(const std::string& path)
+	{
+		std::vector<std::string> names;
+		WIN32_FIND_DATAA data;
+		HANDLE find = FindFirstFileA((path + "\\*").c_str(), &data);
+		if (find == INVALID_HANDLE_VALUE)
+		{
+			return names;
+		}
+		do
+		{
+			if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+			{
+				names.push_back(data.cFileName);
+			}
+		}
+		while (FindNextFileA(find, &data));
+		FindClose(find);
+		return names;
+	}
+
+	void RemoveFile(const std::string& path)
+	{
+		DeleteFileA(path.c_str());
+	}
+
+	bool RenameFile(const std::string& from, const std::string& to)
+	{
+		return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+	}
+
+	void TouchFile(const std::string& path)
+	{
+		HANDLE file = CreateFileA(path.c_str(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file != INVALID_HANDLE_VALUE)
+		{
+			FILETIME now;
+			GetSystemTimeAsFileTime(&now);
+			SetFileTime(file, nullptr, nullptr, &now);
+			CloseHandle(file);
+		}
+	}
+
+	unsigned long GetProcessId()
+	{
+		return (unsigned long)GetCurrentProcessId();
+	}
+
+	const char* Separators = "/\\";
+#else
+	bool GetFileInfo(const std::string& path, uint64_t& size, int64_t& modified)
+	{
+		struct stat st;
+		if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+		{
+			return false;
+		}
+		size = (uint64_t)st.st_size;
+		modified = (int64_t)st.st_mtime * 1000;
+		return true;
+	}
+
+	bool IsDirectory(const std::string& path)
+	{
+		struct stat st;
+		return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+	}
+
+	void MakeDirectory(const std::string& path)
+	{
+		mkdir(path.c_str(), 0755);
+	}
+
+	std::vector<std::string> ListDirectory(const std::string& path)
+	{
+		std::vector<std::string> names;
+		DIR* dir = opendir(path.c_str());
+		if (dir == nullptr)
+		{
+			return names;
+		}
+		while (struct dirent* entry = readdir(dir))
+		{
+			names.push_back(entry->d_name);
+		}
+		closedir(dir);
+		return names;
+	}
+
+	void RemoveFile(const std::string& path)
+	{
+		unlink(path.c_str());
+	}
+
+	bool RenameFile(const std::string& from, const std::string& to)
+	{
+		return rename(from.c_str(), to.c_str()) == 0;
+	}
+
+	void TouchFile(const std::string& path)
+	{
+		utime(path.c_str(), nullptr);
+	}
+
+	unsigned long GetProcessId()
+	{
+		return (unsigned long)getpid();
+	}
+
+	const char* Separators = "/";
+#endif
+
+	// Creates all missing parent directories as well
+	void MakeDirectories(const std::string& path)
+	{
+		for (size_t i = path.find_first_of(Separators, 1); i != std::string::npos; i = path.find_first_of(Separators, i + 1))
+		{
+			MakeDirectory(path.substr(0, i));
+		}
+		MakeDirectory(path);
+		if (!IsDirectory(path))
+		{
+			throw runtime_error("Can not create cache directory %s", path.c_str());
+		}
+	}
+}
+
+
+CacheKey::CacheKey(): m_h1(0), m_h2(0), m_tail_size(0), m_length(0)
+{
+	Add(CacheVersion);
+}
+
+void CacheKey::Update(const void* data, size_t size)
+{
+	const uint8_t* p = (const uint8_t*)data;
+	m_length += size;
+	if (m_tail_size > 0)
+	{
+		size_t n = std::min(size, sizeof(m_tail) - m_tail_size);
+		memcpy(m_tail + m_tail_size, p, n);
+		m_tail_size += n;
+		p += n;
+		size -= n;
+		if (m_tail_size < sizeof(m_tail))
+		{
+			return;
+		}
+		Block(m_tail);
+		m_tail_size = 0;
+	}
+	for (; size >= sizeof(m_tail); p += sizeof(m_tail), size -= sizeof(m_tail))
+	{
+		Block(p);
+	}
+	memcpy(m_tail, p, size);
+	m_tail_size = size;
+}
+
+void CacheKey::Add(const std::string& value)
+{
+	// the length keeps consecutive strings apart
+	Add((uint64_t)value.size());
+	Update(value.data(), value.size());
+}
+
+void CacheKey::AddTexture(const pvrtexture::CPVRTexture& texture)
+{
+	std::vector<uint8_t> header = MakePVRHeader(texture);
+	Update(header.data(), header.size());
+	Update(texture.m_pTextureData, GetTextureDataSize(texture));
+}
+
+void CacheKey::Block(const uint8_t* data)
+{
+	uint64_t k1, k2;
+	memcpy(&k1, data, 8);
+	memcpy(&k2, data + 8, 8);
+
+	k1 *= C1;
+	k1 = RotateLeft(k1, 31);
+	k1 *= C2;
+	m_h1 ^= k1;
+	m_h1 = RotateLeft(m_h1, 27);
+	m_h1 += m_h2;
+	m_h1 = m_h1 * 5 + 0x52dce729;
+
+	k2 *= C2;
+	k2 = RotateLeft(k2, 33);
+	k2 *= C1;
+	m_h2 ^= k2;
+	m_h2 = RotateLeft(m_h2, 31);
+	m_h2 += m_h1;
+	m_h2 = m_h2 * 5 + 0x38495ab5;
+}
+
+std::string CacheKey::ToString() const
+{
+	uint64_t h1 = m_h1;
+	uint64_t h2 = m_h2;
+	uint64_t k1 = 0;
+	uint64_t k2 = 0;
+	for (size_t i = m_tail_size; i > 8; --i)
+	{
+		k2 = (k2 << 8u) | m_tail[i - 1];
+	}
+	for (size_t i = std::min(m_tail_size, (size_t)8); i > 0; --i)
+	{
+		k1 = (k1 << 8u) | m_tail[i - 1];
+	}
+	if (m_tail_size > 8)
+	{
+		k2 *= C2;
+		k2 = RotateLeft(k2, 33);
+		k2 *= C1;
+		h2 ^= k2;
+	}
+	if (m_tail_size > 0)
+	{
+		k1 *= C1;
+		k1 = RotateLeft(k1, 31);
+		k1 *= C2;
+		h1 ^= k1;
+	}
+
+	h1 ^= m_length;
+	h2 ^= m_length;
+	h1 += h2;
+	h2 += h1;
+	h1 = Mix(h1);
+	h2 = Mix(h2);
+	h1 += h2;
+	h2 += h1;
+	return string_format("%016llx%016llx", (unsigned long long)h1, (unsigned long long)h2);
+}
+
+
+TextureCache::TextureCache(): m_enabled(false), m_max_size(0), m_size(0), m_hits(0), m_misses(0), m_stores(0), m_evictions(0)
+{
+}
+
+void TextureCache::Enable(const std::string& directory, uint64_t max_size)
+{
+	if (directory.empty())
+	{
+		throw runtime_error("Cache directory can not be empty");
+	}
+	MakeDirectories(directory);
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_directory = directory;
+	m_max_size = max_size;
+	m_enabled = true;
+	Scan();
+	Evict();
+}
+
+void TextureCache::Disable()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_enabled = false;
+	m_entries.clear();
+	m_size = 0;
+}
+
+bool TextureCache::IsEnabled() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_enabled;
+}
+
+std::unique_ptr<pvrtexture::CPVRTexture> TextureCache::Load(const CacheKey& key)
+{
+	const std::string name = key.ToString();
+	std::string path;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_enabled)
+		{
+			return nullptr;
+		}
+		path = GetPath(name);
+	}
+
+	// The entry may have been stored by another process, so the file is checked rather than the index
+	std::unique_ptr<pvrtexture::CPVRTexture> texture;
+	uint64_t size = 0;
+	int64_t modified = 0;
+	bool corrupted = false;
+	if (GetFileInfo(path, size, modified))
+	{
+		try
+		{
+			texture.reset(MappedPVR(path.c_str()).Load());
+		}
+		catch (const std::exception&)
+		{
+			corrupted = true;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!texture)
+	{
+		++m_misses;
+		if (corrupted)
+		{
+			Remove(name);
+		}
+		return nullptr;
+	}
+	++m_hits;
+	TouchFile(path);
+	auto it = m_entries.find(name);
+	if (it == m_entries.end())
+	{
+		m_entries[name] = Entry{size, GetTimeMilliseconds()};
+		m_size += size;
+	}
+	else
+	{
+		it->second.last_used = GetTimeMilliseconds();
+	}
+	return texture;
+}
+
+void TextureCache::Store(const CacheKey& key, const pvrtexture::CPVRTexture& texture)
+{
+	static std::atomic<uint64_t> counter(0);
+	const std::string name = key.ToString();
+	std::string path;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_enabled)
+		{
+			return;
+		}
+		path = GetPath(name);
+	}
+
+	// Failing to write an entry is not an error of the operation, its result is just not cached
+	const std::string temporary = string_format("%s.%lu.%llu.tmp", path.c_str(), GetProcessId(), (unsigned long long)counter++);
+	uint64_t size = 0;
+	int64_t modified = 0;
+	try
+	{
+		SaveTexture(texture, temporary.c_str(), ContainerPVR);
+	}
+	catch (const std::exception&)
+	{
+		RemoveFile(temporary);
+		return;
+	}
+	if (!GetFileInfo(temporary, size, modified) || !RenameFile(temporary, path))
+	{
+		RemoveFile(temporary);
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	++m_stores;
+	auto it = m_entries.find(name);
+	if (it != m_entries.end())
+	{
+		m_size -= it->second.size;
+	}
+	m_entries[name] = Entry{size, GetTimeMilliseconds()};
+	m_size += size;
+	if (m_size > m_max_size)
+	{
+		Scan();
+		Evict();
+	}
+}
+
+void TextureCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_enabled)
+	{
+		return;
+	}
+	for (const std::string& filename: ListDirectory(m_directory))
+	{
+		if (IsEntryName(filename))
+		{
+			RemoveFile(m_directory + "/" + filename);
+		}
+	}
+	m_entries.clear();
+	m_size = 0;
+}
+
+CacheStats TextureCache::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	CacheStats stats;
+	stats.hits = m_hits;
+	stats.misses = m_misses;
+	stats.stores = m_stores;
+	stats.evictions = m_evictions;
+	stats.entries = m_entries.size();
+	stats.size = m_size;
+	stats.max_size = m_max_size;
+	return stats;
+}
+
+void TextureCache::ResetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_hits = 0;
+	m_misses = 0;
+	m_stores = 0;
+	m_evictions = 0;
+}
+
+TextureCache& TextureCache::GetDefault()
+{
+	static TextureCache cache;
+	return cache;
+}
+
+std::string TextureCache::GetPath(const std::string& name) const
+{
+	return m_directory + "/" + name + EntryExtension;
+}
+
+void TextureCache::Scan()
+{
+	// Entries this process used more recently than their file time says keep their time
+	std::unordered_map<std::string, Entry> entries;
+	uint64_t total = 0;
+	for (const std::string& filename: ListDirectory(m_directory))
+	{
+		Entry entry;
+		if (!IsEntryName(filename) || !GetFileInfo(m_directory + "/" + filename, entry.size, entry.last_used))
+		{
+			continue;
+		}
+		const std::string name = filename.substr(0, EntryNameLength);
+		auto it = m_entries.find(name);
+		if (it != m_entries.end())
+		{
+			entry.last_used = std::max(entry.last_used, it->second.last_used);
+		}
+		entries[name] = entry;
+		total += entry.size;
+	}
+	m_entries.swap(entries);
+	m_size = total;
+}
+
+void TextureCache::Evict()
+{
+	if (m_size <= m_max_size)
+	{
+		return;
+	}
+	std::vector<std::pair<int64_t, std::string> > order;
+	order.reserve(m_entries.size());
+	for (const auto& entry: m_entries)
+	{
+		order.push_back(std::make_pair(entry.second.last_used, entry.first));
+	}
+	std::sort(order.begin(), order.end());
+	for (size_t i = 0; i < order.size() && m_size > m_max_size; ++i)
+	{
+		Remove(order[i].second);
+		++m_evictions;
+	}
+}
+
+void TextureCache::Remove(const std::string& name)
+{
+	RemoveFile(GetPath(name));
+	auto it = m_entries.find(name);
+	if (it != m_entries.end())
+	{
+		m_size -= it->second.size;
+		m_entries.erase(it);
+	}
+}
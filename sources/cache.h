@@ -0,0 +1,125 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+#pragma once
+#include <PVRTexture.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+
+// On-disk cache of operation results, addressed by a hash of the source texture and of the operation parameters.
+// Entries are PVR files named after the hash. They are written to a temporary file and renamed into place, so
+// concurrent processes sharing the directory never see partial entries. The total size is bounded, least recently
+// used entries are evicted first, recency is kept in file modification times so that it survives across processes.
+
+// 128-bit MurmurHash3 of everything added to the key
+class CacheKey
+{
+public:
+	CacheKey();
+
+	void Update(const void* data, size_t size);
+
+	template<typename T>
+	void Add(const T& value)
+	{
+		Update(&value, sizeof(T));
+	}
+
+	void Add(const std::string& value);
+
+	// PVR header with all metadata and the whole texture data
+	void AddTexture(const pvrtexture::CPVRTexture& texture);
+
+	// 32 hex digits
+	std::string ToString() const;
+
+private:
+	void Block(const uint8_t* data);
+
+	uint64_t m_h1;
+	uint64_t m_h2;
+	uint8_t m_tail[16];
+	size_t m_tail_size;
+	uint64_t m_length;
+};
+
+struct CacheStats
+{
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t stores;
+	uint64_t evictions;
+	uint64_t entries;
+	uint64_t size;
+	uint64_t max_size;
+};
+
+class TextureCache
+{
+public:
+	TextureCache();
+
+	TextureCache(const TextureCache&) = delete;
+	TextureCache& operator=(const TextureCache&) = delete;
+
+	// Creates the directory if needed and indexes the entries already in it. Evicts entries if they exceed max_size
+	void Enable(const std::string& directory, uint64_t max_size);
+	void Disable();
+	bool IsEnabled() const;
+
+	// Returns nullptr on a miss. Unreadable entries count as misses and are removed
+	std::unique_ptr<pvrtexture::CPVRTexture> Load(const CacheKey& key);
+	void Store(const CacheKey& key, const pvrtexture::CPVRTexture& texture);
+
+	// Removes all entries of the cache directory
+	void Clear();
+
+	CacheStats GetStats() const;
+	void ResetStats();
+
+	// Process-wide cache used by the bindings, disabled until Enable is called
+	static TextureCache& GetDefault();
+
+private:
+	struct Entry
+	{
+		uint64_t size;
+		// milliseconds since epoch
+		int64_t last_used;
+	};
+
+	std::string GetPath(const std::string& name) const;
+	// Rereads the directory, picking up entries stored by other processes. Called with the mutex locked
+	void Scan();
+	// Called with the mutex locked
+	void Evict();
+	void Remove(const std::string& name);
+
+	mutable std::mutex m_mutex;
+	bool m_enabled;
+	std::string m_directory;
+	uint64_t m_max_size;
+	uint64_t m_size;
+	std::unordered_map<std::string, Entry> m_entries;
+	uint64_t m_hits;
+	uint64_t m_misses;
+	uint64_t m_stores;
+	uint64_t m_evictions;
+};
@@ -0,0 +1,315 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#include "codec.h"
+#include "bc.h"
+#include "bptc.h"
+#include "etc.h"
+#include "astc.h"
+#include "container.h"
+#include "surface.h"
+#include "storage.h"
+#include "pixel_format.h"
+#include "thread_pool.h"
+#include "profiler.h"
+#include "common.h"
+
+#include <PVRTextureUtilities.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <cstring>
+
+
+namespace
+{
+	typedef void (*BlockEncoder)(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality);
+
+	struct NativeEncoder
+	{
+		uint64_t format;
+		int block_width;
+		int block_height;
+		int block_bytes;
+		BlockEncoder encode;
+		// used instead of encode for signed channel types, if not null
+		BlockEncoder encode_signed;
+		// used instead of encode for float channel types, if not null
+		BlockEncoder encode_float;
+	};
+
+	void EncodeDXT1Block(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality)
+	{
+		EncodeBC1Block(rgba, block, quality, true);
+	}
+
+	void EncodeBC6HUnsignedBlock(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality)
+	{
+		EncodeBC6HBlock(rgba, block, quality, false);
+	}
+
+	void EncodeBC6HSignedBlock(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality)
+	{
+		EncodeBC6HBlock(rgba, block, quality, true);
+	}
+
+	void EncodeEACR11UnsignedBlock(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality)
+	{
+		EncodeEACR11Block(rgba, block, quality, false);
+	}
+
+	void EncodeEACR11SignedBlock(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality)
+	{
+		EncodeEACR11Block(rgba, block, quality, true);
+	}
+
+	void EncodeEACRG11UnsignedBlock(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality)
+	{
+		EncodeEACRG11Block(rgba, block, quality, false);
+	}
+
+	void EncodeEACRG11SignedBlock(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality)
+	{
+		EncodeEACRG11Block(rgba, block, quality, true);
+	}
+
+	template<int block_width, int block_height, bool hdr>
+	void EncodeASTCFootprintBlock(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality)
+	{
+		EncodeASTCBlock(rgba, block_width, block_height, block, quality, hdr);
+	}
+
+#define ASTC_ENCODER(W, H) {ePVRTPF_ASTC_##W##x##H, W, H, 16, EncodeASTCFootprintBlock<W, H, false>, nullptr, EncodeASTCFootprintBlock<W, H, true>}
+
+	// DXT2 and DXT4 differ from DXT3 and DXT5 only by premultiplied alpha, which is a property of the header
+	const NativeEncoder encoders[] = {
+			{ePVRTPF_DXT1, 4, 4, 8, EncodeDXT1Block, nullptr, nullptr},
+			{ePVRTPF_DXT2, 4, 4, 16, EncodeBC2Block, nullptr, nullptr},
+			{ePVRTPF_DXT3, 4, 4, 16, EncodeBC2Block, nullptr, nullptr},
+			{ePVRTPF_DXT4, 4, 4, 16, EncodeBC3Block, nullptr, nullptr},
+			{ePVRTPF_DXT5, 4, 4, 16, EncodeBC3Block, nullptr, nullptr},
+			{ePVRTPF_BC4, 4, 4, 8, EncodeBC4Block, nullptr, nullptr},
+			{ePVRTPF_BC5, 4, 4, 16, EncodeBC5Block, nullptr, nullptr},
+			{ePVRTPF_BC6, 4, 4, 16, EncodeBC6HUnsignedBlock, EncodeBC6HSignedBlock, nullptr},
+			{ePVRTPF_BC7, 4, 4, 16, EncodeBC7Block, nullptr, nullptr},
+			{ePVRTPF_ETC1, 4, 4, 8, EncodeETC1Block, nullptr, nullptr},
+			{ePVRTPF_ETC2_RGB, 4, 4, 8, EncodeETC2RGBBlock, nullptr, nullptr},
+			{ePVRTPF_ETC2_RGBA, 4, 4, 16, EncodeETC2RGBABlock, nullptr, nullptr},
+			{ePVRTPF_ETC2_RGB_A1, 4, 4, 8, EncodeETC2RGBA1Block, nullptr, nullptr},
+			{ePVRTPF_EAC_R11, 4, 4, 8, EncodeEACR11UnsignedBlock, EncodeEACR11SignedBlock, nullptr},
+			{ePVRTPF_EAC_RG11, 4, 4, 16, EncodeEACRG11UnsignedBlock, EncodeEACRG11SignedBlock, nullptr},
+			ASTC_ENCODER(4, 4),
+			ASTC_ENCODER(5, 4),
+			ASTC_ENCODER(5, 5),
+			ASTC_ENCODER(6, 5),
+			ASTC_ENCODER(6, 6),
+			ASTC_ENCODER(8, 5),
+			ASTC_ENCODER(8, 6),
+			ASTC_ENCODER(8, 8),
+			ASTC_ENCODER(10, 5),
+			ASTC_ENCODER(10, 6),
+			ASTC_ENCODER(10, 8),
+			ASTC_ENCODER(10, 10),
+			ASTC_ENCODER(12, 10),
+			ASTC_ENCODER(12, 12),
+	};
+
+#undef ASTC_ENCODER
+
+	const NativeEncoder* FindEncoder(uint64_t format)
+	{
+		for (const NativeEncoder& encoder: encoders)
+		{
+			if (encoder.format == format)
+			{
+				return &encoder;
+			}
+		}
+		return nullptr;
+	}
+
+	BlockEncoder SelectEncoder(const NativeEncoder& encoder, EPVRTVariableType channel_type)
+	{
+		if (IsFloatChannelType(channel_type) && encoder.encode_float != nullptr)
+		{
+			return encoder.encode_float;
+		}
+		if (IsSignedChannelType(channel_type) && encoder.encode_signed != nullptr)
+		{
+			return encoder.encode_signed;
+		}
+		return encoder.encode;
+	}
+
+	struct BlockRow
+	{
+		uint32_t mip;
+		uint32_t array;
+		uint32_t face;
+		uint32_t z;
+		uint32_t y;
+	};
+}
+
+
+bool IsSignedChannelType(EPVRTVariableType type)
+{
+	switch (type)
+	{
+		case ePVRTVarTypeSignedByteNorm:
+		case ePVRTVarTypeSignedByte:
+		case ePVRTVarTypeSignedShortNorm:
+		case ePVRTVarTypeSignedShort:
+		case ePVRTVarTypeSignedIntegerNorm:
+		case ePVRTVarTypeSignedInteger:
+		case ePVRTVarTypeSignedFloat:
+			return true;
+		default:
+			return false;
+	}
+}
+
+bool IsFloatChannelType(EPVRTVariableType type)
+{
+	return type == ePVRTVarTypeSignedFloat || type == ePVRTVarTypeUnsignedFloat;
+}
+
+bool HasNativeEncoder(uint64_t format)
+{
+	return FindEncoder(format) != nullptr;
+}
+
+bool RequiresNativeEncoder(uint64_t format)
+{
+	return IsUnsizedFormat(format) || (format >= ePVRTPF_ASTC_4x4 && format <= ePVRTPF_ASTC_12x12);
+}
+
+bool GetNativeBlockSize(uint64_t format, int& block_width, int& block_height, int& block_bytes)
+{
+	const NativeEncoder* encoder = FindEncoder(format);
+	if (encoder == nullptr)
+	{
+		return false;
+	}
+	block_width = encoder->block_width;
+	block_height = encoder->block_height;
+	block_bytes = encoder->block_bytes;
+	return true;
+}
+
+void EncodeNativeBlock(uint64_t format, EPVRTVariableType channel_type, const float* rgba, uint8_t* block,
+                       pvrtexture::ECompressorQuality quality)
+{
+	const NativeEncoder* encoder = FindEncoder(format);
+	if (encoder == nullptr)
+	{
+		throw runtime_error("Native engine does not support pixel format %llu", (unsigned long long)format);
+	}
+	SelectEncoder(*encoder, channel_type)(rgba, block, quality);
+}
+
+void TranscodeNative(pvrtexture::CPVRTexture& texture, uint64_t format, EPVRTVariableType channel_type,
+                     EPVRTColourSpace colour_space, pvrtexture::ECompressorQuality quality)
+{
+	const NativeEncoder* encoder = FindEncoder(format);
+	if (encoder == nullptr)
+	{
+		throw runtime_error("Native engine does not support pixel format %llu", (unsigned long long)format);
+	}
+
+	std::unique_ptr<pvrtexture::CPVRTexture> converted;
+	const pvrtexture::CPVRTexture* source = &texture;
+	if (!IsRGBAReadable(texture))
+	{
+		converted.reset(new pvrtexture::CPVRTexture(texture));
+		if (!pvrtexture::Transcode(*converted, RGBA32323232, ePVRTVarTypeFloat, texture.getColourSpace()))
+		{
+			throw runtime_error("Failed to convert texture to RGBA32323232 for the native encoder");
+		}
+		CountAllocatedBytes(converted->getDataSize());
+		source = converted.get();
+	}
+
+	pvrtexture::CPVRTextureHeader header(texture.getHeader());
+	header.setPixelFormat(format);
+	header.setChannelType(channel_type);
+	header.setColourSpace(colour_space);
+	pvrtexture::CPVRTexture result(header);
+	if (IsUnsizedFormat(format))
+	{
+		AllocateData(result);
+	}
+	else
+	{
+		CountAllocatedBytes(result.getDataSize());
+	}
+
+	const int block_width = encoder->block_width;
+	const int block_height = encoder->block_height;
+	const size_t block_size = encoder->block_bytes;
+	BlockEncoder encode = SelectEncoder(*encoder, channel_type);
+	const size_t bytes_per_texel = source->getBitsPerPixel() / 8;
+
+	std::vector<BlockRow> rows;
+	for (uint32_t mip = 0; mip < header.getNumMIPLevels(); ++mip)
+	{
+		uint32_t blocks_y = (header.getHeight(mip) + block_height - 1) / block_height;
+		for (uint32_t array = 0; array < header.getNumArrayMembers(); ++array)
+			for (uint32_t face = 0; face < header.getNumFaces(); ++face)
+				for (uint32_t z = 0; z < header.getDepth(mip); ++z)
+					for (uint32_t y = 0; y < blocks_y; ++y)
+						rows.push_back({mip, array, face, z, y});
+	}
+
+	RGBAReader reader(*source);
+	ThreadPool::GetDefault().ParallelFor(rows.size(), [&](size_t i)
+	{
+		const BlockRow& row = rows[i];
+		const int width = (int)header.getWidth(row.mip);
+		const int height = (int)header.getHeight(row.mip);
+		const int blocks_x = (width + block_width - 1) / block_width;
+		const int blocks_y = (height + block_height - 1) / block_height;
+
+		// texels past the edge of the surface replicate the last row and column
+		std::vector<float> texels((size_t)block_height * width * 4);
+		std::vector<float> buffer;
+		const uint8_t* src = (const uint8_t*)source->getDataPtr(row.mip, row.array, row.face);
+		for (int y = 0; y < block_height; ++y)
+		{
+			size_t sy = (size_t)std::min((int)row.y * block_height + y, height - 1);
+			reader.Read(src + ((size_t)row.z * height + sy) * width * bytes_per_texel, width, &texels[(size_t)y * width * 4], buffer);
+		}
+
+		uint8_t* dst = GetSurfacePtr(result, row.mip, row.array, row.face) +
+				((size_t)row.z * blocks_y + row.y) * blocks_x * block_size;
+		std::vector<float> block((size_t)block_width * block_height * 4);
+		for (int bx = 0; bx < blocks_x; ++bx)
+		{
+			for (int y = 0; y < block_height; ++y)
+			{
+				for (int x = 0; x < block_width; ++x)
+				{
+					int sx = std::min(bx * block_width + x, width - 1);
+					memcpy(&block[((size_t)y * block_width + x) * 4], &texels[((size_t)y * width + sx) * 4], 4 * sizeof(float));
+				}
+			}
+			encode(block.data(), dst + bx * block_size, quality);
+		}
+	});
+
+	ReplaceTexture(texture, result);
+}
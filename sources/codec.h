@@ -0,0 +1,46 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#pragma once
+#include <PVRTexture.h>
+
+#include <cstdint>
+
+
+// In-tree block compression, an alternative to pvrtexture::Transcode that is selected with engine="native".
+// Block rows of all surfaces are compressed in parallel on the shared thread pool.
+
+bool IsSignedChannelType(EPVRTVariableType type);
+bool IsFloatChannelType(EPVRTVariableType type);
+
+bool HasNativeEncoder(uint64_t format);
+
+// PVRTexLib can not compress BC6H, BC7 and ASTC, these use the native encoders with either engine
+bool RequiresNativeEncoder(uint64_t format);
+
+// Block footprint and size of the native encoder of format, false if there is none
+bool GetNativeBlockSize(uint64_t format, int& block_width, int& block_height, int& block_bytes);
+
+// Compresses a single block of block_width * block_height RGBA float32 texels, row by row, the way TranscodeNative
+// compresses blocks of a texture with that channel type
+void EncodeNativeBlock(uint64_t format, EPVRTVariableType channel_type, const float* rgba, uint8_t* block,
+                       pvrtexture::ECompressorQuality quality);
+
+// Compresses texture in place. Source channels are taken by name, missing colour channels are zero and missing alpha
+// is one. Sources that are not 8, 16 or 32 bits per channel are converted with PVRTexLib first.
+// Throws if format has no native encoder
+void TranscodeNative(pvrtexture::CPVRTexture& texture, uint64_t format, EPVRTVariableType channel_type,
+                     EPVRTColourSpace colour_space, pvrtexture::ECompressorQuality quality);
@@ -31,6 +31,9 @@ typedef py::array_t<uint8_t, py::array::c_style> ndarray_uint32;
 typedef py::array_t<int8_t, py::array::c_style> ndarray_int32;
 typedef py::array_t<float, py::array::c_style> ndarray_float32;
 
+// Bindings that do not touch python objects release GIL, so that python threads can run them concurrently
+typedef py::call_guard<py::gil_scoped_release> release_gil;
+
 
 inline std::string string_format(const std::string fmt_str, va_list ap)
 {
@@ -77,17 +80,18 @@ private:
 };
 
 
+// Allocates memory as a python bytes object of the requested size, bytesObject receives a new reference.
+// Must be called with GIL held
 inline std::function<void*(size_t)> GetBytesAllocator(PyBytesObject*& bytesObject)
 {
-	auto alloc = [&bytesObject](size_t size)
+	auto alloc = [&bytesObject](size_t size) -> void*
 	{
-		bytesObject = (PyBytesObject*) PyObject_Malloc(offsetof(PyBytesObject, ob_sval) + size + 1);
-		size -= sizeof(uint32_t);
-		PyObject_INIT_VAR(bytesObject, &PyBytes_Type, size);
-		bytesObject->ob_shash = -1;
-		bytesObject->ob_sval[size] = '\0';
-		return bytesObject->ob_sval;
+		bytesObject = (PyBytesObject*) PyBytes_FromStringAndSize(nullptr, size);
+		if (bytesObject == nullptr)
+		{
+			throw py::error_already_set();
+		}
+		return PyBytes_AS_STRING(bytesObject);
 	};
 	return alloc;
 }
-
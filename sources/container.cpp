@@ -0,0 +1,398 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#include "container.h"
+#include "pixel_format.h"
+
+#include <cstring>
+
+
+namespace
+{
+	enum
+	{
+		DDSD_CAPS = 0x1,
+		DDSD_HEIGHT = 0x2,
+		DDSD_WIDTH = 0x4,
+		DDSD_PITCH = 0x8,
+		DDSD_PIXELFORMAT = 0x1000,
+		DDSD_MIPMAPCOUNT = 0x20000,
+		DDSD_LINEARSIZE = 0x80000,
+		DDSD_DEPTH = 0x800000,
+
+		DDPF_ALPHAPIXELS = 0x1,
+		DDPF_ALPHA = 0x2,
+		DDPF_FOURCC = 0x4,
+		DDPF_RGB = 0x40,
+		DDPF_LUMINANCE = 0x20000,
+
+		DDSCAPS_COMPLEX = 0x8,
+		DDSCAPS_TEXTURE = 0x1000,
+		DDSCAPS_MIPMAP = 0x400000,
+
+		DDSCAPS2_CUBEMAP_ALLFACES = 0xFE00,
+		DDSCAPS2_VOLUME = 0x200000,
+
+		DDS_DIMENSION_TEXTURE2D = 3,
+		DDS_DIMENSION_TEXTURE3D = 4,
+		DDS_RESOURCE_MISC_TEXTURECUBE = 0x4
+	};
+
+	struct DDSPixelFormat
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourcc;
+		uint32_t bit_count;
+		uint32_t mask[4];
+	};
+
+	struct DDSHeader
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitch_or_linear_size;
+		uint32_t depth;
+		uint32_t mip_map_count;
+		uint32_t reserved1[11];
+		DDSPixelFormat pixel_format;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+
+	struct DDSHeaderDX10
+	{
+		uint32_t dxgi_format;
+		uint32_t resource_dimension;
+		uint32_t misc_flag;
+		uint32_t array_size;
+		uint32_t misc_flags2;
+	};
+
+	// PVRTexLib does not report DXGI formats for block compressed textures
+	uint32_t GetCompressedDXGIFormat(uint64_t format, bool srgb, bool is_signed)
+	{
+		switch (format)
+		{
+			case ePVRTPF_DXT1: return srgb ? 72 : 71;
+			case ePVRTPF_DXT2:
+			case ePVRTPF_DXT3: return srgb ? 75 : 74;
+			case ePVRTPF_DXT4:
+			case ePVRTPF_DXT5: return srgb ? 78 : 77;
+			case ePVRTPF_BC4: return 80;
+			case ePVRTPF_BC5: return 83;
+			case ePVRTPF_BC6: return is_signed ? 96 : 95;
+			case ePVRTPF_BC7: return srgb ? 99 : 98;
+			default: return 0;
+		}
+	}
+
+	// Describes up to 32 bit unsigned normalized formats with bit masks, returns false if that is not possible
+	bool GetMasks(const pvrtexture::CPVRTextureHeader& header, DDSPixelFormat& pf)
+	{
+		auto decoded = DecodePixelType(header.getPixelType().PixelTypeID);
+		uint32_t bpp = header.getBitsPerPixel();
+		EPVRTVariableType type = header.getChannelType();
+		if (bpp > 32 || (type != ePVRTVarTypeUnsignedByteNorm && type != ePVRTVarTypeUnsignedShortNorm &&
+		                 type != ePVRTVarTypeUnsignedIntegerNorm))
+		{
+			return false;
+		}
+		uint32_t shift = 0;
+		for (size_t i = 0; i < decoded.channel_names.size(); ++i)
+		{
+			uint32_t bits = decoded.channel_sizes[i];
+			uint32_t mask = bits == 32 ? 0xFFFFFFFFu : ((1u << bits) - 1u) << shift;
+			switch (decoded.channel_names[i])
+			{
+				case 'r': pf.mask[0] = mask; pf.flags |= DDPF_RGB; break;
+				case 'l': pf.mask[0] = mask; pf.flags |= DDPF_LUMINANCE; break;
+				case 'g': pf.mask[1] = mask; pf.flags |= DDPF_RGB; break;
+				case 'b': pf.mask[2] = mask; pf.flags |= DDPF_RGB; break;
+				case 'a': pf.mask[3] = mask; pf.flags |= DDPF_ALPHAPIXELS; break;
+				default: return false;
+			}
+			shift += bits;
+		}
+		if (header.getPixelType().PixelTypeID == PixelType<'r', 8, 'g', 8, 'b', 8>::ID)
+		{
+			// PVRTexLib labels rgb888 as D3DFMT_R8G8B8 without swizzling texels and expects the same on load
+			pf.mask[0] = 0xFF0000u;
+			pf.mask[2] = 0x0000FFu;
+		}
+		if (pf.flags == DDPF_ALPHAPIXELS)
+		{
+			pf.flags = DDPF_ALPHA;
+		}
+		pf.bit_count = bpp;
+		return true;
+	}
+}
+
+
+bool IsUnsizedFormat(uint64_t format)
+{
+	return format == ePVRTPF_BC6 || format == ePVRTPF_BC7;
+}
+
+size_t GetSurfaceSize(const pvrtexture::CPVRTextureHeader& header, uint32_t mip)
+{
+	if (IsUnsizedFormat(header.getPixelType().PixelTypeID))
+	{
+		size_t blocks_x = (header.getWidth(mip) + 3) / 4;
+		size_t blocks_y = (header.getHeight(mip) + 3) / 4;
+		return blocks_x * blocks_y * header.getDepth(mip) * 16;
+	}
+	return header.getDataSize(mip, false, false);
+}
+
+size_t GetTextureDataSize(const pvrtexture::CPVRTextureHeader& header)
+{
+	if (IsUnsizedFormat(header.getPixelType().PixelTypeID))
+	{
+		size_t size = 0;
+		for (uint32_t mip = 0; mip < header.getNumMIPLevels(); ++mip)
+		{
+			size += GetSurfaceSize(header, mip);
+		}
+		return size * header.getNumArrayMembers() * header.getNumFaces();
+	}
+	return header.getDataSize();
+}
+
+std::vector<uint8_t> MakePVRHeader(const pvrtexture::CPVRTextureHeader& header)
+{
+	std::vector<uint8_t> result(PVRTEX3_HEADERSIZE);
+	auto& metadata = header.m_MetaData;
+	for (uint32_t i = 0; i < metadata.GetSize(); ++i)
+	{
+		auto& blocks = *metadata.GetDataAtIndex(i);
+		for (uint32_t j = 0; j < blocks.GetSize(); ++j)
+		{
+			const MetaDataBlock& block = *blocks.GetDataAtIndex(j);
+			size_t offset = result.size();
+			result.resize(offset + 12 + block.u32DataSize);
+			memcpy(result.data() + offset, &block.DevFOURCC, 4);
+			memcpy(result.data() + offset + 4, &block.u32Key, 4);
+			memcpy(result.data() + offset + 8, &block.u32DataSize, 4);
+			if (block.u32DataSize != 0)
+			{
+				memcpy(result.data() + offset + 12, block.Data, block.u32DataSize);
+			}
+		}
+	}
+	PVRTextureHeaderV3 file_header = header.getFileHeader();
+	file_header.u32Version = PVRTEX3_IDENT;
+	file_header.u32MetaDataSize = (uint32_t)(result.size() - PVRTEX3_HEADERSIZE);
+	memcpy(result.data(), &file_header, PVRTEX3_HEADERSIZE);
+	return result;
+}
+
+std::vector<uint8_t> MakeDDSHeader(const pvrtexture::CPVRTextureHeader& header)
+{
+	uint64_t format = header.getPixelType().PixelTypeID;
+	bool compressed = DecodePixelType(format).compressed;
+	bool srgb = header.getColourSpace() == ePVRTCSpacesRGB;
+	uint32_t mips = header.getNumMIPLevels();
+	uint32_t faces = header.getNumFaces();
+	uint32_t depth = header.getDepth();
+	uint32_t array = header.getNumArrayMembers();
+	if (faces != 1 && faces != 6)
+	{
+		throw runtime_error("DDS supports only textures with 1 or 6 faces, got %d", faces);
+	}
+
+	DDSHeader dds;
+	memset(&dds, 0, sizeof(dds));
+	dds.size = sizeof(DDSHeader);
+	dds.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT;
+	dds.height = header.getHeight();
+	dds.width = header.getWidth();
+	if (compressed)
+	{
+		dds.flags |= DDSD_LINEARSIZE;
+		dds.pitch_or_linear_size = GetSurfaceSize(header, 0);
+	}
+	else
+	{
+		dds.flags |= DDSD_PITCH;
+		dds.pitch_or_linear_size = (dds.width * header.getBitsPerPixel() + 7) / 8;
+	}
+	if (depth > 1)
+	{
+		dds.flags |= DDSD_DEPTH;
+		dds.depth = depth;
+	}
+	if (mips > 1)
+	{
+		dds.flags |= DDSD_MIPMAPCOUNT;
+	}
+	dds.mip_map_count = mips;
+	dds.caps = DDSCAPS_TEXTURE;
+	if (mips > 1)
+	{
+		dds.caps |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+	}
+	if (faces == 6)
+	{
+		dds.caps |= DDSCAPS_COMPLEX;
+		dds.caps2 |= DDSCAPS2_CUBEMAP_ALLFACES;
+	}
+	if (depth > 1)
+	{
+		dds.caps |= DDSCAPS_COMPLEX;
+		dds.caps2 |= DDSCAPS2_VOLUME;
+	}
+	dds.pixel_format.size = sizeof(DDSPixelFormat);
+
+	uint32_t dxgi_format = 0;
+	bool legacy = false;
+	if (compressed)
+	{
+		uint32_t fourcc = header.getD3DFormat();
+		// D3D formats of block compressed textures are FourCC codes such as DXT1
+		if (fourcc > 0xFF && array == 1)
+		{
+			dds.pixel_format.flags = DDPF_FOURCC;
+			dds.pixel_format.fourcc = fourcc;
+			legacy = true;
+		}
+		dxgi_format = GetCompressedDXGIFormat(format, srgb, header.getChannelType() == ePVRTVarTypeSignedFloat);
+	}
+	else
+	{
+		dxgi_format = header.getDXGIFormat();
+		// like PVRTexLib, bit masks are only used for formats that have no DXGI equivalent
+		legacy = dxgi_format == 0 && array == 1 && GetMasks(header, dds.pixel_format);
+		if (srgb && dxgi_format == 28)
+		{
+			dxgi_format = 29; // DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+		}
+		if (srgb && dxgi_format == 87)
+		{
+			dxgi_format = 91; // DXGI_FORMAT_B8G8R8A8_UNORM_SRGB
+		}
+	}
+
+	DDSHeaderDX10 dx10;
+	memset(&dx10, 0, sizeof(dx10));
+	if (!legacy)
+	{
+		if (dxgi_format == 0)
+		{
+			throw runtime_error("Pixel format %llx can not be stored in DDS", (unsigned long long)format);
+		}
+		memset(&dds.pixel_format, 0, sizeof(dds.pixel_format));
+		dds.pixel_format.size = sizeof(DDSPixelFormat);
+		dds.pixel_format.flags = DDPF_FOURCC;
+		dds.pixel_format.fourcc = FourCC<'D', 'X', '1', '0'>::Value;
+		dx10.dxgi_format = dxgi_format;
+		dx10.resource_dimension = depth > 1 ? DDS_DIMENSION_TEXTURE3D : DDS_DIMENSION_TEXTURE2D;
+		dx10.misc_flag = faces == 6 ? DDS_RESOURCE_MISC_TEXTURECUBE : 0;
+		dx10.array_size = array;
+	}
+
+	std::vector<uint8_t> result(4 + sizeof(DDSHeader) + (legacy ? 0 : sizeof(DDSHeaderDX10)));
+	uint32_t magic = FourCC<'D', 'D', 'S', ' '>::Value;
+	memcpy(result.data(), &magic, 4);
+	memcpy(result.data() + 4, &dds, sizeof(DDSHeader));
+	if (!legacy)
+	{
+		memcpy(result.data() + 4 + sizeof(DDSHeader), &dx10, sizeof(DDSHeaderDX10));
+	}
+	return result;
+}
+
+bool ReadUnsizedDDSHeader(const void* data, size_t size, pvrtexture::CPVRTextureHeader& header, size_t& data_offset)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+	DDSHeader dds;
+	uint32_t magic;
+	if (size < 4 + sizeof(DDSHeader))
+	{
+		throw runtime_error("DDS header is truncated, got %llu bytes", (unsigned long long)size);
+	}
+	memcpy(&magic, bytes, 4);
+	memcpy(&dds, bytes + 4, sizeof(DDSHeader));
+	if (magic != FourCC<'D', 'D', 'S', ' '>::Value)
+	{
+		throw runtime_error("Not a DDS file");
+	}
+	if ((dds.pixel_format.flags & DDPF_FOURCC) == 0 || dds.pixel_format.fourcc != FourCC<'D', 'X', '1', '0'>::Value)
+	{
+		return false;
+	}
+	DDSHeaderDX10 dx10;
+	if (size < 4 + sizeof(DDSHeader) + sizeof(DDSHeaderDX10))
+	{
+		throw runtime_error("DDS header is truncated, got %llu bytes", (unsigned long long)size);
+	}
+	memcpy(&dx10, bytes + 4 + sizeof(DDSHeader), sizeof(DDSHeaderDX10));
+
+	uint64_t format;
+	EPVRTVariableType channel_type;
+	EPVRTColourSpace colour_space = ePVRTCSpacelRGB;
+	switch (dx10.dxgi_format)
+	{
+		case 95: format = ePVRTPF_BC6; channel_type = ePVRTVarTypeUnsignedFloat; break;
+		case 96: format = ePVRTPF_BC6; channel_type = ePVRTVarTypeSignedFloat; break;
+		case 98: format = ePVRTPF_BC7; channel_type = ePVRTVarTypeUnsignedByteNorm; break;
+		case 99: format = ePVRTPF_BC7; channel_type = ePVRTVarTypeUnsignedByteNorm; colour_space = ePVRTCSpacesRGB; break;
+		default: return false;
+	}
+	uint32_t depth = dx10.resource_dimension == DDS_DIMENSION_TEXTURE3D && dds.depth > 0 ? dds.depth : 1;
+	uint32_t mips = dds.mip_map_count > 0 ? dds.mip_map_count : 1;
+	uint32_t array = dx10.array_size > 0 ? dx10.array_size : 1;
+	uint32_t faces = (dx10.misc_flag & DDS_RESOURCE_MISC_TEXTURECUBE) != 0 ? 6 : 1;
+	if (dds.width == 0 || dds.height == 0)
+	{
+		throw runtime_error("DDS texture has zero size");
+	}
+	header = pvrtexture::CPVRTextureHeader(format, dds.height, dds.width, depth, mips, array, faces, colour_space, channel_type);
+	header.setOrientation((EPVRTOrientation)(ePVRTOrientRight | ePVRTOrientDown));
+	data_offset = 4 + sizeof(DDSHeader) + sizeof(DDSHeaderDX10);
+	return true;
+}
+
+size_t GetDDSSurfaceOffset(const pvrtexture::CPVRTextureHeader& header, uint32_t mip, uint32_t array, uint32_t face)
+{
+	size_t chain_size = 0;
+	size_t mip_offset = 0;
+	for (uint32_t m = 0; m < header.getNumMIPLevels(); ++m)
+	{
+		if (m == mip)
+		{
+			mip_offset = chain_size;
+		}
+		chain_size += GetSurfaceSize(header, m);
+	}
+	return ((size_t)array * header.getNumFaces() + face) * chain_size + mip_offset;
+}
+
+size_t GetPVRSurfaceOffset(const pvrtexture::CPVRTextureHeader& header, uint32_t mip, uint32_t array, uint32_t face)
+{
+	size_t offset = 0;
+	for (uint32_t m = 0; m < mip; ++m)
+	{
+		offset += GetSurfaceSize(header, m) * header.getNumArrayMembers() * header.getNumFaces();
+	}
+	return offset + ((size_t)array * header.getNumFaces() + face) * GetSurfaceSize(header, mip);
+}
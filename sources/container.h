@@ -0,0 +1,56 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#pragma once
+#include <PVRTextureHeader.h>
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+// Layout of PVR and DDS files, for code that writes or reads surfaces directly instead of going through PVRTexLib
+
+// PVRTexLib reports zero size for BC6H and BC7 and never allocates, saves or loads their data.
+// For these formats sizes follow from 16 byte 4x4 blocks and the module handles the data itself
+bool IsUnsizedFormat(uint64_t format);
+
+// Size of one surface of the mip level, like getDataSize(mip, false, false), but also valid for unsized formats
+size_t GetSurfaceSize(const pvrtexture::CPVRTextureHeader& header, uint32_t mip);
+
+// Size of all surfaces of all mip levels, like getDataSize(), but also valid for unsized formats
+size_t GetTextureDataSize(const pvrtexture::CPVRTextureHeader& header);
+
+// PVR v3 header followed by all metadata blocks of the texture
+std::vector<uint8_t> MakePVRHeader(const pvrtexture::CPVRTextureHeader& header);
+
+// "DDS " magic, DDS_HEADER and, if the format needs it, DDS_HEADER_DXT10.
+// DXT formats of non-array textures use legacy FourCC codes, other formats use the DX10 extension, falling back to
+// bit masks for formats that have no DXGI equivalent. Throws if the format has no DDS representation.
+std::vector<uint8_t> MakeDDSHeader(const pvrtexture::CPVRTextureHeader& header);
+
+// Header of a DDS file in one of the unsized formats, which only the DX10 extension can describe. Returns false for
+// other formats, which PVRTexLib loads; data_offset is where surfaces start, in the order of GetDDSSurfaceOffset.
+// Throws if the header is truncated or not a DDS header
+bool ReadUnsizedDDSHeader(const void* data, size_t size, pvrtexture::CPVRTextureHeader& header, size_t& data_offset);
+
+// Offset of a surface from the end of the DDS header. DDS stores array members one after another,
+// each of them with all faces, each face with the whole mip chain
+size_t GetDDSSurfaceOffset(const pvrtexture::CPVRTextureHeader& header, uint32_t mip, uint32_t array, uint32_t face);
+
+// Offset of a surface from the beginning of PVR texture data: mip levels one after another,
+// each of them with all array members, each array member with all faces
+size_t GetPVRSurfaceOffset(const pvrtexture::CPVRTextureHeader& header, uint32_t mip, uint32_t array, uint32_t face);
@@ -155,3 +155,11 @@ inline double3 uv2cube(double2 uv, int n)
 	v.Normalize();
 	return v;
 }
+
+//Transforms 3d direction to coordinates of equirectangular projection. u is longitude, v is latitude, both in [0, 1] range
+inline double2 dir2equirect(double3 v)
+{
+	double longitude = atan2(v.z, v.x);
+	double latitude = atan2(v.y, sqrt(v.x * v.x + v.z * v.z));
+	return double2((longitude + M_PI) / (2.0 * M_PI), (M_PI / 2.0 - latitude) / M_PI);
+}
@@ -0,0 +1,142 @@
+//The MIT License (MIT)
+//
+//Copyright (c) 2015-2020 Stanislav
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in all
+//copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//SOFTWARE.
+
+#pragma once
+#include "coordinate_transform.h"
+#include "simd.h"
+
+#include <cstddef>
+#include <cstring>
+
+//Batched float32 versions of uv2cube, cube2uv and dir2equirect. Arrays are in SoA layout, every call processes
+//16, 8 or 4 texels per instruction depending on the instruction set the module is compiled for (AVX-512, AVX2, SSE4.1).
+//atan2 is approximated by a minimax polynomial, absolute error is below 1e-5 radians.
+namespace simd
+{
+	inline vfloat atan2(vfloat y, vfloat x)
+	{
+		const vfloat ax = abs(x);
+		const vfloat ay = abs(y);
+		const vfloat lo = min(ax, ay);
+		const vfloat hi = max(ax, ay);
+		// hi is zero only when both are zero, result is zero then
+		const vfloat a = select(hi > set1(0.0f), lo / hi, set1(0.0f));
+		const vfloat s = a * a;
+		vfloat r = set1(-0.01172120f);
+		r = r * s + set1(0.05265332f);
+		r = r * s + set1(-0.11643287f);
+		r = r * s + set1(0.19354346f);
+		r = r * s + set1(-0.33262347f);
+		r = r * s + set1(0.99997726f);
+		r = r * a;
+		r = select(ay > ax, set1((float)M_PI_2) - r, r);
+		r = select(x < set1(0.0f), set1((float)M_PI) - r, r);
+		r = select(y < set1(0.0f), -r, r);
+		return r;
+	}
+}
+
+//Batched uv2cube for a single face. Returned directions are normalized
+inline void uv2cube_batch(const float* u, const float* v, int n, float* x, float* y, float* z, size_t count)
+{
+	using namespace simd;
+	const float* in[2] = {u, v};
+	float* out[3] = {x, y, z};
+	for_each<2, 3>(in, out, count, [n](const vfloat* a, vfloat* r)
+	{
+		const vfloat one = set1(1.0f);
+		const vfloat s = a[0] + a[0] - one;
+		const vfloat t = a[1] + a[1] - one;
+		switch (n)
+		{
+			case ENVMAP_POSITIVEX: r[0] = one; r[1] = -t; r[2] = s; break;
+			case ENVMAP_NEGATIVEX: r[0] = -one; r[1] = -t; r[2] = -s; break;
+			case ENVMAP_POSITIVEY: r[0] = -s; r[1] = one; r[2] = t; break;
+			case ENVMAP_NEGATIVEY: r[0] = -s; r[1] = -one; r[2] = -t; break;
+			case ENVMAP_POSITIVEZ: r[0] = -s; r[1] = -t; r[2] = one; break;
+			default: r[0] = s; r[1] = -t; r[2] = -one; break;
+		}
+		const vfloat inv_length = one / sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]);
+		r[0] = r[0] * inv_length;
+		r[1] = r[1] * inv_length;
+		r[2] = r[2] * inv_length;
+	});
+}
+
+//Batched cube2uv, face index of every direction is written to n
+inline void cube2uv_batch(const float* x, const float* y, const float* z, float* u, float* v, int* n, size_t count)
+{
+	using namespace simd;
+	const float* in[3] = {x, y, z};
+	size_t i = 0;
+	for (; i < count; i += width)
+	{
+		//faces are produced as float and converted at the end, for_each works with float outputs only
+		float face[width];
+		size_t block = count - i < (size_t)width ? count - i : (size_t)width;
+		const float* in_block[3] = {in[0] + i, in[1] + i, in[2] + i};
+		float* out_block[3] = {u + i, v + i, face};
+		for_each<3, 3>(in_block, out_block, block, [](const vfloat* a, vfloat* r)
+		{
+			const vfloat zero = set1(0.0f);
+			const vfloat half = set1(0.5f);
+			const vfloat ax = abs(a[0]);
+			const vfloat ay = abs(a[1]);
+			const vfloat az = abs(a[2]);
+			const vmask major_y = (ay > ax) & (ay >= az);
+			const vmask major_z = (az > ax) & (az > ay);
+
+			// defaults are for the x major axis
+			vfloat ma = select(major_z, a[2], select(major_y, a[1], a[0]));
+			vfloat su = select(major_z, a[0], select(major_y, a[0], a[2]));
+			vfloat sv = select(major_y, a[2], a[1]);
+			const vmask positive = ma > zero;
+			vfloat u_sign = select(major_z, set1(-1.0f), select(major_y & positive, set1(-1.0f), set1(1.0f)));
+			vfloat v_sign = select(major_y, set1(1.0f), select(positive, set1(-1.0f), set1(1.0f)));
+			vfloat base = select(major_z, set1(4.0f), select(major_y, set1(2.0f), zero));
+
+			const vfloat scale = half / ma;
+			r[0] = half + u_sign * su * scale;
+			r[1] = half + v_sign * sv * scale;
+			r[2] = base + select(positive, zero, set1(1.0f));
+		});
+		for (size_t k = 0; k < block; ++k)
+		{
+			n[i + k] = (int)face[k];
+		}
+	}
+}
+
+//Batched dir2equirect, directions do not need to be normalized
+inline void dir2equirect_batch(const float* x, const float* y, const float* z, float* u, float* v, size_t count)
+{
+	using namespace simd;
+	const float* in[3] = {x, y, z};
+	float* out[2] = {u, v};
+	for_each<3, 2>(in, out, count, [](const vfloat* a, vfloat* r)
+	{
+		const vfloat longitude = atan2(a[2], a[0]);
+		const vfloat latitude = atan2(a[1], sqrt(a[0] * a[0] + a[2] * a[2]));
+		r[0] = (longitude + set1((float)M_PI)) * set1((float)(0.5 / M_PI));
+		r[1] = (set1((float)M_PI_2) - latitude) * set1((float)(1.0 / M_PI));
+	});
+}
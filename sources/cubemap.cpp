@@ -0,0 +1,287 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#include "cubemap.h"
+#include "coordinate_transform_simd.h"
+#include "surface.h"
+#include "storage.h"
+#include "thread_pool.h"
+#include "profiler.h"
+#include "common.h"
+
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+
+namespace
+{
+	// Panorama wraps around horizontally and is clamped at the poles
+	inline int WrapX(int x, int width)
+	{
+		x %= width;
+		return x < 0 ? x + width : x;
+	}
+
+	inline int ClampY(int y, int height)
+	{
+		return y < 0 ? 0 : (y >= height ? height - 1 : y);
+	}
+
+	void SampleBilinear(const FloatImage& image, double x, double y, float* out)
+	{
+		int x0 = (int)floor(x);
+		int y0 = (int)floor(y);
+		float fx = (float)(x - x0);
+		float fy = (float)(y - y0);
+		const int channels = image.channels;
+		const float* p00 = &image.data[((size_t)ClampY(y0, image.height) * image.width + WrapX(x0, image.width)) * channels];
+		const float* p01 = &image.data[((size_t)ClampY(y0, image.height) * image.width + WrapX(x0 + 1, image.width)) * channels];
+		const float* p10 = &image.data[((size_t)ClampY(y0 + 1, image.height) * image.width + WrapX(x0, image.width)) * channels];
+		const float* p11 = &image.data[((size_t)ClampY(y0 + 1, image.height) * image.width + WrapX(x0 + 1, image.width)) * channels];
+		for (int c = 0; c < channels; ++c)
+		{
+			float top = p00[c] + (p01[c] - p00[c]) * fx;
+			float bottom = p10[c] + (p11[c] - p10[c]) * fx;
+			out[c] = top + (bottom - top) * fy;
+		}
+	}
+
+	// Swaps each texel of a row with the mirrored texel of the other row, or of the same row
+	void SwapMirroredTexels(uint8_t* a, uint8_t* b, size_t width, size_t texel_size)
+	{
+		const size_t count = a == b ? width / 2 : width;
+		uint8_t tmp[16];
+		for (size_t i = 0; i < count; ++i)
+		{
+			uint8_t* p = a + i * texel_size;
+			uint8_t* q = b + (width - 1 - i) * texel_size;
+			memcpy(tmp, p, texel_size);
+			memcpy(p, q, texel_size);
+			memcpy(q, tmp, texel_size);
+		}
+	}
+
+	// Catmull-Rom weights for samples at offsets -1, 0, 1, 2
+	inline void CubicWeights(float t, float* w)
+	{
+		w[0] = ((-0.5f * t + 1.0f) * t - 0.5f) * t;
+		w[1] = (1.5f * t - 2.5f) * t * t + 1.0f;
+		w[2] = ((-1.5f * t + 2.0f) * t + 0.5f) * t;
+		w[3] = (0.5f * t - 0.5f) * t * t;
+	}
+
+	void SampleBicubic(const FloatImage& image, double x, double y, float* out)
+	{
+		int x0 = (int)floor(x);
+		int y0 = (int)floor(y);
+		float wx[4];
+		float wy[4];
+		CubicWeights((float)(x - x0), wx);
+		CubicWeights((float)(y - y0), wy);
+		const int channels = image.channels;
+		std::fill(out, out + channels, 0.0f);
+		for (int j = 0; j < 4; ++j)
+		{
+			const float* row = &image.data[(size_t)ClampY(y0 - 1 + j, image.height) * image.width * channels];
+			for (int i = 0; i < 4; ++i)
+			{
+				const float* p = row + (size_t)WrapX(x0 - 1 + i, image.width) * channels;
+				float w = wx[i] * wy[j];
+				for (int c = 0; c < channels; ++c)
+				{
+					out[c] += w * p[c];
+				}
+			}
+		}
+	}
+}
+
+
+pvrtexture::CPVRTexture* CubemapFromEquirectangular(const pvrtexture::CPVRTexture& texture, int cubemap_size, Interpolation interpolation, float gamma)
+{
+	if (texture.getDepth() != 1)
+	{
+		throw runtime_error("Equirectangular texture must be 2D, got depth %d", texture.getDepth());
+	}
+	SurfaceCodec codec(texture.getHeader(), texture.getColourSpace(), gamma);
+	const FloatImage panorama = codec.Read(texture, 0, 0, 0);
+	const int channels = codec.channels();
+
+	if (cubemap_size <= 0)
+	{
+		cubemap_size = std::max(1, panorama.width / 4);
+	}
+
+	pvrtexture::CPVRTextureHeader header(texture.getHeader());
+	header.setWidth(cubemap_size);
+	header.setHeight(cubemap_size);
+	header.setDepth(1);
+	header.setNumMIPLevels(1);
+	header.setNumArrayMembers(1);
+	header.setNumFaces(6);
+	std::unique_ptr<pvrtexture::CPVRTexture> result(new pvrtexture::CPVRTexture(header));
+	CountAllocatedBytes(result->getDataSize());
+
+	// texture_tool.coordinate_transform has x axis mirrored compared to uv2cube, so +X and -X faces swap places
+	static const int face_map[6] = {
+			ENVMAP_NEGATIVEX, ENVMAP_POSITIVEX, ENVMAP_POSITIVEY, ENVMAP_NEGATIVEY, ENVMAP_POSITIVEZ, ENVMAP_NEGATIVEZ };
+
+	const size_t row_size = (size_t)cubemap_size * result->getBitsPerPixel() / 8;
+	const size_t size = cubemap_size;
+
+	ThreadPool::GetDefault().ParallelFor(6 * size, [&](size_t i)
+	{
+		int face = (int)(i / size);
+		int y = (int)(i % size);
+		std::vector<float> row(size * channels);
+		std::vector<float> u(size);
+		std::vector<float> v(size, (float)((y + 0.5) / size));
+		std::vector<float> dx(size), dy(size), dz(size);
+		for (size_t x = 0; x < size; ++x)
+		{
+			u[x] = (float)((x + 0.5) / size);
+		}
+		uv2cube_batch(u.data(), v.data(), face_map[face], dx.data(), dy.data(), dz.data(), size);
+		for (size_t x = 0; x < size; ++x)
+		{
+			dx[x] = -dx[x];
+		}
+		// u and v are reused for the equirectangular coordinates
+		dir2equirect_batch(dx.data(), dy.data(), dz.data(), u.data(), v.data(), size);
+
+		for (size_t x = 0; x < size; ++x)
+		{
+			// texel centers are at half-integer coordinates
+			double px = u[x] * (double)panorama.width - 0.5;
+			double py = v[x] * (double)panorama.height - 0.5;
+			if (interpolation == InterpolationBicubic)
+			{
+				SampleBicubic(panorama, px, py, &row[x * channels]);
+			}
+			else
+			{
+				SampleBilinear(panorama, px, py, &row[x * channels]);
+			}
+		}
+		uint8_t* dst = (uint8_t*)result->getDataPtr(0, 0, face) + y * row_size;
+		codec.Encode(row.data(), dst, size);
+	});
+
+	return result.release();
+}
+
+void FlipCubemap(pvrtexture::CPVRTexture& texture, EPVRTAxis axis)
+{
+	if (texture.getNumFaces() != 6)
+	{
+		throw runtime_error("Texture is not a cubemap, it has %d faces", (int)texture.getNumFaces());
+	}
+	const uint32_t bpp = texture.getBitsPerPixel();
+	if (texture.getPixelType().Part.High == 0 || bpp % 8 != 0 || bpp > 128)
+	{
+		throw runtime_error("Can not flip cubemap of pixel format %llu, only uncompressed formats with whole byte texels are supported",
+				(unsigned long long)texture.getPixelType().PixelTypeID);
+	}
+	MakeUnique(texture);
+	const size_t texel_size = bpp / 8;
+
+	// Faces are stored as +X, -X, +Y, -Y, +Z, -Z
+	int partner[6];
+	for (int face = 0; face < 6; ++face)
+	{
+		partner[face] = face / 2 == (int)axis ? face ^ 1 : face;
+	}
+	// Without slices the z axis lies only across faces, see uv2cube: it runs along u of the X faces and along v of
+	// the Y faces, and the exchanged Z faces have u running along x in opposite directions
+	static const EPVRTAxis z_mirror[3] = { ePVRTAxisX, ePVRTAxisY, ePVRTAxisX };
+	const bool across_faces = axis == ePVRTAxisZ && texture.getDepth() == 1;
+
+	struct Job
+	{
+		uint8_t* a;
+		uint8_t* b;
+		size_t width;
+		size_t height;
+		size_t depth;
+		EPVRTAxis mirror;
+	};
+	std::vector<Job> jobs;
+	for (uint32_t mip = 0; mip < texture.getNumMIPLevels(); ++mip)
+	{
+		for (uint32_t array = 0; array < texture.getNumArrayMembers(); ++array)
+		{
+			for (int face = 0; face < 6; ++face)
+			{
+				if (partner[face] < face)
+				{
+					continue;
+				}
+				Job job;
+				job.a = GetSurfacePtr(texture, mip, array, face);
+				job.b = GetSurfacePtr(texture, mip, array, partner[face]);
+				job.width = texture.getWidth(mip);
+				job.height = texture.getHeight(mip);
+				job.depth = texture.getDepth(mip);
+				job.mirror = across_faces ? z_mirror[face / 2] : axis;
+				jobs.push_back(job);
+			}
+		}
+	}
+
+	// A unit is a row for the x and y axes and a slice for the z axis. A face swapped with itself needs half of them
+	ThreadPool::GetDefault().ParallelFor(jobs.size(), [&](size_t j)
+	{
+		const Job& job = jobs[j];
+		const size_t row_size = job.width * texel_size;
+		const size_t slice_size = row_size * job.height;
+		const bool same = job.a == job.b;
+		const size_t rows = same && job.mirror == ePVRTAxisY ? job.height / 2 : job.height;
+		const size_t slices = same && job.mirror == ePVRTAxisZ ? job.depth / 2 : job.depth;
+		const size_t units = job.mirror == ePVRTAxisZ ? slices : rows * slices;
+		ThreadPool::GetDefault().ParallelFor(units, [&](size_t i)
+		{
+			if (job.mirror == ePVRTAxisX)
+			{
+				SwapMirroredTexels(job.a + i * row_size, job.b + i * row_size, job.width, texel_size);
+			}
+			else if (job.mirror == ePVRTAxisY)
+			{
+				const size_t z = i / rows;
+				const size_t y = i % rows;
+				uint8_t* a = job.a + z * slice_size + y * row_size;
+				uint8_t* b = job.b + z * slice_size + (job.height - 1 - y) * row_size;
+				std::swap_ranges(a, a + row_size, b);
+			}
+			else
+			{
+				uint8_t* a = job.a + i * slice_size;
+				uint8_t* b = job.b + (job.depth - 1 - i) * slice_size;
+				std::swap_ranges(a, a + slice_size, b);
+			}
+		});
+	});
+
+	// Orientation is stored per axis, the other two are kept
+	uint32_t orientation = 0;
+	for (int a = ePVRTAxisX; a <= ePVRTAxisZ; ++a)
+	{
+		orientation |= texture.getOrientation((EPVRTAxis)a);
+	}
+	orientation ^= 1u << axis;
+	texture.setOrientation((EPVRTOrientation)orientation);
+}
@@ -0,0 +1,38 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#pragma once
+#include <PVRTexture.h>
+
+
+enum Interpolation
+{
+	InterpolationBilinear,
+	InterpolationBicubic
+};
+
+// Builds a cubemap texture (6 faces) of the same pixel format from the top level of an equirectangular panorama.
+// Sampling is done in float32 linear space, faces and rows are processed in parallel.
+// Faces follow the convention of texture_tool.coordinate_transform.
+pvrtexture::CPVRTexture* CubemapFromEquirectangular(const pvrtexture::CPVRTexture& texture, int cubemap_size, Interpolation interpolation, float gamma);
+
+// Mirrors a cubemap along axis in place: every face is flipped along the axis and the two faces that lie on it,
+// e.g. +Y and -Y for the y axis, are exchanged, which with the flip keeps the faces consistent with each other.
+// Faces without slices have no z axis of their own, for it the X faces are flipped horizontally, the Y faces
+// vertically and the Z faces are exchanged and flipped horizontally, so the whole environment is mirrored along z.
+// All mip levels and array members are processed, each face pair in one pass of swaps, rows in parallel.
+// The orientation of the axis in the PVR metadata is toggled. Compressed formats are not supported
+void FlipCubemap(pvrtexture::CPVRTexture& texture, EPVRTAxis axis);
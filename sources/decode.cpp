@@ -0,0 +1,331 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+#include "decode.h"
+#include "astc.h"
+#include "bc.h"
+#include "bptc.h"
+#include "codec.h"
+#include "etc.h"
+#include "container.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include "common.h"
+
+#include <PVRTDecompress.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+
+namespace
+{
+	struct BlockFormat
+	{
+		bool is_signed;
+		bool is_float;
+		bool srgb;
+	};
+
+	typedef void (*BlockDecoder)(const uint8_t* block, void* rgba, const BlockFormat& format);
+
+	struct NativeDecoder
+	{
+		uint64_t format;
+		int block_width;
+		int block_height;
+		int block_bytes;
+		BlockDecoder decode;
+	};
+
+	void DecodeBC1(const uint8_t* block, void* rgba, const BlockFormat&)
+	{
+		DecodeBC1Block(block, (uint8_t*)rgba);
+	}
+
+	void DecodeBC2(const uint8_t* block, void* rgba, const BlockFormat&)
+	{
+		DecodeBC2Block(block, (uint8_t*)rgba);
+	}
+
+	void DecodeBC3(const uint8_t* block, void* rgba, const BlockFormat&)
+	{
+		DecodeBC3Block(block, (uint8_t*)rgba);
+	}
+
+	void DecodeBC4(const uint8_t* block, void* rgba, const BlockFormat&)
+	{
+		DecodeBC4Block(block, (uint8_t*)rgba);
+	}
+
+	void DecodeBC5(const uint8_t* block, void* rgba, const BlockFormat&)
+	{
+		DecodeBC5Block(block, (uint8_t*)rgba);
+	}
+
+	void DecodeBC6H(const uint8_t* block, void* rgba, const BlockFormat& format)
+	{
+		DecodeBC6HBlock(block, (float*)rgba, format.is_signed);
+	}
+
+	void DecodeBC7(const uint8_t* block, void* rgba, const BlockFormat&)
+	{
+		DecodeBC7Block(block, (uint8_t*)rgba);
+	}
+
+	void DecodeETC2RGB(const uint8_t* block, void* rgba, const BlockFormat&)
+	{
+		DecodeETC2RGBBlock(block, (uint8_t*)rgba);
+	}
+
+	void DecodeETC2RGBA(const uint8_t* block, void* rgba, const BlockFormat&)
+	{
+		DecodeETC2RGBABlock(block, (uint8_t*)rgba);
+	}
+
+	void DecodeETC2RGBA1(const uint8_t* block, void* rgba, const BlockFormat&)
+	{
+		DecodeETC2RGBA1Block(block, (uint8_t*)rgba);
+	}
+
+	void DecodeEACR11(const uint8_t* block, void* rgba, const BlockFormat& format)
+	{
+		DecodeEACR11Block(block, (float*)rgba, format.is_signed);
+	}
+
+	void DecodeEACRG11(const uint8_t* block, void* rgba, const BlockFormat& format)
+	{
+		DecodeEACRG11Block(block, (float*)rgba, format.is_signed);
+	}
+
+	// Rounds values in [0, 1] to uint8, count is a multiple of 4
+	void ToUnorm8(const float* src, uint8_t* dst, int count)
+	{
+		const simd::vfloat lo = simd::set1(0.0f);
+		const simd::vfloat hi = simd::set1(255.0f);
+		const simd::vfloat half = simd::set1(0.5f);
+		int values[simd::width];
+		int i = 0;
+		for (; i + (int)simd::width <= count; i += simd::width)
+		{
+			simd::vfloat x = simd::min(simd::max(simd::load(src + i) * hi, lo), hi) + half;
+			simd::store(values, x);
+			for (int j = 0; j < (int)simd::width; ++j)
+			{
+				dst[i + j] = (uint8_t)values[j];
+			}
+		}
+		for (; i < count; ++i)
+		{
+			dst[i] = (uint8_t)(std::min(std::max(src[i] * 255.0f, 0.0f), 255.0f) + 0.5f);
+		}
+	}
+
+	template<int block_width, int block_height>
+	void DecodeASTC(const uint8_t* block, void* rgba, const BlockFormat& format)
+	{
+		if (format.is_float)
+		{
+			DecodeASTCBlock(block, block_width, block_height, (float*)rgba, format.srgb);
+			return;
+		}
+		float texels[block_width * block_height * 4];
+		DecodeASTCBlock(block, block_width, block_height, texels, format.srgb);
+		ToUnorm8(texels, (uint8_t*)rgba, block_width * block_height * 4);
+	}
+
+#define ASTC_DECODER(W, H) {ePVRTPF_ASTC_##W##x##H, W, H, 16, DecodeASTC<W, H>}
+
+	const NativeDecoder decoders[] = {
+			{ePVRTPF_DXT1, 4, 4, 8, DecodeBC1},
+			{ePVRTPF_DXT2, 4, 4, 16, DecodeBC2},
+			{ePVRTPF_DXT3, 4, 4, 16, DecodeBC2},
+			{ePVRTPF_DXT4, 4, 4, 16, DecodeBC3},
+			{ePVRTPF_DXT5, 4, 4, 16, DecodeBC3},
+			{ePVRTPF_BC4, 4, 4, 8, DecodeBC4},
+			{ePVRTPF_BC5, 4, 4, 16, DecodeBC5},
+			{ePVRTPF_BC6, 4, 4, 16, DecodeBC6H},
+			{ePVRTPF_BC7, 4, 4, 16, DecodeBC7},
+			{ePVRTPF_ETC1, 4, 4, 8, DecodeETC2RGB},
+			{ePVRTPF_ETC2_RGB, 4, 4, 8, DecodeETC2RGB},
+			{ePVRTPF_ETC2_RGBA, 4, 4, 16, DecodeETC2RGBA},
+			{ePVRTPF_ETC2_RGB_A1, 4, 4, 8, DecodeETC2RGBA1},
+			{ePVRTPF_EAC_R11, 4, 4, 8, DecodeEACR11},
+			{ePVRTPF_EAC_RG11, 4, 4, 16, DecodeEACRG11},
+			ASTC_DECODER(4, 4),
+			ASTC_DECODER(5, 4),
+			ASTC_DECODER(5, 5),
+			ASTC_DECODER(6, 5),
+			ASTC_DECODER(6, 6),
+			ASTC_DECODER(8, 5),
+			ASTC_DECODER(8, 6),
+			ASTC_DECODER(8, 8),
+			ASTC_DECODER(10, 5),
+			ASTC_DECODER(10, 6),
+			ASTC_DECODER(10, 8),
+			ASTC_DECODER(10, 10),
+			ASTC_DECODER(12, 10),
+			ASTC_DECODER(12, 12),
+	};
+
+#undef ASTC_DECODER
+
+	const NativeDecoder* FindDecoder(uint64_t format)
+	{
+		for (const NativeDecoder& decoder: decoders)
+		{
+			if (decoder.format == format)
+			{
+				return &decoder;
+			}
+		}
+		return nullptr;
+	}
+
+	bool IsPVRTC(uint64_t format)
+	{
+		return format >= ePVRTPF_PVRTCI_2bpp_RGB && format <= ePVRTPF_PVRTCI_4bpp_RGBA;
+	}
+
+	bool IsASTC(uint64_t format)
+	{
+		return format >= ePVRTPF_ASTC_4x4 && format <= ePVRTPF_ASTC_12x12;
+	}
+
+	void DecodePVRTC(const pvrtexture::CPVRTextureHeader& header, const uint8_t* surface, uint32_t mip, uint8_t* rgba)
+	{
+		const uint64_t format = header.getPixelType().PixelTypeID;
+		const int do_2bit = format == ePVRTPF_PVRTCI_2bpp_RGB || format == ePVRTPF_PVRTCI_2bpp_RGBA;
+		const int width = (int)header.getWidth(mip);
+		const int height = (int)header.getHeight(mip);
+		const uint32_t depth = header.getDepth(mip);
+		const size_t slice_bytes = GetSurfaceSize(header, mip) / depth;
+		const size_t slice_texels = (size_t)width * height;
+		ThreadPool::GetDefault().ParallelFor(depth, [&](size_t z)
+		{
+			PVRTDecompressPVRTC(surface + z * slice_bytes, do_2bit, width, height, rgba + z * slice_texels * 4);
+		});
+	}
+
+	BlockFormat GetBlockFormat(const pvrtexture::CPVRTextureHeader& header)
+	{
+		BlockFormat format;
+		format.is_signed = IsSignedChannelType(header.getChannelType());
+		format.is_float = IsFloatDecoded(header);
+		format.srgb = header.getColourSpace() == ePVRTCSpacesRGB;
+		return format;
+	}
+
+	struct BlockRow
+	{
+		uint32_t z;
+		uint32_t y;
+	};
+}
+
+
+bool HasNativeDecoder(uint64_t format)
+{
+	return FindDecoder(format) != nullptr || IsPVRTC(format);
+}
+
+bool IsFloatDecoded(const pvrtexture::CPVRTextureHeader& header)
+{
+	const uint64_t format = header.getPixelType().PixelTypeID;
+	if (IsASTC(format))
+	{
+		return IsFloatChannelType(header.getChannelType());
+	}
+	return format == ePVRTPF_BC6 || format == ePVRTPF_EAC_R11 || format == ePVRTPF_EAC_RG11;
+}
+
+void DecodeSurface(const pvrtexture::CPVRTextureHeader& header, const uint8_t* surface, uint32_t mip, void* rgba)
+{
+	const uint64_t format = header.getPixelType().PixelTypeID;
+	if (mip >= header.getNumMIPLevels())
+	{
+		throw runtime_error("Mip level %d out of range, texture has %d", mip, header.getNumMIPLevels());
+	}
+	if (IsPVRTC(format))
+	{
+		DecodePVRTC(header, surface, mip, (uint8_t*)rgba);
+		return;
+	}
+	const NativeDecoder* decoder = FindDecoder(format);
+	if (decoder == nullptr)
+	{
+		throw runtime_error("No native decoder for pixel format %llu", (unsigned long long)format);
+	}
+
+	const BlockFormat block_format = GetBlockFormat(header);
+	const size_t texel_size = block_format.is_float ? 4 * sizeof(float) : 4;
+
+	const int block_width = decoder->block_width;
+	const int block_height = decoder->block_height;
+	const int width = (int)header.getWidth(mip);
+	const int height = (int)header.getHeight(mip);
+	const uint32_t depth = header.getDepth(mip);
+	const int blocks_x = (width + block_width - 1) / block_width;
+	const int blocks_y = (height + block_height - 1) / block_height;
+
+	std::vector<BlockRow> rows;
+	rows.reserve((size_t)depth * blocks_y);
+	for (uint32_t z = 0; z < depth; ++z)
+		for (int y = 0; y < blocks_y; ++y)
+			rows.push_back({z, (uint32_t)y});
+
+	uint8_t* dst = (uint8_t*)rgba;
+	ThreadPool::GetDefault().ParallelFor(rows.size(), [&](size_t i)
+	{
+		const BlockRow& row = rows[i];
+		const uint8_t* src = surface + ((size_t)row.z * blocks_y + row.y) * blocks_x * decoder->block_bytes;
+		// texels past the edge of the surface are decoded, but not written
+		const int rows_left = std::min(block_height, height - (int)row.y * block_height);
+		uint8_t texels[12 * 12 * 4 * sizeof(float)];
+		for (int bx = 0; bx < blocks_x; ++bx)
+		{
+			decoder->decode(src + (size_t)bx * decoder->block_bytes, texels, block_format);
+			const int columns = std::min(block_width, width - bx * block_width);
+			for (int y = 0; y < rows_left; ++y)
+			{
+				size_t offset = (((size_t)row.z * height + row.y * block_height + y) * width + (size_t)bx * block_width) * texel_size;
+				memcpy(dst + offset, texels + (size_t)y * block_width * texel_size, columns * texel_size);
+			}
+		}
+	});
+}
+
+void DecodeBlock(const pvrtexture::CPVRTextureHeader& header, const uint8_t* block, float* rgba)
+{
+	const uint64_t format = header.getPixelType().PixelTypeID;
+	const NativeDecoder* decoder = FindDecoder(format);
+	if (decoder == nullptr)
+	{
+		throw runtime_error("No block decoder for pixel format %llu", (unsigned long long)format);
+	}
+	const BlockFormat block_format = GetBlockFormat(header);
+	if (block_format.is_float)
+	{
+		decoder->decode(block, rgba, block_format);
+		return;
+	}
+	const int count = decoder->block_width * decoder->block_height * 4;
+	uint8_t texels[12 * 12 * 4];
+	decoder->decode(block, texels, block_format);
+	for (int i = 0; i < count; ++i)
+	{
+		rgba[i] = (float)texels[i] / 255.0f;
+	}
+}
@@ -0,0 +1,40 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+#pragma once
+#include <PVRTexture.h>
+
+#include <cstdint>
+
+
+// Decoding of compressed surfaces to RGBA texels, a faster alternative to transcoding a copy of the texture.
+// BC1-BC7, ETC1, ETC2, EAC and ASTC are decoded by the in-tree block decoders, one block row per job on the shared
+// thread pool. PVRTC 1 is decoded by PVRTDecompressPVRTC, one depth slice per job, since its blocks are stored in
+// Morton order and interpolate colours of neighbouring blocks.
+//
+// BC6H, EAC and ASTC with a float channel type are decoded to float32, everything else to uint8. Values are not gamma
+// corrected. Signed channel types of BC6H and EAC decode to signed values.
+
+bool HasNativeDecoder(uint64_t format);
+
+// True if the surfaces of header decode to float32, false for uint8
+bool IsFloatDecoded(const pvrtexture::CPVRTextureHeader& header);
+
+// Decodes all depth slices of a surface to rgba, which holds depth * height * width RGBA texels of the mip level.
+// Throws if the format has no native decoder
+void DecodeSurface(const pvrtexture::CPVRTextureHeader& header, const uint8_t* surface, uint32_t mip, void* rgba);
+
+// Decodes a single block to RGBA float32 texels, 8-bit results are scaled to [0, 1]. PVRTC blocks depend on their
+// neighbours and can not be decoded one at a time. Throws if the format has no block decoder
+void DecodeBlock(const pvrtexture::CPVRTextureHeader& header, const uint8_t* block, float* rgba);
@@ -0,0 +1,561 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+#include "downsample.h"
+#include "thread_pool.h"
+#include "profiler.h"
+#include "simd.h"
+#include "common.h"
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <algorithm>
+
+
+namespace
+{
+	// Source samples read by each output of a 1D pass: output j reads index[j * taps + k] with weight[j * taps + k].
+	// Indices are already mapped into [0, n_in)
+	struct AxisTaps
+	{
+		int n_in;
+		int n_out;
+		int taps;
+		std::vector<int> index;
+		std::vector<float> weight;
+
+		bool IsIdentity() const { return n_in == n_out; }
+		const int* Index(int j) const { return &index[(size_t)j * taps]; }
+		const float* Weights(int j) const { return &weight[(size_t)j * taps]; }
+	};
+
+	int DownsampledSize(int n)
+	{
+		return std::max(n / 2, 1);
+	}
+
+	// Mirroring of scipy.ndimage: the edge sample is not repeated, ... 2 1 | 0 1 2 ... n-1 | n-2 n-3 ...
+	int MirrorWhole(int i, int n)
+	{
+		if (n <= 1)
+			return 0;
+		int period = 2 * n - 2;
+		i %= period;
+		if (i < 0)
+			i += period;
+		if (i >= n)
+			i = period - i;
+		return i;
+	}
+
+	// Output j averages the interval [j * scale, (j + 1) * scale) of the source, texels are weighted by their coverage
+	AxisTaps AreaTaps(int n_in, int n_out)
+	{
+		const double scale = (double)n_in / n_out;
+		AxisTaps taps;
+		taps.n_in = n_in;
+		taps.n_out = n_out;
+		taps.taps = (int)ceil(scale) + 1;
+		taps.index.assign((size_t)n_out * taps.taps, 0);
+		taps.weight.assign((size_t)n_out * taps.taps, 0.0f);
+		for (int j = 0; j < n_out; ++j)
+		{
+			const double lo = j * scale;
+			const double hi = j == n_out - 1 ? n_in : (j + 1) * scale;
+			const int first = (int)floor(lo);
+			int k = 0;
+			for (int i = first; i < n_in && i < hi && k < taps.taps; ++i)
+			{
+				double coverage = std::min(hi, i + 1.0) - std::max(lo, (double)i);
+				if (coverage <= 0.0)
+					continue;
+				taps.index[(size_t)j * taps.taps + k] = i;
+				taps.weight[(size_t)j * taps.taps + k] = (float)(coverage / scale);
+				++k;
+			}
+			// unused taps keep weight 0 and point at a valid sample
+			for (; k < taps.taps; ++k)
+			{
+				taps.index[(size_t)j * taps.taps + k] = first;
+			}
+		}
+		return taps;
+	}
+
+	double CubicBSpline(double x)
+	{
+		x = fabs(x);
+		if (x < 1.0)
+			return (4.0 + x * x * (3.0 * x - 6.0)) / 6.0;
+		if (x < 2.0)
+		{
+			double t = 2.0 - x;
+			return t * t * t / 6.0;
+		}
+		return 0.0;
+	}
+
+	// Output j samples the spline at j * (n_in - 1) / (n_out - 1), same as zoom_shift of scipy
+	AxisTaps BSplineTaps(int n_in, int n_out)
+	{
+		const double zoom = n_out > 1 ? (double)(n_in - 1) / (n_out - 1) : 1.0;
+		AxisTaps taps;
+		taps.n_in = n_in;
+		taps.n_out = n_out;
+		taps.taps = 4;
+		taps.index.resize((size_t)n_out * 4);
+		taps.weight.resize((size_t)n_out * 4);
+		for (int j = 0; j < n_out; ++j)
+		{
+			const double x = j * zoom;
+			const int start = (int)floor(x) - 1;
+			for (int k = 0; k < 4; ++k)
+			{
+				taps.index[(size_t)j * 4 + k] = MirrorWhole(start + k, n_in);
+				taps.weight[(size_t)j * 4 + k] = (float)CubicBSpline(x - (start + k));
+			}
+		}
+		return taps;
+	}
+
+	// Horizontal pass over one row of interleaved texels
+	template<int C>
+	void FilterRowT(const float* src, float* dst, const AxisTaps& taps)
+	{
+		for (int j = 0; j < taps.n_out; ++j)
+		{
+			const int* index = taps.Index(j);
+			const float* w = taps.Weights(j);
+			float acc[C] = {};
+			for (int k = 0; k < taps.taps; ++k)
+			{
+				const float* s = src + (size_t)index[k] * C;
+				for (int c = 0; c < C; ++c)
+				{
+					acc[c] += w[k] * s[c];
+				}
+			}
+			memcpy(dst + (size_t)j * C, acc, sizeof(acc));
+		}
+	}
+
+	template<>
+	void FilterRowT<4>(const float* src, float* dst, const AxisTaps& taps)
+	{
+		for (int j = 0; j < taps.n_out; ++j)
+		{
+			const int* index = taps.Index(j);
+			const float* w = taps.Weights(j);
+			__m128 acc = _mm_setzero_ps();
+			for (int k = 0; k < taps.taps; ++k)
+			{
+				acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w[k]), _mm_loadu_ps(src + (size_t)index[k] * 4)));
+			}
+			_mm_storeu_ps(dst + (size_t)j * 4, acc);
+		}
+	}
+
+	void FilterRowGeneric(const float* src, float* dst, int channels, const AxisTaps& taps)
+	{
+		for (int j = 0; j < taps.n_out; ++j)
+		{
+			const int* index = taps.Index(j);
+			const float* w = taps.Weights(j);
+			float* out = dst + (size_t)j * channels;
+			std::fill(out, out + channels, 0.0f);
+			for (int k = 0; k < taps.taps; ++k)
+			{
+				const float* s = src + (size_t)index[k] * channels;
+				for (int c = 0; c < channels; ++c)
+				{
+					out[c] += w[k] * s[c];
+				}
+			}
+		}
+	}
+
+	void FilterRow(const float* src, float* dst, int channels, const AxisTaps& taps)
+	{
+		if (taps.IsIdentity())
+		{
+			memcpy(dst, src, (size_t)taps.n_in * channels * sizeof(float));
+			return;
+		}
+		switch (channels)
+		{
+			case 1: FilterRowT<1>(src, dst, taps); break;
+			case 2: FilterRowT<2>(src, dst, taps); break;
+			case 3: FilterRowT<3>(src, dst, taps); break;
+			case 4: FilterRowT<4>(src, dst, taps); break;
+			default: FilterRowGeneric(src, dst, channels, taps); break;
+		}
+	}
+
+	// Per thread buffers that are reused between jobs, large allocations would fault in fresh pages every time
+	std::vector<float>& Scratch(int slot, size_t size)
+	{
+		thread_local std::vector<float> buffers[3];
+		buffers[slot].resize(size);
+		return buffers[slot];
+	}
+
+	void CopyTexel(float* dst, const float* src, int channels)
+	{
+		for (int c = 0; c < channels; ++c)
+		{
+			dst[c] = src[c];
+		}
+	}
+
+	// dst[i] = sum of w[k] * rows[k][i], over contiguous memory of whole rows or slices
+	void CombineRows(const float* const* rows, const float* w, int taps, float* dst, size_t begin, size_t end)
+	{
+		size_t i = begin;
+		for (; i + simd::width <= end; i += simd::width)
+		{
+			simd::vfloat acc = simd::set1(0.0f);
+			for (int k = 0; k < taps; ++k)
+			{
+				acc = acc + simd::set1(w[k]) * simd::load(rows[k] + i);
+			}
+			simd::store(dst + i, acc);
+		}
+		for (; i < end; ++i)
+		{
+			float acc = 0.0f;
+			for (int k = 0; k < taps; ++k)
+			{
+				acc += w[k] * rows[k][i];
+			}
+			dst[i] = acc;
+		}
+	}
+
+	// Cubic B-spline prefilter of scipy.ndimage.spline_filter1d with mirror mode, in place. Lines are
+	// data[l + i * stride] for i < n, lanes l in [begin, end) are contiguous and are filtered together
+	class SplinePrefilter
+	{
+	public:
+		explicit SplinePrefilter(int n): m_n(n)
+		{
+			const double z = sqrt(3.0) - 2.0;
+			m_pole = (float)z;
+			m_gain = (float)((1.0 - z) * (1.0 - 1.0 / z));
+			m_last = (float)(z / (z * z - 1.0));
+			if (n < 2)
+				return;
+
+			// the causal filter starts from the whole mirrored line: x_0 + z^(n-1) x_(n-1) + sum of
+			// (z^k + z^(2n-2-k)) x_k over the inner samples, divided by 1 - z^(2n-2). Weights below float precision are dropped
+			std::vector<double> w(n, 0.0);
+			w[0] = 1.0;
+			w[n - 1] += pow(z, n - 1);
+			for (int k = 1; k < n - 1; ++k)
+			{
+				w[k] = pow(z, k) + pow(z, 2 * n - 2 - k);
+			}
+			const double norm = m_gain / (1.0 - pow(z, 2 * n - 2));
+			for (int k = 0; k < n; ++k)
+			{
+				if (fabs(w[k]) > 1e-9)
+				{
+					m_init_index.push_back(k);
+					m_init_weight.push_back((float)(w[k] * norm));
+				}
+			}
+		}
+
+		void Filter(float* data, size_t stride, size_t begin, size_t end) const
+		{
+			if (m_n < 2)
+				return;
+			const size_t count = end - begin;
+			std::vector<float>& init = Scratch(2, count);
+			std::fill(init.begin(), init.end(), 0.0f);
+			for (size_t t = 0; t < m_init_index.size(); ++t)
+			{
+				const float* line = data + m_init_index[t] * stride + begin;
+				const float w = m_init_weight[t];
+				Lanes(count, [&](size_t i) { simd::store(init.data() + i, simd::load(init.data() + i) + simd::set1(w) * simd::load(line + i)); },
+				             [&](size_t i) { init[i] += w * line[i]; });
+			}
+			float* first = data + begin;
+			memcpy(first, init.data(), count * sizeof(float));
+
+			// causal
+			const simd::vfloat z = simd::set1(m_pole);
+			const simd::vfloat gain = simd::set1(m_gain);
+			for (int k = 1; k < m_n; ++k)
+			{
+				const float* prev = data + (k - 1) * stride + begin;
+				float* line = data + k * stride + begin;
+				Lanes(count, [&](size_t i) { simd::store(line + i, gain * simd::load(line + i) + z * simd::load(prev + i)); },
+				             [&](size_t i) { line[i] = m_gain * line[i] + m_pole * prev[i]; });
+			}
+
+			// anticausal
+			{
+				const simd::vfloat last = simd::set1(m_last);
+				const float* prev = data + (m_n - 2) * stride + begin;
+				float* line = data + (m_n - 1) * stride + begin;
+				Lanes(count, [&](size_t i) { simd::store(line + i, last * (z * simd::load(prev + i) + simd::load(line + i))); },
+				             [&](size_t i) { line[i] = m_last * (m_pole * prev[i] + line[i]); });
+			}
+			for (int k = m_n - 2; k >= 0; --k)
+			{
+				const float* next = data + (k + 1) * stride + begin;
+				float* line = data + k * stride + begin;
+				Lanes(count, [&](size_t i) { simd::store(line + i, z * (simd::load(next + i) - simd::load(line + i))); },
+				             [&](size_t i) { line[i] = m_pole * (next[i] - line[i]); });
+			}
+		}
+
+	private:
+		// vector_op processes simd::width lanes starting at i, scalar_op the remaining ones
+		template<typename V, typename S>
+		static void Lanes(size_t count, const V& vector_op, const S& scalar_op)
+		{
+			size_t i = 0;
+			for (; i + simd::width <= count; i += simd::width)
+			{
+				vector_op(i);
+			}
+			for (; i < count; ++i)
+			{
+				scalar_op(i);
+			}
+		}
+
+		int m_n;
+		float m_pole;
+		float m_gain;
+		float m_last;
+		std::vector<size_t> m_init_index;
+		std::vector<float> m_init_weight;
+	};
+
+	// Lines are filtered in chunks of lanes that keep a whole line set in cache
+	const size_t lane_chunk = 128;
+
+	void AreaAverage(const float* src, int width, int height, int depth, int channels, FloatImage& dst)
+	{
+		const AxisTaps taps_x = AreaTaps(width, dst.width);
+		const AxisTaps taps_y = AreaTaps(height, dst.height);
+		const AxisTaps taps_z = AreaTaps(depth, dst.depth);
+		const size_t src_row = (size_t)width * channels;
+		const size_t dst_row = (size_t)dst.width * channels;
+
+		// every output row combines the source rows it covers and then pairs of texels, source is read once
+		ThreadPool::GetDefault().ParallelFor((size_t)dst.depth * dst.height, [&](size_t index)
+		{
+			const int z = (int)(index / dst.height);
+			const int y = (int)(index % dst.height);
+			std::vector<const float*> rows;
+			std::vector<float> w;
+			for (int kz = 0; kz < taps_z.taps; ++kz)
+			{
+				for (int ky = 0; ky < taps_y.taps; ++ky)
+				{
+					float weight = taps_z.Weights(z)[kz] * taps_y.Weights(y)[ky];
+					if (weight == 0.0f)
+						continue;
+					rows.push_back(src + ((size_t)taps_z.Index(z)[kz] * height + taps_y.Index(y)[ky]) * src_row);
+					w.push_back(weight);
+				}
+			}
+			float* out = dst.data.data() + index * dst_row;
+			if (taps_x.IsIdentity())
+			{
+				CombineRows(rows.data(), w.data(), (int)rows.size(), out, 0, src_row);
+				return;
+			}
+			std::vector<float> combined(src_row);
+			CombineRows(rows.data(), w.data(), (int)rows.size(), combined.data(), 0, src_row);
+			FilterRow(combined.data(), out, channels, taps_x);
+		});
+	}
+
+	// Prefilters along one axis and samples it, src and dst are [outer, n_in or n_out, inner] arrays of floats
+	void BSplineAxis(const float* src, float* dst, size_t outer, size_t inner, const AxisTaps& taps)
+	{
+		const SplinePrefilter prefilter(taps.n_in);
+		const size_t src_block = (size_t)taps.n_in * inner;
+		const size_t dst_block = (size_t)taps.n_out * inner;
+		const size_t chunks = (inner + lane_chunk - 1) / lane_chunk;
+
+		// the prefilter runs on a copy of the chunk, so that src is left intact
+		ThreadPool::GetDefault().ParallelFor(outer * chunks, [&](size_t index)
+		{
+			const size_t o = index / chunks;
+			const size_t begin = (index % chunks) * lane_chunk;
+			const size_t end = std::min(begin + lane_chunk, inner);
+			const size_t count = end - begin;
+			std::vector<float>& lines = Scratch(0, (size_t)taps.n_in * count);
+			for (int i = 0; i < taps.n_in; ++i)
+			{
+				memcpy(lines.data() + i * count, src + o * src_block + i * inner + begin, count * sizeof(float));
+			}
+			prefilter.Filter(lines.data(), count, 0, count);
+			const float* rows[4];
+			for (int j = 0; j < taps.n_out; ++j)
+			{
+				for (int k = 0; k < 4; ++k)
+				{
+					rows[k] = lines.data() + (size_t)taps.Index(j)[k] * count;
+				}
+				CombineRows(rows, taps.Weights(j), 4, dst + o * dst_block + j * inner + begin, 0, count);
+			}
+		});
+	}
+
+	// Axes are processed one after another: a tensor product spline is prefiltered and sampled separately along each axis,
+	// and sampling x first leaves half of the data for the other axes
+	void BSpline(const float* src, int width, int height, int depth, int channels, FloatImage& dst)
+	{
+		const bool resize_x = width != dst.width;
+		const bool resize_y = height != dst.height;
+		const bool resize_z = depth != dst.depth;
+		if (!resize_x && !resize_y && !resize_z)
+		{
+			memcpy(dst.data.data(), src, dst.data.size() * sizeof(float));
+			return;
+		}
+
+		// the last pass writes to dst directly
+		const float* current = src;
+		FloatImage rows;
+		if (resize_x)
+		{
+			float* target = dst.data.data();
+			if (resize_y || resize_z)
+			{
+				rows = FloatImage(dst.width, height, depth, channels);
+				target = rows.data.data();
+			}
+			const AxisTaps taps_x = BSplineTaps(width, dst.width);
+			const SplinePrefilter prefilter(width);
+			const size_t src_row = (size_t)width * channels;
+			const size_t dst_row = (size_t)dst.width * channels;
+			const size_t row_count = (size_t)height * depth;
+			// A row alone is a chain of dependent operations. Groups of rows are transposed to [x, row, channel],
+			// so that the recursion runs over rows * channels lanes at once
+			const size_t group = 8;
+			ThreadPool::GetDefault().ParallelFor((row_count + group - 1) / group, [&](size_t index)
+			{
+				const size_t y_begin = index * group;
+				const size_t rows_in_group = std::min(group, row_count - y_begin);
+				const size_t lanes = rows_in_group * channels;
+				std::vector<float>& lines = Scratch(0, (size_t)width * lanes);
+				for (size_t r = 0; r < rows_in_group; ++r)
+				{
+					const float* s = src + (y_begin + r) * src_row;
+					for (int x = 0; x < width; ++x)
+					{
+						CopyTexel(lines.data() + x * lanes + r * channels, s + (size_t)x * channels, channels);
+					}
+				}
+				prefilter.Filter(lines.data(), lanes, 0, lanes);
+				std::vector<float>& texels = Scratch(1, lanes);
+				const float* columns[4];
+				for (int j = 0; j < dst.width; ++j)
+				{
+					for (int k = 0; k < 4; ++k)
+					{
+						columns[k] = lines.data() + (size_t)taps_x.Index(j)[k] * lanes;
+					}
+					CombineRows(columns, taps_x.Weights(j), 4, texels.data(), 0, lanes);
+					for (size_t r = 0; r < rows_in_group; ++r)
+					{
+						CopyTexel(target + (y_begin + r) * dst_row + (size_t)j * channels, texels.data() + r * channels, channels);
+					}
+				}
+			});
+			current = target;
+		}
+
+		const size_t row = (size_t)dst.width * channels;
+		FloatImage planes;
+		if (resize_y)
+		{
+			float* target = dst.data.data();
+			if (resize_z)
+			{
+				planes = FloatImage(dst.width, dst.height, depth, channels);
+				target = planes.data.data();
+			}
+			BSplineAxis(current, target, depth, row, BSplineTaps(height, dst.height));
+			current = target;
+		}
+
+		if (resize_z)
+		{
+			BSplineAxis(current, dst.data.data(), 1, row * dst.height, BSplineTaps(depth, dst.depth));
+		}
+	}
+}
+
+
+DownsampleType ParseDownsampleType(const std::string& type)
+{
+	if (type == "area_average")
+		return DownsampleAreaAverage;
+	if (type == "bspline")
+		return DownsampleBSpline;
+	throw runtime_error("Unknown downscaling algorithm %s", type.c_str());
+}
+
+void Downsample2x(const float* src, int width, int height, int depth, int channels, DownsampleType type, FloatImage& dst)
+{
+	if (width <= 0 || height <= 0 || depth <= 0 || channels <= 0)
+	{
+		throw runtime_error("Image size has to be positive, got %dx%dx%d with %d channels", width, height, depth, channels);
+	}
+	dst = FloatImage(DownsampledSize(width), DownsampledSize(height), DownsampledSize(depth), channels);
+	switch (type)
+	{
+		case DownsampleAreaAverage: AreaAverage(src, width, height, depth, channels, dst); break;
+		case DownsampleBSpline: BSpline(src, width, height, depth, channels, dst); break;
+	}
+}
+
+pvrtexture::CPVRTexture* Downsample2xTexture(const pvrtexture::CPVRTexture& texture, DownsampleType type)
+{
+	if (!IsRGBAReadable(texture))
+	{
+		throw runtime_error("Only uncompressed formats with equal channel sizes of 8, 16 or 32 bits are supported");
+	}
+	// identity transfer, stored values are filtered as they are
+	SurfaceCodec codec(texture.getHeader(), ePVRTCSpacelRGB, 1.0f);
+
+	pvrtexture::CPVRTextureHeader header(texture.getHeader());
+	header.setWidth(DownsampledSize(texture.getWidth()));
+	header.setHeight(DownsampledSize(texture.getHeight()));
+	header.setDepth(DownsampledSize(texture.getDepth()));
+	header.setNumMIPLevels(1);
+	std::unique_ptr<pvrtexture::CPVRTexture> result(new pvrtexture::CPVRTexture(header));
+	CountAllocatedBytes(result->getDataSize());
+
+	for (uint32_t array = 0; array < result->getNumArrayMembers(); ++array)
+	{
+		for (uint32_t face = 0; face < result->getNumFaces(); ++face)
+		{
+			FloatImage level = codec.Read(texture, 0, array, face);
+			FloatImage downsampled;
+			Downsample2x(level.data.data(), level.width, level.height, level.depth, level.channels, type, downsampled);
+			codec.Write(downsampled, *result, 0, array, face);
+		}
+	}
+	return result.release();
+}
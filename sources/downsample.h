@@ -0,0 +1,44 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+#pragma once
+#include "surface.h"
+
+#include <PVRTexture.h>
+
+#include <string>
+
+
+// Native versions of the algorithms of texture_tool.downsample2x. Every dimension n becomes n / 2 rounded down,
+// but at least 1, odd sizes included. Channels stay interleaved and are filtered together.
+//   area_average - each output texel is the average of the n / (n / 2) source texels it covers, partially covered
+//                  texels count with their coverage. For even sizes that is the mean of 2x2(x2) blocks.
+//   bspline      - cubic B-spline interpolation, like scipy.ndimage.spline_filter followed by zoom_shift with
+//                  mirror mode: output o samples the spline at o * (n - 1) / (n / 2 - 1), corners are aligned.
+// Computation is done in float32, values are not gamma corrected.
+
+enum DownsampleType
+{
+	DownsampleAreaAverage,
+	DownsampleBSpline
+};
+
+DownsampleType ParseDownsampleType(const std::string& type);
+
+// src holds width * height * depth texels of channels interleaved values, dst gets the downsampled image
+void Downsample2x(const float* src, int width, int height, int depth, int channels, DownsampleType type, FloatImage& dst);
+
+// Downsamples the top mip level of every array member and face into a new texture with a single mip level.
+// Uncompressed formats with equal channel sizes only, stored values are filtered as they are
+pvrtexture::CPVRTexture* Downsample2xTexture(const pvrtexture::CPVRTexture& texture, DownsampleType type);
@@ -21,6 +21,7 @@
 //SOFTWARE.
 
 #pragma once
+#include <cmath>
 
 struct double2 {
 	double x,y;
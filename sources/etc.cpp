@@ -0,0 +1,1316 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#include "etc.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+
+
+namespace
+{
+	// Intensity modifiers of ETC1 subblocks, pixel indices 0 to 3 select +a, +b, -a and -b
+	const int ETC1Modifiers[8][2] = {{2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183}};
+
+	// Distances of the paint colours of ETC2 T and H modes
+	const int ETC2Distances[8] = {3, 6, 11, 16, 23, 32, 41, 64};
+
+	const int EACModifiers[16][8] = {
+			{-3, -6, -9, -15, 2, 5, 8, 14},
+			{-3, -7, -10, -13, 2, 6, 9, 12},
+			{-2, -5, -8, -13, 1, 4, 7, 12},
+			{-2, -4, -6, -13, 1, 3, 5, 12},
+			{-3, -6, -8, -12, 2, 5, 7, 11},
+			{-3, -7, -9, -11, 2, 6, 8, 10},
+			{-4, -7, -8, -11, 3, 6, 7, 10},
+			{-3, -5, -8, -11, 2, 4, 7, 10},
+			{-2, -6, -8, -10, 1, 5, 7, 9},
+			{-2, -5, -8, -10, 1, 4, 7, 9},
+			{-2, -4, -8, -10, 1, 3, 7, 9},
+			{-2, -5, -7, -10, 1, 4, 6, 9},
+			{-3, -4, -7, -10, 2, 3, 6, 9},
+			{-1, -2, -3, -10, 0, 1, 2, 9},
+			{-4, -6, -8, -9, 3, 5, 7, 8},
+			{-3, -5, -7, -9, 2, 4, 6, 8},
+	};
+
+	// Bits of T, H and planar blocks that hold no data. They are set so that the differential mode fields overflow
+	// in red for T mode, in green for H mode and in blue for planar mode
+	const uint64_t TFreeBits = 0xE400000000000000ull;
+	const uint64_t HFreeBits = 0x80E4000000000000ull;
+	const uint64_t PlanarFreeBits = 0x8080E40000000000ull;
+
+	struct Search
+	{
+		// passes that move base colours to the mean of texels without their modifiers
+		int refine;
+		// quantized colours next to the best ones are tried with modifier tables and distances within this radius
+		// of the best ones, 0 skips them
+		int neighbours;
+		bool t_h_modes;
+		// squared error of a block, in [0, 255] units, below which no further modes are tried
+		float threshold;
+	};
+
+	Search GetSearch(pvrtexture::ECompressorQuality quality)
+	{
+		switch (quality)
+		{
+			case pvrtexture::ePVRTCFastest: return {0, 0, false, 16 * 3 * 36.0f};
+			case pvrtexture::ePVRTCFast: return {1, 0, false, 16 * 3 * 16.0f};
+			case pvrtexture::ePVRTCHigh: return {2, 1, true, 16 * 3 * 1.0f};
+			case pvrtexture::ePVRTCBest: return {4, 7, true, 0.0f};
+			default: return {2, 0, true, 16 * 3 * 4.0f};
+		}
+	}
+
+	enum ColourFormat
+	{
+		FormatETC1,
+		FormatETC2,
+		// the differential bit is the opaque flag, individual mode is not available
+		FormatETC2PunchThrough
+	};
+
+	// Colour texels of a block or a subblock in SoA layout, scaled to [0, 255]. Texels of a block are in the order of
+	// ETC pixel indices, column by column. Texels with zero weight are transparent, they take pixel index 2 and
+	// do not contribute to the error. Subblocks have 8 texels, the rest have zero weight
+	struct ColourBlock
+	{
+		float r[16];
+		float g[16];
+		float b[16];
+		float w[16];
+	};
+
+	// Four colours, entries that are not available are only taken by transparent texels
+	struct Palette
+	{
+		float colour[4][3];
+		bool available[4];
+	};
+
+	struct SubblockEncoding
+	{
+		int base[3];
+		int table;
+		int indices[16];
+		float error;
+	};
+
+	// Two 4 bit colours and a distance of T and H modes
+	struct PaintEncoding
+	{
+		int colours[2][3];
+		int distance;
+		int indices[16];
+		float error;
+	};
+
+	struct BlockEncoding
+	{
+		uint64_t bits;
+		float error;
+	};
+
+	inline float To255(float x)
+	{
+		return std::min(std::max(x, 0.0f), 1.0f) * 255.0f;
+	}
+
+	inline int Clamp255(int x)
+	{
+		return std::min(std::max(x, 0), 255);
+	}
+
+	inline int Quantize(float x, int bits)
+	{
+		const int max = (1 << bits) - 1;
+		int v = (int)(x * max / 255.0f + 0.5f);
+		return std::min(std::max(v, 0), max);
+	}
+
+	inline int Expand(int x, int bits)
+	{
+		return (x << (8 - bits)) | (x >> (2 * bits - 8));
+	}
+
+	inline int SignExtend3(int x)
+	{
+		return x >= 4 ? x - 8 : x;
+	}
+
+	uint64_t LoadBigEndian(const uint8_t* block)
+	{
+		uint64_t bits = 0;
+		for (int i = 0; i < 8; ++i)
+		{
+			bits = (bits << 8u) | block[i];
+		}
+		return bits;
+	}
+
+	void StoreBigEndian(uint64_t bits, uint8_t* block)
+	{
+		for (int i = 7; i >= 0; --i)
+		{
+			block[i] = (uint8_t)bits;
+			bits >>= 8u;
+		}
+	}
+
+	// Most significant bits of the 2 bit pixel indices are in bits 16 to 31, least significant in bits 0 to 15
+	uint64_t PackIndices(const int* indices)
+	{
+		uint64_t bits = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			bits |= (uint64_t)(indices[i] >> 1) << (16u + i) | (uint64_t)(indices[i] & 1) << (uint64_t)i;
+		}
+		return bits;
+	}
+
+	inline int GetIndex(uint64_t bits, int i)
+	{
+		return (int)(((bits >> (16u + i)) & 1u) << 1u | ((bits >> (uint64_t)i) & 1u));
+	}
+
+	// Channel whose differential mode base and delta overflow 5 bits, 3 if none does
+	int GetOverflowChannel(uint64_t bits)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			int base = (int)(bits >> (59u - 8 * c)) & 31;
+			int value = base + SignExtend3((int)(bits >> (56u - 8 * c)) & 7);
+			if (value < 0 || value > 31)
+			{
+				return c;
+			}
+		}
+		return 3;
+	}
+
+	uint64_t SetFreeBits(uint64_t bits, uint64_t free, int overflow_channel)
+	{
+		// enumerates all subsets of the free bits, there is always one that selects the mode
+		uint64_t subset = 0;
+		do
+		{
+			uint64_t candidate = (bits & ~free) | subset;
+			if (GetOverflowChannel(candidate) == overflow_channel)
+			{
+				return candidate;
+			}
+			subset = (subset - free) & free;
+		}
+		while (subset != 0);
+		return bits;
+	}
+
+	// Picks the closest available palette entry for count texels, transparent texels take entry 2.
+	// Returns the total squared error
+	float SelectIndices(const ColourBlock& block, int count, const Palette& palette, int* indices)
+	{
+		using namespace simd;
+		float error = 0.0f;
+		for (int i = 0; i < count; i += width)
+		{
+			const vfloat r = load(block.r + i);
+			const vfloat g = load(block.g + i);
+			const vfloat b = load(block.b + i);
+			vfloat best = set1(FLT_MAX);
+			vfloat index = set1(2.0f);
+			for (int k = 0; k < 4; ++k)
+			{
+				if (!palette.available[k])
+				{
+					continue;
+				}
+				const vfloat dr = r - set1(palette.colour[k][0]);
+				const vfloat dg = g - set1(palette.colour[k][1]);
+				const vfloat db = b - set1(palette.colour[k][2]);
+				const vfloat d = dr * dr + dg * dg + db * db;
+				const vmask closer = d < best;
+				best = select(closer, d, best);
+				index = select(closer, set1((float)k), index);
+			}
+			store(indices + i, index);
+			error += reduce_add(best * load(block.w + i));
+		}
+		for (int i = 0; i < count; ++i)
+		{
+			if (block.w[i] == 0.0f)
+			{
+				indices[i] = 2;
+			}
+		}
+		return error;
+	}
+
+	void LoadColourBlock(const float* rgba, bool punch_through, ColourBlock& block)
+	{
+		for (int y = 0; y < 4; ++y)
+		{
+			for (int x = 0; x < 4; ++x)
+			{
+				const float* texel = rgba + 4 * (y * 4 + x);
+				const int i = x * 4 + y;
+				block.r[i] = To255(texel[0]);
+				block.g[i] = To255(texel[1]);
+				block.b[i] = To255(texel[2]);
+				block.w[i] = punch_through && texel[3] < 0.5f ? 0.0f : 1.0f;
+			}
+		}
+	}
+
+	// Subblocks are the left and right halves of the block, or the top and bottom halves if flipped
+	void GetSubblock(const ColourBlock& block, bool flip, int subblock, ColourBlock& result, int* texels)
+	{
+		memset(&result, 0, sizeof(result));
+		for (int k = 0; k < 8; ++k)
+		{
+			const int i = flip ? (k / 2) * 4 + k % 2 + 2 * subblock : k + 8 * subblock;
+			texels[k] = i;
+			result.r[k] = block.r[i];
+			result.g[k] = block.g[i];
+			result.b[k] = block.b[i];
+			result.w[k] = block.w[i];
+		}
+	}
+
+	// Without the opaque flag of punch-through blocks, the +a modifier is zero and index 2 is transparent
+	inline int GetModifier(int table, int index, bool opaque)
+	{
+		const int a = ETC1Modifiers[table][0];
+		const int b = ETC1Modifiers[table][1];
+		switch (index)
+		{
+			case 0: return opaque ? a : 0;
+			case 1: return b;
+			case 2: return -a;
+			default: return -b;
+		}
+	}
+
+	bool TrySubblockBase(const ColourBlock& subblock, const int* base, int bits, bool opaque, SubblockEncoding& best,
+	                     int first_table = 0, int last_table = 7)
+	{
+		bool improved = false;
+		Palette palette;
+		int indices[16];
+		for (int table = std::max(first_table, 0); table <= std::min(last_table, 7); ++table)
+		{
+			for (int k = 0; k < 4; ++k)
+			{
+				const int modifier = GetModifier(table, k, opaque);
+				for (int c = 0; c < 3; ++c)
+				{
+					palette.colour[k][c] = (float)Clamp255(Expand(base[c], bits) + modifier);
+				}
+				palette.available[k] = opaque || k != 2;
+			}
+			float error = SelectIndices(subblock, 8, palette, indices);
+			if (error < best.error)
+			{
+				memcpy(best.base, base, sizeof(best.base));
+				memcpy(best.indices, indices, sizeof(best.indices));
+				best.table = table;
+				best.error = error;
+				improved = true;
+			}
+		}
+		return improved;
+	}
+
+	// Base colour that minimizes the error of the current pixel indices, ignoring clamping. Returns false if it is unchanged
+	bool RefineSubblockBase(const ColourBlock& subblock, const SubblockEncoding& encoding, int bits, bool opaque, int* base)
+	{
+		float sum[3] = {0.0f, 0.0f, 0.0f};
+		float weight = 0.0f;
+		for (int i = 0; i < 8; ++i)
+		{
+			if (subblock.w[i] == 0.0f)
+			{
+				continue;
+			}
+			const float modifier = (float)GetModifier(encoding.table, encoding.indices[i], opaque);
+			sum[0] += subblock.r[i] - modifier;
+			sum[1] += subblock.g[i] - modifier;
+			sum[2] += subblock.b[i] - modifier;
+			weight += 1.0f;
+		}
+		if (weight == 0.0f)
+		{
+			return false;
+		}
+		bool changed = false;
+		for (int c = 0; c < 3; ++c)
+		{
+			base[c] = Quantize(sum[c] / weight, bits);
+			changed = changed || base[c] != encoding.base[c];
+		}
+		return changed;
+	}
+
+	void EncodeSubblock(const ColourBlock& subblock, int bits, bool opaque, const Search& search, SubblockEncoding& best)
+	{
+		best.error = FLT_MAX;
+		float sum[3] = {0.0f, 0.0f, 0.0f};
+		float weight = 0.0f;
+		for (int i = 0; i < 8; ++i)
+		{
+			sum[0] += subblock.r[i] * subblock.w[i];
+			sum[1] += subblock.g[i] * subblock.w[i];
+			sum[2] += subblock.b[i] * subblock.w[i];
+			weight += subblock.w[i];
+		}
+		int base[3];
+		for (int c = 0; c < 3; ++c)
+		{
+			base[c] = weight > 0.0f ? Quantize(sum[c] / weight, bits) : 0;
+		}
+		TrySubblockBase(subblock, base, bits, opaque, best);
+		for (int pass = 0; pass < search.refine; ++pass)
+		{
+			if (!RefineSubblockBase(subblock, best, bits, opaque, base) || !TrySubblockBase(subblock, base, bits, opaque, best))
+			{
+				break;
+			}
+		}
+		if (search.neighbours > 0)
+		{
+			const int max = (1 << bits) - 1;
+			const int table = best.table;
+			int centre[3];
+			memcpy(centre, best.base, sizeof(centre));
+			for (int d = 0; d < 27; ++d)
+			{
+				if (d == 13)
+				{
+					continue;
+				}
+				base[0] = std::min(std::max(centre[0] + d % 3 - 1, 0), max);
+				base[1] = std::min(std::max(centre[1] + (d / 3) % 3 - 1, 0), max);
+				base[2] = std::min(std::max(centre[2] + d / 9 - 1, 0), max);
+				TrySubblockBase(subblock, base, bits, opaque, best, table - search.neighbours, table + search.neighbours);
+			}
+		}
+	}
+
+	// flag is the differential bit, or the opaque flag of punch-through blocks
+	uint64_t PackSubblocks(const SubblockEncoding* encodings, const int texels[2][8], bool differential, bool flip, bool flag)
+	{
+		uint64_t bits = 0;
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			if (differential)
+			{
+				bits |= (uint64_t)encodings[0].base[c] << (59u - 8 * c);
+				bits |= (uint64_t)((encodings[1].base[c] - encodings[0].base[c]) & 7) << (56u - 8 * c);
+			}
+			else
+			{
+				bits |= (uint64_t)encodings[0].base[c] << (60u - 8 * c);
+				bits |= (uint64_t)encodings[1].base[c] << (56u - 8 * c);
+			}
+		}
+		bits |= (uint64_t)encodings[0].table << 37u | (uint64_t)encodings[1].table << 34u;
+		bits |= (uint64_t)flag << 33u | (uint64_t)flip << 32u;
+		int indices[16];
+		for (int s = 0; s < 2; ++s)
+		{
+			for (int k = 0; k < 8; ++k)
+			{
+				indices[texels[s][k]] = encodings[s].indices[k];
+			}
+		}
+		return bits | PackIndices(indices);
+	}
+
+	inline bool FitsDelta(const int* base0, const int* base1)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			int delta = base1[c] - base0[c];
+			if (delta < -4 || delta > 3)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Individual and differential modes with both orientations
+	void TryETC1Modes(const ColourBlock& block, const Search& search, bool punch_through, bool opaque, BlockEncoding& best)
+	{
+		for (int flip = 0; flip < 2; ++flip)
+		{
+			ColourBlock subblocks[2];
+			int texels[2][8];
+			GetSubblock(block, flip != 0, 0, subblocks[0], texels[0]);
+			GetSubblock(block, flip != 0, 1, subblocks[1], texels[1]);
+
+			if (!punch_through)
+			{
+				SubblockEncoding individual[2];
+				EncodeSubblock(subblocks[0], 4, true, search, individual[0]);
+				EncodeSubblock(subblocks[1], 4, true, search, individual[1]);
+				if (individual[0].error + individual[1].error < best.error)
+				{
+					best.bits = PackSubblocks(individual, texels, false, flip != 0, false);
+					best.error = individual[0].error + individual[1].error;
+				}
+			}
+
+			SubblockEncoding differential[2];
+			EncodeSubblock(subblocks[0], 5, opaque, search, differential[0]);
+			EncodeSubblock(subblocks[1], 5, opaque, search, differential[1]);
+			if (FitsDelta(differential[0].base, differential[1].base))
+			{
+				if (differential[0].error + differential[1].error < best.error)
+				{
+					best.bits = PackSubblocks(differential, texels, true, flip != 0, punch_through ? opaque : true);
+					best.error = differential[0].error + differential[1].error;
+				}
+				continue;
+			}
+			// base colours too far apart, one of them is kept and the other is moved into the range of deltas
+			for (int fixed = 0; fixed < 2; ++fixed)
+			{
+				SubblockEncoding constrained[2];
+				constrained[fixed] = differential[fixed];
+				const int other = 1 - fixed;
+				int base[3];
+				for (int c = 0; c < 3; ++c)
+				{
+					int lo = fixed == 0 ? differential[0].base[c] - 4 : differential[1].base[c] - 3;
+					base[c] = std::min(std::max(differential[other].base[c], std::max(lo, 0)), std::min(lo + 7, 31));
+				}
+				constrained[other].error = FLT_MAX;
+				TrySubblockBase(subblocks[other], base, 5, opaque, constrained[other]);
+				if (constrained[0].error + constrained[1].error < best.error)
+				{
+					best.bits = PackSubblocks(constrained, texels, true, flip != 0, punch_through ? opaque : true);
+					best.error = constrained[0].error + constrained[1].error;
+				}
+			}
+		}
+	}
+
+	// Error of one channel of a planar block, O + x (H - O) / 4 + y (V - O) / 4
+	float GetPlanarError(const float* values, int o, int h, int v, int bits)
+	{
+		o = Expand(o, bits);
+		h = Expand(h, bits);
+		v = Expand(v, bits);
+		float error = 0.0f;
+		for (int x = 0; x < 4; ++x)
+		{
+			for (int y = 0; y < 4; ++y)
+			{
+				float d = values[x * 4 + y] - (float)Clamp255((x * (h - o) + y * (v - o) + 4 * o + 2) >> 2);
+				error += d * d;
+			}
+		}
+		return error;
+	}
+
+	// Channels of planar blocks are independent, each one is a least squares fit of a plane
+	void TryPlanarMode(const ColourBlock& block, const Search& search, bool flag, BlockEncoding& best)
+	{
+		const float* channels[3] = {block.r, block.g, block.b};
+		const int bits[3] = {6, 7, 6};
+		int o[3];
+		int h[3];
+		int v[3];
+		float error = 0.0f;
+		for (int c = 0; c < 3; ++c)
+		{
+			const float* values = channels[c];
+			float mean = 0.0f;
+			float sx = 0.0f;
+			float sy = 0.0f;
+			for (int x = 0; x < 4; ++x)
+			{
+				for (int y = 0; y < 4; ++y)
+				{
+					const float value = values[x * 4 + y];
+					mean += value;
+					sx += (x - 1.5f) * value;
+					sy += (y - 1.5f) * value;
+				}
+			}
+			mean /= 16.0f;
+			// sum of (x - 1.5)^2 over the block is 20
+			const float gx = sx / 20.0f;
+			const float gy = sy / 20.0f;
+			const float fo = mean - 1.5f * (gx + gy);
+			o[c] = Quantize(fo, bits[c]);
+			h[c] = Quantize(fo + 4.0f * gx, bits[c]);
+			v[c] = Quantize(fo + 4.0f * gy, bits[c]);
+			float channel_error = GetPlanarError(values, o[c], h[c], v[c], bits[c]);
+			if (search.neighbours > 0)
+			{
+				const int max = (1 << bits[c]) - 1;
+				const int centre[3] = {o[c], h[c], v[c]};
+				for (int d = 0; d < 27; ++d)
+				{
+					int co = std::min(std::max(centre[0] + d % 3 - 1, 0), max);
+					int ch = std::min(std::max(centre[1] + (d / 3) % 3 - 1, 0), max);
+					int cv = std::min(std::max(centre[2] + d / 9 - 1, 0), max);
+					float e = GetPlanarError(values, co, ch, cv, bits[c]);
+					if (e < channel_error)
+					{
+						channel_error = e;
+						o[c] = co;
+						h[c] = ch;
+						v[c] = cv;
+					}
+				}
+			}
+			error += channel_error;
+		}
+		if (error >= best.error)
+		{
+			return;
+		}
+		uint64_t packed = (uint64_t)o[0] << 57u;
+		packed |= (uint64_t)(o[1] >> 6) << 56u | (uint64_t)(o[1] & 63) << 49u;
+		packed |= (uint64_t)(o[2] >> 5) << 48u | (uint64_t)((o[2] >> 3) & 3) << 43u | (uint64_t)(o[2] & 7) << 39u;
+		packed |= (uint64_t)(h[0] >> 1) << 34u | (uint64_t)flag << 33u | (uint64_t)(h[0] & 1) << 32u;
+		packed |= (uint64_t)h[1] << 25u | (uint64_t)h[2] << 19u;
+		packed |= (uint64_t)v[0] << 13u | (uint64_t)v[1] << 6u | (uint64_t)v[2];
+		best.bits = SetFreeBits(packed, PlanarFreeBits, 2);
+		best.error = error;
+	}
+
+	// Splits opaque texels in two by the plane through their mean, orthogonal to the principal axis.
+	// Returns false if there are no texels on one of the sides
+	bool SplitBlock(const ColourBlock& block, float centres[2][3])
+	{
+		const float* channels[3] = {block.r, block.g, block.b};
+		float mean[3] = {0.0f, 0.0f, 0.0f};
+		float weight = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				mean[c] += channels[c][i] * block.w[i];
+			}
+			weight += block.w[i];
+		}
+		if (weight == 0.0f)
+		{
+			return false;
+		}
+		for (int c = 0; c < 3; ++c)
+		{
+			mean[c] /= weight;
+		}
+		float cov[3][3] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					cov[c][k] += (channels[c][i] - mean[c]) * (channels[k][i] - mean[k]) * block.w[i];
+				}
+			}
+		}
+		int largest = 0;
+		for (int c = 1; c < 3; ++c)
+		{
+			largest = cov[c][c] > cov[largest][largest] ? c : largest;
+		}
+		float axis[3] = {cov[largest][0], cov[largest][1], cov[largest][2]};
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[3];
+			for (int c = 0; c < 3; ++c)
+			{
+				next[c] = cov[c][0] * axis[0] + cov[c][1] * axis[1] + cov[c][2] * axis[2];
+			}
+			float norm = std::max(std::max(std::fabs(next[0]), std::fabs(next[1])), std::fabs(next[2]));
+			if (norm < 1e-6f)
+			{
+				return false;
+			}
+			for (int c = 0; c < 3; ++c)
+			{
+				axis[c] = next[c] / norm;
+			}
+		}
+		float sums[2][3] = {};
+		float counts[2] = {0.0f, 0.0f};
+		for (int i = 0; i < 16; ++i)
+		{
+			if (block.w[i] == 0.0f)
+			{
+				continue;
+			}
+			float projection = 0.0f;
+			for (int c = 0; c < 3; ++c)
+			{
+				projection += (channels[c][i] - mean[c]) * axis[c];
+			}
+			const int side = projection < 0.0f ? 0 : 1;
+			for (int c = 0; c < 3; ++c)
+			{
+				sums[side][c] += channels[c][i];
+			}
+			counts[side] += 1.0f;
+		}
+		if (counts[0] == 0.0f || counts[1] == 0.0f)
+		{
+			return false;
+		}
+		for (int side = 0; side < 2; ++side)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				centres[side][c] = sums[side][c] / counts[side];
+			}
+		}
+		return true;
+	}
+
+	// The lowest bit of H mode distances is the order of the colours
+	inline bool IsHOrderValid(const int colours[2][3], int distance)
+	{
+		const int c0 = colours[0][0] << 8 | colours[0][1] << 4 | colours[0][2];
+		const int c1 = colours[1][0] << 8 | colours[1][1] << 4 | colours[1][2];
+		return (c0 >= c1) == ((distance & 1) != 0);
+	}
+
+	// Offset of a paint colour from the 4 bit colour it is derived from. T mode paints the first colour,
+	// the second one, and the second one plus and minus the distance. H mode paints both colours plus and minus the distance
+	inline int GetPaintSource(bool h_mode, int index)
+	{
+		return h_mode ? index / 2 : (index == 0 ? 0 : 1);
+	}
+
+	inline int GetPaintOffset(bool h_mode, int distance, int index)
+	{
+		const int d = ETC2Distances[distance];
+		if (h_mode)
+		{
+			return index % 2 == 0 ? d : -d;
+		}
+		return index == 1 ? d : (index == 3 ? -d : 0);
+	}
+
+	bool TryPaintColours(const ColourBlock& block, bool h_mode, const int colours[2][3], bool opaque, PaintEncoding& best,
+	                     int first_distance = 0, int last_distance = 7)
+	{
+		bool improved = false;
+		for (int distance = std::max(first_distance, 0); distance <= std::min(last_distance, 7); ++distance)
+		{
+			int ordered[2][3];
+			memcpy(ordered, colours, sizeof(ordered));
+			if (h_mode && !IsHOrderValid(ordered, distance))
+			{
+				// swapping colours only swaps pixel indices, it fails for equal colours
+				memcpy(ordered[0], colours[1], sizeof(ordered[0]));
+				memcpy(ordered[1], colours[0], sizeof(ordered[1]));
+				if (!IsHOrderValid(ordered, distance))
+				{
+					continue;
+				}
+			}
+			Palette palette;
+			for (int k = 0; k < 4; ++k)
+			{
+				const int* source = ordered[GetPaintSource(h_mode, k)];
+				const int offset = GetPaintOffset(h_mode, distance, k);
+				for (int c = 0; c < 3; ++c)
+				{
+					palette.colour[k][c] = (float)Clamp255(Expand(source[c], 4) + offset);
+				}
+				palette.available[k] = opaque || k != 2;
+			}
+			int indices[16];
+			float error = SelectIndices(block, 16, palette, indices);
+			if (error < best.error)
+			{
+				memcpy(best.colours, ordered, sizeof(best.colours));
+				memcpy(best.indices, indices, sizeof(best.indices));
+				best.distance = distance;
+				best.error = error;
+				improved = true;
+			}
+		}
+		return improved;
+	}
+
+	// Colours that minimize the error of the current pixel indices, ignoring clamping. Returns false if they are unchanged
+	bool RefinePaintColours(const ColourBlock& block, bool h_mode, const PaintEncoding& encoding, int colours[2][3])
+	{
+		float sums[2][3] = {};
+		float counts[2] = {0.0f, 0.0f};
+		for (int i = 0; i < 16; ++i)
+		{
+			if (block.w[i] == 0.0f)
+			{
+				continue;
+			}
+			const int index = encoding.indices[i];
+			const int source = GetPaintSource(h_mode, index);
+			const float offset = (float)GetPaintOffset(h_mode, encoding.distance, index);
+			sums[source][0] += block.r[i] - offset;
+			sums[source][1] += block.g[i] - offset;
+			sums[source][2] += block.b[i] - offset;
+			counts[source] += 1.0f;
+		}
+		bool changed = false;
+		for (int j = 0; j < 2; ++j)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				colours[j][c] = counts[j] > 0.0f ? Quantize(sums[j][c] / counts[j], 4) : encoding.colours[j][c];
+				changed = changed || colours[j][c] != encoding.colours[j][c];
+			}
+		}
+		return changed;
+	}
+
+	uint64_t PackPaintColours(const PaintEncoding& encoding, bool h_mode, bool flag)
+	{
+		const int (*c)[3] = encoding.colours;
+		const uint64_t d = encoding.distance;
+		uint64_t bits = 0;
+		if (h_mode)
+		{
+			bits |= (uint64_t)c[0][0] << 59u;
+			bits |= (uint64_t)(c[0][1] >> 1) << 56u | (uint64_t)(c[0][1] & 1) << 52u;
+			bits |= (uint64_t)(c[0][2] >> 3) << 51u | (uint64_t)(c[0][2] & 7) << 47u;
+			bits |= (uint64_t)c[1][0] << 43u | (uint64_t)c[1][1] << 39u | (uint64_t)c[1][2] << 35u;
+			bits |= (d >> 2u) << 34u | (uint64_t)flag << 33u | ((d >> 1u) & 1u) << 32u;
+			return SetFreeBits(bits | PackIndices(encoding.indices), HFreeBits, 1);
+		}
+		bits |= (uint64_t)(c[0][0] >> 2) << 59u | (uint64_t)(c[0][0] & 3) << 56u;
+		bits |= (uint64_t)c[0][1] << 52u | (uint64_t)c[0][2] << 48u;
+		bits |= (uint64_t)c[1][0] << 44u | (uint64_t)c[1][1] << 40u | (uint64_t)c[1][2] << 36u;
+		bits |= (d >> 1u) << 34u | (uint64_t)flag << 33u | (d & 1u) << 32u;
+		return SetFreeBits(bits | PackIndices(encoding.indices), TFreeBits, 0);
+	}
+
+	void TryPaintMode(const ColourBlock& block, bool h_mode, const float centres[2][3], const Search& search, bool punch_through,
+	                  bool opaque, BlockEncoding& best)
+	{
+		PaintEncoding encoding;
+		encoding.error = FLT_MAX;
+		int colours[2][3];
+		// either side of the split can be the single colour of T mode
+		for (int order = 0; order < (h_mode ? 1 : 2); ++order)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				colours[0][c] = Quantize(centres[order][c], 4);
+				colours[1][c] = Quantize(centres[1 - order][c], 4);
+			}
+			TryPaintColours(block, h_mode, colours, opaque, encoding);
+		}
+		if (encoding.error == FLT_MAX)
+		{
+			return;
+		}
+		for (int pass = 0; pass < std::max(search.refine, 1); ++pass)
+		{
+			if (!RefinePaintColours(block, h_mode, encoding, colours) || !TryPaintColours(block, h_mode, colours, opaque, encoding))
+			{
+				break;
+			}
+		}
+		if (search.neighbours > 0)
+		{
+			const int distance = encoding.distance;
+			for (int j = 0; j < 2; ++j)
+			{
+				int centre[2][3];
+				memcpy(centre, encoding.colours, sizeof(centre));
+				for (int d = 0; d < 27; ++d)
+				{
+					if (d == 13)
+					{
+						continue;
+					}
+					memcpy(colours, centre, sizeof(colours));
+					colours[j][0] = std::min(std::max(centre[j][0] + d % 3 - 1, 0), 15);
+					colours[j][1] = std::min(std::max(centre[j][1] + (d / 3) % 3 - 1, 0), 15);
+					colours[j][2] = std::min(std::max(centre[j][2] + d / 9 - 1, 0), 15);
+					TryPaintColours(block, h_mode, colours, opaque, encoding, distance - search.neighbours, distance + search.neighbours);
+				}
+			}
+		}
+		if (encoding.error < best.error)
+		{
+			best.bits = PackPaintColours(encoding, h_mode, punch_through ? opaque : true);
+			best.error = encoding.error;
+		}
+	}
+
+	uint64_t EncodeColour(const ColourBlock& block, ColourFormat format, const Search& search)
+	{
+		const bool punch_through = format == FormatETC2PunchThrough;
+		bool opaque = true;
+		for (int i = 0; i < 16; ++i)
+		{
+			opaque = opaque && block.w[i] != 0.0f;
+		}
+
+		BlockEncoding best = {0, FLT_MAX};
+		TryETC1Modes(block, search, punch_through, opaque, best);
+		if (format == FormatETC1 || best.error <= search.threshold)
+		{
+			return best.bits;
+		}
+		// planar blocks are always opaque
+		if (opaque)
+		{
+			TryPlanarMode(block, search, true, best);
+			if (best.error <= search.threshold)
+			{
+				return best.bits;
+			}
+		}
+		float centres[2][3];
+		if (search.t_h_modes && SplitBlock(block, centres))
+		{
+			TryPaintMode(block, false, centres, search, punch_through, opaque, best);
+			if (best.error > search.threshold)
+			{
+				TryPaintMode(block, true, centres, search, punch_through, opaque, best);
+			}
+		}
+		return best.bits;
+	}
+
+	void DecodeColour(uint64_t bits, bool punch_through, uint8_t* rgba)
+	{
+		const bool flag = ((bits >> 33u) & 1u) != 0;
+		const bool opaque = !punch_through || flag;
+		int colours[16][3];
+		bool transparent[16] = {};
+
+		const int mode = !punch_through && !flag ? 4 : GetOverflowChannel(bits);
+		if (mode == 0 || mode == 1)
+		{
+			const bool h_mode = mode == 1;
+			PaintEncoding encoding;
+			int (*c)[3] = encoding.colours;
+			if (h_mode)
+			{
+				c[0][0] = (int)(bits >> 59u) & 15;
+				c[0][1] = (int)((bits >> 56u) & 7) << 1 | (int)((bits >> 52u) & 1);
+				c[0][2] = (int)((bits >> 51u) & 1) << 3 | (int)((bits >> 47u) & 7);
+				c[1][0] = (int)(bits >> 43u) & 15;
+				c[1][1] = (int)(bits >> 39u) & 15;
+				c[1][2] = (int)(bits >> 35u) & 15;
+				encoding.distance = (int)((bits >> 34u) & 1) << 2 | (int)((bits >> 32u) & 1) << 1;
+				const int c0 = c[0][0] << 8 | c[0][1] << 4 | c[0][2];
+				const int c1 = c[1][0] << 8 | c[1][1] << 4 | c[1][2];
+				encoding.distance |= c0 >= c1 ? 1 : 0;
+			}
+			else
+			{
+				c[0][0] = (int)((bits >> 59u) & 3) << 2 | (int)((bits >> 56u) & 3);
+				c[0][1] = (int)(bits >> 52u) & 15;
+				c[0][2] = (int)(bits >> 48u) & 15;
+				c[1][0] = (int)(bits >> 44u) & 15;
+				c[1][1] = (int)(bits >> 40u) & 15;
+				c[1][2] = (int)(bits >> 36u) & 15;
+				encoding.distance = (int)((bits >> 34u) & 3) << 1 | (int)((bits >> 32u) & 1);
+			}
+			for (int i = 0; i < 16; ++i)
+			{
+				const int index = GetIndex(bits, i);
+				transparent[i] = !opaque && index == 2;
+				const int* source = c[GetPaintSource(h_mode, index)];
+				const int offset = GetPaintOffset(h_mode, encoding.distance, index);
+				for (int k = 0; k < 3; ++k)
+				{
+					colours[i][k] = Clamp255(Expand(source[k], 4) + offset);
+				}
+			}
+		}
+		else if (mode == 2)
+		{
+			const int bit_counts[3] = {6, 7, 6};
+			int o[3];
+			int h[3];
+			int v[3];
+			o[0] = (int)(bits >> 57u) & 63;
+			o[1] = (int)((bits >> 56u) & 1) << 6 | (int)((bits >> 49u) & 63);
+			o[2] = (int)((bits >> 48u) & 1) << 5 | (int)((bits >> 43u) & 3) << 3 | (int)((bits >> 39u) & 7);
+			h[0] = (int)((bits >> 34u) & 31) << 1 | (int)((bits >> 32u) & 1);
+			h[1] = (int)(bits >> 25u) & 127;
+			h[2] = (int)(bits >> 19u) & 63;
+			v[0] = (int)(bits >> 13u) & 63;
+			v[1] = (int)(bits >> 6u) & 127;
+			v[2] = (int)bits & 63;
+			for (int k = 0; k < 3; ++k)
+			{
+				o[k] = Expand(o[k], bit_counts[k]);
+				h[k] = Expand(h[k], bit_counts[k]);
+				v[k] = Expand(v[k], bit_counts[k]);
+			}
+			for (int x = 0; x < 4; ++x)
+			{
+				for (int y = 0; y < 4; ++y)
+				{
+					for (int k = 0; k < 3; ++k)
+					{
+						colours[x * 4 + y][k] = Clamp255((x * (h[k] - o[k]) + y * (v[k] - o[k]) + 4 * o[k] + 2) >> 2);
+					}
+				}
+			}
+		}
+		else
+		{
+			int base[2][3];
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				if (mode == 4)
+				{
+					base[0][k] = Expand((int)(bits >> (60u - 8 * k)) & 15, 4);
+					base[1][k] = Expand((int)(bits >> (56u - 8 * k)) & 15, 4);
+				}
+				else
+				{
+					const int b = (int)(bits >> (59u - 8 * k)) & 31;
+					base[0][k] = Expand(b, 5);
+					base[1][k] = Expand(b + SignExtend3((int)(bits >> (56u - 8 * k)) & 7), 5);
+				}
+			}
+			const int tables[2] = {(int)(bits >> 37u) & 7, (int)(bits >> 34u) & 7};
+			const bool flip = (bits & (1ull << 32u)) != 0;
+			for (int i = 0; i < 16; ++i)
+			{
+				const int x = i / 4;
+				const int y = i % 4;
+				const int subblock = flip ? (y >= 2 ? 1 : 0) : (x >= 2 ? 1 : 0);
+				const int index = GetIndex(bits, i);
+				transparent[i] = !opaque && index == 2;
+				const int modifier = GetModifier(tables[subblock], index, opaque);
+				for (int k = 0; k < 3; ++k)
+				{
+					colours[i][k] = Clamp255(base[subblock][k] + modifier);
+				}
+			}
+		}
+
+		for (int i = 0; i < 16; ++i)
+		{
+			uint8_t* texel = rgba + 4 * ((i % 4) * 4 + i / 4);
+			for (int k = 0; k < 3; ++k)
+			{
+				texel[k] = transparent[i] ? 0 : (uint8_t)colours[i][k];
+			}
+			texel[3] = transparent[i] ? 0 : 255;
+		}
+	}
+
+	// Value of an EAC texel is base * scale + offset + modifier * multiplier * scale, clamped to [min, max].
+	// 11 bit formats use a step of 1 instead of multiplier * scale if the multiplier is zero
+	struct EACFormat
+	{
+		float scale;
+		float offset;
+		int base_min;
+		int base_max;
+		float min;
+		float max;
+		bool zero_multiplier;
+	};
+
+	const EACFormat EACAlpha = {1.0f, 0.0f, 0, 255, 0.0f, 255.0f, false};
+	const EACFormat EACUnsigned = {8.0f, 4.0f, 0, 255, 0.0f, 2047.0f, true};
+	const EACFormat EACSigned = {8.0f, 0.0f, -127, 127, -1023.0f, 1023.0f, true};
+
+	struct EACSearch
+	{
+		int multiplier_radius;
+		int base_radius;
+		int refine;
+	};
+
+	EACSearch GetEACSearch(pvrtexture::ECompressorQuality quality)
+	{
+		switch (quality)
+		{
+			case pvrtexture::ePVRTCFastest: return {0, 0, 0};
+			case pvrtexture::ePVRTCFast: return {0, 1, 0};
+			case pvrtexture::ePVRTCHigh: return {1, 2, 2};
+			case pvrtexture::ePVRTCBest: return {2, 3, 4};
+			default: return {1, 1, 1};
+		}
+	}
+
+	struct EACEncoding
+	{
+		int base;
+		int multiplier;
+		int table;
+		int indices[16];
+		float error;
+	};
+
+	inline float GetEACStep(const EACFormat& format, int multiplier)
+	{
+		return multiplier != 0 ? multiplier * format.scale : 1.0f;
+	}
+
+	void BuildEACPalette(const EACFormat& format, int base, int multiplier, int table, float* palette)
+	{
+		const float step = GetEACStep(format, multiplier);
+		for (int k = 0; k < 8; ++k)
+		{
+			float value = base * format.scale + format.offset + EACModifiers[table][k] * step;
+			palette[k] = std::min(std::max(value, format.min), format.max);
+		}
+	}
+
+	float SelectEACIndices(const float* values, const float* palette, int* indices)
+	{
+		using namespace simd;
+		float error = 0.0f;
+		for (int i = 0; i < 16; i += width)
+		{
+			const vfloat x = load(values + i);
+			vfloat best = set1(FLT_MAX);
+			vfloat index = set1(0.0f);
+			for (int k = 0; k < 8; ++k)
+			{
+				const vfloat d = x - set1(palette[k]);
+				const vfloat e = d * d;
+				const vmask closer = e < best;
+				best = select(closer, e, best);
+				index = select(closer, set1((float)k), index);
+			}
+			store(indices + i, index);
+			error += reduce_add(best);
+		}
+		return error;
+	}
+
+	bool TryEAC(const float* values, const EACFormat& format, int base, int multiplier, int table, EACEncoding& best)
+	{
+		base = std::min(std::max(base, format.base_min), format.base_max);
+		float palette[8];
+		BuildEACPalette(format, base, multiplier, table, palette);
+		int indices[16];
+		float error = SelectEACIndices(values, palette, indices);
+		if (error < best.error)
+		{
+			best.base = base;
+			best.multiplier = multiplier;
+			best.table = table;
+			memcpy(best.indices, indices, sizeof(best.indices));
+			best.error = error;
+			return true;
+		}
+		return false;
+	}
+
+	// values are in the order of pixel indices, in units of the format
+	uint64_t EncodeEAC(const float* values, const EACFormat& format, pvrtexture::ECompressorQuality quality)
+	{
+		const EACSearch search = GetEACSearch(quality);
+		float lo = values[0];
+		float hi = values[0];
+		for (int i = 1; i < 16; ++i)
+		{
+			lo = std::min(lo, values[i]);
+			hi = std::max(hi, values[i]);
+		}
+
+		EACEncoding best;
+		best.error = FLT_MAX;
+		const int min_multiplier = format.zero_multiplier ? 0 : 1;
+		for (int table = 0; table < 16 && best.error > 0.0f; ++table)
+		{
+			const float low = (float)EACModifiers[table][3];
+			const float high = (float)EACModifiers[table][7];
+			// multiplier that stretches the modifiers over the range of values
+			int m0 = (int)((hi - lo) / ((high - low) * format.scale) + 0.5f);
+			m0 = std::min(std::max(m0, min_multiplier), 15);
+			for (int m = std::max(m0 - search.multiplier_radius, min_multiplier); m <= std::min(m0 + search.multiplier_radius, 15); ++m)
+			{
+				const float step = GetEACStep(format, m);
+				const float ideal = (0.5f * (lo + hi) - 0.5f * (low + high) * step - format.offset) / format.scale;
+				const int b0 = (int)std::floor(ideal + 0.5f);
+				for (int base = b0 - search.base_radius; base <= b0 + search.base_radius; ++base)
+				{
+					TryEAC(values, format, base, m, table, best);
+				}
+			}
+		}
+		for (int pass = 0; pass < search.refine && best.error > 0.0f; ++pass)
+		{
+			// base that minimizes the error of the current indices, ignoring clamping
+			const float step = GetEACStep(format, best.multiplier);
+			float sum = 0.0f;
+			for (int i = 0; i < 16; ++i)
+			{
+				sum += values[i] - EACModifiers[best.table][best.indices[i]] * step - format.offset;
+			}
+			const int base = (int)std::floor(sum / (16.0f * format.scale) + 0.5f);
+			if (base == best.base || !TryEAC(values, format, base, best.multiplier, best.table, best))
+			{
+				break;
+			}
+		}
+
+		uint64_t bits = (uint64_t)(best.base & 255) << 56u | (uint64_t)best.multiplier << 52u | (uint64_t)best.table << 48u;
+		for (int i = 0; i < 16; ++i)
+		{
+			bits |= (uint64_t)best.indices[i] << (45u - 3 * i);
+		}
+		return bits;
+	}
+
+	void DecodeEAC(uint64_t bits, const EACFormat& format, float* values)
+	{
+		int base = (int)(bits >> 56u) & 255;
+		if (format.base_min < 0)
+		{
+			base = std::max(base >= 128 ? base - 256 : base, format.base_min);
+		}
+		float palette[8];
+		BuildEACPalette(format, base, (int)(bits >> 52u) & 15, (int)(bits >> 48u) & 15, palette);
+		for (int i = 0; i < 16; ++i)
+		{
+			values[i] = palette[(bits >> (45u - 3 * i)) & 7u];
+		}
+	}
+
+	// Loads a channel in the order of pixel indices, scaled and clamped to the range of the format
+	void LoadEACChannel(const float* rgba, int channel, const EACFormat& format, float* values)
+	{
+		const float scale = format.min < 0.0f ? -format.min : format.max;
+		for (int y = 0; y < 4; ++y)
+		{
+			for (int x = 0; x < 4; ++x)
+			{
+				float value = rgba[4 * (y * 4 + x) + channel] * scale;
+				values[x * 4 + y] = std::min(std::max(value, format.min), format.max);
+			}
+		}
+	}
+
+	void DecodeEACChannel(const uint8_t* block, const EACFormat& format, float* rgba, int channel)
+	{
+		float values[16];
+		DecodeEAC(LoadBigEndian(block), format, values);
+		const float scale = format.min < 0.0f ? -format.min : format.max;
+		for (int i = 0; i < 16; ++i)
+		{
+			rgba[4 * ((i % 4) * 4 + i / 4) + channel] = values[i] / scale;
+		}
+	}
+}
+
+
+void EncodeETC1Block(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality)
+{
+	ColourBlock colour;
+	LoadColourBlock(rgba, false, colour);
+	StoreBigEndian(EncodeColour(colour, FormatETC1, GetSearch(quality)), block);
+}
+
+void EncodeETC2RGBBlock(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality)
+{
+	ColourBlock colour;
+	LoadColourBlock(rgba, false, colour);
+	StoreBigEndian(EncodeColour(colour, FormatETC2, GetSearch(quality)), block);
+}
+
+void EncodeETC2RGBABlock(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality)
+{
+	float alpha[16];
+	LoadEACChannel(rgba, 3, EACAlpha, alpha);
+	StoreBigEndian(EncodeEAC(alpha, EACAlpha, quality), block);
+	EncodeETC2RGBBlock(rgba, block + 8, quality);
+}
+
+void EncodeETC2RGBA1Block(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality)
+{
+	ColourBlock colour;
+	LoadColourBlock(rgba, true, colour);
+	StoreBigEndian(EncodeColour(colour, FormatETC2PunchThrough, GetSearch(quality)), block);
+}
+
+void EncodeEACR11Block(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality, bool is_signed)
+{
+	const EACFormat& format = is_signed ? EACSigned : EACUnsigned;
+	float values[16];
+	LoadEACChannel(rgba, 0, format, values);
+	StoreBigEndian(EncodeEAC(values, format, quality), block);
+}
+
+void EncodeEACRG11Block(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality, bool is_signed)
+{
+	const EACFormat& format = is_signed ? EACSigned : EACUnsigned;
+	float values[16];
+	for (int channel = 0; channel < 2; ++channel)
+	{
+		LoadEACChannel(rgba, channel, format, values);
+		StoreBigEndian(EncodeEAC(values, format, quality), block + 8 * channel);
+	}
+}
+
+void DecodeETC2RGBBlock(const uint8_t* block, uint8_t* rgba)
+{
+	DecodeColour(LoadBigEndian(block), false, rgba);
+}
+
+void DecodeETC2RGBABlock(const uint8_t* block, uint8_t* rgba)
+{
+	DecodeColour(LoadBigEndian(block + 8), false, rgba);
+	float values[16];
+	DecodeEAC(LoadBigEndian(block), EACAlpha, values);
+	for (int i = 0; i < 16; ++i)
+	{
+		rgba[4 * ((i % 4) * 4 + i / 4) + 3] = (uint8_t)values[i];
+	}
+}
+
+void DecodeETC2RGBA1Block(const uint8_t* block, uint8_t* rgba)
+{
+	DecodeColour(LoadBigEndian(block), true, rgba);
+}
+
+void DecodeEACR11Block(const uint8_t* block, float* rgba, bool is_signed)
+{
+	for (int i = 0; i < 16; ++i)
+	{
+		rgba[4 * i + 0] = 0.0f;
+		rgba[4 * i + 1] = 0.0f;
+		rgba[4 * i + 2] = 0.0f;
+		rgba[4 * i + 3] = 1.0f;
+	}
+	DecodeEACChannel(block, is_signed ? EACSigned : EACUnsigned, rgba, 0);
+}
+
+void DecodeEACRG11Block(const uint8_t* block, float* rgba, bool is_signed)
+{
+	DecodeEACR11Block(block, rgba, is_signed);
+	DecodeEACChannel(block + 8, is_signed ? EACSigned : EACUnsigned, rgba, 1);
+}
@@ -0,0 +1,54 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#pragma once
+#include <PVRTextureDefines.h>
+
+#include <cstdint>
+
+
+// Block encoders and decoders of ETC1, ETC2 and EAC. Encoders take the 16 texels of a 4x4 block, row by row,
+// as RGBA float32. Blocks are written in the byte order of PVR and KTX files.
+//
+// Colour blocks try the ETC1 individual and differential modes with both subblock orientations, ETC2 adds the T, H and
+// planar modes. The modifier table search is vectorized over texels. A block is finished as soon as its error drops
+// below the threshold of the quality level, so that flat and smooth blocks skip the costlier modes.
+//   Fastest - base colours from subblock averages, planar mode;
+//   Fast    - plus a refinement pass of base colours;
+//   Normal  - plus T and H modes, two refinement passes;
+//   High    - plus search of neighbouring quantized colours with nearby tables and distances, lower threshold;
+//   Best    - neighbouring colours with all tables and distances, more refinement passes, no early out.
+// EAC blocks search all modifier tables, with a wider range of multipliers and base values at higher quality.
+
+// Colour values are clamped to [0, 1]
+void EncodeETC1Block(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality);
+void EncodeETC2RGBBlock(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality);
+// EAC alpha block followed by an ETC2 colour block
+void EncodeETC2RGBABlock(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality);
+// Texels with alpha below 0.5 are encoded as transparent
+void EncodeETC2RGBA1Block(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality);
+// Encodes the red channel, clamped to [0, 1], or to [-1, 1] if is_signed is set
+void EncodeEACR11Block(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality, bool is_signed);
+// Encodes the red and green channels
+void EncodeEACRG11Block(const float* rgba, uint8_t* block, pvrtexture::ECompressorQuality quality, bool is_signed);
+
+// Writes 16 RGBA8 texels. ETC1 blocks are ETC2 blocks that use only the ETC1 modes
+void DecodeETC2RGBBlock(const uint8_t* block, uint8_t* rgba);
+void DecodeETC2RGBABlock(const uint8_t* block, uint8_t* rgba);
+void DecodeETC2RGBA1Block(const uint8_t* block, uint8_t* rgba);
+// Writes 16 RGBA float32 texels, missing channels are 0, alpha is 1
+void DecodeEACR11Block(const uint8_t* block, float* rgba, bool is_signed);
+void DecodeEACRG11Block(const uint8_t* block, float* rgba, bool is_signed);
@@ -15,7 +15,26 @@
 
 
 #include "common.h"
+#include "pixel_format.h"
 #include "coordinate_transform.h"
+#include "mipmaps.h"
+#include "resize.h"
+#include "downsample.h"
+#include "transcode.h"
+#include "cubemap.h"
+#include "storage.h"
+#include "swizzle.h"
+#include "memory_stream.h"
+#include "mapped_pvr.h"
+#include "texture_writer.h"
+#include "container.h"
+#include "codec.h"
+#include "decode.h"
+#include "metrics.h"
+#include "auto_compress.h"
+#include "cache.h"
+#include "memory_stats.h"
+#include "profiler.h"
 
 #include <PVRTexture.h>
 #include <PVRTextureUtilities.h>
@@ -25,330 +44,397 @@
 #include <pybind11/stl.h>
 #include <memory>
 #include <vector>
+#include <limits>
 
 
-
-template<char C1Name, uint8_t C1Bits, char C2Name = 0, uint8_t C2Bits = 0, char C3Name = 0, uint8_t C3Bits = 0, char C4Name = 0, uint8_t C4Bits = 0>
-class PixelType
+// layout is an optional pixel format string, such as "rgba8888". The first channels of the layout are taken from
+// the array, the remaining ones are set to fill[i] (zero, or the maximum value for alpha, if fill is empty).
+// With copy == false the texture borrows memory of the array, if the array is C-contiguous and no channels are added.
+template<typename T>
+pvrtexture::CPVRTexture* from_numpy(py::array_t<T, 0> array, EPVRTColourSpace eColourSpace, bool normed, bool premultiplied, bool copy, const char* layout, std::vector<double> fill)
 {
-public:
-	enum : uint64_t
+	if (array.ndim() != 3 && array.ndim() != 4)
+		throw std::runtime_error(
+				"Number of dimensions must be 3 or 4 for 2D and 3D textures. Shape should be [H, W, C] or [D, H, W, C]. If number of channels is one, dimension should not be reduced");
+	int ndim = (int)array.ndim();
+	int channels = (int)array.shape(ndim - 1);
+	if (channels < 1 or channels > 4)
+		throw std::runtime_error("Wrong number of channels. Number of channels should be one of: 1, 2, 3, 4");
+	uint64_t ptype = getType(channels, sizeof(T) * 8);
+	if (layout != nullptr)
 	{
-		ID = (static_cast<uint64_t>(C1Name) + (static_cast<uint64_t>(C2Name) << 8u) +
-		     (static_cast<uint64_t>(C3Name) << 16u) + (static_cast<uint64_t>(C4Name) << 24u) +
-		     (static_cast<uint64_t>(C1Bits) << 32u) + (static_cast<uint64_t>(C2Bits) << 40u) +
-			 (static_cast<uint64_t>(C3Bits) << 48u) + (static_cast<uint64_t>(C4Bits) << 56u))
-	};
-};
-
-struct DecodedType
-{
-	bool compressed;
-	std::vector<char> channel_names;
-	std::vector<uint8_t> channel_sizes;
-};
+		ptype = parseType(layout);
+		auto decoded = DecodePixelType(ptype);
+		for (auto size: decoded.channel_sizes)
+		{
+			if (size != sizeof(T) * 8)
+				throw runtime_error("Channel sizes of layout %s do not match the array type, expected %d bits per channel", layout, (int)sizeof(T) * 8);
+		}
+		if ((int)decoded.channel_names.size() < channels)
+			throw runtime_error("Layout %s has less channels than the array, got %d", layout, channels);
+	}
+	auto decoded = DecodePixelType(ptype);
+	int dst_channels = (int)decoded.channel_names.size();
+	if (!fill.empty() && (int)fill.size() != dst_channels)
+		throw runtime_error("Number of fill values must match number of channels in layout, expected %d, got %d", dst_channels, (int)fill.size());
 
-DecodedType DecodePixelType(uint64_t pixel_format)
-{
-	bool compressed = (pixel_format & 0xFFFFFFFF00000000) == 0;
-	if (compressed)
+	uint32_t width = array.shape(ndim - 2);
+	uint32_t height = array.shape(ndim - 3);
+	uint32_t depth = 1;
+	if (ndim == 4)
+		depth = array.shape(0);
+	if (width > 65535 || height > 65535  || depth > 65535)
+		throw runtime_error("Wrong number texture size. Got %dx%dx%d", width, height, depth);
+	EPVRTVariableType channelType = (EPVRTVariableType)0;
+	switch (sizeof(T))
 	{
-		return {compressed, {}, {}};
+		case 1: channelType = ePVRTVarTypeUnsignedByteNorm; break;
+		case 2: channelType = ePVRTVarTypeUnsignedShortNorm; break;
+		case 4: channelType = ePVRTVarTypeUnsignedIntegerNorm; break;
+		default:
+			throw runtime_error("Wrong size of type, got %d bytes, but expected 1, 2, or 4", sizeof(T));
 	}
-	std::vector<char> channels;
-	std::vector<uint8_t> sizes;
-	for (int i = 0; i < 4; ++i)
+	if (std::is_signed<T>::value)
+		channelType = (EPVRTVariableType)((uint8_t)channelType | 0b01u);
+	if (!normed)
+		channelType = (EPVRTVariableType)((uint8_t)channelType | 0b10u);
+	if (std::is_floating_point<T>::value)
+		channelType = ePVRTVarTypeFloat;
+
+	pvrtexture::CPVRTextureHeader header(ptype, height, width, depth, 1, 1, 1, eColourSpace, channelType, premultiplied);
+
+	bool contiguous = (array.flags() & py::array::c_style) != 0;
+	pvrtexture::CPVRTexture* pvr;
+	if (!copy && contiguous && dst_channels == channels)
 	{
-		char v = pixel_format & 0xffu;
-		if (v != 0)
-		{
-			channels.push_back(v);
-		}
-		pixel_format = pixel_format >> 8u;
+		// texture points to the memory of the array and keeps a reference to it, data is copied on first modification
+		pvr = new pvrtexture::CPVRTexture();
+		static_cast<pvrtexture::CPVRTextureHeader&>(*pvr) = header;
+		BorrowData(*pvr, (void*)array.data(), array);
 	}
-	for (int i = 0; i < 4; ++i)
+	else
 	{
-		uint8_t v = pixel_format & 0xffu;
-		if (v != 0)
+		StridedImage src;
+		src.data = (const uint8_t*)array.data();
+		src.channels = channels;
+		src.shape[0] = depth;
+		src.shape[1] = height;
+		src.shape[2] = width;
+		src.strides[0] = ndim == 4 ? array.strides(0) : 0;
+		src.strides[1] = array.strides(ndim - 3);
+		src.strides[2] = array.strides(ndim - 2);
+		src.strides[3] = array.strides(ndim - 1);
+
+		int map[4];
+		T fill_values[4];
+		for (int c = 0; c < dst_channels; ++c)
 		{
-			sizes.push_back(v);
+			map[c] = c < channels ? c : -1;
+			if (!fill.empty())
+				fill_values[c] = (T)fill[c];
+			else if (decoded.channel_names[c] == 'a')
+				fill_values[c] = std::is_floating_point<T>::value ? (T)1 : std::numeric_limits<T>::max();
+			else
+				fill_values[c] = (T)0;
 		}
-		pixel_format = pixel_format >> 8u;
-	}
 
-	return {false, channels, sizes};
+		py::gil_scoped_release release;
+		pvr = new pvrtexture::CPVRTexture(header);
+		CopyChannels(src, sizeof(T), (uint8_t*)pvr->getDataPtr(), dst_channels, map, (const uint8_t*)fill_values);
+		CountAllocatedBytes(pvr->getDataSize());
+		CountCopiedBytes(pvr->getDataSize());
+	}
+	pvr->setOrientation((EPVRTOrientation)(ePVRTOrientRight | ePVRTOrientDown));
+	return pvr;
 }
 
-size_t GetChannelCount(uint64_t f)
+
+pvrtexture::CPVRTexture* new_texture(Format pixel_type, int width, int height, int depth, int num_mipmap, int num_array, int num_faces, EPVRTColourSpace eColourSpace, EPVRTVariableType channelType, bool premultiplied)
 {
-	auto decoded = DecodePixelType(f);
-	return decoded.channel_names.size();
+	pvrtexture::CPVRTextureHeader header(pixel_type, height, width, depth, num_mipmap, num_array, num_faces, eColourSpace, channelType, premultiplied);
+
+	auto pvr = new pvrtexture::CPVRTexture(header);
+	// PVRTexLib does not allocate data of these formats
+	if (IsUnsizedFormat(pixel_type))
+		AllocateData(*pvr);
+	else
+		CountAllocatedBytes(pvr->getDataSize());
+	pvr->setOrientation((EPVRTOrientation)(ePVRTOrientRight | ePVRTOrientDown));
+	return pvr;
 }
 
-template<char C1Name, char C2Name, char C3Name, char C4Name>
-class FourCC
+
+// Contiguous memory of a python object that supports buffer protocol, e.g. bytes, bytearray, memoryview or numpy array
+struct ByteBuffer
 {
-public:
-	enum : uint32_t
+	explicit ByteBuffer(const py::buffer& buffer)
 	{
-		Value = (static_cast<uint32_t>(C1Name) + (static_cast<uint32_t>(C2Name) << 8u) +
-		      (static_cast<uint32_t>(C3Name) << 16u) + (static_cast<uint32_t>(C4Name) << 24u))
-	};
+		if (PyObject_GetBuffer(buffer.ptr(), &view, PyBUF_SIMPLE) != 0)
+			throw py::error_already_set();
+	}
+
+	~ByteBuffer()
+	{
+		PyBuffer_Release(&view);
+	}
+
+	ByteBuffer(const ByteBuffer&) = delete;
+	ByteBuffer& operator=(const ByteBuffer&) = delete;
+
+	Py_buffer view;
 };
 
 
-inline uint64_t
-getPixelType(char C1Name, uint8_t C1Bits, char C2Name = 0, uint8_t C2Bits = 0, char C3Name = 0, uint8_t C3Bits = 0,
-             char C4Name = 0, uint8_t C4Bits = 0)
+py::bytes save_to_bytes(const pvrtexture::CPVRTexture& texture, Container container, size_t capacity)
 {
-	return (static_cast<uint64_t>(C1Name) + (static_cast<uint64_t>(C2Name) << 8u) +
-	        (static_cast<uint64_t>(C3Name) << 16u) + (static_cast<uint64_t>(C4Name) << 24u) +
-	        (static_cast<uint64_t>(C1Bits) << 32u) + (static_cast<uint64_t>(C2Bits) << 40u) +
-	        (static_cast<uint64_t>(C3Bits) << 48u) + (static_cast<uint64_t>(C4Bits) << 56u));
+	PyBytesObject* bytesObject = nullptr;
+	char* buffer = (char*)GetBytesAllocator(bytesObject)(capacity);
+	py::object result = py::reinterpret_steal<py::object>((PyObject*)bytesObject);
+	size_t size;
+	{
+		py::gil_scoped_release release;
+		size = SaveToMemory(texture, container, buffer, capacity);
+	}
+	// capacity is an upper bound. The object is not shared yet, so it can be shrunk to the actual size.
+	// On failure _PyBytes_Resize frees it and sets it to null
+	PyObject* object = result.release().ptr();
+	if (_PyBytes_Resize(&object, (Py_ssize_t)size) != 0)
+	{
+		throw py::error_already_set();
+	}
+	return py::reinterpret_steal<py::bytes>(object);
 }
 
-inline uint64_t parseType(const char* s)
+
+struct TexView
 {
-	char buff[255];
-	strncpy(buff, s, 255);
+	void *ptr;
+	size_t itemsize;
+	std::string format;
+	size_t ndim;
+	std::vector<py::ssize_t> shape;
+	std::vector<py::ssize_t> strides;
+	bool readonly;
+};
 
-	int i = 0;
-	while (buff[i] && i < 255)
-	{
-		buff[i] = (tolower(buff[i]));
-		i++;
-	}
 
-	uint64_t type = 0;
-	uint64_t mul = 1;
-	for (i = 0; i < 4; i++)
+// View of one surface: [D, ]H, W, C array for uncompressed formats, flat array of bytes for compressed ones
+TexView make_view(const pvrtexture::CPVRTextureHeader& header, void* ptr, int mipmap, bool readonly)
+{
+	if (DecodePixelType(header.getPixelType().PixelTypeID).compressed)
 	{
-		if (buff[i] == 'r' || buff[i] == 'g' || buff[i] == 'b' || buff[i] == 'a' || buff[i] == 'l' ||
-		    buff[i] == 'd')
-		{
-			type += buff[i] * mul;
-			mul = mul << 8u;
-		}
-		else
-		{
-			break;
-		}
+		py::ssize_t size = GetSurfaceSize(header, mipmap);
+		return TexView{ptr, 1, py::format_descriptor<uint8_t>::format(), 1, {size}, {1}, readonly};
 	}
-	if (i == 0)
+	size_t width = header.getWidth(mipmap);
+	size_t height = header.getHeight(mipmap);
+	size_t depth = header.getDepth(mipmap);
+	std::vector<py::ssize_t> shape;
+	std::vector<py::ssize_t> strides;
+	int channel_count = GetChannelCount(header.getPixelType().PixelTypeID);
+	if (depth > 1)
 	{
-		throw runtime_error("Format should start from channel names, such as: r, g, b, a, l, d. Got %c", buff[0]);
+		shape.push_back(depth);
+		strides.push_back(width * height * header.getBitsPerPixel() / 8);
 	}
-	for (int _i = i; _i < 4; _i++)
+	shape.push_back(height);
+	strides.push_back(width * header.getBitsPerPixel() / 8);
+	shape.push_back(width);
+	strides.push_back(header.getBitsPerPixel() / 8);
+	shape.push_back(channel_count);
+	strides.push_back((header.getBitsPerPixel() / 8) / channel_count);
+	std::string dtype = "";
+	size_t item_size = (header.getBitsPerPixel() / 8) / channel_count;
+	switch(header.getChannelType())
 	{
-		mul = mul << 8u;
+		case ePVRTVarTypeUnsignedByteNorm: dtype = py::format_descriptor<uint8_t>::format(); break;
+		case ePVRTVarTypeSignedByteNorm: dtype = py::format_descriptor<int8_t>::format(); break;
+		case ePVRTVarTypeUnsignedByte: dtype = py::format_descriptor<uint8_t>::format(); break;
+		case  ePVRTVarTypeSignedByte: dtype = py::format_descriptor<int8_t>::format(); break;
+		case ePVRTVarTypeUnsignedShortNorm: dtype = py::format_descriptor<uint16_t>::format(); break;
+		case ePVRTVarTypeSignedShortNorm: dtype = py::format_descriptor<int16_t>::format(); break;
+		case ePVRTVarTypeUnsignedShort: dtype = py::format_descriptor<uint16_t>::format(); break;
+		case ePVRTVarTypeSignedShort: dtype = py::format_descriptor<int16_t>::format(); break;
+		case ePVRTVarTypeUnsignedIntegerNorm: dtype = py::format_descriptor<uint32_t>::format(); break;
+		case ePVRTVarTypeSignedIntegerNorm: dtype = py::format_descriptor<int32_t>::format(); break;
+		case ePVRTVarTypeUnsignedInteger: dtype = py::format_descriptor<uint32_t>::format(); break;
+		case ePVRTVarTypeSignedInteger: dtype = py::format_descriptor<int32_t>::format(); break;
+		case ePVRTVarTypeFloat:
+		case ePVRTVarTypeUnsignedFloat:
+			dtype = py::format_descriptor<float>::format(); break;
 	}
+	return TexView{
+			ptr,
+			item_size,
+			dtype,
+			shape.size(),
+			shape,
+			strides,
+			readonly
+	};
+}
 
-	if (!(buff[i] >= '0' && buff[i] <= '9'))
+
+// Pixel format of the texture a binding is called on: self, the first argument or the "texture" keyword argument.
+// Compressed formats are named as in PixelFormat, others as pixel_format_str, e.g. "rgba8888"
+std::string ProfiledFormat(const py::args& args, const py::kwargs& kwargs)
+{
+	py::handle texture;
+	if (args.size() > 0)
+		texture = args[0].ptr();
+	else if (kwargs.contains("texture"))
+		texture = kwargs["texture"].ptr();
+	uint64_t format;
+	if (texture && py::isinstance<pvrtexture::CPVRTexture>(texture))
+		format = texture.cast<pvrtexture::CPVRTexture&>().getPixelType().PixelTypeID;
+	else if (texture && py::isinstance<MappedPVR>(texture))
+		format = texture.cast<MappedPVR&>().header().getPixelType().PixelTypeID;
+	else
+		return std::string();
+
+	if ((format & 0xFFFFFFFF00000000ull) == 0)
 	{
-		throw runtime_error("Unexpected symbol after channel names: %c. Expected digits", buff[i]);
+		std::string name = py::str(py::cast((Format)format));
+		return name.substr(name.find('.') + 1);
 	}
+	auto decoded = DecodePixelType(format);
+	std::string name(decoded.channel_names.begin(), decoded.channel_names.end());
+	for (auto size: decoded.channel_sizes)
+		name += std::to_string(size);
+	return name;
+}
+
+
+// Wraps function of scope, a module or a class for methods, so that its calls are recorded. Overloads are recorded
+// together
+py::cpp_function Profiled(const std::string& name, py::object function, py::handle scope, bool method)
+{
+	auto wrapper = [name, function](py::args args, py::kwargs kwargs) -> py::object
+	{
+		ProfileScope profile(name.c_str(), ProfiledFormat(args, kwargs));
+		return function(*args, **kwargs);
+	};
+	std::string doc = py::str(function.attr("__doc__"));
+	std::string short_name = name.substr(name.rfind('.') + 1);
+	if (method)
+		return py::cpp_function(wrapper, py::name(short_name.c_str()), py::is_method(scope), py::doc(doc.c_str()));
+	return py::cpp_function(wrapper, py::name(short_name.c_str()), py::scope(scope), py::doc(doc.c_str()));
+}
+
 
-	int j = 0;
-	const char* p = buff + i;
-	for (; j < 4; j++)
+// Bindings are only wrapped while the profiler is enabled, so that calls pay for the extra dispatch only then.
+// Functions of the module are also replaced in the modules of the texture_tool package, "from _pypvrtex import *"
+// copies them. Other modules that imported them keep calling the unprofiled originals
+class ProfiledBindings
+{
+public:
+	// Takes the functions of module and the methods of its classes, except for enums, defined so far. Names starting
+	// with underscore, such as constructors and properties, are left out
+	explicit ProfiledBindings(const py::module& m): m_installed(false)
 	{
-		if (*p >= '0' && *p <= '9')
+		for (auto item: py::reinterpret_borrow<py::dict>(m.attr("__dict__")))
 		{
-			int v = *p - '0';
-			if (*p == '1' && *(p + 1) == '0')
-			{
-				v = 10;
-				++p;
-			}
-			if (*p == '1' && *(p + 1) == '1')
-			{
-				v = 11;
-				++p;
-			}
-			if (*p == '1' && *(p + 1) == '2')
-			{
-				v = 12;
-				++p;
-			}
-			if (*p == '1' && *(p + 1) == '6')
+			std::string name = py::str(item.first);
+			py::handle value = item.second;
+			if (name[0] == '_')
+				continue;
+			if (PyCFunction_Check(value.ptr()))
 			{
-				v = 16;
-				++p;
+				m_functions.push_back({m, name, py::reinterpret_borrow<py::object>(value), py::object()});
 			}
-			if (*p == '3' && *(p + 1) == '2')
+			else if (PyType_Check(value.ptr()) && !py::hasattr(value, "__members__"))
 			{
-				v = 32;
-				++p;
+				for (auto method: value.attr("__dict__").attr("items")())
+				{
+					py::tuple pair = py::reinterpret_borrow<py::tuple>(method);
+					std::string method_name = py::str(pair[0]);
+					if (method_name[0] != '_' && PyInstanceMethod_Check(pair[1].ptr()))
+						m_methods.push_back({py::reinterpret_borrow<py::object>(value), method_name,
+								py::reinterpret_borrow<py::object>(pair[1].ptr()), py::object()});
+				}
 			}
-			++p;
-			type += v * mul;
-			mul = mul << 8u;
-		}
-		else
-		{
-			break;
 		}
 	}
 
-	if (*p != '\0')
+	// Replaces the bindings with Profiled wrappers
+	void Install()
 	{
-		throw runtime_error("Unexpected symbol at the end of the format: %c", *p);
-	}
+		if (m_installed)
+			return;
+		m_installed = true;
 
-	if (i != j)
-	{
-		throw runtime_error("Number of channel names and sizes do not match, got %d and %d", i, j);
+		for (auto& function: m_functions)
+			function.wrapper = Profiled(function.name, function.original, function.scope, false);
+		for (auto& method: m_methods)
+		{
+			std::string name = py::str(method.scope.attr("__name__"));
+			py::object function = py::reinterpret_borrow<py::object>(PyInstanceMethod_GET_FUNCTION(method.original.ptr()));
+			method.wrapper = Profiled(name + "." + method.name, function, method.scope, true);
+			py::setattr(method.scope, method.name.c_str(), method.wrapper);
+		}
+		Replace(false);
 	}
-	return type;
-}
 
+	// Puts the bindings back
+	void Uninstall()
+	{
+		if (!m_installed)
+			return;
+		m_installed = false;
 
-enum Format : uint64_t
-{
-	PVRTCI_2bpp_RGB,
-	PVRTCI_2bpp_RGBA,
-	PVRTCI_4bpp_RGB,
-	PVRTCI_4bpp_RGBA,
-
-	PVRTCII_2bpp,
-	PVRTCII_4bpp,
-
-	ETC1,
-
-	DXT1,
-	DXT2,
-	DXT3,
-	DXT4,
-	DXT5,
-	BC1 = DXT1,
-	BC2 = DXT3,
-	BC3 = DXT5,
-
-	RGBG8888 = 20,
-	GRGB8888,
-
-	ETC2_RGB = 22,
-	ETC2_RGBA,
-	ETC2_RGB_A1,
-
-	EAC_R11,
-	EAC_RG11,
-
-	ASTC_4x4,
-	ASTC_5x4,
-	ASTC_5x5,
-	ASTC_6x5,
-	ASTC_6x6,
-	ASTC_8x5,
-	ASTC_8x6,
-	ASTC_8x8,
-	ASTC_10x5,
-	ASTC_10x6,
-	ASTC_10x8,
-	ASTC_10x10,
-	ASTC_12x10,
-	ASTC_12x12,
-
-	RGBA8888 = PixelType<'r', 8, 'g', 8, 'b', 8, 'a', 8>::ID,
-	RGBA1010102 = PixelType<'r', 10, 'g', 10, 'b', 10, 'a', 2>::ID,
-	RGBA4444 = PixelType<'r', 4, 'g', 4, 'b', 4, 'a', 4>::ID,
-	RGBA5551 = PixelType<'r', 5, 'g', 5, 'b', 5, 'a', 1>::ID,
-	BGRA8888 = PixelType<'b', 8, 'g', 8, 'r', 8, 'a', 8>::ID,
-	RGBA16161616 = PixelType<'r', 16, 'g', 16, 'b', 16, 'a', 16>::ID,
-	RGBA32323232 = PixelType<'r', 32, 'g', 32, 'b', 32, 'a', 32>::ID,
-
-	RGB888 = PixelType<'r', 8, 'g', 8, 'b', 8>::ID,
-	RGB161616 = PixelType<'r', 16, 'g', 16, 'b', 16>::ID,
-	RGB565 = PixelType<'r', 5, 'g', 6, 'b', 5>::ID,
-	RGB323232 = PixelType<'r', 32, 'g', 32, 'b', 32>::ID,
-	BGR101111 = PixelType<'b', 10, 'g', 11, 'r', 11>::ID,
-
-	RG88 = PixelType<'r', 8, 'g', 8>::ID,
-	LA88 = PixelType<'l', 8, 'a', 8>::ID,
-	RG1616 = PixelType<'r', 16, 'g', 16>::ID,
-	RG3232 = PixelType<'r', 32, 'g', 32>::ID,
-
-	R8 = PixelType<'r', 8>::ID,
-	A8 = PixelType<'a', 8>::ID,
-	L8 = PixelType<'l', 8>::ID,
-	R16 = PixelType<'r', 16>::ID,
-	R32 = PixelType<'r', 32>::ID,
-};
-
-uint64_t getType(int channel_count, int bits)
-{
-	std::string part_a;
-	std::string part_b;
-	const char* names = "rgba";
-	char bitsstr[32];
-	sprintf(bitsstr, "%d", bits);
-	for (int i = 0; i < channel_count; ++i)
-	{
-		part_a += names[i];
-		part_b += bitsstr;
+		for (auto& method: m_methods)
+			py::setattr(method.scope, method.name.c_str(), method.original);
+		Replace(true);
 	}
-	return parseType((part_a + part_b).c_str());
-}
 
-template<typename T>
-pvrtexture::CPVRTexture* from_numpy(py::array_t<T, py::array::c_style> array, EPVRTColourSpace eColourSpace, bool normed, bool premultiplied)
-{
-	py::buffer_info buf = array.request();
-	if (buf.ndim != 3 && buf.ndim != 4)
-		throw std::runtime_error(
-				"Number of dimensions must be 3 or 4 for 2D and 3D textures. Shape should be [H, W, C] or [D, H, W, C]. If number of channels is one, dimension should not be reduced");
-	if (buf.shape.back() < 1 or buf.shape.back() > 4)
-		throw std::runtime_error("Wrong number of channels. Number of channels should be one of: 1, 2, 3, 4");
-	uint64_t ptype = getType(buf.shape.back(), sizeof(T) * 8);
-	uint32_t width = buf.shape[buf.ndim - 2];
-	uint32_t height = buf.shape[buf.ndim - 3];
-	uint32_t depth = 1;
-	if (buf.ndim == 4)
-		depth = buf.shape[0];
-	if (width > 65535 || height > 65535  || depth > 65535)
-		throw runtime_error("Wrong number texture size. Got %dx%dx%d", width, height, depth);
-	EPVRTVariableType channelType = (EPVRTVariableType)0;
-	switch (sizeof(T))
+private:
+	struct Binding
 	{
-		case 1: channelType = ePVRTVarTypeUnsignedByteNorm; break;
-		case 2: channelType = ePVRTVarTypeUnsignedShortNorm; break;
-		case 4: channelType = ePVRTVarTypeUnsignedIntegerNorm; break;
-		default:
-			throw runtime_error("Wrong size of type, got %d bytes, but expected 1, 2, or 4", sizeof(T));
-	}
-	if (std::is_signed<T>::value)
-		channelType = (EPVRTVariableType)((uint8_t)channelType | 0b01u);
-	if (!normed)
-		channelType = (EPVRTVariableType)((uint8_t)channelType | 0b10u);
-	if (std::is_floating_point<T>::value)
-		channelType = ePVRTVarTypeFloat;
-
-	pvrtexture::CPVRTextureHeader header(ptype, height, width, depth, 1, 1, 1, eColourSpace, channelType, premultiplied);
-
-	auto pvr = new pvrtexture::CPVRTexture(header, buf.ptr);
-	pvr->setOrientation((EPVRTOrientation)(ePVRTOrientRight | ePVRTOrientDown));
-	return pvr;
-}
-
-
-pvrtexture::CPVRTexture* new_texture(Format pixel_type, int width, int height, int depth, int num_mipmap, int num_array, int num_faces, EPVRTColourSpace eColourSpace, EPVRTVariableType channelType, bool premultiplied)
-{
-	pvrtexture::CPVRTextureHeader header(pixel_type, height, width, depth, num_mipmap, num_array, num_faces, eColourSpace, channelType, premultiplied);
+		// module of a function, class of a method
+		py::object scope;
+		std::string name;
+		py::object original;
+		py::object wrapper;
+	};
 
-	auto pvr = new pvrtexture::CPVRTexture(header);
-	pvr->setOrientation((EPVRTOrientation)(ePVRTOrientRight | ePVRTOrientDown));
-	return pvr;
-}
+	// Sets every attribute of _pypvrtex and texture_tool modules that is a function to its wrapper, or back
+	void Replace(bool restore)
+	{
+		std::map<PyObject*, py::handle> replacements;
+		for (auto& function: m_functions)
+		{
+			if (restore)
+				replacements[function.wrapper.ptr()] = function.original;
+			else
+				replacements[function.original.ptr()] = function.wrapper;
+		}
 
+		py::list modules = py::module::import("sys").attr("modules").attr("items")();
+		for (auto entry: modules)
+		{
+			py::tuple pair = py::reinterpret_borrow<py::tuple>(entry);
+			std::string name = py::str(pair[0]);
+			if (name != "_pypvrtex" && name != "texture_tool" && name.compare(0, 13, "texture_tool.") != 0)
+				continue;
+			py::object value = py::getattr(pair[1], "__dict__", py::none());
+			if (!py::isinstance<py::dict>(value))
+				continue;
+			py::dict dict = py::reinterpret_borrow<py::dict>(value);
+			std::vector<std::pair<py::object, py::handle>> found;
+			for (auto item: dict)
+			{
+				auto replacement = replacements.find(item.second.ptr());
+				if (replacement != replacements.end())
+					found.emplace_back(py::reinterpret_borrow<py::object>(item.first), replacement->second);
+			}
+			for (auto& item: found)
+				dict[item.first] = item.second;
+		}
+	}
 
-struct TexView
-{
-	void *ptr;
-	size_t itemsize;
-	std::string format;
-	size_t ndim;
-	std::vector<int> shape;
-	std::vector<int> strides;
+	bool m_installed;
+	std::vector<Binding> m_functions;
+	std::vector<Binding> m_methods;
 };
 
 
@@ -370,6 +456,19 @@ PYBIND11_MODULE(_pypvrtex, m)
 			.value("Cubic", pvrtexture::eResizeCubic)
 			.export_values();
 
+	py::enum_<ResampleFilter>(m, "Filter")
+			.value("Box", FilterBox)
+			.value("Kaiser", FilterKaiser)
+			.value("BSpline", FilterBSpline)
+			.value("Lanczos3", FilterLanczos3)
+			.value("Mitchell", FilterMitchell)
+			.export_values();
+
+	py::enum_<Interpolation>(m, "Interpolation")
+			.value("Bilinear", InterpolationBilinear)
+			.value("Bicubic", InterpolationBicubic)
+			.export_values();
+
 	py::enum_<EPVRTColourSpace>(m, "ColourSpace")
 			.value("lRGB", ePVRTCSpacelRGB)
 			.value("sRGB", ePVRTCSpacesRGB)
@@ -431,6 +530,10 @@ PYBIND11_MODULE(_pypvrtex, m)
 			.value("DXT3", DXT3)
 			.value("DXT4", DXT4)
 			.value("DXT5", DXT5)
+			.value("BC4", BC4)
+			.value("BC5", BC5)
+			.value("BC6H", BC6)
+			.value("BC7", BC7)
 
 			.value("RGBG8888", RGBG8888)
 			.value("GRGB8888", GRGB8888)
@@ -440,6 +543,21 @@ PYBIND11_MODULE(_pypvrtex, m)
 			.value("EAC_R11", EAC_R11)
 			.value("EAC_RG11", EAC_RG11)
 
+			.value("ASTC_4x4", ASTC_4x4)
+			.value("ASTC_5x4", ASTC_5x4)
+			.value("ASTC_5x5", ASTC_5x5)
+			.value("ASTC_6x5", ASTC_6x5)
+			.value("ASTC_6x6", ASTC_6x6)
+			.value("ASTC_8x5", ASTC_8x5)
+			.value("ASTC_8x6", ASTC_8x6)
+			.value("ASTC_8x8", ASTC_8x8)
+			.value("ASTC_10x5", ASTC_10x5)
+			.value("ASTC_10x6", ASTC_10x6)
+			.value("ASTC_10x8", ASTC_10x8)
+			.value("ASTC_10x10", ASTC_10x10)
+			.value("ASTC_12x10", ASTC_12x10)
+			.value("ASTC_12x12", ASTC_12x12)
+
 			.value("RGBA8888", RGBA8888)
 			.value("RGBA1010102", RGBA1010102)
 			.value("RGBA4444", RGBA4444)
@@ -466,12 +584,13 @@ PYBIND11_MODULE(_pypvrtex, m)
 			.value("R32", R32)
 			.export_values();
 
-	py::class_<pvrtexture::CPVRTexture>(m, "PVRTexture")
+	py::class_<pvrtexture::CPVRTexture, TextureHolder>(m, "PVRTexture")
 			.def(py::init<>())
 			.def_property("pixel_format", [](pvrtexture::CPVRTexture& self){
 				auto pixel_format = self.getPixelType();
 				return (Format)pixel_format.PixelTypeID;
 			}, [](pvrtexture::CPVRTexture& self, Format format){
+				MakeUnique(self);
 				self.setPixelFormat(format);
 			})
 			.def_property_readonly("bpp", &pvrtexture::CPVRTexture::getBitsPerPixel)
@@ -480,9 +599,19 @@ PYBIND11_MODULE(_pypvrtex, m)
 			.def("get_width", &pvrtexture::CPVRTexture::getWidth, py::arg("mipmap")=0)
 			.def("get_height", &pvrtexture::CPVRTexture::getHeight, py::arg("mipmap")=0)
 			.def("get_depth", &pvrtexture::CPVRTexture::getDepth, py::arg("mipmap")=0)
-			.def_property("num_array", &pvrtexture::CPVRTexture::getNumArrayMembers, &pvrtexture::CPVRTexture::setNumArrayMembers)
-			.def_property("num_faces", &pvrtexture::CPVRTexture::getNumFaces, &pvrtexture::CPVRTexture::setNumFaces)
-			.def_property("num_mip_levels", &pvrtexture::CPVRTexture::getNumMIPLevels, &pvrtexture::CPVRTexture::setNumMIPLevels)
+			.def_property("num_array", &pvrtexture::CPVRTexture::getNumArrayMembers, [](pvrtexture::CPVRTexture& self, uint32_t num_array){
+				MakeUnique(self);
+				self.setNumArrayMembers(num_array);
+			})
+			.def_property("num_faces", &pvrtexture::CPVRTexture::getNumFaces, [](pvrtexture::CPVRTexture& self, uint32_t num_faces){
+				MakeUnique(self);
+				self.setNumFaces(num_faces);
+			})
+			.def_property("num_mip_levels", &pvrtexture::CPVRTexture::getNumMIPLevels, [](pvrtexture::CPVRTexture& self, uint32_t num_mip_levels){
+				MakeUnique(self);
+				self.setNumMIPLevels(num_mip_levels);
+			})
+			.def_property_readonly("is_borrowed", &IsBorrowed)
 			.def_property_readonly("is_compressed", &pvrtexture::CPVRTexture::isFileCompressed)
 
 			.def("get_orientation", [](pvrtexture::CPVRTexture& self, EPVRTAxis axis){
@@ -530,14 +659,49 @@ PYBIND11_MODULE(_pypvrtex, m)
 			})
 
 			.def("save_pvr", [](pvrtexture::CPVRTexture& self, const char* filename){
+				if (IsUnsizedFormat(self.getPixelType().PixelTypeID))
+				{
+					SaveTexture(self, filename, ContainerPVR);
+					return;
+				}
 				FILE* file = fopen(filename, "wb");
 				self.privateSavePVRFile(file);
 				fclose(file);
-			})
+			}, release_gil())
 			.def("save_dds", [](pvrtexture::CPVRTexture& self, const char* filename){
+				if (IsUnsizedFormat(self.getPixelType().PixelTypeID))
+				{
+					SaveTexture(self, filename, ContainerDDS);
+					return;
+				}
 				FILE* file = fopen(filename, "wb");
 				self.privateSaveDDSFile(file);
 				fclose(file);
+			}, release_gil())
+			// .astc files hold a single surface, the top mip level of the first face
+			.def("save_astc", [](pvrtexture::CPVRTexture& self, const char* filename){
+				uint64_t format = self.getPixelType().PixelTypeID;
+				if (format < ePVRTPF_ASTC_4x4 || format > ePVRTPF_ASTC_12x12)
+				{
+					throw runtime_error("Only ASTC textures can be saved as .astc files");
+				}
+				FILE* file = fopen(filename, "wb");
+				if (file == nullptr)
+				{
+					throw runtime_error("Can not open file %s for writing", filename);
+				}
+				bool saved = self.privateSaveASTCFile(file);
+				fclose(file);
+				if (!saved)
+				{
+					throw runtime_error("Failed to save ASTC file %s", filename);
+				}
+			}, release_gil())
+			.def("save_pvr_to_bytes", [](pvrtexture::CPVRTexture& self){
+				return save_to_bytes(self, ContainerPVR, GetPVRFileSizeBound(self));
+			})
+			.def("save_dds_to_bytes", [](pvrtexture::CPVRTexture& self){
+				return save_to_bytes(self, ContainerDDS, GetDDSFileSizeBound(self));
 			})
 //			.def("save_ktx", [](pvrtexture::CPVRTexture& self, const char* filename){
 //				FILE* file = fopen(filename, "wb");
@@ -548,56 +712,75 @@ PYBIND11_MODULE(_pypvrtex, m)
 				FILE* file = fopen(filename, "wb");
 				self.privateSaveLegacyPVRFile(file, api);
 				fclose(file);
-			})
-			.def("open_view", [](pvrtexture::CPVRTexture& self, int mipmap, int face)
+			}, release_gil())
+			.def("open_view", [](pvrtexture::CPVRTexture& self, int mipmap, int face, bool writable, int array)
 			{
-				void* ptr = self.getDataPtr(mipmap, 0, face);
-				size_t size = self.getDataSize(mipmap, 0, face);
-				size_t width = self.getWidth(mipmap);
-				size_t height = self.getHeight(mipmap);
-				size_t depth = self.getDepth(mipmap);
-				std::vector<int> shape;
-				std::vector<int> strides;
-				int channel_count = GetChannelCount(self.getPixelType().PixelTypeID);
-				if (depth > 1)
+				// views of borrowed or shared data are read-only, a writable view gets the texture its own copy first.
+				// Views opened with writable=False are read-only as well, since copies may share the data with them
+				if (writable)
 				{
-					shape.push_back(depth);
-					strides.push_back(width * height * self.getBitsPerPixel() / 8);
+					MakeUnique(self);
+					MarkExposed(self);
 				}
-				shape.push_back(height);
-				strides.push_back(width * self.getBitsPerPixel() / 8);
-				shape.push_back(width);
-				strides.push_back(self.getBitsPerPixel() / 8);
-				shape.push_back(channel_count);
-				strides.push_back((self.getBitsPerPixel() / 8) / channel_count);
-				std::string dtype = "";
-				size_t item_size = (self.getBitsPerPixel() / 8) / channel_count;
-				switch(self.getChannelType())
+				return make_view(self, GetSurfacePtr(self, mipmap, array, face), mipmap, !writable || IsBorrowed(self));
+			}, py::arg("mipmap") = 0, py::arg("face") = 0, py::arg("writable") = true, py::arg("array") = 0, py::keep_alive<0, 1>())
+			;
+
+	py::class_<MappedPVR>(m, "MappedPVR")
+			.def(py::init<const char*>(), py::arg("filename"))
+			.def_property_readonly("pixel_format", [](MappedPVR& self){
+				return (Format)self.header().getPixelType().PixelTypeID;
+			})
+			.def_property_readonly("bpp", [](MappedPVR& self){ return self.header().getBitsPerPixel(); })
+			.def_property_readonly("colour_space", [](MappedPVR& self){ return self.header().getColourSpace(); })
+			.def_property_readonly("channel_type", [](MappedPVR& self){ return self.header().getChannelType(); })
+			.def("get_width", [](MappedPVR& self, uint32_t mipmap){ return self.header().getWidth(mipmap); }, py::arg("mipmap")=0)
+			.def("get_height", [](MappedPVR& self, uint32_t mipmap){ return self.header().getHeight(mipmap); }, py::arg("mipmap")=0)
+			.def("get_depth", [](MappedPVR& self, uint32_t mipmap){ return self.header().getDepth(mipmap); }, py::arg("mipmap")=0)
+			.def_property_readonly("num_array", [](MappedPVR& self){ return self.header().getNumArrayMembers(); })
+			.def_property_readonly("num_faces", [](MappedPVR& self){ return self.header().getNumFaces(); })
+			.def_property_readonly("num_mip_levels", [](MappedPVR& self){ return self.header().getNumMIPLevels(); })
+			.def_property_readonly("is_compressed", [](MappedPVR& self){ return self.header().isFileCompressed(); })
+			// same signature as PVRTexture.open_view, so that texture_tool.view works for both; it passes writable=False here
+			.def("open_view", [](MappedPVR& self, int mipmap, int face, bool writable, int array)
+			{
+				if (writable)
+					throw runtime_error("Memory mapped PVR files are read-only, use writable=False or load the texture");
+				return make_view(self.header(), (void*)self.GetSurface(mipmap, array, face), mipmap, true);
+			}, py::arg("mipmap") = 0, py::arg("face") = 0, py::arg("writable") = false, py::arg("array") = 0, py::keep_alive<0, 1>())
+			.def("load", &MappedPVR::Load, release_gil())
+			;
+
+	py::enum_<Container>(m, "Container")
+			.value("PVR", ContainerPVR)
+			.value("DDS", ContainerDDS)
+			.export_values();
+
+	py::class_<TextureWriter>(m, "TextureWriter")
+			.def(py::init([](const char* filename, Format pixel_type, int width, int height, int depth, int num_mipmap, int num_array, int num_faces, EPVRTColourSpace eColourSpace, EPVRTVariableType channelType, bool premultiplied, Container container)
+			{
+				pvrtexture::CPVRTextureHeader header(pixel_type, height, width, depth, num_mipmap, num_array, num_faces, eColourSpace, channelType, premultiplied);
+				header.setOrientation((EPVRTOrientation)(ePVRTOrientRight | ePVRTOrientDown));
+				return new TextureWriter(filename, header, container);
+			}), py::arg("filename"), py::arg("pixel_format"), py::arg("width"), py::arg("height"), py::arg("depth") = 1, py::arg("num_mipmap") = 1,
+				py::arg("num_array") = 1, py::arg("num_faces") = 1, py::arg("colour_space") = ePVRTCSpacelRGB,
+				py::arg("channel_type") = ePVRTVarTypeUnsignedByteNorm, py::arg("premultiplied") = false, py::arg("container") = ContainerPVR)
+			.def("write_surface", [](TextureWriter& self, uint32_t mipmap, uint32_t array, uint32_t face, py::buffer data)
+			{
+				ByteBuffer bytes(data);
+				py::gil_scoped_release release;
+				self.WriteSurface(mipmap, array, face, bytes.view.buf, bytes.view.len);
+			}, py::arg("mipmap"), py::arg("array"), py::arg("face"), py::arg("data"))
+			.def("close", &TextureWriter::Close, release_gil())
+			.def("__enter__", [](TextureWriter& self) -> TextureWriter& { return self; }, py::return_value_policy::reference)
+			.def("__exit__", [](TextureWriter& self, py::object type, py::object, py::object)
+			{
+				// on exception the file is left without header
+				if (type.is_none())
 				{
-                    case ePVRTVarTypeUnsignedByteNorm: dtype = py::format_descriptor<uint8_t>::format(); break;
-                    case ePVRTVarTypeSignedByteNorm: dtype = py::format_descriptor<int8_t>::format(); break;
-                    case ePVRTVarTypeUnsignedByte: dtype = py::format_descriptor<uint8_t>::format(); break;
-                    case  ePVRTVarTypeSignedByte: dtype = py::format_descriptor<int8_t>::format(); break;
-                    case ePVRTVarTypeUnsignedShortNorm: dtype = py::format_descriptor<uint16_t>::format(); break;
-                    case ePVRTVarTypeSignedShortNorm: dtype = py::format_descriptor<int16_t>::format(); break;
-                    case ePVRTVarTypeUnsignedShort: dtype = py::format_descriptor<uint16_t>::format(); break;
-                    case ePVRTVarTypeSignedShort: dtype = py::format_descriptor<int16_t>::format(); break;
-                    case ePVRTVarTypeUnsignedIntegerNorm: dtype = py::format_descriptor<uint32_t>::format(); break;
-                    case ePVRTVarTypeSignedIntegerNorm: dtype = py::format_descriptor<int32_t>::format(); break;
-                    case ePVRTVarTypeUnsignedInteger: dtype = py::format_descriptor<uint32_t>::format(); break;
-                    case ePVRTVarTypeSignedInteger: dtype = py::format_descriptor<int32_t>::format(); break;
-                    case ePVRTVarTypeFloat:
-                    case ePVRTVarTypeUnsignedFloat:
-                        dtype = py::format_descriptor<float>::format(); break;
+					py::gil_scoped_release release;
+					self.Close();
 				}
-				return TexView{
-						ptr,
-						item_size,
-						dtype,
-						shape.size(),
-						shape,
-						strides
-				};
 			})
 			;
 
@@ -610,7 +793,8 @@ PYBIND11_MODULE(_pypvrtex, m)
 						            m.format,
 						            m.ndim,
 						            m.shape,
-						            m.strides
+						            m.strides,
+						            m.readonly
 				            );
 			            });
 
@@ -618,17 +802,23 @@ PYBIND11_MODULE(_pypvrtex, m)
 	m.def("load_pvr", [](const char* filename)
 	{
 		auto pvr = new pvrtexture::CPVRTexture(filename);
+		if (IsUnsizedFormat(pvr->getPixelType().PixelTypeID))
+		{
+			// PVRTexLib reads only the header of these formats
+			delete pvr;
+			pvr = MappedPVR(filename).Load();
+		}
+		else
+		{
+			CountAllocatedBytes(pvr->getDataSize());
+		}
 		return pvr;
-	});
+	}, release_gil());
 
 	m.def("load_dds", [](const char* filename)
 	{
-		FILE* file = fopen(filename, "rb");
-		auto pvr = new pvrtexture::CPVRTexture();
-		pvr->privateLoadDDSFile(file);
-		fclose(file);
-		return pvr;
-	});
+		return LoadDDSFile(filename);
+	}, release_gil());
 
 	m.def("load_ktx", [](const char* filename)
 	{
@@ -636,7 +826,29 @@ PYBIND11_MODULE(_pypvrtex, m)
 		auto pvr = new pvrtexture::CPVRTexture();
 		pvr->privateLoadKTXFile(file);
 		fclose(file);
+		CountAllocatedBytes(pvr->getDataSize());
 		return pvr;
+	}, release_gil());
+
+	m.def("load_pvr_from_buffer", [](py::buffer buffer)
+	{
+		ByteBuffer bytes(buffer);
+		py::gil_scoped_release release;
+		return LoadPVRFromMemory(bytes.view.buf, bytes.view.len);
+	});
+
+	m.def("load_dds_from_buffer", [](py::buffer buffer)
+	{
+		ByteBuffer bytes(buffer);
+		py::gil_scoped_release release;
+		return LoadDDSFromMemory(bytes.view.buf, bytes.view.len);
+	});
+
+	m.def("load_ktx_from_buffer", [](py::buffer buffer)
+	{
+		ByteBuffer bytes(buffer);
+		py::gil_scoped_release release;
+		return LoadFromMemory(&pvrtexture::CPVRTexture::privateLoadKTXFile, bytes.view.buf, bytes.view.len);
 	});
 
 	m.def("check_if_pvr", [](const char* filename)
@@ -646,7 +858,7 @@ PYBIND11_MODULE(_pypvrtex, m)
 		fread(&w, 4, 1, file);
 		fclose(file);
 		return w == 0x03525650 || w == 0x50565203;
-	});
+	}, release_gil());
 
 	m.def("check_if_dds", [](const char* filename)
 	{
@@ -655,36 +867,389 @@ PYBIND11_MODULE(_pypvrtex, m)
 		fread(&w, 4, 1, file);
 		fclose(file);
 		return w == 0x20534444;
-	});
+	}, release_gil());
 
-	m.def("from_numpy", from_numpy<uint8_t>, py::arg("array"), py::arg("eColourSpace") = ePVRTCSpacelRGB, py::arg("normed") = true, py::arg("premultiplied") = false);
-	m.def("from_numpy", from_numpy<int8_t>, py::arg("array"), py::arg("eColourSpace") = ePVRTCSpacelRGB, py::arg("normed") = true, py::arg("premultiplied") = false);
-	m.def("from_numpy", from_numpy<uint16_t>, py::arg("array"), py::arg("eColourSpace") = ePVRTCSpacelRGB, py::arg("normed") = true, py::arg("premultiplied") = false);
-	m.def("from_numpy", from_numpy<int16_t>, py::arg("array"), py::arg("eColourSpace") = ePVRTCSpacelRGB, py::arg("normed") = true, py::arg("premultiplied") = false);
-	m.def("from_numpy", from_numpy<uint32_t>, py::arg("array"), py::arg("eColourSpace") = ePVRTCSpacelRGB, py::arg("normed") = true, py::arg("premultiplied") = false);
-	m.def("from_numpy", from_numpy<int32_t>, py::arg("array"), py::arg("eColourSpace") = ePVRTCSpacelRGB, py::arg("normed") = true, py::arg("premultiplied") = false);
-	m.def("from_numpy", from_numpy<float>, py::arg("array"), py::arg("eColourSpace") = ePVRTCSpacelRGB, py::arg("normed") = true, py::arg("premultiplied") = false);
+	m.def("from_numpy", from_numpy<uint8_t>, py::arg("array"), py::arg("eColourSpace") = ePVRTCSpacelRGB, py::arg("normed") = true, py::arg("premultiplied") = false, py::arg("copy") = true, py::arg("layout") = py::none(), py::arg("fill") = std::vector<double>());
+	m.def("from_numpy", from_numpy<int8_t>, py::arg("array"), py::arg("eColourSpace") = ePVRTCSpacelRGB, py::arg("normed") = true, py::arg("premultiplied") = false, py::arg("copy") = true, py::arg("layout") = py::none(), py::arg("fill") = std::vector<double>());
+	m.def("from_numpy", from_numpy<uint16_t>, py::arg("array"), py::arg("eColourSpace") = ePVRTCSpacelRGB, py::arg("normed") = true, py::arg("premultiplied") = false, py::arg("copy") = true, py::arg("layout") = py::none(), py::arg("fill") = std::vector<double>());
+	m.def("from_numpy", from_numpy<int16_t>, py::arg("array"), py::arg("eColourSpace") = ePVRTCSpacelRGB, py::arg("normed") = true, py::arg("premultiplied") = false, py::arg("copy") = true, py::arg("layout") = py::none(), py::arg("fill") = std::vector<double>());
+	m.def("from_numpy", from_numpy<uint32_t>, py::arg("array"), py::arg("eColourSpace") = ePVRTCSpacelRGB, py::arg("normed") = true, py::arg("premultiplied") = false, py::arg("copy") = true, py::arg("layout") = py::none(), py::arg("fill") = std::vector<double>());
+	m.def("from_numpy", from_numpy<int32_t>, py::arg("array"), py::arg("eColourSpace") = ePVRTCSpacelRGB, py::arg("normed") = true, py::arg("premultiplied") = false, py::arg("copy") = true, py::arg("layout") = py::none(), py::arg("fill") = std::vector<double>());
+	m.def("from_numpy", from_numpy<float>, py::arg("array"), py::arg("eColourSpace") = ePVRTCSpacelRGB, py::arg("normed") = true, py::arg("premultiplied") = false, py::arg("copy") = true, py::arg("layout") = py::none(), py::arg("fill") = std::vector<double>());
 
+	// Copies are copy-on-write, the data is shared with texture until one of them is modified
 	m.def("copy", [](pvrtexture::CPVRTexture& texture)
 	{
-		return new pvrtexture::CPVRTexture(texture);
-	});
+		std::unique_ptr<pvrtexture::CPVRTexture> copy(new pvrtexture::CPVRTexture());
+		static_cast<pvrtexture::CPVRTextureHeader&>(*copy) = texture;
+		ShareData(*copy, texture);
+		return copy.release();
+	}, release_gil());
+
+	m.def("inplace_resize", Mutating(pvrtexture::Resize), py::arg("texture"), py::arg("width"), py::arg("height"), py::arg("depth") = 1, py::arg("resize_mode") = pvrtexture::eResizeCubic, release_gil());
+	m.def("inplace_resize_canvas", Mutating(pvrtexture::ResizeCanvas), py::arg("texture"), py::arg("width"), py::arg("height"), py::arg("depth"), py::arg("x_offset"), py::arg("y_offset"), py::arg("z_offset"), release_gil());
+	m.def("inplace_rotate90", Mutating(pvrtexture::Rotate90), py::arg("texture"), py::arg("axis"), py::arg("forward"), release_gil());
+	m.def("inplace_flip", Mutating(pvrtexture::Flip), py::arg("texture"), py::arg("axis"), release_gil());
+	m.def("inplace_flip_cubemap", FlipCubemap, py::arg("texture"), py::arg("axis"), release_gil());
+	m.def("inplace_premultiply_alpha", Mutating(pvrtexture::PreMultiplyAlpha), py::arg("texture"), release_gil());
+	m.def("inplace_bleed", Mutating(pvrtexture::Bleed), py::arg("texture"), release_gil());
+	m.def("inplace_generate_mipmaps", Mutating(pvrtexture::GenerateMIPMaps), py::arg("texture"), py::arg("filter"), py::arg("mipmaps"), release_gil());
+	m.def("inplace_colour_mipmaps", Mutating(pvrtexture::ColourMIPMaps), py::arg("texture"), release_gil());
+	m.def("resize_native", ResizeTexture, py::arg("texture"), py::arg("width"), py::arg("height"), py::arg("depth"), py::arg("filter"), py::arg("gamma"), py::arg("colour_space"), release_gil());
+	// type is "area_average" or "bspline", see Downsample2x. Textures give a texture of the same format,
+	// arrays of [H, W, C] or [D, H, W, C] layout give a float32 array
+	m.def("downsample2x_native", [](const pvrtexture::CPVRTexture& texture, const std::string& type)
+	{
+		return Downsample2xTexture(texture, ParseDownsampleType(type));
+	}, py::arg("input"), py::arg("type"), release_gil());
+	m.def("downsample2x_native", [](py::array_t<float, py::array::c_style | py::array::forcecast> array, const std::string& type)
+	{
+		if (array.ndim() != 3 && array.ndim() != 4)
+		{
+			throw runtime_error("Expected an array of [H, W, C] or [D, H, W, C] layout, got %d dimensions", (int)array.ndim());
+		}
+		const bool volume = array.ndim() == 4;
+		const int depth = volume ? (int)array.shape(0) : 1;
+		const int height = (int)array.shape(volume ? 1 : 0);
+		const int width = (int)array.shape(volume ? 2 : 1);
+		const int channels = (int)array.shape(volume ? 3 : 2);
+		const DownsampleType downsample_type = ParseDownsampleType(type);
+		FloatImage image;
+		{
+			py::gil_scoped_release release;
+			Downsample2x(array.data(), width, height, depth, channels, downsample_type, image);
+		}
+		std::vector<py::ssize_t> shape = {image.height, image.width, image.channels};
+		if (volume)
+		{
+			shape.insert(shape.begin(), image.depth);
+		}
+		py::array_t<float> result(shape);
+		std::copy(image.data.begin(), image.data.end(), result.mutable_data());
+		return result;
+	}, py::arg("input"), py::arg("type"));
+	m.def("generate_mipmaps_native", [](const pvrtexture::CPVRTexture& texture, ResampleFilter filter, float gamma, EPVRTColourSpace colour_space)
+	{
+		TextureCache& cache = TextureCache::GetDefault();
+		const bool cached = cache.IsEnabled();
+		CacheKey key;
+		if (cached)
+		{
+			key.Add(std::string("generate_mipmaps"));
+			key.AddTexture(texture);
+			key.Add(filter);
+			key.Add(gamma);
+			key.Add(colour_space);
+			std::unique_ptr<pvrtexture::CPVRTexture> hit = cache.Load(key);
+			if (hit)
+			{
+				return hit.release();
+			}
+		}
+		std::unique_ptr<pvrtexture::CPVRTexture> result(GenerateMipmaps(texture, filter, gamma, colour_space));
+		if (cached)
+		{
+			cache.Store(key, *result);
+		}
+		return result.release();
+	}, py::arg("texture"), py::arg("filter"), py::arg("gamma"), py::arg("colour_space"), release_gil());
+	// engine="native" compresses with the in-tree encoders, it does not dither
+	m.def("inplace_transcode", [](pvrtexture::CPVRTexture& texture, Format format, const EPVRTVariableType channel_type, const EPVRTColourSpace colour_space, const pvrtexture::ECompressorQuality quality, const bool dither, const std::string& engine)
+	{
+		const bool native = UsesNativeEncoder(engine, format);
+		TextureCache& cache = TextureCache::GetDefault();
+		const bool cached = cache.IsEnabled();
+		CacheKey key;
+		if (cached)
+		{
+			key = TranscodeCacheKey(texture, format, channel_type, colour_space, quality, dither, native);
+			std::unique_ptr<pvrtexture::CPVRTexture> hit = cache.Load(key);
+			if (hit)
+			{
+				ReplaceTexture(texture, *hit);
+				return true;
+			}
+		}
+		if (native)
+		{
+			TranscodeNative(texture, format, channel_type, colour_space, quality);
+		}
+		else
+		{
+			MakeUnique(texture);
+			if (!pvrtexture::Transcode(texture, format, channel_type, colour_space, quality, dither))
+			{
+				return false;
+			}
+			CountAllocatedBytes(texture.getDataSize());
+		}
+		if (cached)
+		{
+			cache.Store(key, texture);
+		}
+		return true;
+	}, py::arg("texture"), py::arg("format"), py::arg("channel_type"), py::arg("colour_space"), py::arg("quality")=pvrtexture::ePVRTCNormal, py::arg("dither")=false, py::arg("engine")="pvrtexlib", release_gil());
+	m.def("has_native_encoder", [](Format format){ return HasNativeEncoder(format); }, py::arg("format"));
+	m.def("has_native_decoder", [](Format format){ return HasNativeDecoder(format); }, py::arg("format"));
+	// Decodes a compressed surface to RGBA, shaped (height, width, 4), or (depth, height, width, 4) for volume textures.
+	// The array is uint8, or float32 for formats that decode to float, see IsFloatDecoded. If out is given, it has to be
+	// a writable C-contiguous array of that shape and type, it is filled and returned
+	m.def("decode", [](pvrtexture::CPVRTexture& texture, uint32_t mipmap, uint32_t face, uint32_t array, py::object out)
+	{
+		const uint64_t format = texture.getPixelType().PixelTypeID;
+		if (!HasNativeDecoder(format))
+		{
+			throw runtime_error("No native decoder for pixel format %llu", (unsigned long long)format);
+		}
+		const uint8_t* surface = GetSurfacePtr(texture, mipmap, array, face);
+		std::vector<py::ssize_t> shape = {(py::ssize_t)texture.getHeight(mipmap), (py::ssize_t)texture.getWidth(mipmap), 4};
+		if (texture.getDepth(mipmap) > 1)
+		{
+			shape.insert(shape.begin(), (py::ssize_t)texture.getDepth(mipmap));
+		}
+		py::dtype dtype = IsFloatDecoded(texture) ? py::dtype::of<float>() : py::dtype::of<uint8_t>();
 
-	m.def("inplace_resize", pvrtexture::Resize, py::arg("texture"), py::arg("width"), py::arg("height"), py::arg("depth") = 1, py::arg("resize_mode") = pvrtexture::eResizeCubic);
-	m.def("inplace_resize_canvas", pvrtexture::ResizeCanvas, py::arg("texture"), py::arg("width"), py::arg("height"), py::arg("depth"), py::arg("x_offset"), py::arg("y_offset"), py::arg("z_offset"));
-	m.def("inplace_rotate90", pvrtexture::Rotate90, py::arg("texture"), py::arg("axis"), py::arg("forward"));
-	m.def("inplace_flip", pvrtexture::Flip, py::arg("texture"), py::arg("axis"));
-	m.def("inplace_premultiply_alpha", pvrtexture::PreMultiplyAlpha, py::arg("texture"));
-	m.def("inplace_bleed", pvrtexture::Bleed, py::arg("texture"));
-	m.def("inplace_generate_mipmaps", pvrtexture::GenerateMIPMaps, py::arg("texture"), py::arg("filter"), py::arg("mipmaps"));
-	m.def("inplace_colour_mipmaps", pvrtexture::ColourMIPMaps, py::arg("texture"));
-	m.def("inplace_transcode", [](pvrtexture::CPVRTexture& texture, Format format, const EPVRTVariableType channel_type, const EPVRTColourSpace colour_space, const pvrtexture::ECompressorQuality quality, const bool dither)
-	{
-		return pvrtexture::Transcode(texture, format, channel_type, colour_space, quality, dither);
-	}, py::arg("texture"), py::arg("format"), py::arg("channel_type"), py::arg("colour_space"), py::arg("quality")=pvrtexture::ePVRTCNormal, py::arg("dither")=false);
+		py::array result;
+		if (out.is_none())
+		{
+			result = py::array(dtype, shape);
+		}
+		else
+		{
+			if (!py::isinstance<py::array>(out))
+			{
+				throw runtime_error("out has to be a numpy array");
+			}
+			result = out.cast<py::array>();
+			bool same_shape = result.ndim() == (py::ssize_t)shape.size();
+			for (size_t i = 0; same_shape && i < shape.size(); ++i)
+			{
+				same_shape = result.shape(i) == shape[i];
+			}
+			bool same_type = result.dtype().kind() == dtype.kind() && result.dtype().itemsize() == dtype.itemsize();
+			if (!same_shape || !same_type)
+			{
+				throw runtime_error("out does not match the shape or the type of the decoded surface");
+			}
+			if ((result.flags() & py::array::c_style) == 0 || !result.writeable())
+			{
+				throw runtime_error("out has to be writable and C-contiguous");
+			}
+		}
+		void* rgba = result.mutable_data();
+		{
+			py::gil_scoped_release release;
+			DecodeSurface(texture, surface, mipmap, rgba);
+		}
+		return result;
+	}, py::arg("texture"), py::arg("mipmap") = 0, py::arg("face") = 0, py::arg("array") = 0, py::arg("out") = py::none());
+	// engine and caching work as in inplace_transcode, threads only applies to PVRTexLib
+	m.def("transcode_batch", [](const std::vector<pvrtexture::CPVRTexture*>& textures, Format format, const EPVRTVariableType channel_type, const EPVRTColourSpace colour_space, const pvrtexture::ECompressorQuality quality, const bool dither, int threads, const std::string& engine)
+	{
+		return TranscodeBatch(textures, format, channel_type, colour_space, quality, dither, UsesNativeEncoder(engine, format), threads);
+	}, py::arg("textures"), py::arg("format"), py::arg("channel_type"), py::arg("colour_space"), py::arg("quality")=pvrtexture::ePVRTCNormal, py::arg("dither")=false, py::arg("threads")=0, py::arg("engine")="pvrtexlib", py::return_value_policy::take_ownership, release_gil());
+	// Returns a dict with the requested metrics over the channels of the reference format. With per_channel, "channels"
+	// maps each of these channels to a dict of its own metrics. With heatmap, "heatmap" is a float32 array of 4x4 block
+	// MSE, shaped (blocks_y * depth, blocks_x)
+	m.def("compare", [](const pvrtexture::CPVRTexture& reference, const pvrtexture::CPVRTexture& candidate, const std::vector<std::string>& metrics, bool per_channel, bool heatmap, uint32_t mipmap, uint32_t face, uint32_t array)
+	{
+		int flags = 0;
+		for (const std::string& metric: metrics)
+		{
+			if (metric == "psnr")
+				flags |= MetricPSNR;
+			else if (metric == "ssim")
+				flags |= MetricSSIM;
+			else if (metric == "max_err")
+				flags |= MetricMaxError;
+			else
+				throw runtime_error("Unknown metric %s, expected psnr, ssim or max_err", metric.c_str());
+		}
+		CompareResult result;
+		{
+			py::gil_scoped_release release;
+			result = CompareSurfaces(reference, candidate, mipmap, array, face, flags, heatmap);
+		}
+		auto to_dict = [flags](const ChannelMetrics& m)
+		{
+			py::dict d;
+			if (flags & MetricPSNR)
+				d["psnr"] = m.psnr;
+			if (flags & MetricSSIM)
+				d["ssim"] = m.ssim;
+			if (flags & MetricMaxError)
+				d["max_err"] = m.max_error;
+			return d;
+		};
+		py::dict output = to_dict(result.overall);
+		if (per_channel)
+		{
+			py::dict channels;
+			for (char name: result.channels)
+			{
+				int c = name == 'r' ? 0 : name == 'g' ? 1 : name == 'b' ? 2 : 3;
+				channels[py::str(std::string(1, name))] = to_dict(result.channel[c]);
+			}
+			output["channels"] = channels;
+		}
+		if (heatmap)
+		{
+			py::array_t<float> map({(py::ssize_t)result.heatmap_height, (py::ssize_t)result.heatmap_width});
+			std::copy(result.heatmap.begin(), result.heatmap.end(), map.mutable_data());
+			output["heatmap"] = map;
+		}
+		return output;
+	}, py::arg("reference"), py::arg("candidate"), py::arg("metrics") = std::vector<std::string>{"psnr", "ssim", "max_err"},
+		py::arg("per_channel") = false, py::arg("heatmap") = false, py::arg("mipmap") = 0, py::arg("face") = 0, py::arg("array") = 0);
+	// Compresses the texture with the cheapest of the candidate formats, and the fastest of the quality levels, that reach
+	// min_psnr on the top mip level, see AutoCompress. Channel type and colour space default to those of the texture.
+	// Returns a dict with the compressed "texture" (None if nothing was encoded), its "format", "quality" and "psnr",
+	// "target_met", "budget_exceeded", "elapsed_ms" and a list of per "candidates" dicts
+	m.def("auto_compress", [](const pvrtexture::CPVRTexture& texture, const std::vector<Format>& candidates, double min_psnr, double budget_ms, const std::vector<pvrtexture::ECompressorQuality>& qualities, py::object channel_type, py::object colour_space, int sample_blocks)
+	{
+		std::vector<uint64_t> formats(candidates.begin(), candidates.end());
+		EPVRTVariableType type = channel_type.is_none() ? texture.getChannelType() : channel_type.cast<EPVRTVariableType>();
+		EPVRTColourSpace space = colour_space.is_none() ? texture.getColourSpace() : colour_space.cast<EPVRTColourSpace>();
+		AutoResult result;
+		{
+			py::gil_scoped_release release;
+			result = AutoCompress(texture, formats, qualities, type, space, min_psnr, budget_ms, sample_blocks);
+		}
+		py::list list;
+		for (const AutoCandidate& candidate: result.candidates)
+		{
+			py::dict d;
+			d["format"] = (Format)candidate.format;
+			d["quality"] = candidate.quality;
+			d["bits_per_texel"] = candidate.bits_per_texel;
+			d["sampled"] = candidate.sampled;
+			d["pruned"] = candidate.pruned;
+			d["encoded"] = candidate.encoded;
+			d["estimated_psnr"] = candidate.sampled ? py::cast(candidate.estimated_psnr) : py::none();
+			d["psnr"] = candidate.encoded ? py::cast(candidate.psnr) : py::none();
+			d["sample_ms"] = candidate.sample_ms;
+			d["encode_ms"] = candidate.encode_ms;
+			list.append(d);
+		}
+		py::dict output;
+		if (result.chosen >= 0)
+		{
+			const AutoCandidate& chosen = result.candidates[result.chosen];
+			output["texture"] = py::cast(result.texture.release(), py::return_value_policy::take_ownership);
+			output["format"] = (Format)chosen.format;
+			output["quality"] = chosen.quality;
+			output["psnr"] = chosen.psnr;
+		}
+		else
+		{
+			output["texture"] = py::none();
+			output["format"] = py::none();
+			output["quality"] = py::none();
+			output["psnr"] = py::none();
+		}
+		output["target_met"] = result.target_met;
+		output["budget_exceeded"] = result.budget_exceeded;
+		output["elapsed_ms"] = result.elapsed_ms;
+		output["candidates"] = list;
+		return output;
+	}, py::arg("texture"), py::arg("candidates"), py::arg("min_psnr"), py::arg("budget_ms") = 0.0,
+		py::arg("qualities") = std::vector<pvrtexture::ECompressorQuality>{pvrtexture::ePVRTCFastest, pvrtexture::ePVRTCNormal, pvrtexture::ePVRTCBest},
+		py::arg("channel_type") = py::none(), py::arg("colour_space") = py::none(), py::arg("sample_blocks") = 256);
+	// Results of inplace_transcode and generate_mipmaps_native are cached in directory, keyed by a hash of the source
+	// texture and of the parameters. max_size bounds the total size of the entries in bytes
+	m.def("enable_cache", [](const std::string& directory, uint64_t max_size){ TextureCache::GetDefault().Enable(directory, max_size); },
+		py::arg("directory"), py::arg("max_size") = (uint64_t)4 << 30u, release_gil());
+	m.def("disable_cache", []{ TextureCache::GetDefault().Disable(); });
+	m.def("clear_cache", []{ TextureCache::GetDefault().Clear(); }, release_gil());
+	m.def("cache_stats", []
+	{
+		CacheStats stats = TextureCache::GetDefault().GetStats();
+		py::dict d;
+		d["hits"] = stats.hits;
+		d["misses"] = stats.misses;
+		d["stores"] = stats.stores;
+		d["evictions"] = stats.evictions;
+		d["entries"] = stats.entries;
+		d["size"] = stats.size;
+		d["max_size"] = stats.max_size;
+		d["enabled"] = TextureCache::GetDefault().IsEnabled();
+		return d;
+	});
+	m.def("reset_cache_stats", []{ TextureCache::GetDefault().ResetStats(); });
+	// Memory use of the process in bytes, see MemoryStats. Used by texture_tool.bench to account for native allocations
+	m.def("memory_stats", []
+	{
+		MemoryStats stats = GetMemoryStats();
+		py::dict d;
+		d["rss"] = stats.rss;
+		d["peak_rss"] = stats.peak_rss;
+		d["heap"] = stats.heap;
+		return d;
+	});
+	m.def("reset_peak_memory", ResetPeakRSS);
+	m.def("cubemap_from_equirectangular_native", CubemapFromEquirectangular, py::arg("texture"), py::arg("cubemap_size") = 0, py::arg("interpolation") = InterpolationBilinear, py::arg("gamma") = 2.2f, release_gil());
 	m.def("format_from_string", [](const char* str){
 		uint64_t format = parseType(str);
 		return (Format)format;
 	});
 	m.def("new_texture", new_texture);
+
+	// Calls of everything defined above are recorded by the profiler, calls of the profiler bindings are not.
+	// Leaked, the objects it holds can not be released after the interpreter is finalized
+	auto* profiled = new ProfiledBindings(m);
+	// Starts recording calls of the bindings; with trace, every call is also kept for save_trace
+	m.def("enable_profiling", [profiled](bool trace)
+	{
+		profiled->Install();
+		Profiler::GetDefault().Enable(trace);
+	}, py::arg("trace") = false);
+	m.def("disable_profiling", [profiled]
+	{
+		Profiler::GetDefault().Disable();
+		profiled->Uninstall();
+	});
+	// Per binding: calls, total_ms, max_ms, allocated and copied bytes, and the same per pixel format of the
+	// texture it was called on under "formats". Bytes are counted per call, see profiler.h
+	m.def("stats", []
+	{
+		auto to_dict = [](const ProfileStats& stats)
+		{
+			py::dict d;
+			d["calls"] = stats.calls;
+			d["total_ms"] = stats.total_ms;
+			d["max_ms"] = stats.max_ms;
+			d["allocated"] = stats.allocated;
+			d["copied"] = stats.copied;
+			return d;
+		};
+		py::dict output;
+		for (auto& operation: Profiler::GetDefault().GetStats())
+		{
+			py::dict formats;
+			py::dict d;
+			for (auto& format: operation.second)
+			{
+				if (format.first.empty())
+					d = to_dict(format.second);
+				else
+					formats[py::str(format.first)] = to_dict(format.second);
+			}
+			d["formats"] = formats;
+			output[py::str(operation.first)] = d;
+		}
+		return output;
+	});
+	m.def("reset_stats", []{ Profiler::GetDefault().Reset(); });
+	// Chrome trace event JSON of the calls recorded with enable_profiling(trace=True)
+	m.def("save_trace", [](const char* filename)
+	{
+		std::string trace = Profiler::GetDefault().GetTrace();
+		FILE* file = fopen(filename, "wb");
+		if (file == nullptr)
+			throw runtime_error("Can not open file %s for writing", filename);
+		size_t written = fwrite(trace.data(), 1, trace.size(), file);
+		fclose(file);
+		if (written != trace.size())
+			throw runtime_error("Failed to write trace to %s", filename);
+	}, py::arg("filename"), release_gil());
 }
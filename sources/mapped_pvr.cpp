@@ -0,0 +1,179 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#include "mapped_pvr.h"
+#include "container.h"
+#include "storage.h"
+#include "profiler.h"
+#include "common.h"
+
+#include <cstring>
+#include <memory>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+MappedPVR::MappedPVR(const char* filename): m_mapping(nullptr), m_size(0), m_data_offset(0)
+{
+#ifdef _WIN32
+	m_file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE)
+	{
+		throw runtime_error("Can not open file %s", filename);
+	}
+	LARGE_INTEGER size;
+	GetFileSizeEx(m_file, &size);
+	m_size = (size_t)size.QuadPart;
+	m_mapping_handle = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping_handle != nullptr)
+	{
+		m_mapping = (const uint8_t*)MapViewOfFile(m_mapping_handle, FILE_MAP_READ, 0, 0, 0);
+	}
+	if (m_mapping == nullptr)
+	{
+		if (m_mapping_handle != nullptr)
+		{
+			CloseHandle(m_mapping_handle);
+		}
+		CloseHandle(m_file);
+		throw runtime_error("Can not map file %s", filename);
+	}
+#else
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+	{
+		throw runtime_error("Can not open file %s", filename);
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		throw runtime_error("Can not read file %s", filename);
+	}
+	m_size = (size_t)st.st_size;
+	void* mapping = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+	// mapping stays valid after the descriptor is closed
+	close(fd);
+	if (mapping == MAP_FAILED)
+	{
+		throw runtime_error("Can not map file %s", filename);
+	}
+	m_mapping = (const uint8_t*)mapping;
+#endif
+
+	try
+	{
+		PVRTextureHeaderV3 file_header;
+		if (m_size < PVRTEX3_HEADERSIZE)
+		{
+			throw runtime_error("File %s is too small for a PVR file", filename);
+		}
+		memcpy(&file_header, m_mapping, PVRTEX3_HEADERSIZE);
+		if (file_header.u32Version != PVRTEX3_IDENT)
+		{
+			throw runtime_error("File %s is not a PVR v3 file with native byte order", filename);
+		}
+		size_t metadata_size = file_header.u32MetaDataSize;
+		m_data_offset = PVRTEX3_HEADERSIZE + metadata_size;
+		if (m_data_offset > m_size)
+		{
+			throw runtime_error("Metadata of %s is truncated", filename);
+		}
+
+		// metadata size is accumulated by addMetaData
+		file_header.u32MetaDataSize = 0;
+		m_header = pvrtexture::CPVRTextureHeader(file_header);
+
+		const uint8_t* p = m_mapping + PVRTEX3_HEADERSIZE;
+		const uint8_t* end = m_mapping + m_data_offset;
+		while (end - p >= 12)
+		{
+			MetaDataBlock block;
+			memcpy(&block.DevFOURCC, p, 4);
+			memcpy(&block.u32Key, p + 4, 4);
+			memcpy(&block.u32DataSize, p + 8, 4);
+			p += 12;
+			if ((size_t)(end - p) < block.u32DataSize)
+			{
+				throw runtime_error("Metadata block of %s is truncated", filename);
+			}
+			block.Data = new PVRTuint8[block.u32DataSize];
+			memcpy(block.Data, p, block.u32DataSize);
+			p += block.u32DataSize;
+			m_header.addMetaData(block);
+		}
+
+		if (m_data_offset + GetTextureDataSize(m_header) > m_size)
+		{
+			throw runtime_error("Texture data of %s is truncated, expected %llu bytes, but file has %llu", filename,
+					(unsigned long long)(m_data_offset + GetTextureDataSize(m_header)), (unsigned long long)m_size);
+		}
+	}
+	catch (...)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(m_mapping);
+		CloseHandle(m_mapping_handle);
+		CloseHandle(m_file);
+#else
+		munmap((void*)m_mapping, m_size);
+#endif
+		throw;
+	}
+}
+
+MappedPVR::~MappedPVR()
+{
+#ifdef _WIN32
+	UnmapViewOfFile(m_mapping);
+	CloseHandle(m_mapping_handle);
+	CloseHandle(m_file);
+#else
+	munmap((void*)m_mapping, m_size);
+#endif
+}
+
+const uint8_t* MappedPVR::GetSurface(uint32_t mip, uint32_t array, uint32_t face) const
+{
+	if (mip >= m_header.getNumMIPLevels() || array >= m_header.getNumArrayMembers() || face >= m_header.getNumFaces())
+	{
+		throw runtime_error("Surface index out of range: mip %d, array %d, face %d", mip, array, face);
+	}
+	return m_mapping + m_data_offset + GetPVRSurfaceOffset(m_header, mip, array, face);
+}
+
+pvrtexture::CPVRTexture* MappedPVR::Load() const
+{
+	if (!IsUnsizedFormat(m_header.getPixelType().PixelTypeID))
+	{
+		CountAllocatedBytes(GetTextureDataSize(m_header));
+		CountCopiedBytes(GetTextureDataSize(m_header));
+		return new pvrtexture::CPVRTexture(m_header, m_mapping + m_data_offset);
+	}
+	std::unique_ptr<pvrtexture::CPVRTexture> texture(new pvrtexture::CPVRTexture(m_header));
+	AllocateData(*texture);
+	memcpy(texture->m_pTextureData, m_mapping + m_data_offset, texture->m_stDataSize);
+	CountCopiedBytes(texture->m_stDataSize);
+	return texture.release();
+}
@@ -0,0 +1,52 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#pragma once
+#include <PVRTexture.h>
+
+#include <cstdint>
+#include <cstddef>
+
+
+// Read-only PVR v3 container mapped into memory. Only the header and metadata are parsed on open,
+// texture data is paged in by the OS when a surface is accessed, so opening a multi-GB file is cheap.
+class MappedPVR
+{
+public:
+	explicit MappedPVR(const char* filename);
+	~MappedPVR();
+
+	MappedPVR(const MappedPVR&) = delete;
+	MappedPVR& operator=(const MappedPVR&) = delete;
+
+	const pvrtexture::CPVRTextureHeader& header() const { return m_header; }
+
+	// Surface of the given mip level, array member and face. Size is GetSurfaceSize(header(), mip)
+	const uint8_t* GetSurface(uint32_t mip, uint32_t array, uint32_t face) const;
+
+	// Reads the whole texture into a new CPVRTexture
+	pvrtexture::CPVRTexture* Load() const;
+
+private:
+	pvrtexture::CPVRTextureHeader m_header;
+	const uint8_t* m_mapping;
+	size_t m_size;
+	size_t m_data_offset;
+#ifdef _WIN32
+	void* m_file;
+	void* m_mapping_handle;
+#endif
+};
@@ -0,0 +1,132 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#include "memory_stats.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#include <cstdio>
+#include <cstring>
+#endif
+
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+namespace
+{
+	// Value of a "Name:   1234 kB" line of /proc/self/status
+	uint64_t ParseStatusField(const char* line, const char* name)
+	{
+		size_t length = strlen(name);
+		if (strncmp(line, name, length) != 0 || line[length] != ':')
+		{
+			return 0;
+		}
+		unsigned long long kb = 0;
+		sscanf(line + length + 1, "%llu", &kb);
+		return kb * 1024u;
+	}
+}
+#endif
+
+MemoryStats GetMemoryStats()
+{
+	MemoryStats stats = {};
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS_EX counters = {};
+	if (GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&counters, sizeof(counters)))
+	{
+		stats.rss = counters.WorkingSetSize;
+		stats.peak_rss = counters.PeakWorkingSetSize;
+	}
+#elif defined(__APPLE__)
+	mach_task_basic_info_data_t info;
+	mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+	if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) == KERN_SUCCESS)
+	{
+		stats.rss = info.resident_size;
+		stats.peak_rss = info.resident_size_max;
+	}
+#else
+	FILE* file = fopen("/proc/self/status", "r");
+	if (file != nullptr)
+	{
+		char line[256];
+		while (fgets(line, sizeof(line), file) != nullptr)
+		{
+			if (uint64_t value = ParseStatusField(line, "VmRSS"))
+			{
+				stats.rss = value;
+			}
+			else if (uint64_t value = ParseStatusField(line, "VmHWM"))
+			{
+				stats.peak_rss = value;
+			}
+		}
+		fclose(file);
+	}
+#endif
+	stats.heap = GetHeapBytes();
+	return stats;
+}
+
+uint64_t GetHeapBytes()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS_EX counters = {};
+	if (GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&counters, sizeof(counters)))
+	{
+		return counters.PrivateUsage;
+	}
+	return 0;
+#elif defined(__APPLE__)
+	malloc_statistics_t heap;
+	malloc_zone_statistics(nullptr, &heap);
+	return heap.size_in_use;
+#elif defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+	struct mallinfo2 info = mallinfo2();
+	return info.uordblks + info.hblkhd;
+#elif defined(__GLIBC__)
+	// Fields are int and wrap past 4GB
+	struct mallinfo info = mallinfo();
+	return (uint64_t)(unsigned int)info.uordblks + (unsigned int)info.hblkhd;
+#else
+	return 0;
+#endif
+}
+
+bool ResetPeakRSS()
+{
+#if defined(_WIN32) || defined(__APPLE__)
+	return false;
+#else
+	// Writing 5 to clear_refs resets VmHWM to the current RSS, since Linux 4.0
+	FILE* file = fopen("/proc/self/clear_refs", "w");
+	if (file == nullptr)
+	{
+		return false;
+	}
+	bool ok = fputs("5", file) >= 0;
+	ok = fclose(file) == 0 && ok;
+	return ok;
+#endif
+}
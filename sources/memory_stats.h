@@ -0,0 +1,40 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#pragma once
+#include <cstdint>
+
+
+// Memory use of the whole process, in bytes. Fields that the platform does not report are 0
+struct MemoryStats
+{
+	// Resident set size
+	uint64_t rss;
+	// Largest resident set size since the start of the process or since the last ResetPeakRSS
+	uint64_t peak_rss;
+	// Bytes in use by the C allocator: texture data, native temporaries and PVRTexLib buffers.
+	// Private committed bytes on Windows
+	uint64_t heap;
+};
+
+MemoryStats GetMemoryStats();
+
+// MemoryStats::heap alone, without reading the resident set size
+uint64_t GetHeapBytes();
+
+// Starts peak_rss over from the current resident set size. Only Linux supports it, elsewhere returns false and
+// peak_rss keeps counting from the start of the process
+bool ResetPeakRSS();
@@ -0,0 +1,256 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#include "memory_stream.h"
+#include "container.h"
+#include "storage.h"
+#include "profiler.h"
+#include "common.h"
+
+#include <cstring>
+#include <memory>
+
+
+namespace
+{
+	enum
+	{
+		// "DDS " magic, DDS_HEADER and DDS_HEADER_DXT10
+		DDSHeaderBound = 4 + 124 + 20
+	};
+
+	struct FileCloser
+	{
+		void operator()(FILE* file) const { fclose(file); }
+	};
+
+	typedef std::unique_ptr<FILE, FileCloser> File;
+
+	File OpenForReading(const void* data, size_t size)
+	{
+#ifdef _WIN32
+		File file(tmpfile());
+		if (file && fwrite(data, 1, size, file.get()) == size)
+		{
+			rewind(file.get());
+		}
+		else
+		{
+			file.reset();
+		}
+#else
+		File file(fmemopen(const_cast<void*>(data), size, "rb"));
+#endif
+		if (!file)
+		{
+			throw runtime_error("Failed to open memory stream of %d bytes", (int)size);
+		}
+		return file;
+	}
+}
+
+
+pvrtexture::CPVRTexture* LoadPVRFromMemory(const void* data, size_t size)
+{
+	if (size >= PVRTEX3_HEADERSIZE)
+	{
+		PVRTextureHeaderV3 file_header;
+		memcpy(&file_header, data, PVRTEX3_HEADERSIZE);
+		if (file_header.u32Version == PVRTEX3_IDENT)
+		{
+			pvrtexture::CPVRTextureHeader header(file_header);
+			uint64_t expected = (uint64_t)PVRTEX3_HEADERSIZE + file_header.u32MetaDataSize + GetTextureDataSize(header);
+			if (expected > size)
+			{
+				throw runtime_error("PVR data is truncated, expected %llu bytes, but got %llu", (unsigned long long)expected, (unsigned long long)size);
+			}
+			std::unique_ptr<pvrtexture::CPVRTexture> texture(new pvrtexture::CPVRTexture(data));
+			if (IsUnsizedFormat(header.getPixelType().PixelTypeID))
+			{
+				AllocateData(*texture);
+				memcpy(texture->m_pTextureData, (const uint8_t*)data + PVRTEX3_HEADERSIZE + file_header.u32MetaDataSize, texture->m_stDataSize);
+			}
+			else
+			{
+				CountAllocatedBytes(texture->m_stDataSize);
+			}
+			CountCopiedBytes(texture->m_stDataSize);
+			return texture.release();
+		}
+	}
+	// legacy and byte swapped headers
+	return LoadFromMemory(&pvrtexture::CPVRTexture::privateLoadPVRFile, data, size);
+}
+
+pvrtexture::CPVRTexture* LoadDDSFromMemory(const void* data, size_t size)
+{
+	pvrtexture::CPVRTextureHeader header;
+	size_t data_offset;
+	if (!ReadUnsizedDDSHeader(data, size, header, data_offset))
+	{
+		return LoadFromMemory(&pvrtexture::CPVRTexture::privateLoadDDSFile, data, size);
+	}
+	uint64_t expected = (uint64_t)data_offset + GetTextureDataSize(header);
+	if (expected > size)
+	{
+		throw runtime_error("DDS data is truncated, expected %llu bytes, but got %llu", (unsigned long long)expected, (unsigned long long)size);
+	}
+	std::unique_ptr<pvrtexture::CPVRTexture> texture(new pvrtexture::CPVRTexture(header));
+	AllocateData(*texture);
+	const uint8_t* src = (const uint8_t*)data + data_offset;
+	for (uint32_t mip = 0; mip < header.getNumMIPLevels(); ++mip)
+	{
+		for (uint32_t array = 0; array < header.getNumArrayMembers(); ++array)
+		{
+			for (uint32_t face = 0; face < header.getNumFaces(); ++face)
+			{
+				memcpy(GetSurfacePtr(*texture, mip, array, face), src + GetDDSSurfaceOffset(header, mip, array, face),
+				       GetSurfaceSize(header, mip));
+			}
+		}
+	}
+	CountCopiedBytes(texture->m_stDataSize);
+	return texture.release();
+}
+
+pvrtexture::CPVRTexture* LoadDDSFile(const char* filename)
+{
+	File file(fopen(filename, "rb"));
+	if (!file)
+	{
+		throw runtime_error("Can not open file %s", filename);
+	}
+	uint8_t bytes[DDSHeaderBound];
+	size_t read = fread(bytes, 1, sizeof(bytes), file.get());
+	pvrtexture::CPVRTextureHeader header;
+	size_t data_offset;
+	if (!ReadUnsizedDDSHeader(bytes, read, header, data_offset))
+	{
+		rewind(file.get());
+		std::unique_ptr<pvrtexture::CPVRTexture> texture(new pvrtexture::CPVRTexture());
+		if (!texture->privateLoadDDSFile(file.get()))
+		{
+			throw runtime_error("Failed to load %s", filename);
+		}
+		CountAllocatedBytes(texture->getDataSize());
+		return texture.release();
+	}
+	std::unique_ptr<pvrtexture::CPVRTexture> texture(new pvrtexture::CPVRTexture(header));
+	AllocateData(*texture);
+	// surfaces are stored one after another in the order of GetDDSSurfaceOffset
+	fseek(file.get(), (long)data_offset, SEEK_SET);
+	for (uint32_t array = 0; array < header.getNumArrayMembers(); ++array)
+	{
+		for (uint32_t face = 0; face < header.getNumFaces(); ++face)
+		{
+			for (uint32_t mip = 0; mip < header.getNumMIPLevels(); ++mip)
+			{
+				size_t surface_size = GetSurfaceSize(header, mip);
+				if (fread(GetSurfacePtr(*texture, mip, array, face), 1, surface_size, file.get()) != surface_size)
+				{
+					throw runtime_error("DDS data of %s is truncated", filename);
+				}
+			}
+		}
+	}
+	CountCopiedBytes(texture->m_stDataSize);
+	return texture.release();
+}
+
+pvrtexture::CPVRTexture* LoadFromMemory(LoadFunction load, const void* data, size_t size)
+{
+	File file = OpenForReading(data, size);
+	std::unique_ptr<pvrtexture::CPVRTexture> texture(new pvrtexture::CPVRTexture());
+	if (!((*texture).*load)(file.get()))
+	{
+		throw runtime_error("Failed to load texture from buffer");
+	}
+	CountAllocatedBytes(texture->getDataSize());
+	return texture.release();
+}
+
+size_t GetPVRFileSizeBound(const pvrtexture::CPVRTexture& texture)
+{
+	return PVRTEX3_HEADERSIZE + (size_t)texture.getMetaDataSize() + GetTextureDataSize(texture);
+}
+
+size_t GetDDSFileSizeBound(const pvrtexture::CPVRTexture& texture)
+{
+	return DDSHeaderBound + GetTextureDataSize(texture);
+}
+
+size_t SaveToMemory(const pvrtexture::CPVRTexture& texture, SaveFunction save, void* buffer, size_t capacity)
+{
+#ifdef _WIN32
+	File file(tmpfile());
+#else
+	// fmemopen keeps the last byte for the terminating null
+	File file(fmemopen(buffer, capacity + 1, "wb"));
+#endif
+	if (!file)
+	{
+		throw runtime_error("Failed to open memory stream of %d bytes", (int)capacity);
+	}
+	bool success = (texture.*save)(file.get()) && fflush(file.get()) == 0;
+	long size = ftell(file.get());
+	if (!success || size < 0 || (size_t)size > capacity)
+	{
+		throw runtime_error("Failed to save texture into a buffer of %llu bytes", (unsigned long long)capacity);
+	}
+#ifdef _WIN32
+	rewind(file.get());
+	if (fread(buffer, 1, size, file.get()) != (size_t)size)
+	{
+		throw runtime_error("Failed to read back saved texture");
+	}
+#endif
+	return size;
+}
+
+size_t SaveToMemory(const pvrtexture::CPVRTexture& texture, Container container, void* buffer, size_t capacity)
+{
+	if (!IsUnsizedFormat(texture.getPixelType().PixelTypeID))
+	{
+		SaveFunction save = container == ContainerDDS ? &pvrtexture::CPVRTexture::privateSaveDDSFile : &pvrtexture::CPVRTexture::privateSavePVRFile;
+		return SaveToMemory(texture, save, buffer, capacity);
+	}
+	std::vector<uint8_t> header = container == ContainerDDS ? MakeDDSHeader(texture) : MakePVRHeader(texture);
+	size_t size = header.size() + GetTextureDataSize(texture);
+	if (size > capacity)
+	{
+		throw runtime_error("Failed to save texture into a buffer of %llu bytes", (unsigned long long)capacity);
+	}
+	uint8_t* dst = (uint8_t*)buffer;
+	memcpy(dst, header.data(), header.size());
+	CountCopiedBytes(GetTextureDataSize(texture));
+	if (container == ContainerPVR)
+	{
+		memcpy(dst + header.size(), texture.m_pTextureData, GetTextureDataSize(texture));
+		return size;
+	}
+	for (uint32_t mip = 0; mip < texture.getNumMIPLevels(); ++mip)
+	{
+		for (uint32_t array = 0; array < texture.getNumArrayMembers(); ++array)
+		{
+			for (uint32_t face = 0; face < texture.getNumFaces(); ++face)
+			{
+				memcpy(dst + header.size() + GetDDSSurfaceOffset(texture, mip, array, face),
+				       GetSurfacePtr(texture, mip, array, face), GetSurfaceSize(texture, mip));
+			}
+		}
+	}
+	return size;
+}
@@ -0,0 +1,53 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#pragma once
+#include "texture_writer.h"
+
+#include <PVRTexture.h>
+
+#include <cstdio>
+#include <cstddef>
+
+
+// Loading and saving of textures without temporary files. PVRTexLib readers and writers take FILE*,
+// so memory is wrapped with fmemopen. Where fmemopen is not available, data goes through tmpfile.
+
+typedef bool (pvrtexture::CPVRTexture::*LoadFunction)(FILE* file);
+typedef bool (pvrtexture::CPVRTexture::*SaveFunction)(FILE* file) const;
+
+// Loads a PVR container. Current version headers are parsed in place, after checking that size covers the whole texture
+pvrtexture::CPVRTexture* LoadPVRFromMemory(const void* data, size_t size);
+
+// Load DDS containers. BC6H and BC7 in the DX10 extension are read by the module, as PVRTexLib does not load their
+// data, other formats go through privateLoadDDSFile. Throw if loading fails or the data is truncated
+pvrtexture::CPVRTexture* LoadDDSFromMemory(const void* data, size_t size);
+pvrtexture::CPVRTexture* LoadDDSFile(const char* filename);
+
+// Loads a texture with one of CPVRTexture::privateLoad*File. Throws if loading fails
+pvrtexture::CPVRTexture* LoadFromMemory(LoadFunction load, const void* data, size_t size);
+
+// Upper bound of the file size produced by privateSavePVRFile and privateSaveDDSFile
+size_t GetPVRFileSizeBound(const pvrtexture::CPVRTexture& texture);
+size_t GetDDSFileSizeBound(const pvrtexture::CPVRTexture& texture);
+
+// Saves a texture with one of CPVRTexture::privateSave*File into buffer, that must hold capacity + 1 bytes, like
+// the storage of python bytes objects. Returns number of bytes written, throws if saving fails or does not fit into capacity
+size_t SaveToMemory(const pvrtexture::CPVRTexture& texture, SaveFunction save, void* buffer, size_t capacity);
+
+// Saves a texture as a PVR or DDS container. Unlike the overload above, also handles formats that
+// PVRTexLib can not save, see IsUnsizedFormat
+size_t SaveToMemory(const pvrtexture::CPVRTexture& texture, Container container, void* buffer, size_t capacity);
@@ -0,0 +1,588 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+#include "metrics.h"
+#include "decode.h"
+#include "surface.h"
+#include "storage.h"
+#include "pixel_format.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include "profiler.h"
+#include "common.h"
+
+#include <PVRTextureUtilities.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+
+namespace
+{
+	// rows per parallel job, SSIM bands also read 5 rows above and below
+	const int BandRows = 32;
+	const int SSIMRadius = 5;
+
+	struct Band
+	{
+		int begin;
+		int end;
+		// rows of the depth slice, SSIM windows do not cross slices
+		int slice_begin;
+		int slice_end;
+	};
+
+	std::vector<Band> GetBands(const RGBASurface& s)
+	{
+		std::vector<Band> bands;
+		for (int z = 0; z < s.depth; ++z)
+		{
+			for (int y = 0; y < s.height; y += BandRows)
+			{
+				int begin = z * s.height + y;
+				bands.push_back({begin, begin + std::min(BandRows, s.height - y), z * s.height, (z + 1) * s.height});
+			}
+		}
+		return bands;
+	}
+
+	bool IsUInt8(const pvrtexture::CPVRTextureHeader& header)
+	{
+		if (header.getChannelType() != ePVRTVarTypeUnsignedByteNorm)
+		{
+			return false;
+		}
+		auto decoded = DecodePixelType(header.getPixelType().PixelTypeID);
+		for (auto size: decoded.channel_sizes)
+		{
+			if (size != 8)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	struct ErrorSums
+	{
+		double sum[4];
+		double max[4];
+	};
+
+	// Sums squared differences of RGBA8 texels per channel. Squares of 8-bit differences fit 16 bits, they are
+	// accumulated in 32-bit lanes, which are flushed before they can overflow
+	void AccumulateUInt8(const uint8_t* a, const uint8_t* b, size_t count, ErrorSums& sums)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		__m128i max_diff = zero;
+		size_t i = 0;
+		while (i + 4 <= count)
+		{
+			const size_t end = std::min(count & ~(size_t)3, i + 4 * 16384);
+			__m128i acc = zero;
+			for (; i < end; i += 4)
+			{
+				__m128i x = _mm_loadu_si128((const __m128i*)(a + 4 * i));
+				__m128i y = _mm_loadu_si128((const __m128i*)(b + 4 * i));
+				__m128i d = _mm_or_si128(_mm_subs_epu8(x, y), _mm_subs_epu8(y, x));
+				max_diff = _mm_max_epu8(max_diff, d);
+				__m128i lo = _mm_unpacklo_epi8(d, zero);
+				__m128i hi = _mm_unpackhi_epi8(d, zero);
+				lo = _mm_mullo_epi16(lo, lo);
+				hi = _mm_mullo_epi16(hi, hi);
+				acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(lo, zero));
+				acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(lo, zero));
+				acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(hi, zero));
+				acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(hi, zero));
+			}
+			uint32_t partial[4];
+			_mm_storeu_si128((__m128i*)partial, acc);
+			for (int c = 0; c < 4; ++c)
+			{
+				sums.sum[c] += (double)partial[c];
+			}
+		}
+		uint8_t maxima[16];
+		_mm_storeu_si128((__m128i*)maxima, max_diff);
+		for (int j = 0; j < 16; ++j)
+		{
+			sums.max[j % 4] = std::max(sums.max[j % 4], (double)maxima[j]);
+		}
+		for (; i < count; ++i)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				int d = std::abs((int)a[4 * i + c] - (int)b[4 * i + c]);
+				sums.sum[c] += (double)(d * d);
+				sums.max[c] = std::max(sums.max[c], (double)d);
+			}
+		}
+	}
+
+	// Lanes of RGBA float32 texels keep their channel, since the vector width is a multiple of 4
+	void AccumulateFloat(const float* a, const float* b, size_t count, ErrorSums& sums)
+	{
+		const size_t values = count * 4;
+		simd::vfloat acc = simd::set1(0.0f);
+		simd::vfloat max_diff = simd::set1(0.0f);
+		size_t i = 0;
+		for (; i + simd::width <= values; i += simd::width)
+		{
+			simd::vfloat d = simd::load(a + i) - simd::load(b + i);
+			acc = acc + d * d;
+			max_diff = simd::max(max_diff, simd::abs(d));
+		}
+		float partial[simd::width];
+		float maxima[simd::width];
+		simd::store(partial, acc);
+		simd::store(maxima, max_diff);
+		for (int j = 0; j < (int)simd::width; ++j)
+		{
+			sums.sum[j % 4] += partial[j];
+			sums.max[j % 4] = std::max(sums.max[j % 4], (double)maxima[j]);
+		}
+		for (; i < values; ++i)
+		{
+			double d = (double)a[i] - (double)b[i];
+			sums.sum[i % 4] += d * d;
+			sums.max[i % 4] = std::max(sums.max[i % 4], std::abs(d));
+		}
+	}
+
+	ErrorSums GetErrors(const RGBASurface& a, const RGBASurface& b, const std::vector<Band>& bands)
+	{
+		std::vector<ErrorSums> partial(bands.size(), ErrorSums());
+		ThreadPool::GetDefault().ParallelFor(bands.size(), [&](size_t i)
+		{
+			const size_t offset = (size_t)bands[i].begin * a.width * 4;
+			const size_t count = (size_t)(bands[i].end - bands[i].begin) * a.width;
+			if (a.is_uint8)
+			{
+				AccumulateUInt8(&a.uint8[offset], &b.uint8[offset], count, partial[i]);
+			}
+			else
+			{
+				AccumulateFloat(&a.float32[offset], &b.float32[offset], count, partial[i]);
+			}
+		});
+		ErrorSums total = ErrorSums();
+		for (const ErrorSums& p: partial)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				total.sum[c] += p.sum[c];
+				total.max[c] = std::max(total.max[c], p.max[c]);
+			}
+		}
+		return total;
+	}
+
+	float GetValue(const RGBASurface& s, size_t index)
+	{
+		return s.is_uint8 ? (float)s.uint8[index] * (1.0f / 255.0f) : s.float32[index];
+	}
+
+	// Mean SSIM of a channel. Rows are blurred horizontally into a band buffer, including the rows of the window
+	// above and below the band, then vertically, one output row at a time
+	double GetSSIM(const RGBASurface& a, const RGBASurface& b, int channel, const std::vector<Band>& bands)
+	{
+		const int taps = 2 * SSIMRadius + 1;
+		float kernel[taps];
+		float kernel_sum = 0.0f;
+		for (int k = 0; k < taps; ++k)
+		{
+			float x = (float)(k - SSIMRadius);
+			kernel[k] = std::exp(-x * x / (2.0f * 1.5f * 1.5f));
+			kernel_sum += kernel[k];
+		}
+		for (int k = 0; k < taps; ++k)
+		{
+			kernel[k] /= kernel_sum;
+		}
+		const float c1 = 0.01f * 0.01f;
+		const float c2 = 0.03f * 0.03f;
+		const int width = a.width;
+		const size_t padded = (size_t)width + 2 * SSIMRadius;
+
+		std::vector<double> sums(bands.size(), 0.0);
+		ThreadPool::GetDefault().ParallelFor(bands.size(), [&](size_t band_index)
+		{
+			const Band& band = bands[band_index];
+			const int first = std::max(band.begin - SSIMRadius, band.slice_begin);
+			const int last = std::min(band.end + SSIMRadius, band.slice_end);
+			const size_t rows = (size_t)(last - first);
+			// horizontally blurred x, y, x^2, y^2 and xy
+			std::vector<float> blurred(5 * rows * width);
+			std::vector<float> line(5 * padded);
+			for (int y = first; y < last; ++y)
+			{
+				float* lx = &line[0];
+				float* ly = &line[padded];
+				float* lxx = &line[2 * padded];
+				float* lyy = &line[3 * padded];
+				float* lxy = &line[4 * padded];
+				for (size_t x = 0; x < padded; ++x)
+				{
+					int sx = std::min(std::max((int)x - SSIMRadius, 0), width - 1);
+					size_t index = ((size_t)y * width + sx) * 4 + channel;
+					float va = GetValue(a, index);
+					float vb = GetValue(b, index);
+					lx[x] = va;
+					ly[x] = vb;
+					lxx[x] = va * va;
+					lyy[x] = vb * vb;
+					lxy[x] = va * vb;
+				}
+				for (int q = 0; q < 5; ++q)
+				{
+					const float* src = &line[q * padded];
+					float* dst = &blurred[((size_t)q * rows + (y - first)) * width];
+					int x = 0;
+					for (; x + (int)simd::width <= width; x += simd::width)
+					{
+						simd::vfloat acc = simd::set1(0.0f);
+						for (int k = 0; k < taps; ++k)
+						{
+							acc = acc + simd::load(src + x + k) * simd::set1(kernel[k]);
+						}
+						simd::store(dst + x, acc);
+					}
+					for (; x < width; ++x)
+					{
+						float acc = 0.0f;
+						for (int k = 0; k < taps; ++k)
+						{
+							acc += src[x + k] * kernel[k];
+						}
+						dst[x] = acc;
+					}
+				}
+			}
+
+			std::vector<float> moments(5 * (size_t)width);
+			double sum = 0.0;
+			for (int y = band.begin; y < band.end; ++y)
+			{
+				const float* row_pointers[5][taps];
+				for (int q = 0; q < 5; ++q)
+				{
+					for (int k = 0; k < taps; ++k)
+					{
+						int sy = std::min(std::max(y + k - SSIMRadius, band.slice_begin), band.slice_end - 1);
+						row_pointers[q][k] = &blurred[((size_t)q * rows + (sy - first)) * width];
+					}
+				}
+				for (int q = 0; q < 5; ++q)
+				{
+					float* dst = &moments[(size_t)q * width];
+					int x = 0;
+					for (; x + (int)simd::width <= width; x += simd::width)
+					{
+						simd::vfloat acc = simd::set1(0.0f);
+						for (int k = 0; k < taps; ++k)
+						{
+							acc = acc + simd::load(row_pointers[q][k] + x) * simd::set1(kernel[k]);
+						}
+						simd::store(dst + x, acc);
+					}
+					for (; x < width; ++x)
+					{
+						float acc = 0.0f;
+						for (int k = 0; k < taps; ++k)
+						{
+							acc += row_pointers[q][k][x] * kernel[k];
+						}
+						dst[x] = acc;
+					}
+				}
+				const float* mx = &moments[0];
+				const float* my = &moments[(size_t)width];
+				const float* mxx = &moments[2 * (size_t)width];
+				const float* myy = &moments[3 * (size_t)width];
+				const float* mxy = &moments[4 * (size_t)width];
+				simd::vfloat acc = simd::set1(0.0f);
+				const simd::vfloat vc1 = simd::set1(c1);
+				const simd::vfloat vc2 = simd::set1(c2);
+				const simd::vfloat two = simd::set1(2.0f);
+				int x = 0;
+				for (; x + (int)simd::width <= width; x += simd::width)
+				{
+					simd::vfloat ux = simd::load(mx + x);
+					simd::vfloat uy = simd::load(my + x);
+					simd::vfloat uxy = ux * uy;
+					simd::vfloat uxx = ux * ux;
+					simd::vfloat uyy = uy * uy;
+					simd::vfloat sxy = simd::load(mxy + x) - uxy;
+					simd::vfloat sxx = simd::load(mxx + x) - uxx;
+					simd::vfloat syy = simd::load(myy + x) - uyy;
+					acc = acc + ((two * uxy + vc1) * (two * sxy + vc2)) / ((uxx + uyy + vc1) * (sxx + syy + vc2));
+				}
+				double row_sum = simd::reduce_add(acc);
+				for (; x < width; ++x)
+				{
+					float uxy = mx[x] * my[x];
+					float uxx = mx[x] * mx[x];
+					float uyy = my[x] * my[x];
+					float sxy = mxy[x] - uxy;
+					float sxx = mxx[x] - uxx;
+					float syy = myy[x] - uyy;
+					row_sum += ((2.0f * uxy + c1) * (2.0f * sxy + c2)) / ((uxx + uyy + c1) * (sxx + syy + c2));
+				}
+				sum += row_sum;
+			}
+			sums[band_index] = sum;
+		});
+		double total = 0.0;
+		for (double s: sums)
+		{
+			total += s;
+		}
+		return total / (double)a.texel_count();
+	}
+
+	// MSE of 4x4 blocks over the channels in mask, blocks of depth slices are stacked along rows
+	void GetHeatmap(const RGBASurface& a, const RGBASurface& b, unsigned mask, CompareResult& result)
+	{
+		const int blocks_x = (a.width + 3) / 4;
+		const int blocks_y = (a.height + 3) / 4;
+		result.heatmap_width = blocks_x;
+		result.heatmap_height = blocks_y * a.depth;
+		result.heatmap.assign((size_t)blocks_x * result.heatmap_height, 0.0f);
+		const float scale = a.is_uint8 ? 255.0f : 1.0f;
+		ThreadPool::GetDefault().ParallelFor((size_t)result.heatmap_height, [&](size_t row)
+		{
+			const int z = (int)row / blocks_y;
+			const int y0 = ((int)row % blocks_y) * 4;
+			const int y1 = std::min(y0 + 4, a.height);
+			for (int bx = 0; bx < blocks_x; ++bx)
+			{
+				const int x0 = bx * 4;
+				const int x1 = std::min(x0 + 4, a.width);
+				float sum = 0.0f;
+				int count = 0;
+				for (int y = y0; y < y1; ++y)
+				{
+					for (int x = x0; x < x1; ++x)
+					{
+						size_t index = (((size_t)z * a.height + y) * a.width + x) * 4;
+						for (int c = 0; c < 4; ++c)
+						{
+							if (mask & (1u << c))
+							{
+								float d = (GetValue(a, index + c) - GetValue(b, index + c)) * scale;
+								sum += d * d;
+								++count;
+							}
+						}
+					}
+				}
+				result.heatmap[row * blocks_x + bx] = sum / (float)count;
+			}
+		});
+	}
+
+	double ToPSNR(double mse, double peak)
+	{
+		if (mse <= 0.0)
+		{
+			return std::numeric_limits<double>::infinity();
+		}
+		return 10.0 * std::log10(peak * peak / mse);
+	}
+}
+
+
+RGBASurface LoadRGBASurface(const pvrtexture::CPVRTexture& texture, uint32_t mip, uint32_t array, uint32_t face)
+{
+	RGBASurface s;
+	s.width = (int)texture.getWidth(mip);
+	s.height = (int)texture.getHeight(mip);
+	s.depth = (int)texture.getDepth(mip);
+	const uint64_t format = texture.getPixelType().PixelTypeID;
+	if (HasNativeDecoder(format))
+	{
+		s.is_uint8 = !IsFloatDecoded(texture);
+		void* rgba;
+		if (s.is_uint8)
+		{
+			s.uint8.resize(s.texel_count() * 4);
+			rgba = s.uint8.data();
+		}
+		else
+		{
+			s.float32.resize(s.texel_count() * 4);
+			rgba = s.float32.data();
+		}
+		DecodeSurface(texture, GetSurfacePtr(texture, mip, array, face), mip, rgba);
+		return s;
+	}
+	if (DecodePixelType(format).compressed)
+	{
+		throw runtime_error("No native decoder for pixel format %llu", (unsigned long long)format);
+	}
+
+	std::unique_ptr<pvrtexture::CPVRTexture> converted;
+	const pvrtexture::CPVRTexture* source = &texture;
+	if (!IsRGBAReadable(texture))
+	{
+		converted.reset(new pvrtexture::CPVRTexture(texture));
+		if (!pvrtexture::Transcode(*converted, RGBA32323232, ePVRTVarTypeFloat, texture.getColourSpace()))
+		{
+			throw runtime_error("Failed to convert texture to RGBA32323232 for comparison");
+		}
+		CountAllocatedBytes(converted->getDataSize());
+		source = converted.get();
+	}
+	s.is_uint8 = IsUInt8(*source);
+	s.float32.resize(s.texel_count() * 4);
+	const RGBAReader reader(*source);
+	const uint8_t* src = GetSurfacePtr(*source, mip, array, face);
+	const size_t row_bytes = (size_t)s.width * source->getBitsPerPixel() / 8;
+	ThreadPool::GetDefault().ParallelFor((size_t)s.height * s.depth, [&](size_t y)
+	{
+		std::vector<float> buffer;
+		reader.Read(src + y * row_bytes, s.width, &s.float32[y * s.width * 4], buffer);
+	});
+	if (s.is_uint8)
+	{
+		s.uint8.resize(s.float32.size());
+		for (size_t i = 0; i < s.float32.size(); ++i)
+		{
+			s.uint8[i] = (uint8_t)(s.float32[i] * 255.0f + 0.5f);
+		}
+		std::vector<float>().swap(s.float32);
+	}
+	return s;
+}
+
+void ConvertToFloat(RGBASurface& s)
+{
+	if (!s.is_uint8)
+	{
+		return;
+	}
+	s.float32.resize(s.uint8.size());
+	for (size_t i = 0; i < s.uint8.size(); ++i)
+	{
+		s.float32[i] = (float)s.uint8[i] / 255.0f;
+	}
+	std::vector<uint8_t>().swap(s.uint8);
+	s.is_uint8 = false;
+}
+
+unsigned GetChannelMask(uint64_t format)
+{
+	switch (format)
+	{
+		case ePVRTPF_BC4:
+		case ePVRTPF_EAC_R11:
+			return 1;
+		case ePVRTPF_BC5:
+		case ePVRTPF_EAC_RG11:
+			return 3;
+		case ePVRTPF_PVRTCI_2bpp_RGB:
+		case ePVRTPF_PVRTCI_4bpp_RGB:
+		case ePVRTPF_ETC1:
+		case ePVRTPF_ETC2_RGB:
+		case ePVRTPF_BC6:
+			return 7;
+		default:
+			break;
+	}
+	auto decoded = DecodePixelType(format);
+	unsigned mask = 0;
+	for (char name: decoded.channel_names)
+	{
+		switch (name)
+		{
+			case 'r': case 'd': mask |= 1; break;
+			case 'g': mask |= 2; break;
+			case 'b': mask |= 4; break;
+			case 'a': mask |= 8; break;
+			case 'l': mask |= 7; break;
+			default: break;
+		}
+	}
+	return mask != 0 ? mask : 15;
+}
+
+CompareResult CompareSurfaces(const pvrtexture::CPVRTexture& reference, const pvrtexture::CPVRTexture& candidate,
+                              uint32_t mip, uint32_t array, uint32_t face, int metrics, bool heatmap)
+{
+	if (mip >= reference.getNumMIPLevels() || mip >= candidate.getNumMIPLevels())
+	{
+		throw runtime_error("Mip level %d out of range", mip);
+	}
+	if (reference.getWidth(mip) != candidate.getWidth(mip) || reference.getHeight(mip) != candidate.getHeight(mip) ||
+	    reference.getDepth(mip) != candidate.getDepth(mip))
+	{
+		throw runtime_error("Can not compare surfaces of different sizes, %dx%dx%d and %dx%dx%d",
+				reference.getWidth(mip), reference.getHeight(mip), reference.getDepth(mip),
+				candidate.getWidth(mip), candidate.getHeight(mip), candidate.getDepth(mip));
+	}
+
+	RGBASurface a = LoadRGBASurface(reference, mip, array, face);
+	RGBASurface b = LoadRGBASurface(candidate, mip, array, face);
+	if (a.is_uint8 != b.is_uint8)
+	{
+		ConvertToFloat(a);
+		ConvertToFloat(b);
+	}
+	const std::vector<Band> bands = GetBands(a);
+	const unsigned mask = GetChannelMask(reference.getPixelType().PixelTypeID);
+	const double peak = a.is_uint8 ? 255.0 : 1.0;
+
+	CompareResult result = CompareResult();
+	for (int c = 0; c < 4; ++c)
+	{
+		if (mask & (1u << c))
+		{
+			result.channels.push_back("rgba"[c]);
+		}
+	}
+
+	ErrorSums errors = ErrorSums();
+	if (metrics & (MetricPSNR | MetricMaxError))
+	{
+		errors = GetErrors(a, b, bands);
+	}
+	double mse_sum = 0.0;
+	double ssim_sum = 0.0;
+	for (int c = 0; c < 4; ++c)
+	{
+		ChannelMetrics& m = result.channel[c];
+		m.mse = errors.sum[c] / (double)a.texel_count();
+		m.psnr = ToPSNR(m.mse, peak);
+		m.max_error = errors.max[c];
+		m.ssim = (metrics & MetricSSIM) && (mask & (1u << c)) ? GetSSIM(a, b, c, bands) : 1.0;
+		if (mask & (1u << c))
+		{
+			mse_sum += m.mse;
+			ssim_sum += m.ssim;
+			result.overall.max_error = std::max(result.overall.max_error, m.max_error);
+		}
+	}
+	const double channel_count = (double)result.channels.size();
+	result.overall.mse = mse_sum / channel_count;
+	result.overall.psnr = ToPSNR(result.overall.mse, peak);
+	result.overall.ssim = ssim_sum / channel_count;
+
+	if (heatmap)
+	{
+		GetHeatmap(a, b, mask, result);
+	}
+	return result;
+}
@@ -0,0 +1,81 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+#pragma once
+#include <PVRTexture.h>
+
+#include <cstdint>
+#include <vector>
+
+
+// Quality metrics of a candidate surface against a reference surface. Compressed surfaces are decoded with the native
+// decoders into temporary buffers, other formats are read as RGBA, formats that can not be read directly are
+// converted by PVRTexLib first.
+//
+// If both surfaces decode to 8 bits per channel, errors are summed as integers, PSNR has a peak of 255 and max_err is
+// in 8-bit units. Otherwise values are compared as float, with a peak of 1. SSIM uses the 11x11 Gaussian window with
+// sigma 1.5, values are scaled to [0, 1] for 8-bit surfaces. Overall metrics cover the channels present in the
+// reference format; absent channels would only add zero error.
+
+// Surface as RGBA texels, depth slices stacked along rows. Holds uint8 texels if the format stores 8-bit unsigned
+// normalized channels or decodes to them, float32 texels otherwise
+struct RGBASurface
+{
+	int width;
+	int height;
+	int depth;
+	bool is_uint8;
+	std::vector<uint8_t> uint8;
+	std::vector<float> float32;
+
+	size_t texel_count() const { return (size_t)width * height * depth; }
+};
+
+RGBASurface LoadRGBASurface(const pvrtexture::CPVRTexture& texture, uint32_t mip, uint32_t array, uint32_t face);
+// Converts uint8 texels to float32 in [0, 1]
+void ConvertToFloat(RGBASurface& surface);
+
+// Bit mask of the RGBA channels stored by a pixel format, R is bit 0
+unsigned GetChannelMask(uint64_t format);
+
+enum CompareMetric
+{
+	MetricPSNR = 1,
+	MetricSSIM = 2,
+	MetricMaxError = 4,
+};
+
+struct ChannelMetrics
+{
+	double mse;
+	double psnr;
+	double ssim;
+	double max_error;
+};
+
+struct CompareResult
+{
+	// names of the channels present in the reference, a subset of "rgba"
+	std::vector<char> channels;
+	ChannelMetrics overall;
+	// indexed by RGBA channel, including the absent ones
+	ChannelMetrics channel[4];
+	// MSE of every 4x4 block over the present channels, row by row, if requested
+	int heatmap_width;
+	int heatmap_height;
+	std::vector<float> heatmap;
+};
+
+CompareResult CompareSurfaces(const pvrtexture::CPVRTexture& reference, const pvrtexture::CPVRTexture& candidate,
+                              uint32_t mip, uint32_t array, uint32_t face, int metrics, bool heatmap);
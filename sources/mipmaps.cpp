@@ -0,0 +1,61 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#include "mipmaps.h"
+#include "surface.h"
+#include "profiler.h"
+
+#include <memory>
+#include <algorithm>
+#include <cstring>
+
+
+pvrtexture::CPVRTexture* GenerateMipmaps(const pvrtexture::CPVRTexture& texture, ResampleFilter filter, float gamma, EPVRTColourSpace colour_space)
+{
+	SurfaceCodec codec(texture.getHeader(), colour_space, gamma);
+
+	uint32_t size = std::max(std::max(texture.getWidth(), texture.getHeight()), texture.getDepth());
+	uint32_t num_levels = 1;
+	while (size > 1)
+	{
+		size >>= 1u;
+		++num_levels;
+	}
+
+	pvrtexture::CPVRTextureHeader header(texture.getHeader());
+	header.setNumMIPLevels(num_levels);
+	std::unique_ptr<pvrtexture::CPVRTexture> result(new pvrtexture::CPVRTexture(header));
+	CountAllocatedBytes(result->getDataSize());
+
+	for (uint32_t array = 0; array < texture.getNumArrayMembers(); ++array)
+	{
+		for (uint32_t face = 0; face < texture.getNumFaces(); ++face)
+		{
+			memcpy(result->getDataPtr(0, array, face), texture.getDataPtr(0, array, face), texture.getDataSize(0, false, false));
+			CountCopiedBytes(texture.getDataSize(0, false, false));
+
+			FloatImage level = codec.Read(texture, 0, array, face);
+			for (uint32_t mip = 1; mip < num_levels; ++mip)
+			{
+				FloatImage next(result->getWidth(mip), result->getHeight(mip), result->getDepth(mip), codec.channels());
+				Resample(level, next, filter);
+				codec.Write(next, *result, mip, array, face);
+				level.swap(next);
+			}
+		}
+	}
+	return result.release();
+}
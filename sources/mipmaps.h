@@ -0,0 +1,26 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#pragma once
+#include "resample.h"
+
+#include <PVRTexture.h>
+
+
+// Returns a copy of the texture with the full mipmap chain. Every level is computed from the previous one
+// in float32 linear space and written directly into the surfaces of the new texture,
+// for all faces and array members. Existing mipmaps, if any, are regenerated from the top level.
+pvrtexture::CPVRTexture* GenerateMipmaps(const pvrtexture::CPVRTexture& texture, ResampleFilter filter, float gamma, EPVRTColourSpace colour_space);
@@ -0,0 +1,292 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#pragma once
+#include "common.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cctype>
+
+
+template<char C1Name, uint8_t C1Bits, char C2Name = 0, uint8_t C2Bits = 0, char C3Name = 0, uint8_t C3Bits = 0, char C4Name = 0, uint8_t C4Bits = 0>
+class PixelType
+{
+public:
+	enum : uint64_t
+	{
+		ID = (static_cast<uint64_t>(C1Name) + (static_cast<uint64_t>(C2Name) << 8u) +
+		     (static_cast<uint64_t>(C3Name) << 16u) + (static_cast<uint64_t>(C4Name) << 24u) +
+		     (static_cast<uint64_t>(C1Bits) << 32u) + (static_cast<uint64_t>(C2Bits) << 40u) +
+			 (static_cast<uint64_t>(C3Bits) << 48u) + (static_cast<uint64_t>(C4Bits) << 56u))
+	};
+};
+
+struct DecodedType
+{
+	bool compressed;
+	std::vector<char> channel_names;
+	std::vector<uint8_t> channel_sizes;
+};
+
+inline DecodedType DecodePixelType(uint64_t pixel_format)
+{
+	bool compressed = (pixel_format & 0xFFFFFFFF00000000) == 0;
+	if (compressed)
+	{
+		return {compressed, {}, {}};
+	}
+	std::vector<char> channels;
+	std::vector<uint8_t> sizes;
+	for (int i = 0; i < 4; ++i)
+	{
+		char v = pixel_format & 0xffu;
+		if (v != 0)
+		{
+			channels.push_back(v);
+		}
+		pixel_format = pixel_format >> 8u;
+	}
+	for (int i = 0; i < 4; ++i)
+	{
+		uint8_t v = pixel_format & 0xffu;
+		if (v != 0)
+		{
+			sizes.push_back(v);
+		}
+		pixel_format = pixel_format >> 8u;
+	}
+
+	return {false, channels, sizes};
+}
+
+inline size_t GetChannelCount(uint64_t f)
+{
+	auto decoded = DecodePixelType(f);
+	return decoded.channel_names.size();
+}
+
+template<char C1Name, char C2Name, char C3Name, char C4Name>
+class FourCC
+{
+public:
+	enum : uint32_t
+	{
+		Value = (static_cast<uint32_t>(C1Name) + (static_cast<uint32_t>(C2Name) << 8u) +
+		      (static_cast<uint32_t>(C3Name) << 16u) + (static_cast<uint32_t>(C4Name) << 24u))
+	};
+};
+
+
+inline uint64_t
+getPixelType(char C1Name, uint8_t C1Bits, char C2Name = 0, uint8_t C2Bits = 0, char C3Name = 0, uint8_t C3Bits = 0,
+             char C4Name = 0, uint8_t C4Bits = 0)
+{
+	return (static_cast<uint64_t>(C1Name) + (static_cast<uint64_t>(C2Name) << 8u) +
+	        (static_cast<uint64_t>(C3Name) << 16u) + (static_cast<uint64_t>(C4Name) << 24u) +
+	        (static_cast<uint64_t>(C1Bits) << 32u) + (static_cast<uint64_t>(C2Bits) << 40u) +
+	        (static_cast<uint64_t>(C3Bits) << 48u) + (static_cast<uint64_t>(C4Bits) << 56u));
+}
+
+inline uint64_t parseType(const char* s)
+{
+	char buff[255];
+	strncpy(buff, s, 255);
+
+	int i = 0;
+	while (buff[i] && i < 255)
+	{
+		buff[i] = (tolower(buff[i]));
+		i++;
+	}
+
+	uint64_t type = 0;
+	uint64_t mul = 1;
+	for (i = 0; i < 4; i++)
+	{
+		if (buff[i] == 'r' || buff[i] == 'g' || buff[i] == 'b' || buff[i] == 'a' || buff[i] == 'l' ||
+		    buff[i] == 'd')
+		{
+			type += buff[i] * mul;
+			mul = mul << 8u;
+		}
+		else
+		{
+			break;
+		}
+	}
+	if (i == 0)
+	{
+		throw runtime_error("Format should start from channel names, such as: r, g, b, a, l, d. Got %c", buff[0]);
+	}
+	for (int _i = i; _i < 4; _i++)
+	{
+		mul = mul << 8u;
+	}
+
+	if (!(buff[i] >= '0' && buff[i] <= '9'))
+	{
+		throw runtime_error("Unexpected symbol after channel names: %c. Expected digits", buff[i]);
+	}
+
+	int j = 0;
+	const char* p = buff + i;
+	for (; j < 4; j++)
+	{
+		if (*p >= '0' && *p <= '9')
+		{
+			int v = *p - '0';
+			if (*p == '1' && *(p + 1) == '0')
+			{
+				v = 10;
+				++p;
+			}
+			if (*p == '1' && *(p + 1) == '1')
+			{
+				v = 11;
+				++p;
+			}
+			if (*p == '1' && *(p + 1) == '2')
+			{
+				v = 12;
+				++p;
+			}
+			if (*p == '1' && *(p + 1) == '6')
+			{
+				v = 16;
+				++p;
+			}
+			if (*p == '3' && *(p + 1) == '2')
+			{
+				v = 32;
+				++p;
+			}
+			++p;
+			type += v * mul;
+			mul = mul << 8u;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	if (*p != '\0')
+	{
+		throw runtime_error("Unexpected symbol at the end of the format: %c", *p);
+	}
+
+	if (i != j)
+	{
+		throw runtime_error("Number of channel names and sizes do not match, got %d and %d", i, j);
+	}
+	return type;
+}
+
+
+enum Format : uint64_t
+{
+	PVRTCI_2bpp_RGB,
+	PVRTCI_2bpp_RGBA,
+	PVRTCI_4bpp_RGB,
+	PVRTCI_4bpp_RGBA,
+
+	PVRTCII_2bpp,
+	PVRTCII_4bpp,
+
+	ETC1,
+
+	DXT1,
+	DXT2,
+	DXT3,
+	DXT4,
+	DXT5,
+	BC1 = DXT1,
+	BC2 = DXT3,
+	BC3 = DXT5,
+	BC4,
+	BC5,
+	BC6,
+	BC7,
+
+	RGBG8888 = 20,
+	GRGB8888,
+
+	ETC2_RGB = 22,
+	ETC2_RGBA,
+	ETC2_RGB_A1,
+
+	EAC_R11,
+	EAC_RG11,
+
+	ASTC_4x4,
+	ASTC_5x4,
+	ASTC_5x5,
+	ASTC_6x5,
+	ASTC_6x6,
+	ASTC_8x5,
+	ASTC_8x6,
+	ASTC_8x8,
+	ASTC_10x5,
+	ASTC_10x6,
+	ASTC_10x8,
+	ASTC_10x10,
+	ASTC_12x10,
+	ASTC_12x12,
+
+	RGBA8888 = PixelType<'r', 8, 'g', 8, 'b', 8, 'a', 8>::ID,
+	RGBA1010102 = PixelType<'r', 10, 'g', 10, 'b', 10, 'a', 2>::ID,
+	RGBA4444 = PixelType<'r', 4, 'g', 4, 'b', 4, 'a', 4>::ID,
+	RGBA5551 = PixelType<'r', 5, 'g', 5, 'b', 5, 'a', 1>::ID,
+	BGRA8888 = PixelType<'b', 8, 'g', 8, 'r', 8, 'a', 8>::ID,
+	RGBA16161616 = PixelType<'r', 16, 'g', 16, 'b', 16, 'a', 16>::ID,
+	RGBA32323232 = PixelType<'r', 32, 'g', 32, 'b', 32, 'a', 32>::ID,
+
+	RGB888 = PixelType<'r', 8, 'g', 8, 'b', 8>::ID,
+	RGB161616 = PixelType<'r', 16, 'g', 16, 'b', 16>::ID,
+	RGB565 = PixelType<'r', 5, 'g', 6, 'b', 5>::ID,
+	RGB323232 = PixelType<'r', 32, 'g', 32, 'b', 32>::ID,
+	BGR101111 = PixelType<'b', 10, 'g', 11, 'r', 11>::ID,
+
+	RG88 = PixelType<'r', 8, 'g', 8>::ID,
+	LA88 = PixelType<'l', 8, 'a', 8>::ID,
+	RG1616 = PixelType<'r', 16, 'g', 16>::ID,
+	RG3232 = PixelType<'r', 32, 'g', 32>::ID,
+
+	R8 = PixelType<'r', 8>::ID,
+	A8 = PixelType<'a', 8>::ID,
+	L8 = PixelType<'l', 8>::ID,
+	R16 = PixelType<'r', 16>::ID,
+	R32 = PixelType<'r', 32>::ID,
+};
+
+inline uint64_t getType(int channel_count, int bits)
+{
+	std::string part_a;
+	std::string part_b;
+	const char* names = "rgba";
+	char bitsstr[32];
+	sprintf(bitsstr, "%d", bits);
+	for (int i = 0; i < channel_count; ++i)
+	{
+		part_a += names[i];
+		part_b += bitsstr;
+	}
+	return parseType((part_a + part_b).c_str());
+}
@@ -0,0 +1,250 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#include <unistd.h>
+#else
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+namespace
+{
+	// Trace of a long running process is bounded, later events are dropped and counted
+	const size_t max_trace_events = 1u << 20u;
+
+	thread_local ProfileCounters* current_counters = nullptr;
+
+	uint64_t GetThreadId()
+	{
+		static thread_local uint64_t id = 0;
+		if (id == 0)
+		{
+#if defined(_WIN32)
+			id = GetCurrentThreadId();
+#elif defined(__APPLE__)
+			pthread_threadid_np(nullptr, &id);
+#else
+			id = (uint64_t)syscall(SYS_gettid);
+#endif
+		}
+		return id;
+	}
+
+	uint64_t GetProcessId()
+	{
+#if defined(_WIN32)
+		return GetCurrentProcessId();
+#else
+		return (uint64_t)getpid();
+#endif
+	}
+
+	double Milliseconds(Profiler::Clock::duration duration)
+	{
+		return std::chrono::duration<double, std::milli>(duration).count();
+	}
+
+	void Add(ProfileStats& stats, double ms, uint64_t allocated, uint64_t copied)
+	{
+		stats.calls += 1;
+		stats.total_ms += ms;
+		stats.max_ms = std::max(stats.max_ms, ms);
+		stats.allocated += allocated;
+		stats.copied += copied;
+	}
+
+	void AppendEscaped(std::string& out, const std::string& str)
+	{
+		for (char c: str)
+		{
+			if (c == '"' || c == '\\')
+			{
+				out += '\\';
+			}
+			if ((unsigned char)c < 0x20)
+			{
+				continue;
+			}
+			out += c;
+		}
+	}
+}
+
+
+Profiler::Profiler(): m_enabled(false), m_trace(false), m_dropped_events(0), m_epoch(Clock::now())
+{
+}
+
+Profiler& Profiler::GetDefault()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+void Profiler::Enable(bool trace)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_trace = trace;
+	m_enabled = true;
+}
+
+void Profiler::Disable()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_enabled = false;
+}
+
+void Profiler::Record(const std::string& name, const std::string& format, Clock::time_point start, Clock::time_point end,
+		uint64_t allocated, uint64_t copied)
+{
+	double ms = Milliseconds(end - start);
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::map<std::string, ProfileStats>& operation = m_stats[name];
+	Add(operation[std::string()], ms, allocated, copied);
+	if (!format.empty())
+	{
+		Add(operation[format], ms, allocated, copied);
+	}
+	if (m_trace)
+	{
+		if (m_events.size() < max_trace_events)
+		{
+			TraceEvent event = {name, format, GetThreadId(), start, end, allocated, copied};
+			m_events.push_back(std::move(event));
+		}
+		else
+		{
+			++m_dropped_events;
+		}
+	}
+}
+
+std::map<std::string, std::map<std::string, ProfileStats>> Profiler::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+void Profiler::Reset()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stats.clear();
+	m_events.clear();
+	m_dropped_events = 0;
+	m_epoch = Clock::now();
+}
+
+std::string Profiler::GetTrace() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	uint64_t pid = GetProcessId();
+	std::string out = "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+	char buffer[256];
+	for (size_t i = 0; i < m_events.size(); ++i)
+	{
+		const TraceEvent& event = m_events[i];
+		out += i == 0 ? "\n" : ",\n";
+		out += "{\"name\": \"";
+		AppendEscaped(out, event.name);
+		out += "\", \"cat\": \"texture_tool\", \"ph\": \"X\"";
+		// timestamps are in microseconds
+		snprintf(buffer, sizeof(buffer), ", \"ts\": %.3f, \"dur\": %.3f, \"pid\": %llu, \"tid\": %llu",
+				Milliseconds(event.start - m_epoch) * 1e3, Milliseconds(event.end - event.start) * 1e3,
+				(unsigned long long)pid, (unsigned long long)event.thread);
+		out += buffer;
+		snprintf(buffer, sizeof(buffer), ", \"args\": {\"allocated\": %llu, \"copied\": %llu",
+				(unsigned long long)event.allocated, (unsigned long long)event.copied);
+		out += buffer;
+		if (!event.format.empty())
+		{
+			out += ", \"format\": \"";
+			AppendEscaped(out, event.format);
+			out += "\"";
+		}
+		out += "}}";
+	}
+	snprintf(buffer, sizeof(buffer), "\n], \"otherData\": {\"dropped_events\": %llu}}\n", (unsigned long long)m_dropped_events);
+	out += buffer;
+	return out;
+}
+
+ProfileCounters* GetProfileCounters()
+{
+	return current_counters;
+}
+
+ProfileCounters* SetProfileCounters(ProfileCounters* counters)
+{
+	ProfileCounters* previous = current_counters;
+	current_counters = counters;
+	return previous;
+}
+
+ProfileScope::ProfileScope(const char* name, std::string format):
+		m_name(name), m_format(std::move(format)), m_enabled(Profiler::GetDefault().IsEnabled()), m_parent(nullptr)
+{
+	m_counters.allocated = 0;
+	m_counters.copied = 0;
+	if (m_enabled)
+	{
+		m_parent = SetProfileCounters(&m_counters);
+		m_start = Profiler::Clock::now();
+	}
+}
+
+ProfileScope::~ProfileScope()
+{
+	if (m_enabled)
+	{
+		Profiler::Clock::time_point end = Profiler::Clock::now();
+		SetProfileCounters(m_parent);
+		uint64_t allocated = m_counters.allocated.load(std::memory_order_relaxed);
+		uint64_t copied = m_counters.copied.load(std::memory_order_relaxed);
+		if (m_parent != nullptr)
+		{
+			m_parent->allocated.fetch_add(allocated, std::memory_order_relaxed);
+			m_parent->copied.fetch_add(copied, std::memory_order_relaxed);
+		}
+		Profiler::GetDefault().Record(m_name, m_format, m_start, end, allocated, copied);
+	}
+}
+
+void CountAllocatedBytes(size_t size)
+{
+	if (current_counters != nullptr)
+	{
+		current_counters->allocated.fetch_add(size, std::memory_order_relaxed);
+	}
+}
+
+void CountCopiedBytes(size_t size)
+{
+	if (current_counters != nullptr)
+	{
+		current_counters->copied.fetch_add(size, std::memory_order_relaxed);
+	}
+}
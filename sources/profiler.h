@@ -0,0 +1,133 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+// Opt-in accounting of the bindings of the module. Every call records its duration and the bytes of texture data
+// allocated and copied on its behalf, per operation and per pixel format of the texture it was called on. Bytes are
+// counted where texture data is allocated or copied in bulk and are attributed to the innermost scope of the calling
+// thread, including the ThreadPool jobs it runs. Nested calls are included in the outer ones.
+// When tracing is on, every call is also kept as a Chrome trace event (chrome://tracing, Perfetto) with the id of the
+// thread that made it.
+
+struct ProfileStats
+{
+	uint64_t calls;
+	double total_ms;
+	double max_ms;
+	uint64_t allocated;
+	uint64_t copied;
+};
+
+class Profiler
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	Profiler();
+
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	// Used by the bindings
+	static Profiler& GetDefault();
+
+	void Enable(bool trace);
+	void Disable();
+
+	bool IsEnabled() const
+	{
+		return m_enabled.load(std::memory_order_relaxed);
+	}
+
+	// format is empty for calls that were not made on a texture
+	void Record(const std::string& name, const std::string& format, Clock::time_point start, Clock::time_point end,
+			uint64_t allocated, uint64_t copied);
+
+	// Operation name to pixel format to stats, the totals of an operation are under the empty format
+	std::map<std::string, std::map<std::string, ProfileStats>> GetStats() const;
+
+	// Clears stats and trace events
+	void Reset();
+
+	// Chrome trace event JSON of the calls recorded since tracing was enabled or reset
+	std::string GetTrace() const;
+
+private:
+	struct TraceEvent
+	{
+		std::string name;
+		std::string format;
+		uint64_t thread;
+		Clock::time_point start;
+		Clock::time_point end;
+		uint64_t allocated;
+		uint64_t copied;
+	};
+
+	std::atomic<bool> m_enabled;
+	bool m_trace;
+	mutable std::mutex m_mutex;
+	std::map<std::string, std::map<std::string, ProfileStats>> m_stats;
+	std::vector<TraceEvent> m_events;
+	uint64_t m_dropped_events;
+	Clock::time_point m_epoch;
+};
+
+// Bytes counted on behalf of a scope, shared by the threads working for it
+struct ProfileCounters
+{
+	std::atomic<uint64_t> allocated;
+	std::atomic<uint64_t> copied;
+};
+
+// Counters of the innermost enabled scope of the calling thread, null if there is none
+ProfileCounters* GetProfileCounters();
+
+// Makes counters current for the calling thread and returns the previous ones, used to hand a scope to pool threads
+ProfileCounters* SetProfileCounters(ProfileCounters* counters);
+
+// Records the enclosing scope with Profiler::GetDefault(), if it was enabled when the scope was entered
+class ProfileScope
+{
+public:
+	ProfileScope(const char* name, std::string format);
+	~ProfileScope();
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	const char* m_name;
+	std::string m_format;
+	bool m_enabled;
+	Profiler::Clock::time_point m_start;
+	ProfileCounters m_counters;
+	ProfileCounters* m_parent;
+};
+
+// Called where texture data is allocated or copied in bulk. Thread safe, no-ops outside of an enabled scope
+void CountAllocatedBytes(size_t size);
+void CountCopiedBytes(size_t size);
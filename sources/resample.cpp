@@ -0,0 +1,469 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+#include "resample.h"
+#include "thread_pool.h"
+#include "simd.h"
+#include "common.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+
+namespace
+{
+	// Polyphase weights of a 1D resampling pass. Output j reads taps source samples starting at first[j],
+	// indices outside of [0, n_in) are mirrored. Outputs with the same j % phases share weights
+	struct FilterWeights
+	{
+		int n_in;
+		int taps;
+		int phases;
+		std::vector<int> first;
+		std::vector<float> weight;
+
+		const float* Weights(int j) const
+		{
+			return &weight[(size_t)(j % phases) * taps];
+		}
+
+		bool IsInterior(int j) const
+		{
+			return first[j] >= 0 && first[j] + taps <= n_in;
+		}
+	};
+
+	double BesselI0(double x)
+	{
+		double sum = 1.0;
+		double term = 1.0;
+		double q = x * x / 4.0;
+		for (int k = 1; k < 32; ++k)
+		{
+			term *= q / (k * k);
+			sum += term;
+			if (term < sum * 1e-12)
+				break;
+		}
+		return sum;
+	}
+
+	double Sinc(double x)
+	{
+		if (fabs(x) < 1e-9)
+			return 1.0;
+		x *= M_PI;
+		return sin(x) / x;
+	}
+
+	double KaiserFilter(double x)
+	{
+		const double width = 3.0;
+		const double alpha = 4.0;
+		if (fabs(x) >= width)
+			return 0.0;
+		double t = x / width;
+		return Sinc(x) * BesselI0(alpha * sqrt(1.0 - t * t)) / BesselI0(alpha);
+	}
+
+	double BSplineFilter(double x)
+	{
+		x = fabs(x);
+		if (x < 1.0)
+			return (4.0 + x * x * (3.0 * x - 6.0)) / 6.0;
+		if (x < 2.0)
+		{
+			double t = 2.0 - x;
+			return t * t * t / 6.0;
+		}
+		return 0.0;
+	}
+
+	double Lanczos3Filter(double x)
+	{
+		if (fabs(x) >= 3.0)
+			return 0.0;
+		return Sinc(x) * Sinc(x / 3.0);
+	}
+
+	// Mitchell-Netravali with B = C = 1/3
+	double MitchellFilter(double x)
+	{
+		const double b = 1.0 / 3.0;
+		const double c = 1.0 / 3.0;
+		x = fabs(x);
+		if (x < 1.0)
+			return ((12.0 - 9.0 * b - 6.0 * c) * x * x * x + (-18.0 + 12.0 * b + 6.0 * c) * x * x + (6.0 - 2.0 * b)) / 6.0;
+		if (x < 2.0)
+			return ((-b - 6.0 * c) * x * x * x + (6.0 * b + 30.0 * c) * x * x + (-12.0 * b - 48.0 * c) * x + (8.0 * b + 24.0 * c)) / 6.0;
+		return 0.0;
+	}
+
+	double FilterSupport(ResampleFilter filter)
+	{
+		switch (filter)
+		{
+			case FilterBox: return 0.5;
+			case FilterKaiser: return 3.0;
+			case FilterBSpline: return 2.0;
+			case FilterLanczos3: return 3.0;
+			case FilterMitchell: return 2.0;
+		}
+		return 0.0;
+	}
+
+	double EvaluateFilter(ResampleFilter filter, double x)
+	{
+		switch (filter)
+		{
+			case FilterKaiser: return KaiserFilter(x);
+			case FilterBSpline: return BSplineFilter(x);
+			case FilterLanczos3: return Lanczos3Filter(x);
+			case FilterMitchell: return MitchellFilter(x);
+			default: return 0.0;
+		}
+	}
+
+	int Mirror(int i, int n)
+	{
+		int period = 2 * n;
+		i %= period;
+		if (i < 0)
+			i += period;
+		if (i >= n)
+			i = period - 1 - i;
+		return i;
+	}
+
+	int GreatestCommonDivisor(int a, int b)
+	{
+		while (b != 0)
+		{
+			int t = a % b;
+			a = b;
+			b = t;
+		}
+		return a;
+	}
+
+	FilterWeights BuildWeights(int n_in, int n_out, ResampleFilter filter)
+	{
+		const double scale = (double)n_in / n_out;
+		const double filter_scale = std::max(scale, 1.0);
+		const double support = FilterSupport(filter) * filter_scale;
+		const int divisor = GreatestCommonDivisor(n_in, n_out);
+		// output j + phases is centered exactly shift source texels after output j
+		const int phases = n_out / divisor;
+		const int shift = n_in / divisor;
+
+		std::vector<int> phase_first(phases);
+		std::vector<std::vector<double> > phase_weights(phases);
+		int taps = 1;
+		for (int p = 0; p < phases; ++p)
+		{
+			double center = (p + 0.5) * scale - 0.5;
+			int first = (int)floor(center - support);
+			int last = (int)ceil(center + support);
+			std::vector<double>& w = phase_weights[p];
+			double sum = 0.0;
+			for (int i = first; i <= last; ++i)
+			{
+				double x;
+				if (filter == FilterBox)
+				{
+					// exact coverage of the source texel by the box footprint
+					double lo = std::max(i - 0.5, center - support);
+					double hi = std::min(i + 0.5, center + support);
+					x = std::max(hi - lo, 0.0);
+				}
+				else
+				{
+					x = EvaluateFilter(filter, (i - center) / filter_scale);
+				}
+				w.push_back(x);
+				sum += x;
+			}
+			// leading and trailing zeros only cost taps
+			size_t begin = 0;
+			while (begin + 1 < w.size() && w[begin] == 0.0)
+				++begin;
+			size_t end = w.size();
+			while (end > begin + 1 && w[end - 1] == 0.0)
+				--end;
+			w = std::vector<double>(w.begin() + begin, w.begin() + end);
+			for (double& x: w)
+				x /= sum;
+			phase_first[p] = first + (int)begin;
+			taps = std::max(taps, (int)w.size());
+		}
+
+		FilterWeights weights;
+		weights.n_in = n_in;
+		weights.taps = taps;
+		weights.phases = phases;
+		weights.weight.assign((size_t)phases * taps, 0.0f);
+		for (int p = 0; p < phases; ++p)
+		{
+			for (size_t k = 0; k < phase_weights[p].size(); ++k)
+			{
+				weights.weight[(size_t)p * taps + k] = (float)phase_weights[p][k];
+			}
+		}
+		weights.first.resize(n_out);
+		for (int j = 0; j < n_out; ++j)
+		{
+			weights.first[j] = phase_first[j % phases] + (j / phases) * shift;
+		}
+		return weights;
+	}
+
+	// Horizontal pass over one row of interleaved texels. Channel count is a template parameter,
+	// so that the per-texel loop is unrolled; RGBA is accumulated as one SSE vector
+	template<int C>
+	void ResampleRowT(const float* src, float* dst, int n_out, const FilterWeights& weights)
+	{
+		for (int j = 0; j < n_out; ++j)
+		{
+			const float* w = weights.Weights(j);
+			float acc[C] = {};
+			if (weights.IsInterior(j))
+			{
+				const float* s = src + (size_t)weights.first[j] * C;
+				for (int k = 0; k < weights.taps; ++k)
+				{
+					for (int c = 0; c < C; ++c)
+					{
+						acc[c] += w[k] * s[k * C + c];
+					}
+				}
+			}
+			else
+			{
+				for (int k = 0; k < weights.taps; ++k)
+				{
+					const float* s = src + (size_t)Mirror(weights.first[j] + k, weights.n_in) * C;
+					for (int c = 0; c < C; ++c)
+					{
+						acc[c] += w[k] * s[c];
+					}
+				}
+			}
+			memcpy(dst + (size_t)j * C, acc, sizeof(acc));
+		}
+	}
+
+	template<>
+	void ResampleRowT<4>(const float* src, float* dst, int n_out, const FilterWeights& weights)
+	{
+		for (int j = 0; j < n_out; ++j)
+		{
+			const float* w = weights.Weights(j);
+			__m128 acc = _mm_setzero_ps();
+			if (weights.IsInterior(j))
+			{
+				const float* s = src + (size_t)weights.first[j] * 4;
+				for (int k = 0; k < weights.taps; ++k)
+				{
+					acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w[k]), _mm_loadu_ps(s + k * 4)));
+				}
+			}
+			else
+			{
+				for (int k = 0; k < weights.taps; ++k)
+				{
+					const float* s = src + (size_t)Mirror(weights.first[j] + k, weights.n_in) * 4;
+					acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w[k]), _mm_loadu_ps(s)));
+				}
+			}
+			_mm_storeu_ps(dst + (size_t)j * 4, acc);
+		}
+	}
+
+	void ResampleRowGeneric(const float* src, float* dst, int n_out, int channels, const FilterWeights& weights)
+	{
+		for (int j = 0; j < n_out; ++j)
+		{
+			const float* w = weights.Weights(j);
+			float* out = dst + (size_t)j * channels;
+			std::fill(out, out + channels, 0.0f);
+			for (int k = 0; k < weights.taps; ++k)
+			{
+				const float* s = src + (size_t)Mirror(weights.first[j] + k, weights.n_in) * channels;
+				for (int c = 0; c < channels; ++c)
+				{
+					out[c] += w[k] * s[c];
+				}
+			}
+		}
+	}
+
+	void ResampleRow(const float* src, float* dst, int n_out, int channels, const FilterWeights& weights)
+	{
+		switch (channels)
+		{
+			case 1: ResampleRowT<1>(src, dst, n_out, weights); break;
+			case 2: ResampleRowT<2>(src, dst, n_out, weights); break;
+			case 3: ResampleRowT<3>(src, dst, n_out, weights); break;
+			case 4: ResampleRowT<4>(src, dst, n_out, weights); break;
+			default: ResampleRowGeneric(src, dst, n_out, channels, weights); break;
+		}
+	}
+
+	// dst[i] = sum of w[k] * rows[k][i], over contiguous memory of whole rows or slices
+	void CombineRows(const float* const* rows, const float* w, int taps, float* dst, size_t begin, size_t end)
+	{
+		size_t i = begin;
+		for (; i + simd::width <= end; i += simd::width)
+		{
+			simd::vfloat acc = simd::set1(0.0f);
+			for (int k = 0; k < taps; ++k)
+			{
+				acc = acc + simd::set1(w[k]) * simd::load(rows[k] + i);
+			}
+			simd::store(dst + i, acc);
+		}
+		for (; i < end; ++i)
+		{
+			float acc = 0.0f;
+			for (int k = 0; k < taps; ++k)
+			{
+				acc += w[k] * rows[k][i];
+			}
+			dst[i] = acc;
+		}
+	}
+
+	// Horizontal and vertical passes of every slice, from src to dst of size (dst_width, dst_height, src.depth)
+	void ResamplePlanes(const FloatImage& src, FloatImage& dst, ResampleFilter filter)
+	{
+		const int channels = src.channels;
+		const bool resize_x = src.width != dst.width;
+		const bool resize_y = src.height != dst.height;
+		const size_t src_row = (size_t)src.width * channels;
+		const size_t dst_row = (size_t)dst.width * channels;
+		FilterWeights weights_x;
+		FilterWeights weights_y;
+		if (resize_x)
+		{
+			weights_x = BuildWeights(src.width, dst.width, filter);
+		}
+		if (resize_y)
+		{
+			weights_y = BuildWeights(src.height, dst.height, filter);
+		}
+
+		// bands are long enough that the rows filtered twice at their edges are a small fraction
+		ThreadPool& pool = ThreadPool::GetDefault();
+		const int bands = std::max(1, std::min(dst.height / 32, (pool.thread_count() + 1) * 4));
+		pool.ParallelFor((size_t)src.depth * bands, [&](size_t index)
+		{
+			const int z = (int)(index / bands);
+			const int band = (int)(index % bands);
+			const int y_begin = (int)((int64_t)dst.height * band / bands);
+			const int y_end = (int)((int64_t)dst.height * (band + 1) / bands);
+			const float* src_slice = src.data.data() + (size_t)z * src.height * src_row;
+			float* dst_slice = dst.data.data() + (size_t)z * dst.height * dst_row;
+
+			if (!resize_y)
+			{
+				for (int y = y_begin; y < y_end; ++y)
+				{
+					ResampleRow(src_slice + y * src_row, dst_slice + y * dst_row, dst.width, channels, weights_x);
+				}
+				return;
+			}
+
+			// Ring of horizontally filtered source rows, row r lives in slot r % taps. Rows needed by one output
+			// span at most taps consecutive indices, so they never share a slot
+			const int ring_size = weights_y.taps;
+			std::vector<float> ring(resize_x ? (size_t)ring_size * dst_row : 0);
+			std::vector<int> slot_row(ring_size, -1);
+			std::vector<const float*> rows(weights_y.taps);
+			for (int y = y_begin; y < y_end; ++y)
+			{
+				for (int k = 0; k < weights_y.taps; ++k)
+				{
+					int r = Mirror(weights_y.first[y] + k, src.height);
+					if (!resize_x)
+					{
+						rows[k] = src_slice + r * src_row;
+						continue;
+					}
+					int slot = r % ring_size;
+					float* row = ring.data() + slot * dst_row;
+					if (slot_row[slot] != r)
+					{
+						ResampleRow(src_slice + r * src_row, row, dst.width, channels, weights_x);
+						slot_row[slot] = r;
+					}
+					rows[k] = row;
+				}
+				CombineRows(rows.data(), weights_y.Weights(y), weights_y.taps, dst_slice + y * dst_row, 0, dst_row);
+			}
+		});
+	}
+
+	// Depth pass, slices of src and dst have the same size
+	void ResampleDepth(const FloatImage& src, FloatImage& dst, ResampleFilter filter)
+	{
+		const FilterWeights weights = BuildWeights(src.depth, dst.depth, filter);
+		const size_t slice = (size_t)src.width * src.height * src.channels;
+		// slices are split into chunks, so that small depths still spread over all threads
+		const size_t chunk = 16384;
+		const size_t chunks = (slice + chunk - 1) / chunk;
+		ThreadPool::GetDefault().ParallelFor((size_t)dst.depth * chunks, [&](size_t index)
+		{
+			const int z = (int)(index / chunks);
+			const size_t begin = (index % chunks) * chunk;
+			const size_t end = std::min(begin + chunk, slice);
+			std::vector<const float*> rows(weights.taps);
+			for (int k = 0; k < weights.taps; ++k)
+			{
+				rows[k] = src.data.data() + Mirror(weights.first[z] + k, src.depth) * slice;
+			}
+			CombineRows(rows.data(), weights.Weights(z), weights.taps, dst.data.data() + z * slice, begin, end);
+		});
+	}
+}
+
+
+void Resample(const FloatImage& src, FloatImage& dst, ResampleFilter filter)
+{
+	if (src.channels != dst.channels)
+	{
+		throw runtime_error("Number of channels must match, got %d and %d", src.channels, dst.channels);
+	}
+	dst.data.resize(dst.texel_count() * dst.channels);
+	const bool resize_planes = src.width != dst.width || src.height != dst.height;
+	const bool resize_depth = src.depth != dst.depth;
+	if (!resize_planes && !resize_depth)
+	{
+		dst = src;
+		return;
+	}
+	if (!resize_depth)
+	{
+		ResamplePlanes(src, dst, filter);
+		return;
+	}
+	if (!resize_planes)
+	{
+		ResampleDepth(src, dst, filter);
+		return;
+	}
+	FloatImage planes(dst.width, dst.height, src.depth, src.channels);
+	ResamplePlanes(src, planes, filter);
+	ResampleDepth(planes, dst, filter);
+}
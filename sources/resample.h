@@ -0,0 +1,37 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#pragma once
+#include "surface.h"
+
+
+enum ResampleFilter
+{
+	FilterBox,
+	FilterKaiser,
+	FilterBSpline,
+	FilterLanczos3,
+	FilterMitchell
+};
+
+// Separable resampling of a float image. Size of dst defines the target size.
+// Borders are handled by mirroring.
+//
+// Weights are tabulated per phase: for sizes n_in and n_out, outputs n_out / gcd(n_in, n_out) apart share their
+// weights, shifted by a whole number of source texels. Rows are filtered horizontally first, then vertically, then
+// along depth. Output rows are split into bands that run in parallel; each band keeps a ring of horizontally filtered
+// rows, so every source row is filtered once per band. Vertical and depth passes run over whole rows in SIMD.
+void Resample(const FloatImage& src, FloatImage& dst, ResampleFilter filter);
@@ -0,0 +1,97 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+#include "resize.h"
+#include "surface.h"
+#include "codec.h"
+#include "pixel_format.h"
+#include "profiler.h"
+#include "common.h"
+
+#include <PVRTextureUtilities.h>
+
+#include <memory>
+#include <algorithm>
+
+
+pvrtexture::CPVRTexture* ResizeTexture(const pvrtexture::CPVRTexture& texture, uint32_t width, uint32_t height, uint32_t depth,
+                                       ResampleFilter filter, float gamma, EPVRTColourSpace colour_space)
+{
+	if (width == 0 || height == 0 || depth == 0)
+	{
+		throw runtime_error("Size has to be positive, got %dx%dx%d", width, height, depth);
+	}
+	if (texture.getPixelType().Part.High == 0)
+	{
+		throw runtime_error("Operation is not supported for compressed textures. Transcode texture to an uncompressed format first");
+	}
+
+	std::unique_ptr<pvrtexture::CPVRTexture> converted;
+	const pvrtexture::CPVRTexture* source = &texture;
+	if (!IsRGBAReadable(texture))
+	{
+		const EPVRTVariableType type = texture.getChannelType();
+		const bool is_float = IsFloatChannelType(type);
+		converted.reset(new pvrtexture::CPVRTexture(texture));
+		if (!pvrtexture::Transcode(*converted, is_float ? RGBA32323232 : RGBA16161616,
+		                           is_float ? ePVRTVarTypeFloat : (IsSignedChannelType(type) ? ePVRTVarTypeSignedShortNorm : ePVRTVarTypeUnsignedShortNorm),
+		                           texture.getColourSpace()))
+		{
+			throw runtime_error("Failed to convert texture for resampling");
+		}
+		CountAllocatedBytes(converted->getDataSize());
+		source = converted.get();
+	}
+	SurfaceCodec codec(source->getHeader(), colour_space, gamma);
+
+	uint32_t size = std::max(std::max(width, height), depth);
+	uint32_t max_levels = 1;
+	while (size > 1)
+	{
+		size >>= 1u;
+		++max_levels;
+	}
+
+	pvrtexture::CPVRTextureHeader header(source->getHeader());
+	header.setWidth(width);
+	header.setHeight(height);
+	header.setDepth(depth);
+	header.setNumMIPLevels(std::min(source->getNumMIPLevels(), max_levels));
+	std::unique_ptr<pvrtexture::CPVRTexture> result(new pvrtexture::CPVRTexture(header));
+	CountAllocatedBytes(result->getDataSize());
+
+	for (uint32_t mip = 0; mip < result->getNumMIPLevels(); ++mip)
+	{
+		for (uint32_t array = 0; array < result->getNumArrayMembers(); ++array)
+		{
+			for (uint32_t face = 0; face < result->getNumFaces(); ++face)
+			{
+				FloatImage level = codec.Read(*source, mip, array, face);
+				FloatImage resized(result->getWidth(mip), result->getHeight(mip), result->getDepth(mip), codec.channels());
+				Resample(level, resized, filter);
+				codec.Write(resized, *result, mip, array, face);
+			}
+		}
+	}
+
+	if (converted)
+	{
+		if (!pvrtexture::Transcode(*result, texture.getPixelType(), texture.getChannelType(), texture.getColourSpace()))
+		{
+			throw runtime_error("Failed to convert resized texture back to the pixel format of the source");
+		}
+		CountAllocatedBytes(result->getDataSize());
+	}
+	return result.release();
+}
@@ -0,0 +1,28 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+#pragma once
+#include "resample.h"
+
+#include <PVRTexture.h>
+
+#include <cstdint>
+
+
+// Returns a resized copy of the texture. Every surface is resampled from the surface of the same mip level, array
+// member and face of the source, in float32 linear space, see SurfaceCodec and Resample. Mip levels are kept, as many
+// as the chain of the new size has room for. Formats that SurfaceCodec can not read, e.g. packed ones, are converted
+// by PVRTexLib to RGBA16161616, or RGBA32323232 for float channel types, and back. Compressed formats are not supported.
+pvrtexture::CPVRTexture* ResizeTexture(const pvrtexture::CPVRTexture& texture, uint32_t width, uint32_t height, uint32_t depth,
+                                       ResampleFilter filter, float gamma, EPVRTColourSpace colour_space);
@@ -0,0 +1,164 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#pragma once
+#include <cstddef>
+#include <cstring>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#else
+#include <smmintrin.h>
+#endif
+
+//Thin wrapper over float32 vectors of the widest instruction set the module is compiled for (AVX-512, AVX2, SSE4.1),
+//so that kernels are written once and process 16, 8 or 4 lanes per instruction
+namespace simd
+{
+#if defined(__AVX512F__)
+	struct vfloat { __m512 v; };
+	struct vmask { __mmask16 m; };
+	enum { width = 16 };
+
+	inline vfloat load(const float* p) { return {_mm512_loadu_ps(p)}; }
+	inline void store(float* p, vfloat a) { _mm512_storeu_ps(p, a.v); }
+	inline void store(int* p, vfloat a) { _mm512_storeu_si512(p, _mm512_cvttps_epi32(a.v)); }
+	inline vfloat set1(float x) { return {_mm512_set1_ps(x)}; }
+	inline vfloat operator+(vfloat a, vfloat b) { return {_mm512_add_ps(a.v, b.v)}; }
+	inline vfloat operator-(vfloat a, vfloat b) { return {_mm512_sub_ps(a.v, b.v)}; }
+	inline vfloat operator*(vfloat a, vfloat b) { return {_mm512_mul_ps(a.v, b.v)}; }
+	inline vfloat operator/(vfloat a, vfloat b) { return {_mm512_div_ps(a.v, b.v)}; }
+	inline vfloat min(vfloat a, vfloat b) { return {_mm512_min_ps(a.v, b.v)}; }
+	inline vfloat max(vfloat a, vfloat b) { return {_mm512_max_ps(a.v, b.v)}; }
+	inline vfloat sqrt(vfloat a) { return {_mm512_sqrt_ps(a.v)}; }
+	inline vfloat abs(vfloat a) { return {_mm512_abs_ps(a.v)}; }
+	inline vmask operator>(vfloat a, vfloat b) { return {_mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ)}; }
+	inline vmask operator>=(vfloat a, vfloat b) { return {_mm512_cmp_ps_mask(a.v, b.v, _CMP_GE_OQ)}; }
+	inline vmask operator<(vfloat a, vfloat b) { return {_mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ)}; }
+	inline vmask operator&(vmask a, vmask b) { return {(__mmask16)(a.m & b.m)}; }
+	inline vfloat select(vmask m, vfloat a, vfloat b) { return {_mm512_mask_blend_ps(m.m, b.v, a.v)}; }
+#elif defined(__AVX2__)
+	struct vfloat { __m256 v; };
+	struct vmask { __m256 m; };
+	enum { width = 8 };
+
+	inline vfloat load(const float* p) { return {_mm256_loadu_ps(p)}; }
+	inline void store(float* p, vfloat a) { _mm256_storeu_ps(p, a.v); }
+	inline void store(int* p, vfloat a) { _mm256_storeu_si256((__m256i*)p, _mm256_cvttps_epi32(a.v)); }
+	inline vfloat set1(float x) { return {_mm256_set1_ps(x)}; }
+	inline vfloat operator+(vfloat a, vfloat b) { return {_mm256_add_ps(a.v, b.v)}; }
+	inline vfloat operator-(vfloat a, vfloat b) { return {_mm256_sub_ps(a.v, b.v)}; }
+	inline vfloat operator*(vfloat a, vfloat b) { return {_mm256_mul_ps(a.v, b.v)}; }
+	inline vfloat operator/(vfloat a, vfloat b) { return {_mm256_div_ps(a.v, b.v)}; }
+	inline vfloat min(vfloat a, vfloat b) { return {_mm256_min_ps(a.v, b.v)}; }
+	inline vfloat max(vfloat a, vfloat b) { return {_mm256_max_ps(a.v, b.v)}; }
+	inline vfloat sqrt(vfloat a) { return {_mm256_sqrt_ps(a.v)}; }
+	inline vfloat abs(vfloat a) { return {_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)}; }
+	inline vmask operator>(vfloat a, vfloat b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)}; }
+	inline vmask operator>=(vfloat a, vfloat b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)}; }
+	inline vmask operator<(vfloat a, vfloat b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)}; }
+	inline vmask operator&(vmask a, vmask b) { return {_mm256_and_ps(a.m, b.m)}; }
+	inline vfloat select(vmask m, vfloat a, vfloat b) { return {_mm256_blendv_ps(b.v, a.v, m.m)}; }
+#else
+	struct vfloat { __m128 v; };
+	struct vmask { __m128 m; };
+	enum { width = 4 };
+
+	inline vfloat load(const float* p) { return {_mm_loadu_ps(p)}; }
+	inline void store(float* p, vfloat a) { _mm_storeu_ps(p, a.v); }
+	inline void store(int* p, vfloat a) { _mm_storeu_si128((__m128i*)p, _mm_cvttps_epi32(a.v)); }
+	inline vfloat set1(float x) { return {_mm_set1_ps(x)}; }
+	inline vfloat operator+(vfloat a, vfloat b) { return {_mm_add_ps(a.v, b.v)}; }
+	inline vfloat operator-(vfloat a, vfloat b) { return {_mm_sub_ps(a.v, b.v)}; }
+	inline vfloat operator*(vfloat a, vfloat b) { return {_mm_mul_ps(a.v, b.v)}; }
+	inline vfloat operator/(vfloat a, vfloat b) { return {_mm_div_ps(a.v, b.v)}; }
+	inline vfloat min(vfloat a, vfloat b) { return {_mm_min_ps(a.v, b.v)}; }
+	inline vfloat max(vfloat a, vfloat b) { return {_mm_max_ps(a.v, b.v)}; }
+	inline vfloat sqrt(vfloat a) { return {_mm_sqrt_ps(a.v)}; }
+	inline vfloat abs(vfloat a) { return {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)}; }
+	inline vmask operator>(vfloat a, vfloat b) { return {_mm_cmpgt_ps(a.v, b.v)}; }
+	inline vmask operator>=(vfloat a, vfloat b) { return {_mm_cmpge_ps(a.v, b.v)}; }
+	inline vmask operator<(vfloat a, vfloat b) { return {_mm_cmplt_ps(a.v, b.v)}; }
+	inline vmask operator&(vmask a, vmask b) { return {_mm_and_ps(a.m, b.m)}; }
+	inline vfloat select(vmask m, vfloat a, vfloat b) { return {_mm_blendv_ps(b.v, a.v, m.m)}; }
+#endif
+
+	inline vfloat operator-(vfloat a) { return set1(0.0f) - a; }
+
+	inline float reduce_add(vfloat a)
+	{
+		float t[width];
+		store(t, a);
+		float s = 0.0f;
+		for (int i = 0; i < width; ++i)
+			s += t[i];
+		return s;
+	}
+
+	inline float reduce_min(vfloat a)
+	{
+		float t[width];
+		store(t, a);
+		float s = t[0];
+		for (int i = 1; i < width; ++i)
+			s = t[i] < s ? t[i] : s;
+		return s;
+	}
+
+	inline float reduce_max(vfloat a)
+	{
+		float t[width];
+		store(t, a);
+		float s = t[0];
+		for (int i = 1; i < width; ++i)
+			s = t[i] > s ? t[i] : s;
+		return s;
+	}
+
+	//Runs kernel over count elements, the tail is processed through zero-padded buffers
+	template<int Inputs, int Outputs, typename F>
+	inline void for_each(const float* const* in, float* const* out, size_t count, const F& kernel)
+	{
+		size_t i = 0;
+		vfloat a[Inputs > 0 ? Inputs : 1];
+		vfloat b[Outputs];
+		for (; i + width <= count; i += width)
+		{
+			for (int k = 0; k < Inputs; ++k)
+				a[k] = load(in[k] + i);
+			kernel(a, b);
+			for (int k = 0; k < Outputs; ++k)
+				store(out[k] + i, b[k]);
+		}
+		if (i < count)
+		{
+			size_t rest = count - i;
+			float tmp[width];
+			for (int k = 0; k < Inputs; ++k)
+			{
+				memset(tmp, 0, sizeof(tmp));
+				memcpy(tmp, in[k] + i, rest * sizeof(float));
+				a[k] = load(tmp);
+			}
+			kernel(a, b);
+			for (int k = 0; k < Outputs; ++k)
+			{
+				store(tmp, b[k]);
+				memcpy(out[k] + i, tmp, rest * sizeof(float));
+			}
+		}
+	}
+}
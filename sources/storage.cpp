@@ -0,0 +1,231 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#include "storage.h"
+#include "container.h"
+#include "profiler.h"
+
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+
+namespace
+{
+	// Memory that textures point to without owning it
+	struct SharedData
+	{
+		virtual ~SharedData() {}
+
+		// True for OwnedData. Used instead of dynamic_cast, since Windows builds disable RTTI
+		virtual bool Owns() const { return false; }
+	};
+
+	struct BorrowedData: SharedData
+	{
+		explicit BorrowedData(py::object owner): owner(std::move(owner)) {}
+
+		// May be destroyed from a binding that released GIL
+		~BorrowedData()
+		{
+			py::gil_scoped_acquire acquire;
+			owner = py::object();
+		}
+
+		py::object owner;
+	};
+
+	// Buffer that was owned by a texture before it was shared
+	struct OwnedData: SharedData
+	{
+		explicit OwnedData(uint8_t* data): data(data) {}
+
+		// PVRTexLib frees texture data with delete[]
+		~OwnedData()
+		{
+			delete[] data;
+		}
+
+		bool Owns() const { return true; }
+
+		uint8_t* data;
+	};
+
+	std::mutex registry_mutex;
+	std::unordered_map<const pvrtexture::CPVRTexture*, std::shared_ptr<SharedData>> registry;
+	// Textures that handed out writable views of their data
+	std::unordered_set<const pvrtexture::CPVRTexture*> exposed;
+
+	// Unregisters texture. The result must be destroyed after registry_mutex is unlocked,
+	// since destruction may acquire GIL and a thread holding GIL may be waiting for the mutex
+	std::shared_ptr<SharedData> Take(const pvrtexture::CPVRTexture& texture)
+	{
+		std::lock_guard<std::mutex> lock(registry_mutex);
+		auto it = registry.find(&texture);
+		if (it == registry.end())
+		{
+			return nullptr;
+		}
+		std::shared_ptr<SharedData> shared = std::move(it->second);
+		registry.erase(it);
+		return shared;
+	}
+}
+
+
+void BorrowData(pvrtexture::CPVRTexture& texture, void* data, py::object owner)
+{
+	if (texture.m_pTextureData != nullptr)
+	{
+		throw runtime_error("Can not borrow data for a texture that already has data");
+	}
+	std::shared_ptr<SharedData> borrowed(new BorrowedData(std::move(owner)));
+	{
+		std::lock_guard<std::mutex> lock(registry_mutex);
+		registry[&texture] = std::move(borrowed);
+	}
+	texture.m_pTextureData = (uint8_t*)data;
+	texture.m_stDataSize = GetTextureDataSize(texture);
+}
+
+void ShareData(pvrtexture::CPVRTexture& texture, pvrtexture::CPVRTexture& source)
+{
+	if (texture.m_pTextureData != nullptr)
+	{
+		throw runtime_error("Can not share data with a texture that already has data");
+	}
+	if (source.m_pTextureData == nullptr)
+	{
+		return;
+	}
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	if (exposed.count(&source) != 0)
+	{
+		size_t size = GetTextureDataSize(source);
+		texture.m_pTextureData = new PVRTuint8[size];
+		texture.m_stDataSize = size;
+		memcpy(texture.m_pTextureData, source.m_pTextureData, size);
+		CountAllocatedBytes(size);
+		CountCopiedBytes(size);
+		return;
+	}
+	std::shared_ptr<SharedData> shared = registry[&source];
+	if (!shared)
+	{
+		shared = std::make_shared<OwnedData>(source.m_pTextureData);
+		registry[&source] = shared;
+	}
+	registry[&texture] = shared;
+	texture.m_pTextureData = source.m_pTextureData;
+	texture.m_stDataSize = source.m_stDataSize;
+}
+
+void MarkExposed(const pvrtexture::CPVRTexture& texture)
+{
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	exposed.insert(&texture);
+}
+
+bool IsBorrowed(const pvrtexture::CPVRTexture& texture)
+{
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	return registry.find(&texture) != registry.end();
+}
+
+void MakeUnique(pvrtexture::CPVRTexture& texture)
+{
+	std::shared_ptr<SharedData> shared = Take(texture);
+	if (!shared)
+	{
+		return;
+	}
+	// Other textures can only get a reference through the registry, so a count of one can not grow
+	if (shared->Owns() && shared.use_count() == 1)
+	{
+		static_cast<OwnedData*>(shared.get())->data = nullptr;
+		return;
+	}
+	// Copied by hand rather than with CPVRTexture(header, data), which does not size every format
+	size_t size = GetTextureDataSize(texture);
+	uint8_t* data = new PVRTuint8[size];
+	memcpy(data, texture.m_pTextureData, size);
+	CountAllocatedBytes(size);
+	CountCopiedBytes(size);
+	texture.m_pTextureData = data;
+	texture.m_stDataSize = size;
+}
+
+void ReleaseData(pvrtexture::CPVRTexture& texture)
+{
+	std::shared_ptr<SharedData> shared = Take(texture);
+	if (shared)
+	{
+		texture.m_pTextureData = nullptr;
+		texture.m_stDataSize = 0;
+	}
+}
+
+void AllocateData(pvrtexture::CPVRTexture& texture)
+{
+	ReleaseData(texture);
+	size_t size = GetTextureDataSize(texture);
+	// PVRTexLib frees texture data with delete[]
+	delete[] texture.m_pTextureData;
+	texture.m_pTextureData = nullptr;
+	texture.m_stDataSize = 0;
+	texture.m_pTextureData = new PVRTuint8[size]();
+	texture.m_stDataSize = size;
+	CountAllocatedBytes(size);
+}
+
+uint8_t* GetSurfacePtr(const pvrtexture::CPVRTexture& texture, uint32_t mip, uint32_t array, uint32_t face)
+{
+	if (mip >= texture.getNumMIPLevels() || array >= texture.getNumArrayMembers() || face >= texture.getNumFaces())
+	{
+		throw runtime_error("Surface index out of range: mip %d, array %d, face %d", mip, array, face);
+	}
+	size_t size = GetTextureDataSize(texture);
+	if (texture.m_pTextureData == nullptr || texture.m_stDataSize < size)
+	{
+		throw runtime_error("Texture holds %llu bytes of data, but its header needs %llu",
+				(unsigned long long)(texture.m_pTextureData == nullptr ? 0 : texture.m_stDataSize), (unsigned long long)size);
+	}
+	return texture.m_pTextureData + GetPVRSurfaceOffset(texture, mip, array, face);
+}
+
+void ReplaceTexture(pvrtexture::CPVRTexture& texture, pvrtexture::CPVRTexture& source)
+{
+	ReleaseData(texture);
+	static_cast<pvrtexture::CPVRTextureHeader&>(texture) = source;
+	std::swap(texture.m_pTextureData, source.m_pTextureData);
+	std::swap(texture.m_stDataSize, source.m_stDataSize);
+}
+
+void TextureDeleter::operator()(pvrtexture::CPVRTexture* texture) const
+{
+	if (texture != nullptr)
+	{
+		ReleaseData(*texture);
+		{
+			std::lock_guard<std::mutex> lock(registry_mutex);
+			exposed.erase(texture);
+		}
+		delete texture;
+	}
+}
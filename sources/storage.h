@@ -0,0 +1,93 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#pragma once
+#include "common.h"
+#include "profiler.h"
+
+#include <PVRTexture.h>
+
+#include <functional>
+#include <memory>
+
+
+// Normally CPVRTexture owns its texture data. A texture can also borrow data owned by a python object,
+// e.g. the numpy array passed to from_numpy. In that case m_pTextureData points to the memory of that object
+// and a reference to the object is kept until the texture is destroyed or gets its own copy of the data.
+// Textures can also share data with each other, copies made with ShareData point to the data of the source until
+// one of them is modified. Borrowed and shared data is never written to. MakeUnique must be called before any
+// operation that may modify or reallocate texture data, it copies the data into a buffer owned by the texture.
+
+// Makes an empty texture point to data owned by owner. data must hold at least GetTextureDataSize(texture) bytes
+void BorrowData(pvrtexture::CPVRTexture& texture, void* data, py::object owner);
+
+// Makes an empty texture point to the data of source, which may itself be borrowed or shared.
+// Data owned by source is handed over to a reference counted buffer, freed when the last texture drops it
+void ShareData(pvrtexture::CPVRTexture& texture, pvrtexture::CPVRTexture& source);
+
+// Called when a writable view of texture data is handed out. Writes through views can not be tracked,
+// so ShareData copies the data of such textures instead of sharing it
+void MarkExposed(const pvrtexture::CPVRTexture& texture);
+
+// True for borrowed and for shared data
+bool IsBorrowed(const pvrtexture::CPVRTexture& texture);
+
+// Copies borrowed or shared data into a buffer owned by the texture. Does nothing if the texture already owns its
+// data. The last texture referencing a shared buffer takes the buffer back without copying
+void MakeUnique(pvrtexture::CPVRTexture& texture);
+
+// Drops borrowed or shared data without copying, texture is left empty
+void ReleaseData(pvrtexture::CPVRTexture& texture);
+
+// Replaces data of the texture with zero filled data sized for its header. Unlike CPVRTexture(header),
+// this also allocates formats that PVRTexLib does not size, see IsUnsizedFormat
+void AllocateData(pvrtexture::CPVRTexture& texture);
+
+// Pointer to a surface, like getDataPtr, but also valid for unsized formats. Throws if the texture holds less data
+// than its header needs, e.g. a texture of an unsized format created by PVRTexLib
+uint8_t* GetSurfacePtr(const pvrtexture::CPVRTexture& texture, uint32_t mip, uint32_t array, uint32_t face);
+
+// Moves header and data of source into texture, e.g. the result of an operation that can not work in place.
+// Borrowed or shared data of texture is released without copying, owned data is handed over to source
+void ReplaceTexture(pvrtexture::CPVRTexture& texture, pvrtexture::CPVRTexture& source);
+
+
+// Deleter of the holder used for PVRTexture python objects, detaches borrowed data before deleting the texture
+struct TextureDeleter
+{
+	void operator()(pvrtexture::CPVRTexture* texture) const;
+};
+
+typedef std::unique_ptr<pvrtexture::CPVRTexture, TextureDeleter> TextureHolder;
+
+
+// Wraps a PVRTexLib function that modifies texture in place, so that borrowed data is copied first.
+// Functions that replace the data, e.g. resizing, count the new data as allocated
+template<typename R, typename... Args>
+std::function<R(pvrtexture::CPVRTexture&, Args...)> Mutating(R (*f)(pvrtexture::CPVRTexture&, Args...))
+{
+	return [f](pvrtexture::CPVRTexture& texture, Args... args)
+	{
+		MakeUnique(texture);
+		const uint8_t* data = texture.m_pTextureData;
+		R result = f(texture, args...);
+		if (texture.m_pTextureData != data)
+		{
+			CountAllocatedBytes(texture.m_stDataSize);
+		}
+		return result;
+	};
+}
@@ -0,0 +1,432 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#include "surface.h"
+#include "pixel_format.h"
+#include "thread_pool.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+
+namespace
+{
+	// Read and Write convert surfaces in chunks of this many texels in parallel
+	const size_t ChunkTexels = 16384;
+}
+
+
+float HalfToFloat(uint16_t h)
+{
+	uint32_t sign = (uint32_t)(h & 0x8000u) << 16u;
+	uint32_t exponent = (h >> 10u) & 0x1fu;
+	uint32_t mantissa = h & 0x3ffu;
+	uint32_t bits;
+	if (exponent == 0)
+	{
+		if (mantissa == 0)
+		{
+			bits = sign;
+		}
+		else
+		{
+			// subnormal, renormalize
+			exponent = 127 - 15 + 1;
+			while ((mantissa & 0x400u) == 0)
+			{
+				mantissa <<= 1u;
+				--exponent;
+			}
+			mantissa &= 0x3ffu;
+			bits = sign | (exponent << 23u) | (mantissa << 13u);
+		}
+	}
+	else if (exponent == 0x1f)
+	{
+		bits = sign | 0x7f800000u | (mantissa << 13u);
+	}
+	else
+	{
+		bits = sign | ((exponent + 127 - 15) << 23u) | (mantissa << 13u);
+	}
+	float f;
+	memcpy(&f, &bits, 4);
+	return f;
+}
+
+uint16_t FloatToHalf(float f)
+{
+	uint32_t bits;
+	memcpy(&bits, &f, 4);
+	uint16_t sign = (bits >> 16u) & 0x8000u;
+	int32_t exponent = (int32_t)((bits >> 23u) & 0xffu) - 127 + 15;
+	uint32_t mantissa = bits & 0x7fffffu;
+	if (((bits >> 23u) & 0xffu) == 0xff)
+	{
+		return sign | 0x7c00u | (mantissa != 0 ? 0x200u : 0u);
+	}
+	if (exponent >= 0x1f)
+	{
+		return sign | 0x7c00u;
+	}
+	if (exponent <= 0)
+	{
+		if (exponent < -10)
+		{
+			return sign;
+		}
+		mantissa |= 0x800000u;
+		uint32_t shift = 14 - exponent;
+		uint32_t half_mantissa = mantissa >> shift;
+		// round to nearest even
+		uint32_t rest = mantissa & ((1u << shift) - 1u);
+		uint32_t halfway = 1u << (shift - 1u);
+		if (rest > halfway || (rest == halfway && (half_mantissa & 1u)))
+		{
+			++half_mantissa;
+		}
+		return sign | half_mantissa;
+	}
+	uint16_t h = sign | (uint16_t)(exponent << 10u) | (uint16_t)(mantissa >> 13u);
+	uint32_t rest = mantissa & 0x1fffu;
+	if (rest > 0x1000u || (rest == 0x1000u && (h & 1u)))
+	{
+		++h;
+	}
+	return h;
+}
+
+
+SurfaceCodec::SurfaceCodec(const pvrtexture::CPVRTextureHeader& header, EPVRTColourSpace colour_space, float gamma):
+		m_transfer(TransferLinear), m_gamma(gamma)
+{
+	auto decoded = DecodePixelType(header.getPixelType().PixelTypeID);
+	if (decoded.compressed)
+	{
+		throw runtime_error("Operation is not supported for compressed textures. Transcode texture to an uncompressed format first");
+	}
+	m_channels = (int)decoded.channel_names.size();
+	for (int i = 0; i < m_channels; ++i)
+	{
+		if (decoded.channel_sizes[i] != decoded.channel_sizes[0])
+		{
+			throw runtime_error("Operation is supported only for pixel formats with equal channel sizes");
+		}
+		m_colour[i] = decoded.channel_names[i] != 'a' && decoded.channel_names[i] != 'd';
+	}
+	int bits = decoded.channel_sizes[0];
+
+	EPVRTVariableType type = header.getChannelType();
+	bool is_float = type == ePVRTVarTypeSignedFloat || type == ePVRTVarTypeUnsignedFloat;
+	bool is_signed = type == ePVRTVarTypeSignedByteNorm || type == ePVRTVarTypeSignedByte ||
+			type == ePVRTVarTypeSignedShortNorm || type == ePVRTVarTypeSignedShort ||
+			type == ePVRTVarTypeSignedIntegerNorm || type == ePVRTVarTypeSignedInteger;
+	m_normalized = type == ePVRTVarTypeUnsignedByteNorm || type == ePVRTVarTypeSignedByteNorm ||
+			type == ePVRTVarTypeUnsignedShortNorm || type == ePVRTVarTypeSignedShortNorm ||
+			type == ePVRTVarTypeUnsignedIntegerNorm || type == ePVRTVarTypeSignedIntegerNorm;
+
+	switch (bits)
+	{
+		case 8: m_storage = is_signed ? SInt8 : UInt8; break;
+		case 16: m_storage = is_float ? Half : (is_signed ? SInt16 : UInt16); break;
+		case 32: m_storage = is_float ? Float : (is_signed ? SInt32 : UInt32); break;
+		default:
+			throw runtime_error("Operation is supported only for pixel formats with 8, 16 or 32 bits per channel, got %d", bits);
+	}
+	if (is_float && bits == 8)
+	{
+		throw runtime_error("8 bit float channels are not supported");
+	}
+
+	if (m_normalized && !is_signed)
+	{
+		if (colour_space == ePVRTCSpacesRGB)
+		{
+			m_transfer = TransferSRGB;
+		}
+		else if (gamma != 1.0f)
+		{
+			m_transfer = TransferGamma;
+		}
+	}
+	for (int i = 0; i < 256; ++i)
+	{
+		m_lut8[i] = ToLinear(i / 255.0f);
+	}
+	for (int i = 1; i < 256; ++i)
+	{
+		m_encode8[i - 1] = ToLinear((i - 0.5f) / 255.0f);
+	}
+	if (m_storage == UInt16 && m_transfer != TransferLinear)
+	{
+		m_lut16.resize(65536);
+		for (int i = 0; i < 65536; ++i)
+		{
+			m_lut16[i] = ToLinear(i / 65535.0f);
+		}
+	}
+}
+
+float SurfaceCodec::ToLinear(float x) const
+{
+	switch (m_transfer)
+	{
+		case TransferGamma:
+			return x <= 0.0f ? 0.0f : powf(x, m_gamma);
+		case TransferSRGB:
+			return x <= 0.04045f ? x / 12.92f : powf((x + 0.055f) / 1.055f, 2.4f);
+		default:
+			return x;
+	}
+}
+
+float SurfaceCodec::FromLinear(float x) const
+{
+	switch (m_transfer)
+	{
+		case TransferGamma:
+			return x <= 0.0f ? 0.0f : powf(x, 1.0f / m_gamma);
+		case TransferSRGB:
+			return x <= 0.0031308f ? x * 12.92f : 1.055f * powf(x, 1.0f / 2.4f) - 0.055f;
+		default:
+			return x;
+	}
+}
+
+template<typename T>
+void SurfaceCodec::DecodeT(const T* src, float* dst, size_t count) const
+{
+	const float scale = m_normalized ? 1.0f / (float)std::numeric_limits<T>::max() : 1.0f;
+	size_t n = count * m_channels;
+	if (m_transfer != TransferLinear && sizeof(T) <= 2)
+	{
+		// transfer curves only apply to unsigned normalized formats
+		const float* lut = sizeof(T) == 1 ? m_lut8 : m_lut16.data();
+		for (size_t i = 0; i < n; i += m_channels)
+		{
+			for (int c = 0; c < m_channels; ++c)
+			{
+				dst[i + c] = m_colour[c] ? lut[(size_t)src[i + c]] : src[i + c] * scale;
+			}
+		}
+		return;
+	}
+	// signed normalized values have one extra negative code, e.g. -128 / 127 that maps to -1 as well
+	const float lo = m_normalized && std::numeric_limits<T>::is_signed ? -1.0f : -std::numeric_limits<float>::max();
+	for (size_t i = 0; i < n; ++i)
+	{
+		dst[i] = std::max(src[i] * scale, lo);
+	}
+	if (m_transfer != TransferLinear)
+	{
+		for (size_t i = 0; i < n; i += m_channels)
+		{
+			for (int c = 0; c < m_channels; ++c)
+			{
+				if (m_colour[c])
+				{
+					dst[i + c] = ToLinear(dst[i + c]);
+				}
+			}
+		}
+	}
+}
+
+template<typename T>
+void SurfaceCodec::EncodeT(const float* src, T* dst, size_t count) const
+{
+	const float lo = (float)std::numeric_limits<T>::min();
+	const float hi = (float)std::numeric_limits<T>::max();
+	const float scale = m_normalized ? hi : 1.0f;
+	size_t n = count * m_channels;
+	for (size_t i = 0; i < n; i += m_channels)
+	{
+		for (int c = 0; c < m_channels; ++c)
+		{
+			float v = src[i + c];
+			if (m_transfer != TransferLinear && m_colour[c])
+			{
+				if (sizeof(T) == 1)
+				{
+					dst[i + c] = (T)(std::upper_bound(m_encode8, m_encode8 + 255, v) - m_encode8);
+					continue;
+				}
+				v = FromLinear(v);
+			}
+			v = v * scale;
+			v = v < 0.0f ? v - 0.5f : v + 0.5f;
+			// clamp in double, float can not represent 2^32 - 1 exactly
+			double d = std::min(std::max((double)v, (double)lo), (double)hi);
+			dst[i + c] = (T)d;
+		}
+	}
+}
+
+void SurfaceCodec::Decode(const void* src, float* dst, size_t texel_count) const
+{
+	switch (m_storage)
+	{
+		case UInt8: DecodeT((const uint8_t*)src, dst, texel_count); break;
+		case SInt8: DecodeT((const int8_t*)src, dst, texel_count); break;
+		case UInt16: DecodeT((const uint16_t*)src, dst, texel_count); break;
+		case SInt16: DecodeT((const int16_t*)src, dst, texel_count); break;
+		case UInt32: DecodeT((const uint32_t*)src, dst, texel_count); break;
+		case SInt32: DecodeT((const int32_t*)src, dst, texel_count); break;
+		case Half:
+		{
+			const uint16_t* p = (const uint16_t*)src;
+			for (size_t i = 0, n = texel_count * m_channels; i < n; ++i)
+			{
+				dst[i] = HalfToFloat(p[i]);
+			}
+			break;
+		}
+		case Float:
+			memcpy(dst, src, texel_count * m_channels * sizeof(float));
+			break;
+	}
+}
+
+void SurfaceCodec::Encode(const float* src, void* dst, size_t texel_count) const
+{
+	switch (m_storage)
+	{
+		case UInt8: EncodeT(src, (uint8_t*)dst, texel_count); break;
+		case SInt8: EncodeT(src, (int8_t*)dst, texel_count); break;
+		case UInt16: EncodeT(src, (uint16_t*)dst, texel_count); break;
+		case SInt16: EncodeT(src, (int16_t*)dst, texel_count); break;
+		case UInt32: EncodeT(src, (uint32_t*)dst, texel_count); break;
+		case SInt32: EncodeT(src, (int32_t*)dst, texel_count); break;
+		case Half:
+		{
+			uint16_t* p = (uint16_t*)dst;
+			for (size_t i = 0, n = texel_count * m_channels; i < n; ++i)
+			{
+				p[i] = FloatToHalf(src[i]);
+			}
+			break;
+		}
+		case Float:
+			memcpy(dst, src, texel_count * m_channels * sizeof(float));
+			break;
+	}
+}
+
+size_t SurfaceCodec::GetTexelSize() const
+{
+	switch (m_storage)
+	{
+		case UInt8:
+		case SInt8:
+			return m_channels;
+		case UInt16:
+		case SInt16:
+		case Half:
+			return m_channels * 2;
+		default:
+			return m_channels * 4;
+	}
+}
+
+FloatImage SurfaceCodec::Read(const pvrtexture::CPVRTexture& texture, int mip, int array, int face) const
+{
+	FloatImage image(texture.getWidth(mip), texture.getHeight(mip), texture.getDepth(mip), m_channels);
+	const uint8_t* src = (const uint8_t*)texture.getDataPtr(mip, array, face);
+	const size_t texel_size = GetTexelSize();
+	const size_t count = image.texel_count();
+	const size_t chunks = (count + ChunkTexels - 1) / ChunkTexels;
+	ThreadPool::GetDefault().ParallelFor(chunks, [&](size_t i)
+	{
+		size_t begin = i * ChunkTexels;
+		size_t n = std::min(ChunkTexels, count - begin);
+		Decode(src + begin * texel_size, image.data.data() + begin * m_channels, n);
+	});
+	return image;
+}
+
+void SurfaceCodec::Write(const FloatImage& image, pvrtexture::CPVRTexture& texture, int mip, int array, int face) const
+{
+	if (image.width != (int)texture.getWidth(mip) || image.height != (int)texture.getHeight(mip) ||
+	    image.depth != (int)texture.getDepth(mip) || image.channels != m_channels)
+	{
+		throw runtime_error("Image size does not match size of the surface");
+	}
+	uint8_t* dst = (uint8_t*)texture.getDataPtr(mip, array, face);
+	const size_t texel_size = GetTexelSize();
+	const size_t count = image.texel_count();
+	const size_t chunks = (count + ChunkTexels - 1) / ChunkTexels;
+	ThreadPool::GetDefault().ParallelFor(chunks, [&](size_t i)
+	{
+		size_t begin = i * ChunkTexels;
+		size_t n = std::min(ChunkTexels, count - begin);
+		Encode(image.data.data() + begin * m_channels, dst + begin * texel_size, n);
+	});
+}
+
+bool IsRGBAReadable(const pvrtexture::CPVRTextureHeader& header)
+{
+	auto decoded = DecodePixelType(header.getPixelType().PixelTypeID);
+	if (decoded.compressed)
+	{
+		return false;
+	}
+	for (auto size: decoded.channel_sizes)
+	{
+		if (size != decoded.channel_sizes[0] || (size != 8 && size != 16 && size != 32))
+		{
+			return false;
+		}
+	}
+	EPVRTVariableType type = header.getChannelType();
+	bool is_float = type == ePVRTVarTypeSignedFloat || type == ePVRTVarTypeUnsignedFloat;
+	return !(is_float && decoded.channel_sizes[0] == 8);
+}
+
+RGBAReader::RGBAReader(const pvrtexture::CPVRTextureHeader& header): m_codec(header, ePVRTCSpacelRGB, 1.0f)
+{
+	auto decoded = DecodePixelType(header.getPixelType().PixelTypeID);
+	for (int c = 0; c < 4; ++c)
+	{
+		m_map[c] = -1;
+	}
+	for (int i = 0; i < (int)decoded.channel_names.size(); ++i)
+	{
+		switch (decoded.channel_names[i])
+		{
+			case 'r': case 'd': m_map[0] = i; break;
+			case 'g': m_map[1] = i; break;
+			case 'b': m_map[2] = i; break;
+			case 'a': m_map[3] = i; break;
+			case 'l': m_map[0] = m_map[1] = m_map[2] = i; break;
+			default: break;
+		}
+	}
+}
+
+void RGBAReader::Read(const void* src, size_t count, float* rgba, std::vector<float>& buffer) const
+{
+	const int channels = m_codec.channels();
+	buffer.resize(count * channels);
+	m_codec.Decode(src, buffer.data(), count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		for (int c = 0; c < 4; ++c)
+		{
+			rgba[4 * i + c] = m_map[c] >= 0 ? buffer[i * channels + m_map[c]] : (c == 3 ? 1.0f : 0.0f);
+		}
+	}
+}
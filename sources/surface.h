@@ -0,0 +1,133 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#pragma once
+#include <PVRTexture.h>
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+// IEEE 754 binary16 conversions, float to half rounds to nearest even
+float HalfToFloat(uint16_t h);
+uint16_t FloatToHalf(float f);
+
+
+// Interleaved float32 image, [D, H, W, C] layout, same as the surfaces of CPVRTexture
+struct FloatImage
+{
+	FloatImage(): width(0), height(0), depth(0), channels(0) {}
+	FloatImage(int width, int height, int depth, int channels):
+			width(width), height(height), depth(depth), channels(channels),
+			data((size_t)width * height * depth * channels) {}
+
+	size_t texel_count() const { return (size_t)width * height * depth; }
+
+	void swap(FloatImage& other)
+	{
+		std::swap(width, other.width);
+		std::swap(height, other.height);
+		std::swap(depth, other.depth);
+		std::swap(channels, other.channels);
+		data.swap(other.data);
+	}
+
+	int width;
+	int height;
+	int depth;
+	int channels;
+	std::vector<float> data;
+};
+
+
+// Converts texels of an uncompressed pixel format to float32 and back.
+// Colour channels of unsigned normalized formats are converted to linear space on decode
+// (sRGB curve for sRGB textures, power of gamma otherwise) and back to the stored space on encode.
+// Alpha is never gamma corrected.
+class SurfaceCodec
+{
+public:
+	SurfaceCodec(const pvrtexture::CPVRTextureHeader& header, EPVRTColourSpace colour_space, float gamma);
+
+	int channels() const { return m_channels; }
+
+	void Decode(const void* src, float* dst, size_t texel_count) const;
+	void Encode(const float* src, void* dst, size_t texel_count) const;
+
+	FloatImage Read(const pvrtexture::CPVRTexture& texture, int mip, int array, int face) const;
+	void Write(const FloatImage& image, pvrtexture::CPVRTexture& texture, int mip, int array, int face) const;
+
+private:
+	enum Storage
+	{
+		UInt8,
+		SInt8,
+		UInt16,
+		SInt16,
+		UInt32,
+		SInt32,
+		Half,
+		Float
+	};
+
+	enum Transfer
+	{
+		TransferLinear,
+		TransferGamma,
+		TransferSRGB
+	};
+
+	template<typename T>
+	void DecodeT(const T* src, float* dst, size_t count) const;
+
+	template<typename T>
+	void EncodeT(const float* src, T* dst, size_t count) const;
+
+	float ToLinear(float x) const;
+	float FromLinear(float x) const;
+	size_t GetTexelSize() const;
+
+	int m_channels;
+	Storage m_storage;
+	bool m_normalized;
+	Transfer m_transfer;
+	float m_gamma;
+	bool m_colour[4];
+	float m_lut8[256];
+	// linear values from which each 8-bit code up from 1 is encoded, transfer of 8-bit colour is a binary search
+	float m_encode8[255];
+	// filled only for 16-bit formats with a transfer curve
+	std::vector<float> m_lut16;
+};
+
+
+// Formats that RGBAReader can read: uncompressed, with equal channel sizes of 8, 16 or 32 bits
+bool IsRGBAReadable(const pvrtexture::CPVRTextureHeader& header);
+
+// Converts texel runs of an uncompressed surface to RGBA float32, stored values are not gamma corrected.
+// Channels are taken by name, missing colour channels are zero and missing alpha is one
+class RGBAReader
+{
+public:
+	explicit RGBAReader(const pvrtexture::CPVRTextureHeader& header);
+
+	void Read(const void* src, size_t count, float* rgba, std::vector<float>& buffer) const;
+
+private:
+	SurfaceCodec m_codec;
+	int m_map[4];
+};
@@ -0,0 +1,176 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#include "swizzle.h"
+#include "thread_pool.h"
+
+#include <cstring>
+
+// MSVC has no switch for SSSE3 and compiles the intrinsics regardless. Builds already require SSE4.1 through simd.h
+#if defined(__SSSE3__) || (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+#define SWIZZLE_SSSE3
+#include <tmmintrin.h>
+#endif
+
+
+namespace
+{
+	template<int Size>
+	void CopyRowScalar(const uint8_t* src, ptrdiff_t texel_stride, ptrdiff_t channel_stride, size_t count,
+			uint8_t* dst, int dst_channels, const int* map, const uint8_t* fill)
+	{
+		for (size_t x = 0; x < count; ++x, src += texel_stride)
+		{
+			for (int c = 0; c < dst_channels; ++c, dst += Size)
+			{
+				const uint8_t* p = map[c] >= 0 ? src + map[c] * channel_stride : fill + c * Size;
+				memcpy(dst, p, Size);
+			}
+		}
+	}
+
+	void CopyRowScalar(int channel_size, const uint8_t* src, ptrdiff_t texel_stride, ptrdiff_t channel_stride, size_t count,
+			uint8_t* dst, int dst_channels, const int* map, const uint8_t* fill)
+	{
+		switch (channel_size)
+		{
+			case 1: CopyRowScalar<1>(src, texel_stride, channel_stride, count, dst, dst_channels, map, fill); break;
+			case 2: CopyRowScalar<2>(src, texel_stride, channel_stride, count, dst, dst_channels, map, fill); break;
+			case 4: CopyRowScalar<4>(src, texel_stride, channel_stride, count, dst, dst_channels, map, fill); break;
+			default:
+				for (size_t x = 0; x < count; ++x, src += texel_stride)
+				{
+					for (int c = 0; c < dst_channels; ++c, dst += channel_size)
+					{
+						const uint8_t* p = map[c] >= 0 ? src + map[c] * channel_stride : fill + c * channel_size;
+						memcpy(dst, p, channel_size);
+					}
+				}
+		}
+	}
+
+#ifdef SWIZZLE_SSSE3
+	// Converts several packed texels per iteration with a single pshufb. Missing channels get zeros from the shuffle
+	// and are or-ed with the fill pattern
+	struct ShuffleKernel
+	{
+		ShuffleKernel(int channel_size, int src_channels, int dst_channels, const int* map, const uint8_t* fill):
+				enabled(false), texels(0), src_texel_size(channel_size * src_channels)
+		{
+			int dst_texel_size = channel_size * dst_channels;
+			if (16 % dst_texel_size != 0)
+			{
+				return;
+			}
+			texels = 16 / dst_texel_size;
+			if (texels * src_texel_size > 16)
+			{
+				return;
+			}
+			alignas(16) uint8_t shuffle[16];
+			alignas(16) uint8_t pattern[16];
+			for (int t = 0; t < texels; ++t)
+			{
+				for (int c = 0; c < dst_channels; ++c)
+				{
+					for (int b = 0; b < channel_size; ++b)
+					{
+						int o = t * dst_texel_size + c * channel_size + b;
+						if (map[c] >= 0)
+						{
+							shuffle[o] = (uint8_t)(t * src_texel_size + map[c] * channel_size + b);
+							pattern[o] = 0;
+						}
+						else
+						{
+							shuffle[o] = 0x80;
+							pattern[o] = fill[c * channel_size + b];
+						}
+					}
+				}
+			}
+			mask = _mm_load_si128((const __m128i*)shuffle);
+			constant = _mm_load_si128((const __m128i*)pattern);
+			enabled = true;
+		}
+
+		// Returns number of processed texels, the rest should be copied with CopyRowScalar
+		size_t Run(const uint8_t* src, size_t count, uint8_t* dst) const
+		{
+			size_t x = 0;
+			// loads are 16 bytes wide, so stop while a full load still fits into the row
+			for (; (count - x) * src_texel_size >= 16; x += texels, src += texels * src_texel_size, dst += 16)
+			{
+				__m128i v = _mm_loadu_si128((const __m128i*)src);
+				_mm_storeu_si128((__m128i*)dst, _mm_or_si128(_mm_shuffle_epi8(v, mask), constant));
+			}
+			return x;
+		}
+
+		bool enabled;
+		int texels;
+		int src_texel_size;
+		__m128i mask;
+		__m128i constant;
+	};
+#endif
+}
+
+
+void CopyChannels(const StridedImage& src, int channel_size, uint8_t* dst, int dst_channels, const int* map, const uint8_t* fill)
+{
+	const size_t height = src.shape[1];
+	const size_t width = src.shape[2];
+	const size_t rows = src.shape[0] * height;
+	const size_t dst_row_size = width * dst_channels * channel_size;
+
+	bool identity = dst_channels == src.channels;
+	for (int c = 0; c < dst_channels; ++c)
+	{
+		identity = identity && map[c] == c;
+	}
+	if (identity && src.strides[3] == channel_size && src.strides[2] == channel_size * src.channels &&
+	    src.strides[1] == (ptrdiff_t)dst_row_size)
+	{
+		// rows are already packed, only depth slices may be apart
+		ThreadPool::GetDefault().ParallelFor(src.shape[0] * height, [&](size_t row)
+		{
+			memcpy(dst + row * dst_row_size, src.data + (row / height) * src.strides[0] + (row % height) * src.strides[1], dst_row_size);
+		});
+		return;
+	}
+
+#ifdef SWIZZLE_SSSE3
+	ShuffleKernel kernel(channel_size, src.channels, dst_channels, map, fill);
+	const bool packed = src.strides[3] == channel_size && src.strides[2] == channel_size * src.channels;
+	const bool shuffle = packed && kernel.enabled;
+#endif
+
+	ThreadPool::GetDefault().ParallelFor(rows, [&](size_t row)
+	{
+		const uint8_t* s = src.data + (row / height) * src.strides[0] + (row % height) * src.strides[1];
+		uint8_t* d = dst + row * dst_row_size;
+		size_t done = 0;
+#ifdef SWIZZLE_SSSE3
+		if (shuffle)
+		{
+			done = kernel.Run(s, width, d);
+		}
+#endif
+		CopyRowScalar(channel_size, s + done * src.strides[2], src.strides[2], src.strides[3], width - done,
+				d + done * dst_channels * channel_size, dst_channels, map, fill);
+	});
+}
@@ -0,0 +1,35 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+
+// Interleaved image with arbitrary strides, e.g. a sliced or transposed numpy array
+struct StridedImage
+{
+	const uint8_t* data;
+	size_t shape[3];      // depth, height, width
+	ptrdiff_t strides[4]; // in bytes: depth, height, width, channel
+	int channels;
+};
+
+
+// Copies texels of src into the packed buffer dst, that has dst_channels channels of channel_size bytes.
+// Channel c of dst is taken from channel map[c] of src, or from fill + c * channel_size if map[c] is negative.
+// Rows are processed in parallel, packed rows of small texels use byte shuffles.
+void CopyChannels(const StridedImage& src, int channel_size, uint8_t* dst, int dst_channels, const int* map, const uint8_t* fill);
@@ -0,0 +1,185 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#include "texture_writer.h"
+#include "container.h"
+#include "storage.h"
+#include "common.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+
+TextureWriter::TextureWriter(const char* filename, const pvrtexture::CPVRTextureHeader& header, Container container):
+		m_header(header), m_container(container)
+{
+	// headers are built up front, so that unsupported formats fail before anything is written
+	m_file_header = container == ContainerDDS ? MakeDDSHeader(header) : MakePVRHeader(header);
+	m_written.resize((size_t)header.getNumMIPLevels() * header.getNumArrayMembers() * header.getNumFaces());
+	m_remaining = m_written.size();
+
+#ifdef _WIN32
+	m_file = CreateFileA(filename, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE)
+	{
+		m_file = nullptr;
+		throw runtime_error("Can not open file %s for writing", filename);
+	}
+#else
+	m_file = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (m_file < 0)
+	{
+		throw runtime_error("Can not open file %s for writing", filename);
+	}
+#endif
+}
+
+TextureWriter::~TextureWriter()
+{
+	CloseFile();
+}
+
+void TextureWriter::WriteSurface(uint32_t mip, uint32_t array, uint32_t face, const void* data, size_t size)
+{
+	if (mip >= m_header.getNumMIPLevels() || array >= m_header.getNumArrayMembers() || face >= m_header.getNumFaces())
+	{
+		throw runtime_error("Surface index out of range: mip %d, array %d, face %d", mip, array, face);
+	}
+	size_t expected = GetSurfaceSize(m_header, mip);
+	if (size != expected)
+	{
+		throw runtime_error("Wrong size of surface data, expected %llu bytes, got %llu", (unsigned long long)expected, (unsigned long long)size);
+	}
+	uint64_t offset = m_file_header.size();
+	if (m_container == ContainerDDS)
+	{
+		offset += GetDDSSurfaceOffset(m_header, mip, array, face);
+	}
+	else
+	{
+		offset += GetPVRSurfaceOffset(m_header, mip, array, face);
+	}
+
+	Write(data, size, offset);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	size_t index = ((size_t)mip * m_header.getNumArrayMembers() + array) * m_header.getNumFaces() + face;
+	if (!m_written[index])
+	{
+		m_written[index] = true;
+		--m_remaining;
+	}
+}
+
+void TextureWriter::Close()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_remaining != 0)
+		{
+			throw runtime_error("Can not finalize texture file, %d surfaces were not written", (int)m_remaining);
+		}
+	}
+	Write(m_file_header.data(), m_file_header.size(), 0);
+	CloseFile();
+}
+
+void TextureWriter::Write(const void* data, size_t size, uint64_t offset)
+{
+	const uint8_t* p = (const uint8_t*)data;
+#ifdef _WIN32
+	if (m_file == nullptr)
+	{
+		throw runtime_error("Texture file is closed");
+	}
+	while (size > 0)
+	{
+		DWORD chunk = (DWORD)std::min<size_t>(size, 1u << 30u);
+		OVERLAPPED overlapped = {};
+		overlapped.Offset = (DWORD)offset;
+		overlapped.OffsetHigh = (DWORD)(offset >> 32u);
+		DWORD written = 0;
+		if (!WriteFile(m_file, p, chunk, &written, &overlapped) || written == 0)
+		{
+			throw runtime_error("Failed to write texture file");
+		}
+		p += written;
+		size -= written;
+		offset += written;
+	}
+#else
+	if (m_file < 0)
+	{
+		throw runtime_error("Texture file is closed");
+	}
+	while (size > 0)
+	{
+		ssize_t written = pwrite(m_file, p, size, (off_t)offset);
+		if (written < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (written <= 0)
+		{
+			throw runtime_error("Failed to write texture file");
+		}
+		p += written;
+		size -= written;
+		offset += written;
+	}
+#endif
+}
+
+void TextureWriter::CloseFile()
+{
+#ifdef _WIN32
+	if (m_file != nullptr)
+	{
+		CloseHandle(m_file);
+		m_file = nullptr;
+	}
+#else
+	if (m_file >= 0)
+	{
+		close(m_file);
+		m_file = -1;
+	}
+#endif
+}
+
+void SaveTexture(const pvrtexture::CPVRTexture& texture, const char* filename, Container container)
+{
+	TextureWriter writer(filename, texture, container);
+	for (uint32_t mip = 0; mip < texture.getNumMIPLevels(); ++mip)
+	{
+		for (uint32_t array = 0; array < texture.getNumArrayMembers(); ++array)
+		{
+			for (uint32_t face = 0; face < texture.getNumFaces(); ++face)
+			{
+				writer.WriteSurface(mip, array, face, GetSurfacePtr(texture, mip, array, face), GetSurfaceSize(texture, mip));
+			}
+		}
+	}
+	writer.Close();
+}
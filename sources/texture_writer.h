@@ -0,0 +1,74 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#pragma once
+#include <PVRTexture.h>
+
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+
+enum Container
+{
+	ContainerPVR,
+	ContainerDDS
+};
+
+
+// Writes a PVR or DDS file surface by surface. Offsets of all surfaces follow from the header, so surfaces may be
+// written in any order and from several threads, each goes straight to its place in the file with a positional write.
+// The container header is written by Close, after all surfaces, so an unfinished file is never a valid texture.
+class TextureWriter
+{
+public:
+	TextureWriter(const char* filename, const pvrtexture::CPVRTextureHeader& header, Container container);
+
+	// Closes the file without writing the header if Close was not called
+	~TextureWriter();
+
+	TextureWriter(const TextureWriter&) = delete;
+	TextureWriter& operator=(const TextureWriter&) = delete;
+
+	const pvrtexture::CPVRTextureHeader& header() const { return m_header; }
+
+	// size must be equal to GetSurfaceSize(header(), mip)
+	void WriteSurface(uint32_t mip, uint32_t array, uint32_t face, const void* data, size_t size);
+
+	// Writes the header and closes the file. Throws if some surfaces were not written
+	void Close();
+
+private:
+	void Write(const void* data, size_t size, uint64_t offset);
+	void CloseFile();
+
+	pvrtexture::CPVRTextureHeader m_header;
+	Container m_container;
+	std::vector<uint8_t> m_file_header;
+	std::mutex m_mutex;
+	std::vector<bool> m_written;
+	size_t m_remaining;
+#ifdef _WIN32
+	void* m_file;
+#else
+	int m_file;
+#endif
+};
+
+
+// Saves a whole texture with TextureWriter, for formats that PVRTexLib can not save, see IsUnsizedFormat
+void SaveTexture(const pvrtexture::CPVRTexture& texture, const char* filename, Container container);
@@ -0,0 +1,175 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#include "thread_pool.h"
+#include "profiler.h"
+
+#include <chrono>
+
+
+namespace
+{
+	// Index of the queue owned by the current thread. Threads that do not belong to the pool
+	// push to the queues in round robin fashion.
+	thread_local const ThreadPool* tls_pool = nullptr;
+	thread_local size_t tls_queue = 0;
+}
+
+
+ThreadPool::ThreadPool(int thread_count): m_queued(0), m_next_queue(0), m_stop(false)
+{
+	if (thread_count <= 0)
+	{
+		thread_count = std::max(1, (int)std::thread::hardware_concurrency());
+	}
+	for (int i = 0; i < thread_count; ++i)
+	{
+		m_queues.emplace_back(new Queue);
+	}
+	for (int i = 0; i < thread_count; ++i)
+	{
+		m_threads.emplace_back(&ThreadPool::WorkerLoop, this, (size_t)i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_wake_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	for (auto& thread: m_threads)
+	{
+		thread.join();
+	}
+}
+
+ThreadPool& ThreadPool::GetDefault()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+bool ThreadPool::TryRunTask(size_t home)
+{
+	std::function<void()> task;
+	size_t n = m_queues.size();
+	for (size_t i = 0; i < n && !task; ++i)
+	{
+		Queue& queue = *m_queues[(home + i) % n];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty())
+			continue;
+		if (i == 0)
+		{
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		}
+		else
+		{
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		}
+	}
+	if (!task)
+		return false;
+	--m_queued;
+	task();
+	return true;
+}
+
+void ThreadPool::WorkerLoop(size_t index)
+{
+	tls_pool = this;
+	tls_queue = index;
+	while (true)
+	{
+		if (TryRunTask(index))
+			continue;
+		std::unique_lock<std::mutex> lock(m_wake_mutex);
+		m_wake.wait(lock, [this]{ return m_stop || m_queued > 0; });
+		if (m_stop)
+			return;
+	}
+}
+
+void ThreadPool::Run(std::vector<std::function<void()> >& jobs)
+{
+	if (jobs.empty())
+		return;
+
+	std::atomic<size_t> remaining(jobs.size());
+	std::mutex batch_mutex;
+	std::condition_variable done;
+	std::exception_ptr error;
+
+	bool is_worker = tls_pool == this;
+	size_t home = is_worker ? tls_queue : m_next_queue++ % m_queues.size();
+	// jobs count their bytes to the scope that started the batch, whichever thread runs them
+	ProfileCounters* counters = GetProfileCounters();
+
+	for (size_t i = 0; i < jobs.size(); ++i)
+	{
+		std::function<void()>& job = jobs[i];
+		// owner keeps it's share of jobs, the rest is spread, so workers do not start by stealing
+		size_t q = is_worker ? home : (home + i) % m_queues.size();
+		std::lock_guard<std::mutex> lock(m_queues[q]->mutex);
+		m_queues[q]->tasks.push_back([&job, &remaining, &batch_mutex, &done, &error, counters]()
+		{
+			ProfileCounters* previous = SetProfileCounters(counters);
+			try
+			{
+				job();
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(batch_mutex);
+				if (!error)
+					error = std::current_exception();
+			}
+			SetProfileCounters(previous);
+			std::lock_guard<std::mutex> lock(batch_mutex);
+			if (--remaining == 0)
+			{
+				done.notify_all();
+			}
+		});
+		++m_queued;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_wake_mutex);
+	}
+	m_wake.notify_all();
+
+	while (remaining > 0)
+	{
+		if (!TryRunTask(home))
+		{
+			// nothing to steal, jobs of this batch are running on other threads. Timeout is needed since
+			// those jobs may start nested batches that this thread could help with
+			std::unique_lock<std::mutex> lock(batch_mutex);
+			done.wait_for(lock, std::chrono::milliseconds(1), [&remaining]{ return remaining == 0; });
+		}
+	}
+
+	// the last job may still hold the lock, batch state lives on this stack frame
+	std::lock_guard<std::mutex> lock(batch_mutex);
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+}
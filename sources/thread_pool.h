@@ -0,0 +1,91 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include <exception>
+#include <algorithm>
+
+
+// Work-stealing thread pool. Every worker has its own queue, it takes tasks from the back of it's own queue and,
+// when it runs dry, steals from the front of the others. Thread that waits for a batch of jobs takes part in the work,
+// so jobs may safely start nested batches on the same pool.
+class ThreadPool
+{
+public:
+	// thread_count == 0 means one worker per hardware thread
+	explicit ThreadPool(int thread_count = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	int thread_count() const { return (int)m_threads.size(); }
+
+	// Runs jobs and blocks until all of them are done. The first exception thrown by a job is rethrown here.
+	void Run(std::vector<std::function<void()> >& jobs);
+
+	// Calls job(i) for every i in [0, count). Indices are split into chunks, so the per-call overhead is low
+	// even for a large count, e.g. when iterating over compression blocks.
+	template<typename F>
+	void ParallelFor(size_t count, const F& job)
+	{
+		if (count == 0)
+			return;
+		size_t chunks = std::min(count, (size_t)(thread_count() + 1) * 8);
+		std::vector<std::function<void()> > jobs;
+		jobs.reserve(chunks);
+		for (size_t c = 0; c < chunks; ++c)
+		{
+			size_t begin = count * c / chunks;
+			size_t end = count * (c + 1) / chunks;
+			jobs.push_back([begin, end, &job]()
+			{
+				for (size_t i = begin; i < end; ++i)
+					job(i);
+			});
+		}
+		Run(jobs);
+	}
+
+	// Process-wide pool, shared by all parallel operations of the module
+	static ThreadPool& GetDefault();
+
+private:
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<std::function<void()> > tasks;
+	};
+
+	bool TryRunTask(size_t home);
+	void WorkerLoop(size_t index);
+
+	std::vector<std::unique_ptr<Queue> > m_queues;
+	std::vector<std::thread> m_threads;
+	std::mutex m_wake_mutex;
+	std::condition_variable m_wake;
+	std::atomic<size_t> m_queued;
+	std::atomic<size_t> m_next_queue;
+	bool m_stop;
+};
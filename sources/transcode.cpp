@@ -0,0 +1,178 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#include "transcode.h"
+#include "thread_pool.h"
+#include "profiler.h"
+#include "container.h"
+#include "storage.h"
+#include "codec.h"
+#include "cache.h"
+#include "common.h"
+
+#include <memory>
+#include <cstring>
+
+
+namespace
+{
+	struct SurfaceJob
+	{
+		size_t texture;
+		uint32_t mip;
+		uint32_t array;
+		uint32_t face;
+	};
+
+	// Copies a single surface into a texture of its own, so that PVRTexLib can process it independently.
+	// Sizes come from GetSurfaceSize, PVRTexLib reports zero for some formats
+	void ExtractSurface(const pvrtexture::CPVRTexture& texture, uint32_t mip, uint32_t array, uint32_t face,
+	                    pvrtexture::CPVRTexture& surface)
+	{
+		pvrtexture::CPVRTextureHeader header(texture.getHeader());
+		header.setWidth(texture.getWidth(mip));
+		header.setHeight(texture.getHeight(mip));
+		header.setDepth(texture.getDepth(mip));
+		header.setNumMIPLevels(1);
+		header.setNumArrayMembers(1);
+		header.setNumFaces(1);
+		static_cast<pvrtexture::CPVRTextureHeader&>(surface) = header;
+		AllocateData(surface);
+		size_t size = GetSurfaceSize(texture, mip);
+		memcpy(surface.m_pTextureData, GetSurfacePtr(texture, mip, array, face), size);
+		CountCopiedBytes(size);
+	}
+}
+
+
+bool UsesNativeEncoder(const std::string& engine, uint64_t format)
+{
+	if (engine == "native")
+	{
+		return true;
+	}
+	if (engine != "pvrtexlib")
+	{
+		throw runtime_error("Unknown engine %s, expected pvrtexlib or native", engine.c_str());
+	}
+	return RequiresNativeEncoder(format);
+}
+
+CacheKey TranscodeCacheKey(const pvrtexture::CPVRTexture& texture, uint64_t format, EPVRTVariableType channel_type,
+                           EPVRTColourSpace colour_space, pvrtexture::ECompressorQuality quality, bool dither, bool native)
+{
+	CacheKey key;
+	key.Add(std::string("transcode"));
+	key.AddTexture(texture);
+	key.Add(format);
+	key.Add(channel_type);
+	key.Add(colour_space);
+	key.Add(quality);
+	key.Add(dither);
+	key.Add(native);
+	return key;
+}
+
+std::vector<pvrtexture::CPVRTexture*> TranscodeBatch(const std::vector<pvrtexture::CPVRTexture*>& textures, uint64_t format,
+                                                     EPVRTVariableType channel_type, EPVRTColourSpace colour_space,
+                                                     pvrtexture::ECompressorQuality quality, bool dither, bool native,
+                                                     int thread_count)
+{
+	// results may share data with the sources, so they are destroyed through TextureDeleter
+	std::vector<TextureHolder> results(textures.size());
+	std::vector<CacheKey> keys;
+	std::vector<bool> hits(textures.size(), false);
+	std::vector<SurfaceJob> surfaces;
+
+	TextureCache& cache = TextureCache::GetDefault();
+	const bool cached = cache.IsEnabled();
+
+	for (size_t i = 0; i < textures.size(); ++i)
+	{
+		const pvrtexture::CPVRTexture& texture = *textures[i];
+		if (cached)
+		{
+			keys.push_back(TranscodeCacheKey(texture, format, channel_type, colour_space, quality, dither, native));
+			std::unique_ptr<pvrtexture::CPVRTexture> hit = cache.Load(keys.back());
+			if (hit)
+			{
+				results[i].reset(hit.release());
+				hits[i] = true;
+				continue;
+			}
+		}
+		if (native)
+		{
+			// compressed in place, the copy shares the data of the source until then
+			results[i].reset(new pvrtexture::CPVRTexture());
+			static_cast<pvrtexture::CPVRTextureHeader&>(*results[i]) = texture;
+			ShareData(*results[i], *textures[i]);
+			TranscodeNative(*results[i], format, channel_type, colour_space, quality);
+			continue;
+		}
+		pvrtexture::CPVRTextureHeader header(texture.getHeader());
+		header.setPixelFormat(format);
+		header.setChannelType(channel_type);
+		header.setColourSpace(colour_space);
+		results[i].reset(new pvrtexture::CPVRTexture(header));
+		CountAllocatedBytes(results[i]->getDataSize());
+
+		for (uint32_t mip = 0; mip < texture.getNumMIPLevels(); ++mip)
+			for (uint32_t array = 0; array < texture.getNumArrayMembers(); ++array)
+				for (uint32_t face = 0; face < texture.getNumFaces(); ++face)
+					surfaces.push_back({i, mip, array, face});
+	}
+
+	std::unique_ptr<ThreadPool> local_pool;
+	if (thread_count > 0 && !surfaces.empty())
+	{
+		local_pool.reset(new ThreadPool(thread_count));
+	}
+	ThreadPool& pool = local_pool ? *local_pool : ThreadPool::GetDefault();
+
+	pool.ParallelFor(surfaces.size(), [&](size_t i)
+	{
+		const SurfaceJob& job = surfaces[i];
+		pvrtexture::CPVRTexture surface;
+		ExtractSurface(*textures[job.texture], job.mip, job.array, job.face, surface);
+		if (!pvrtexture::Transcode(surface, format, channel_type, colour_space, quality, dither))
+		{
+			throw runtime_error("Transcode failed for texture %d, mip %d, array member %d, face %d",
+					(int)job.texture, job.mip, job.array, job.face);
+		}
+		CountAllocatedBytes(surface.getDataSize());
+		pvrtexture::CPVRTexture& result = *results[job.texture];
+		size_t size = GetSurfaceSize(result, job.mip);
+		if (surface.getDataSize() != size)
+		{
+			throw runtime_error("Unexpected size of transcoded surface, got %d bytes, but expected %d",
+					(int)surface.getDataSize(), (int)size);
+		}
+		memcpy(GetSurfacePtr(result, job.mip, job.array, job.face), surface.getDataPtr(), size);
+		CountCopiedBytes(size);
+	});
+
+	std::vector<pvrtexture::CPVRTexture*> output;
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		if (cached && !hits[i])
+		{
+			cache.Store(keys[i], *results[i]);
+		}
+		output.push_back(results[i].release());
+	}
+	return output;
+}
@@ -0,0 +1,43 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+#pragma once
+#include <PVRTexture.h>
+#include <PVRTextureUtilities.h>
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+class CacheKey;
+
+
+// Whether engine, "pvrtexlib" or "native", compresses to format with the native encoders. Formats that PVRTexLib can
+// not compress use them with either engine, see RequiresNativeEncoder. Throws on unknown engines
+bool UsesNativeEncoder(const std::string& engine, uint64_t format);
+
+// Key of a transcode result in TextureCache
+CacheKey TranscodeCacheKey(const pvrtexture::CPVRTexture& texture, uint64_t format, EPVRTVariableType channel_type,
+                           EPVRTColourSpace colour_space, pvrtexture::ECompressorQuality quality, bool dither, bool native);
+
+// Transcodes every texture into a new one. Results found in TextureCache::GetDefault() are loaded from it, new ones
+// are stored. With PVRTexLib each surface (mip, array member, face) of every texture is an independent job, so a few
+// large textures are spread over all threads as well as many small ones; thread_count == 0 uses the shared pool of
+// the module. The native encoders compress one texture at a time, spreading its block rows over the shared pool.
+std::vector<pvrtexture::CPVRTexture*> TranscodeBatch(const std::vector<pvrtexture::CPVRTexture*>& textures, uint64_t format,
+                                                     EPVRTVariableType channel_type, EPVRTColourSpace colour_space,
+                                                     pvrtexture::ECompressorQuality quality, bool dither, bool native,
+                                                     int thread_count);
@@ -0,0 +1,122 @@
+# Copyright 2020 Stanislav Pidhorskyi
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#  http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Parity of the native downsample2x with the Python implementations it replaced.
+
+    python tests/test_downsample2x.py
+
+bspline is compared with _downsample2x_bspline (scipy spline_filter and zoom_shift), area_average with
+_downsample2x_area_average, on 2D and 3D arrays with odd and even sizes. Needs scipy. Also runs with pytest.
+"""
+
+import sys
+
+import numpy as np
+import texture_tool
+
+try:
+    import scipy.ndimage  # noqa: F401, the Python reference implementations need it
+except ImportError:
+    if __name__ == '__main__':
+        print('scipy is not installed, skipping')
+        sys.exit(0)
+    import pytest
+    pytest.skip('scipy is not installed', allow_module_level=True)
+
+from texture_tool.downsample2x import downsample2x, _downsample2x_area_average, _downsample2x_bspline, \
+    _cast_like_scipy
+
+
+# [H, W, C] and [D, H, W, C]; odd sizes, a side of 1 and a side that halves to 1
+BSPLINE_SHAPES = [(64, 64, 4), (33, 47, 3), (17, 1, 1), (3, 130, 2), (9, 17, 12, 2), (5, 8, 7, 1)]
+# the Python area average only handles even sizes
+AREA_SHAPES = [(64, 64, 4), (34, 46, 3), (2, 130, 2), (8, 16, 12, 2)]
+DTYPES = [np.uint8, np.uint16, np.float32]
+
+
+def make_input(shape, dtype, seed=0):
+    rng = np.random.RandomState(seed)
+    grid = np.meshgrid(*[np.linspace(0.0, 1.0, n) for n in shape[:-1]], indexing='ij')
+    smooth = sum(np.sin(3.0 * g + i) for i, g in enumerate(grid)) / len(grid) * 0.5 + 0.5
+    img = np.clip(smooth[..., None] * 0.8 + 0.2 * rng.random_sample(shape), 0.0, 1.0)
+    if dtype == np.float32:
+        return (img * 16.0).astype(np.float32)
+    return np.round(img * np.iinfo(dtype).max).astype(dtype)
+
+
+def check_bspline(shape, dtype):
+    img = make_input(shape, dtype)
+    expected = _downsample2x_bspline(img)
+    actual = downsample2x(img, 'bspline')
+    assert actual.shape == expected.shape and actual.dtype == expected.dtype, (actual.shape, expected.shape)
+    diff = np.abs(actual.astype(np.float64) - expected.astype(np.float64))
+    if dtype == np.float32:
+        assert diff.max() <= 1e-4 * 16.0, (shape, diff.max())
+    else:
+        # float32 accumulation may flip rounding of values within about 1e-4 of a half
+        assert diff.max() <= 1, (shape, dtype, diff.max())
+        assert np.mean(diff != 0) < 1e-3, (shape, dtype, np.mean(diff != 0))
+
+
+def check_area_average(shape, dtype):
+    img = make_input(shape, dtype)
+    expected = _downsample2x_area_average(img)
+    actual = downsample2x(img, 'area_average')
+    assert actual.shape == expected.shape and actual.dtype == np.float32, (actual.shape, expected.shape)
+    scale = 16.0 if dtype == np.float32 else float(np.iinfo(dtype).max)
+    assert np.abs(actual - expected).max() <= 1e-6 * scale, (shape, dtype)
+
+
+def test_bspline():
+    for shape in BSPLINE_SHAPES:
+        for dtype in DTYPES:
+            check_bspline(shape, dtype)
+
+
+def test_area_average():
+    for shape in AREA_SHAPES:
+        for dtype in DTYPES:
+            check_area_average(shape, dtype)
+
+
+def test_bspline_rounding():
+    # zoom_shift rounds integer outputs half away from zero and clips them to the range of the type
+    output = np.array([0.5, 1.5, 2.5, 2.49, -0.5, -3.0, 255.5, 300.0])
+    assert _cast_like_scipy(output, np.uint8).tolist() == [1, 2, 3, 2, 0, 0, 255, 255]
+    assert _cast_like_scipy(output, np.int16).tolist() == [1, 2, 3, 2, -1, -3, 256, 300]
+    # a constant image stays exactly constant, also where the spline filter overshoots at edges of odd sizes
+    for dtype in [np.uint8, np.uint16]:
+        img = np.full((31, 45, 2), 200, dtype=dtype)
+        assert np.all(downsample2x(img, 'bspline') == 200)
+
+
+def test_texture():
+    img = make_input((33, 47, 4), np.uint8)
+    texture = texture_tool.from_numpy(img)
+    result = downsample2x(texture, 'bspline')
+    assert (result.get_width(0), result.get_height(0)) == (23, 16)
+    assert result.pixel_format == texture.pixel_format
+
+
+if __name__ == '__main__':
+    tests = [test_bspline, test_area_average, test_bspline_rounding, test_texture]
+    failed = 0
+    for test in tests:
+        try:
+            test()
+            print('%s: OK' % test.__name__)
+        except AssertionError as e:
+            failed += 1
+            print('%s: FAILED %s' % (test.__name__, e))
+    sys.exit(1 if failed else 0)
@@ -0,0 +1,98 @@
+//Copyright 2020 Stanislav Pidhorskyi
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+//==============================================================================
+
+
+// Checks the batched SIMD direction kernels against the scalar double precision versions in coordinate_transform.h.
+// Bounds are a few float32 ulps for uv2cube and cube2uv, whose face index has to match exactly, and follow from the
+// 1e-5 radians atan2 approximation for dir2equirect
+#include "coordinate_transform_simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+
+namespace
+{
+	const double uv2cube_bound = 1e-6;
+	const double cube2uv_bound = 1e-6;
+	const double dir2equirect_bound = 1e-5 / M_PI;
+
+	// u of dir2equirect wraps around at longitude -pi and pi
+	double WrappedDistance(double a, double b)
+	{
+		double d = std::fabs(a - b);
+		return std::min(d, 1.0 - d);
+	}
+}
+
+
+int main()
+{
+	// odd count, so that the tail of every vector width is covered
+	const int side = 255;
+	const size_t count = (size_t)side * side;
+	std::vector<float> u(count), v(count), x(count), y(count), z(count), eu(count), ev(count), cu(count), cv(count);
+	std::vector<int> faces(count);
+	for (int j = 0; j < side; ++j)
+	{
+		for (int i = 0; i < side; ++i)
+		{
+			// texel centres and both edges of the face
+			u[j * side + i] = i == 0 ? 0.0f : i == side - 1 ? 1.0f : (i + 0.5f) / side;
+			v[j * side + i] = j == 0 ? 0.0f : j == side - 1 ? 1.0f : (j + 0.5f) / side;
+		}
+	}
+
+	double uv2cube_error = 0.0;
+	double cube2uv_error = 0.0;
+	size_t face_mismatches = 0;
+	double dir2equirect_error = 0.0;
+	for (int face = 0; face < 6; ++face)
+	{
+		uv2cube_batch(u.data(), v.data(), face, x.data(), y.data(), z.data(), count);
+		cube2uv_batch(x.data(), y.data(), z.data(), cu.data(), cv.data(), faces.data(), count);
+		dir2equirect_batch(x.data(), y.data(), z.data(), eu.data(), ev.data(), count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			double3 d = uv2cube(double2(u[i], v[i]), face);
+			uv2cube_error = std::max(uv2cube_error, std::fabs(d.x - x[i]));
+			uv2cube_error = std::max(uv2cube_error, std::fabs(d.y - y[i]));
+			uv2cube_error = std::max(uv2cube_error, std::fabs(d.z - z[i]));
+
+			// from the float directions, so that only the error of cube2uv_batch and dir2equirect_batch is measured.
+			// Directions on an edge of the face go to the same face as with the scalar version
+			int n = -1;
+			double2 c = cube2uv(double3(x[i], y[i], z[i]), &n);
+			face_mismatches += n != faces[i] ? 1 : 0;
+			cube2uv_error = std::max(cube2uv_error, std::fabs(c.x - cu[i]));
+			cube2uv_error = std::max(cube2uv_error, std::fabs(c.y - cv[i]));
+
+			double2 e = dir2equirect(double3(x[i], y[i], z[i]));
+			dir2equirect_error = std::max(dir2equirect_error, WrappedDistance(e.x, eu[i]));
+			dir2equirect_error = std::max(dir2equirect_error, std::fabs(e.y - ev[i]));
+		}
+	}
+
+	printf("vector width %d\n", (int)simd::width);
+	printf("uv2cube max error %g, bound %g\n", uv2cube_error, uv2cube_bound);
+	printf("cube2uv max error %g, bound %g, %d face mismatches\n", cube2uv_error, cube2uv_bound, (int)face_mismatches);
+	printf("dir2equirect max error %g, bound %g\n", dir2equirect_error, dir2equirect_bound);
+	bool ok = uv2cube_error <= uv2cube_bound && cube2uv_error <= cube2uv_bound && face_mismatches == 0 &&
+			dir2equirect_error <= dir2equirect_bound;
+	printf(ok ? "OK\n" : "FAILED\n");
+	return ok ? 0 : 1;
+}
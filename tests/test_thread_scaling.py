@@ -0,0 +1,150 @@
+# Copyright 2020 Stanislav Pidhorskyi
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#  http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Stress test of GIL release: PVRTexLib encodes started from Python threads must overlap.
+
+    python tests/test_thread_scaling.py [--textures-per-worker 4] [--size 256] [--min-ratio 0.5]
+
+Transcodes textures with a ThreadPoolExecutor of 1, 2, 4, ... workers, up to the number of physical cores available to
+the process, and prints the speedup in throughput over one worker. Every worker gets the same number of textures, so
+all runs end with full waves. Fails when the speedup drops below --min-ratio * min(workers, cores), e.g. because a
+binding holds the GIL while encoding. Hyper-threads are not counted as cores, they scale far below that.
+Also runs with pytest.
+"""
+
+import argparse
+import concurrent.futures
+import os
+import sys
+import time
+
+import numpy as np
+import texture_tool
+
+
+def available_cpus():
+    if hasattr(os, 'sched_getaffinity'):
+        return sorted(os.sched_getaffinity(0))
+    return list(range(os.cpu_count() or 1))
+
+
+def physical_cores():
+    """Number of physical cores among the CPUs available to the process, hyper-threads of a core count once"""
+    cpus = available_cpus()
+    cores = set()
+    for cpu in cpus:
+        try:
+            with open('/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list' % cpu) as f:
+                cores.add(f.read().strip())
+        except OSError:
+            break
+    else:
+        return len(cores)
+    # no sysfs topology, e.g. on Windows and macOS
+    try:
+        import psutil
+        return min(len(cpus), psutil.cpu_count(logical=False) or len(cpus))
+    except ImportError:
+        return len(cpus)
+
+
+def make_textures(count, size):
+    rng = np.random.RandomState(0)
+    y, x = np.mgrid[0:size, 0:size]
+    textures = []
+    for i in range(count):
+        img = np.stack([x * 255 // size, y * 255 // size, (x ^ y) & 255, np.full_like(x, 255)], axis=-1)
+        img = (img + rng.randint(0, 32, img.shape)).clip(0, 255).astype(np.uint8)
+        textures.append(texture_tool.from_numpy(img))
+    return textures
+
+
+def encode(texture):
+    # PVRTexLib encodes on the calling thread, so all parallelism comes from the executor
+    return texture_tool.transcode(texture, texture_tool.PixelFormat.ETC1, quality=texture_tool.Quality.Fastest,
+                                  engine='pvrtexlib')
+
+
+def run(textures, workers):
+    with concurrent.futures.ThreadPoolExecutor(max_workers=workers) as executor:
+        start = time.perf_counter()
+        list(executor.map(encode, textures))
+        return time.perf_counter() - start
+
+
+def measure(textures_per_worker=4, size=256, repeat=3):
+    """Returns (cores, [(workers, textures, seconds)]), best of repeat runs each"""
+    # at least two textures per worker, so that workers never exceed half the textures and none idles while another
+    # one finishes
+    textures_per_worker = max(textures_per_worker, 2)
+    cores = physical_cores()
+    counts = []
+    workers = 1
+    while workers <= cores:
+        counts.append(workers)
+        workers *= 2
+    if counts[-1] != cores:
+        counts.append(cores)
+    textures = make_textures(counts[-1] * textures_per_worker, size)
+    # warm up, the first call initialises PVRTexLib
+    encode(textures[0])
+    results = []
+    for n in counts:
+        subset = textures[:n * textures_per_worker]
+        results.append((n, len(subset), min(run(subset, n) for _ in range(repeat))))
+    return cores, results
+
+
+def check(cores, results, min_ratio):
+    base = results[0][1] / results[0][2]
+    failed = []
+    print('%d physical cores' % cores)
+    print('workers  textures  seconds  speedup  required')
+    for workers, count, seconds in results:
+        speedup = count / seconds / base
+        required = min_ratio * min(workers, cores)
+        print('%7d  %8d  %7.3f  %7.2f  %8.2f' % (workers, count, seconds, speedup, required))
+        if speedup < required:
+            failed.append(workers)
+    return failed
+
+
+def test_thread_scaling():
+    if physical_cores() < 2:
+        import pytest
+        pytest.skip('needs at least 2 physical cores')
+    assert not check(*measure(), min_ratio=0.5)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('--textures-per-worker', type=int, default=4)
+    parser.add_argument('--size', type=int, default=256)
+    parser.add_argument('--repeat', type=int, default=3)
+    parser.add_argument('--min-ratio', type=float, default=0.5)
+    args = parser.parse_args()
+
+    if physical_cores() < 2:
+        print('Only one physical core is available, nothing to compare')
+        return 0
+    failed = check(*measure(args.textures_per_worker, args.size, args.repeat), min_ratio=args.min_ratio)
+    if failed:
+        print('Speedup below %.2f per worker with %s workers' % (args.min_ratio, ', '.join(map(str, failed))))
+        return 1
+    print('OK')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
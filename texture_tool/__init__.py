@@ -143,8 +143,11 @@ def cast_from_float(self, x):
         return x.astype(self.dtype)
 
 
-def view(texture, mipmap=0, face=0):
-    return np.array(texture.open_view(mipmap, face), copy=False)
+def view(texture, mipmap=0, face=0, writable=None, array=0):
+    # textures are viewed writable by default, memory mapped files can only be viewed read-only
+    if writable is None:
+        writable = not isinstance(texture, MappedPVR)
+    return np.array(texture.open_view(mipmap, face, writable, array), copy=False)
 
 
 def is_power_of_two(n):
@@ -0,0 +1,347 @@
+# Copyright 2020 Stanislav Pidhorskyi
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#  http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Benchmarks of the Python API on generated images.
+
+    python -m texture_tool.bench --size 1024 2048 --dtype uint8 float32 --repeat 10 --output result.json
+    python -m texture_tool.bench --baseline result.json
+
+Every stage reports throughput in megapixels per second of its input, latency percentiles, the peak of Python
+allocations during a call (tracemalloc, numpy arrays included) and the peak resident set size increase of the process,
+which also covers native allocations. Latencies are measured without tracemalloc, memory in one extra traced call.
+
+With --baseline, results are compared against an earlier --output file, and the exit status is 1 when a stage got
+slower or used more memory than the baseline by more than --tolerance.
+"""
+
+import argparse
+import gc
+import json
+import os
+import platform
+import sys
+import tempfile
+import time
+import tracemalloc
+
+import numpy as np
+import texture_tool
+
+
+DTYPES = {
+    'uint8': np.uint8,
+    'uint16': np.uint16,
+    'float32': np.float32,
+}
+
+# memory below this is noise from the allocator and page granularity, it never counts as a regression
+MEMORY_SLACK = 1 << 20
+# same for latency, in milliseconds
+TIME_SLACK = 0.05
+
+
+def make_image(width, height, dtype, seed=0):
+    """RGBA image with gradients, rings and noise, the same for the same arguments. float32 images are HDR,
+    colour goes up to 16."""
+    y, x = np.mgrid[0:height, 0:width].astype(np.float32)
+    u = x / width
+    v = y / height
+    r = np.sqrt((u - 0.5) ** 2 + (v - 0.5) ** 2)
+    noise = np.random.RandomState(seed).random_sample((height, width)).astype(np.float32) - 0.5
+    img = np.stack([u, v, 0.5 + 0.5 * np.sin(r * 60.0), 1.0 - r], axis=-1)
+    img += 0.05 * noise[..., None]
+    np.clip(img, 0.0, 1.0, out=img)
+    if dtype == np.float32:
+        img[..., :3] *= 16.0
+        return img
+    return np.round(img * np.iinfo(dtype).max).astype(dtype)
+
+
+class Stage(object):
+    """prepare(width, height, dtype) returns a function without arguments that runs the stage once, and the number of
+    input pixels it processes. It returns None when the stage does not apply to the dtype."""
+    def __init__(self, name, prepare):
+        self.name = name
+        self.prepare = prepare
+
+
+def _texture(width, height, dtype, mipmaps=False):
+    texture = texture_tool.from_numpy(make_image(width, height, dtype))
+    if mipmaps:
+        texture = texture_tool.generate_mipmaps(texture)
+    return texture
+
+
+def _prepare_imread(width, height, dtype):
+    # imageio writes 8 bit RGBA PNG on every backend, other dtypes are not reliably supported
+    if dtype != np.uint8:
+        return None
+    import imageio
+    fd, path = tempfile.mkstemp(suffix='.png')
+    os.close(fd)
+    imageio.imwrite(path, make_image(width, height, dtype))
+    _temporary_files.append(path)
+    return lambda: texture_tool.imread(path), width * height
+
+
+def _prepare_from_numpy(width, height, dtype):
+    img = make_image(width, height, dtype)
+    return lambda: texture_tool.from_numpy(img), width * height
+
+
+def _prepare_generate_mipmaps(width, height, dtype):
+    texture = _texture(width, height, dtype)
+    return lambda: texture_tool.generate_mipmaps(texture), width * height
+
+
+def _prepare_transcode(format, channel_type, hdr):
+    def prepare(width, height, dtype):
+        if hdr != (dtype == np.float32):
+            return None
+        texture = _texture(width, height, dtype)
+        pixel_format = getattr(texture_tool.PixelFormat, format)
+        engine = 'native' if texture_tool.has_native_encoder(pixel_format) else 'pvrtexlib'
+        quality = texture_tool.Quality.Fastest if engine == 'pvrtexlib' else texture_tool.Quality.Normal
+        return lambda: texture_tool.transcode(texture, pixel_format, channel_type=channel_type, quality=quality,
+                                              engine=engine), width * height
+    return prepare
+
+
+def _prepare_cubemap(width, height, dtype):
+    # panorama has 2:1 aspect, with the same number of pixels as the other stages
+    panorama_width = int(np.sqrt(width * height * 2))
+    texture = _texture(panorama_width, panorama_width // 2, dtype)
+    return lambda: texture_tool.cubemap_from_equirectangular(texture), panorama_width * (panorama_width // 2)
+
+
+def _prepare_resize(filter):
+    def prepare(width, height, dtype):
+        texture = _texture(width, height, dtype)
+        return lambda: texture_tool.utils.resize(texture, width * 3 // 4, height * 3 // 4, filter=filter), \
+            width * height
+    return prepare
+
+
+def _prepare_util(function, *args):
+    def prepare(width, height, dtype):
+        texture = _texture(width, height, dtype)
+        return lambda: function(texture, *args), width * height
+    return prepare
+
+
+def _prepare_downsample2x(width, height, dtype):
+    img = make_image(width, height, dtype)
+    return lambda: texture_tool.downsample2x(img, 'bspline'), width * height
+
+
+STAGES = [
+    Stage('imread', _prepare_imread),
+    Stage('from_numpy', _prepare_from_numpy),
+    Stage('generate_mipmaps', _prepare_generate_mipmaps),
+    Stage('transcode.BC1', _prepare_transcode('DXT1', texture_tool.ChannelType.UnsignedByteNorm, False)),
+    Stage('transcode.BC7', _prepare_transcode('BC7', texture_tool.ChannelType.UnsignedByteNorm, False)),
+    Stage('transcode.ETC2_RGBA', _prepare_transcode('ETC2_RGBA', texture_tool.ChannelType.UnsignedByteNorm, False)),
+    Stage('transcode.BC6H', _prepare_transcode('BC6H', texture_tool.ChannelType.UnsignedFloat, True)),
+    Stage('cubemap_from_equirectangular', _prepare_cubemap),
+    Stage('utils.resize', _prepare_resize(None)),
+    Stage('utils.resize.lanczos3', _prepare_resize(texture_tool.Filter.Lanczos3)),
+    Stage('utils.flip', _prepare_util(texture_tool.utils.flip, texture_tool.Axis.y)),
+    Stage('utils.rotate90', _prepare_util(texture_tool.utils.rotate90, texture_tool.Axis.z, True)),
+    Stage('utils.premultiply_alpha', _prepare_util(texture_tool.utils.premultiply_alpha)),
+    Stage('downsample2x', _prepare_downsample2x),
+]
+
+_temporary_files = []
+
+
+def percentile(sorted_values, p):
+    """Linear interpolation between closest ranks, as numpy.percentile"""
+    position = (len(sorted_values) - 1) * p / 100.0
+    lower = int(position)
+    upper = min(lower + 1, len(sorted_values) - 1)
+    return sorted_values[lower] + (sorted_values[upper] - sorted_values[lower]) * (position - lower)
+
+
+def measure_memory(run):
+    """Peak of Python allocations and peak RSS increase during one call, in bytes. The RSS peak is None where it can
+    not be reset between calls"""
+    gc.collect()
+    can_reset = texture_tool.reset_peak_memory()
+    before = texture_tool.memory_stats()
+    tracemalloc.start()
+    try:
+        result = run()
+        _, python_peak = tracemalloc.get_traced_memory()
+    finally:
+        tracemalloc.stop()
+    after = texture_tool.memory_stats()
+    del result
+    native_peak = max(after['peak_rss'] - before['rss'], 0) if can_reset else None
+    return python_peak, native_peak, after['heap'] - before['heap']
+
+
+def run_stage(stage, width, height, dtype, repeat):
+    prepared = stage.prepare(width, height, dtype)
+    if prepared is None:
+        return None
+    run, pixels = prepared
+    # the first call pays for lazy initialisation, e.g. of PVRTexLib and thread pool
+    run()
+    times = []
+    for _ in range(repeat):
+        start = time.perf_counter()
+        run()
+        times.append(time.perf_counter() - start)
+    times.sort()
+    python_peak, native_peak, heap_delta = measure_memory(run)
+    p50 = percentile(times, 50)
+    return {
+        'stage': stage.name,
+        'size': '%dx%d' % (width, height),
+        'dtype': np.dtype(dtype).name,
+        'megapixels': pixels / 1e6,
+        'mpix_per_s': pixels / 1e6 / p50 if p50 > 0 else float('inf'),
+        'ms': {
+            'min': times[0] * 1e3,
+            'p50': p50 * 1e3,
+            'p90': percentile(times, 90) * 1e3,
+            'p99': percentile(times, 99) * 1e3,
+            'max': times[-1] * 1e3,
+        },
+        'python_peak_bytes': python_peak,
+        'native_peak_bytes': native_peak,
+        'heap_delta_bytes': heap_delta,
+    }
+
+
+def _key(result):
+    return result['stage'], result['size'], result['dtype']
+
+
+def compare(results, baseline, tolerance):
+    """Attaches 'baseline' ratios to results and returns the list of regression descriptions"""
+    previous = {_key(r): r for r in baseline['results']}
+    regressions = []
+    for result in results:
+        old = previous.get(_key(result))
+        if old is None:
+            continue
+        time_ratio = result['ms']['p50'] / old['ms']['p50'] if old['ms']['p50'] > 0 else 1.0
+        comparison = {'time': time_ratio}
+        if result['ms']['p50'] > old['ms']['p50'] * (1.0 + tolerance) + TIME_SLACK:
+            regressions.append('%s %s %s: p50 %.2f ms -> %.2f ms (%+.0f%%)' % (
+                result['stage'], result['size'], result['dtype'], old['ms']['p50'], result['ms']['p50'],
+                (time_ratio - 1.0) * 100.0))
+        for field in ['python_peak_bytes', 'native_peak_bytes']:
+            new_value, old_value = result[field], old.get(field)
+            if new_value is None or old_value is None:
+                continue
+            comparison[field] = new_value / old_value if old_value > 0 else 1.0
+            if new_value > old_value * (1.0 + tolerance) + MEMORY_SLACK:
+                regressions.append('%s %s %s: %s %.1f MB -> %.1f MB' % (
+                    result['stage'], result['size'], result['dtype'], field, old_value / 2.0 ** 20,
+                    new_value / 2.0 ** 20))
+        result['baseline'] = comparison
+    return regressions
+
+
+def _format_mb(value):
+    return '-' if value is None else '%.1f' % (value / 2.0 ** 20)
+
+
+def print_table(results, out=sys.stdout):
+    columns = ['stage', 'size', 'dtype', 'MP/s', 'p50 ms', 'p90 ms', 'p99 ms', 'py MB', 'rss MB', 'vs base']
+    rows = []
+    for r in results:
+        comparison = r.get('baseline')
+        rows.append([
+            r['stage'], r['size'], r['dtype'], '%.1f' % r['mpix_per_s'],
+            '%.2f' % r['ms']['p50'], '%.2f' % r['ms']['p90'], '%.2f' % r['ms']['p99'],
+            _format_mb(r['python_peak_bytes']), _format_mb(r['native_peak_bytes']),
+            '%+.0f%%' % ((comparison['time'] - 1.0) * 100.0) if comparison else '-',
+        ])
+    widths = [max(len(str(x)) for x in column) for column in zip(columns, *rows)]
+    for row in [columns] + rows:
+        out.write('  '.join(str(x).ljust(w) if i < 3 else str(x).rjust(w)
+                            for i, (x, w) in enumerate(zip(row, widths))) + '\n')
+    out.flush()
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(prog='python -m texture_tool.bench', description=__doc__.split('\n\n')[0])
+    parser.add_argument('--size', type=int, nargs='+', default=[1024], help='side of square images, in pixels')
+    parser.add_argument('--dtype', nargs='+', default=['uint8', 'float32'], choices=sorted(DTYPES))
+    parser.add_argument('--repeat', type=int, default=10, help='timed calls of each stage')
+    parser.add_argument('--stages', nargs='+', default=None,
+                        help='stages to run, prefixes match, e.g. "transcode". All by default: ' +
+                             ', '.join(s.name for s in STAGES))
+    parser.add_argument('--output', help='writes results as JSON, can later be passed as --baseline')
+    parser.add_argument('--baseline', help='JSON written by --output to compare against')
+    parser.add_argument('--tolerance', type=float, default=0.1,
+                        help='relative increase of p50 latency or peak memory that counts as a regression')
+    args = parser.parse_args(argv)
+
+    stages = STAGES
+    if args.stages:
+        stages = [s for s in STAGES if any(s.name == x or s.name.startswith(x + '.') for x in args.stages)]
+        if not stages:
+            parser.error('no stages match %s' % ' '.join(args.stages))
+
+    results = []
+    try:
+        for size in args.size:
+            for dtype_name in args.dtype:
+                for stage in stages:
+                    result = run_stage(stage, size, size, DTYPES[dtype_name], args.repeat)
+                    if result is not None:
+                        results.append(result)
+                        sys.stderr.write('%s %s %s: %.2f ms\n' % (stage.name, result['size'], dtype_name,
+                                                                  result['ms']['p50']))
+    finally:
+        for path in _temporary_files:
+            os.remove(path)
+        del _temporary_files[:]
+
+    regressions = []
+    if args.baseline:
+        with open(args.baseline) as f:
+            regressions = compare(results, json.load(f), args.tolerance)
+
+    print_table(results)
+
+    if args.output:
+        document = {
+            'context': {
+                'date': time.strftime('%Y-%m-%dT%H:%M:%S'),
+                'python': platform.python_version(),
+                'numpy': np.__version__,
+                'platform': platform.platform(),
+                'cpu_count': os.cpu_count(),
+                'repeat': args.repeat,
+            },
+            'results': results,
+        }
+        with open(args.output, 'w') as f:
+            json.dump(document, f, indent=2)
+
+    if regressions:
+        sys.stdout.write('\n%d regression(s) against %s:\n' % (len(regressions), args.baseline))
+        for regression in regressions:
+            sys.stdout.write('  ' + regression + '\n')
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -15,7 +15,6 @@
 
 import scipy.ndimage
 import numpy as np
-import warnings
 import texture_tool
 
 
@@ -73,16 +72,29 @@ def _downsample2x_bspline(input, order=3):
     return np.stack(r, axis=-1)
 
 
+def _cast_like_scipy(output, dtype):
+    # zoom_shift rounds integer outputs half away from zero
+    dtype = np.dtype(dtype)
+    if np.issubdtype(dtype, np.integer):
+        info = np.iinfo(dtype)
+        output = np.clip(np.trunc(output + np.where(output > 0, 0.5, -0.5)), info.min, info.max)
+    return output.astype(dtype)
+
+
 def downsample2x(input, type):
-    if not texture_tool.is_power_of_two(input.shape[:-1]):
-        if type == 'area_average':
-            warnings.warn("area_average is not permitted for generating mipmaps for non power of two images. "
-                          "Forcing bspline instead", UserWarning)
-            type = 'bspline'
+    """Halves every dimension of a texture or of an [H, W, C] or [D, H, W, C] array, odd sizes included.
 
-    if type == 'area_average':
-        return _downsample2x_area_average(input)
-    elif type == 'bspline':
-        return _downsample2x_bspline(input)
-    else:
+    type is 'area_average' or 'bspline'. Textures give a texture of the same format. For arrays, area_average gives
+    float32 and bspline gives the dtype of the input, as the Python implementations above do (area_average of those
+    returns float64 and requires even sizes).
+    """
+    if type not in ('area_average', 'bspline'):
         raise RuntimeError('Unknown downscaling algorithm')
+    if isinstance(input, texture_tool.PVRTexture):
+        return texture_tool.downsample2x_native(input, type)
+
+    input = np.asarray(input)
+    output = texture_tool.downsample2x_native(input, type)
+    if type == 'bspline' and input.dtype != output.dtype:
+        output = _cast_like_scipy(output, input.dtype)
+    return output
@@ -28,10 +28,8 @@ def imread(filename):
         raise RuntimeError('Wrong shape, must be 3-dimensional for 2D textures and 4-dimensional for 3D textures')
     if img.shape[-1] > 4:
         raise RuntimeError('Wrong number of channels. Expected 1, 2, 3 or 4, but got %f' % img.shape[-1])
-    if img.shape[-1] == 1:
-        img = np.concatenate([img, np.zeros_like(img[:, :, :1])], axis=2)
-    if img.shape[-1] == 2:
-        img = np.concatenate([img, np.zeros_like(img[:, :, :1])], axis=2)
-    if img.shape[-1] == 3:
-        img = np.concatenate([img, 255 * np.ones_like(img[:, :, :1])], axis=2)
-    return texture_tool.from_numpy(img)
+    # channels are padded to rgba while copying into the texture: zeros for colour, maximum value for alpha,
+    # that is 255 for 8 bit, 65535 for 16 bit and 1.0 for float images
+    layout = 'rgba' + str(img.dtype.itemsize * 8) * 4
+    # img is not referenced anywhere else, so texture can use its memory instead of copying it
+    return texture_tool.from_numpy(img, copy=False, layout=layout)
@@ -16,7 +16,7 @@
 import texture_tool
 
 
-def transcode(texture, format, channel_type=None, colour_space=None, quality=texture_tool.Quality.Normal, dither=False):
+def transcode(texture, format, channel_type=None, colour_space=None, quality=texture_tool.Quality.Normal, dither=False, engine='pvrtexlib'):
     newtex = texture_tool.copy(texture)
     if isinstance(format, str):
         if format in texture_tool.PixelFormat.__entries:
@@ -27,7 +27,7 @@ def transcode(texture, format, channel_type=None, colour_space=None, quality=tex
         channel_type = texture.channel_type
     if colour_space is None:
         colour_space = texture.colour_space
-    res = texture_tool.inplace_transcode(newtex, format, channel_type, colour_space, quality, dither)
+    res = texture_tool.inplace_transcode(newtex, format, channel_type, colour_space, quality, dither, engine)
     if not res:
         raise RuntimeError('Operation failed')
     return newtex
@@ -16,10 +16,14 @@
 import texture_tool
 
 
-def resize(texture, width, height, depth=1, resize_mode=texture_tool.ResizeMode.Cubic):
+def resize(texture, width, height, depth=1, resize_mode=texture_tool.ResizeMode.Cubic, filter=None, gamma=2.2):
+    """With filter, e.g. texture_tool.Filter.Lanczos3, the texture is resampled natively in linear space and
+    mipmaps are resized as well. Otherwise PVRTexLib resizes it with resize_mode."""
+    if filter is not None:
+        return texture_tool.resize_native(texture, width, height, depth, filter, gamma, texture.colour_space)
     if texture.num_mip_levels > 1:
         raise RuntimeError('"resize" operation is not permitted on texture with mipmap layers. '
-                           'Generate mipmaps after all transformations are done.')
+                           'Generate mipmaps after all transformations are done, or pass filter to resize natively.')
     newtex = texture_tool.copy(texture)
     res = texture_tool.inplace_resize(newtex, width, height, depth, resize_mode)
     if not res:
@@ -44,20 +48,18 @@ def rotate90(texture, axis, forward):
 
 
 def flip(texture, axis=texture_tool.Axis.y):
+    """Cubemaps are mirrored as a whole environment: the two faces on the axis are exchanged and every face is
+    flipped. For Axis.z on cubemaps of depth 1 that means the X faces are flipped horizontally, the Y faces
+    vertically and the exchanged Z faces horizontally."""
     newtex = texture_tool.copy(texture)
+    if newtex.num_faces == 6:
+        texture_tool.inplace_flip_cubemap(newtex, axis)
+        return newtex
     res = texture_tool.inplace_flip(newtex, axis)
     if not res:
         raise RuntimeError('Operation failed')
     orientation = newtex.get_orientation(axis)
     newtex.set_orientation(axis, not orientation)
-    if newtex.num_faces == 6:
-        v1 = texture_tool.view(newtex, 0, 2)
-        v2 = texture_tool.view(newtex, 0, 3)
-        v1_ = v1 + 0
-        v2_ = v2 + 0
-        v2[:] = v1_
-        v1[:] = v2_
-
     return newtex
 
 